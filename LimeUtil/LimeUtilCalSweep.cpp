@@ -98,7 +98,9 @@ int deviceCalSweep(
             for (int i = 0; i < LMS_GetNumChannels(device, LMS_CH_TX); i++)
                 LMS_SetAntenna(device, LMS_CH_TX, i, path);
 
-            //iterate through the matrix of channel options
+            //tune every channel in the matrix, then calibrate them together
+            //so that channels of different chips are calibrated concurrently
+            std::vector<lms_calib_request_t> requests;
             for (const auto chanConfig : channelMatrix)
             {
                 if (LMS_SetLOFrequency(device, chanConfig.first, chanConfig.second, freq) != 0)
@@ -106,11 +108,21 @@ int deviceCalSweep(
                     std::cerr << "Error tuning (skipping): " << LMS_GetLastErrorMessage() << std::endl;
                     continue;
                 }
-                if (LMS_Calibrate(device, chanConfig.first, chanConfig.second, bw, 0) != 0)
-                {
-                    std::cerr << "Error calibrating (skipping): " << LMS_GetLastErrorMessage() << std::endl;
-                    continue;
-                }
+                lms_calib_request_t request = {};
+                request.dir_tx = chanConfig.first;
+                request.chan = chanConfig.second;
+                request.bw = bw;
+                requests.push_back(request);
+            }
+            if (requests.empty())
+                continue;
+            if (LMS_CalibrateMultiple(device, requests.data(), requests.size()) != 0)
+                std::cerr << "Error calibrating (skipping): " << LMS_GetLastErrorMessage() << std::endl;
+            for (const auto &request : requests)
+            {
+                std::cout << (request.dir_tx ? "Tx" : "Rx") << request.chan << " path " << path
+                          << ": " << (request.status == 0 ? "OK" : "FAILED")
+                          << " (" << request.duration << " s)" << std::endl;
             }
         }
         std::cout << std::endl;
@@ -27,6 +27,8 @@ struct IConnectionStream
     size_t elemSize;
     size_t elemMTU;
     bool skipCal;
+    bool directAccess; //native format, FIFO memory can be exposed
+    size_t numAcquired; //elements of acquired read buffer
 
     //rx cmd requests
     bool hasCmd;
@@ -95,6 +97,101 @@ SoapySDR::ArgInfoList SoapyLMS7::getStreamArgsInfo(const int direction, const si
         argInfos.push_back(info);
     }
 
+    //float scaling
+    {
+        SoapySDR::ArgInfo info;
+        info.value = "32767";
+        info.key = "fullScale";
+        info.name = "Full Scale";
+        info.description = "Integer sample value corresponding to 1.0 in CF32 format.";
+        info.type = SoapySDR::ArgInfo::FLOAT;
+        argInfos.push_back(info);
+    }
+
+    //lock-free fifo
+    {
+        SoapySDR::ArgInfo info;
+        info.value = "false";
+        info.key = "lockFreeFifo";
+        info.name = "Lock-free FIFO";
+        info.description = "Use single producer/single consumer lock-free sample FIFO.";
+        info.type = SoapySDR::ArgInfo::BOOL;
+        argInfos.push_back(info);
+    }
+
+    //transfer sizing
+    {
+        SoapySDR::ArgInfo info;
+        info.value = "static";
+        info.key = "transferPolicy";
+        info.name = "Transfer Policy";
+        info.description = "Runtime adjustment of USB transfer count and size.";
+        info.type = SoapySDR::ArgInfo::STRING;
+        info.options = {"static", "latency", "throughput", "auto"};
+        argInfos.push_back(info);
+    }
+
+    //streaming thread scheduling
+    {
+        SoapySDR::ArgInfo info;
+        info.value = "0";
+        info.key = "threadPriority";
+        info.name = "Thread Priority";
+        info.description = "Realtime priority (1-99) of the streaming thread, 0 - default scheduling.";
+        info.type = SoapySDR::ArgInfo::INT;
+        argInfos.push_back(info);
+    }
+    {
+        SoapySDR::ArgInfo info;
+        info.value = "0";
+        info.key = "cpuAffinity";
+        info.name = "CPU Affinity";
+        info.description = "Bit mask of CPUs for the streaming thread (e.g. 0x4), 0 - any CPU.";
+        info.type = SoapySDR::ArgInfo::STRING;
+        argInfos.push_back(info);
+    }
+    {
+        SoapySDR::ArgInfo info;
+        info.value = "false";
+        info.key = "numaLocal";
+        info.name = "NUMA Local Buffers";
+        info.description = "Allocate stream buffers on the NUMA node of cpuAffinity CPUs.";
+        info.type = SoapySDR::ArgInfo::BOOL;
+        argInfos.push_back(info);
+    }
+
+    //stream memory
+    {
+        SoapySDR::ArgInfo info;
+        info.value = "false";
+        info.key = "hugePages";
+        info.name = "Huge Pages";
+        info.description = "Back stream buffers with huge pages.";
+        info.type = SoapySDR::ArgInfo::BOOL;
+        argInfos.push_back(info);
+    }
+    {
+        SoapySDR::ArgInfo info;
+        info.value = "false";
+        info.key = "lockMemory";
+        info.name = "Lock Memory";
+        info.description = "Lock stream buffers in RAM.";
+        info.type = SoapySDR::ArgInfo::BOOL;
+        argInfos.push_back(info);
+    }
+
+    //zero-copy rx
+    if (direction == SOAPY_SDR_RX)
+    {
+        SoapySDR::ArgInfo info;
+        info.value = "false";
+        info.key = "zeroCopy";
+        info.name = "Zero-copy Rx";
+        info.description = "Decode received transfers directly into readStream() buffers instead of using Rx thread.";
+        info.type = SoapySDR::ArgInfo::BOOL;
+        argInfos.push_back(info);
+    }
+
     return argInfos;
 }
 
@@ -113,12 +210,38 @@ SoapySDR::Stream *SoapyLMS7::setupStream(
     stream->direction = direction;
     stream->elemSize = SoapySDR::formatToSize(format);
     stream->hasCmd = false;
+    stream->directAccess = (format == SOAPY_SDR_CS16);
+    stream->numAcquired = 0;
     stream->skipCal = args.count("skipCal") != 0 and args.at("skipCal") == "true";
 
     StreamConfig config;
     config.isTx = (direction == SOAPY_SDR_TX);
     config.performanceLatency = 0.5;
     config.bufferLength = 0; //auto
+    if (args.count("lockFreeFifo") != 0 and args.at("lockFreeFifo") == "true")
+        config.fifoType = StreamConfig::FIFO_LOCKFREE;
+    if (args.count("fullScale") != 0)
+        config.fullScale = std::stof(args.at("fullScale"));
+    if (args.count("zeroCopy") != 0 and args.at("zeroCopy") == "true")
+        config.zeroCopy = !config.isTx;
+    if (args.count("transferPolicy") != 0)
+    {
+        const std::string &policy = args.at("transferPolicy");
+        if (policy == "latency") config.transferPolicy = StreamConfig::TRANSFER_LATENCY;
+        else if (policy == "throughput") config.transferPolicy = StreamConfig::TRANSFER_THROUGHPUT;
+        else if (policy == "auto") config.transferPolicy = StreamConfig::TRANSFER_AUTO;
+        else if (policy != "static") throw std::runtime_error("SoapyLMS7::setupStream(transferPolicy="+policy+") unsupported policy");
+    }
+    if (args.count("threadPriority") != 0)
+        config.threadPriority = std::stoi(args.at("threadPriority"));
+    if (args.count("cpuAffinity") != 0)
+        config.cpuAffinity = std::stoull(args.at("cpuAffinity"), nullptr, 0);
+    if (args.count("numaLocal") != 0 and args.at("numaLocal") == "true")
+        config.numaLocal = true;
+    if (args.count("hugePages") != 0 and args.at("hugePages") == "true")
+        config.hugePages = true;
+    if (args.count("lockMemory") != 0 and args.at("lockMemory") == "true")
+        config.lockMemory = true;
 
     //default to channel 0, if none were specified
     const std::vector<size_t> &channelIDs = channels.empty() ? std::vector<size_t>{0} : channels;
@@ -247,16 +370,6 @@ int SoapyLMS7::deactivateStream(
 /*******************************************************************
  * Stream alignment helper for multiple channels
  ******************************************************************/
-static inline void fastForward(
-    char *buff, size_t &numWritten, const size_t elemSize,
-    const uint64_t oldHeadTime, const uint64_t desiredHeadTime)
-{
-    const size_t numPop = std::min<size_t>(desiredHeadTime - oldHeadTime, numWritten);
-    const size_t numMove = (numWritten-numPop);
-    numWritten -= numPop;
-    std::memmove(buff, buff+(numPop*elemSize), numMove*elemSize);
-}
-
 int SoapyLMS7::_readStreamAligned(
     IConnectionStream *stream,
     char * const *buffs,
@@ -266,61 +379,15 @@ int SoapyLMS7::_readStreamAligned(
     const long timeoutMs)
 {
     const auto &streamID = stream->streamID;
-    const size_t elemSize = stream->elemSize;
-    std::vector<size_t> numWritten(streamID.size(), 0);
-
-    for (size_t i = 0; i < streamID.size(); i += (numWritten[i]==numElems)?1:0)
-    {
-        size_t &N = numWritten[i];
-        const uint64_t expectedTime(requestTime + N);
-
-        int status = streamID[i]->Read(buffs[i]+(elemSize*N), numElems-N,&md, timeoutMs);
-        if (status == 0) return SOAPY_SDR_TIMEOUT;
-        if (status < 0) return SOAPY_SDR_STREAM_ERROR;
-
-        //update accounting
-        const size_t elemsRead = size_t(status);
-        const size_t prevN = N;
-        N += elemsRead; //num written total
-
-        //unspecified request time, set the new head condition
-        if (requestTime == 0) goto updateHead;
-
-        //good contiguous read, read again for remainder
-        if (expectedTime == md.timestamp) continue;
-
-        //request time is later, fast forward buffer
-        if (md.timestamp < expectedTime)
-        {
-            if (prevN != 0)
-            {
-                SoapySDR::log(SOAPY_SDR_ERROR, "readStream() experienced non-monotonic timestamp");
-                return SOAPY_SDR_CORRUPTION;
-            }
-            fastForward(buffs[i], N, elemSize, md.timestamp, requestTime);
-            if (i == 0 and N != 0) numElems = N; //match size on other channels
-            continue; //read again into the remaining buffer
-        }
-
-        //overflow in the middle of a contiguous buffer
-        //fast-forward all prior channels and restart loop
-        if (md.timestamp > expectedTime)
-        {
-            for (size_t j = 0; j < i; j++)
-            {
-                fastForward(buffs[j], numWritten[j], elemSize, requestTime, md.timestamp);
-            }
-            fastForward(buffs[i], N, elemSize, md.timestamp-prevN, md.timestamp);
-            i = 0; //start over at ch0
-        }
-
-        updateHead:
-        requestTime = md.timestamp;
-        numElems = elemsRead;
-    }
 
+    //unspecified request time, start from the oldest aligned samples
     md.timestamp = requestTime;
-    return int(numElems);
+    md.flags = (requestTime != 0) ? RingFIFO::SYNC_TIMESTAMP : 0;
+
+    int status = StreamChannel::ReadAligned(streamID.data(), streamID.size(), (void * const *)buffs, numElems, &md, timeoutMs);
+    if (status == 0) return SOAPY_SDR_TIMEOUT;
+    if (status < 0) return SOAPY_SDR_STREAM_ERROR;
+    return status;
 }
 
 /*******************************************************************
@@ -488,3 +555,165 @@ int SoapyLMS7::readStreamStatus(
     flags |= SOAPY_SDR_HAS_TIME;
     return ret;
 }
+
+/*******************************************************************
+ * Direct buffer access API
+ ******************************************************************/
+size_t SoapyLMS7::getNumDirectAccessBuffers(SoapySDR::Stream *stream)
+{
+    auto icstream = (IConnectionStream *)stream;
+    return icstream->directAccess ? 1 : 0;
+}
+
+int SoapyLMS7::acquireReadBuffer(
+    SoapySDR::Stream *stream,
+    size_t &handle,
+    const void **buffs,
+    int &flags,
+    long long &timeNs,
+    const long timeoutUs)
+{
+    auto icstream = (IConnectionStream *)stream;
+    const auto &streamID = icstream->streamID;
+    if (not icstream->directAccess) return SOAPY_SDR_NOT_SUPPORTED;
+
+    const auto exitTime = std::chrono::high_resolution_clock::now() + std::chrono::microseconds(timeoutUs);
+
+    //wait for a command from activate stream up to the timeout specified
+    if (not icstream->hasCmd)
+    {
+        while (std::chrono::high_resolution_clock::now() < exitTime)
+        {
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        }
+        return SOAPY_SDR_TIMEOUT;
+    }
+
+    const uint64_t cmdTicks = ((icstream->flags & SOAPY_SDR_HAS_TIME) != 0)?SoapySDR::timeNsToTicks(icstream->timeNs, sampleRate):0;
+    std::vector<StreamChannel::Metadata> md(streamID.size());
+    std::vector<int> numElems(streamID.size(), 0);
+
+    //acquire each channel and drop samples until all of them start at the same time
+    for (size_t i = 0; i < streamID.size();)
+    {
+        const auto timeLeft = std::chrono::duration_cast<std::chrono::milliseconds>(exitTime - std::chrono::high_resolution_clock::now()).count();
+        int status = streamID[i]->AcquireBuffer((void**)&buffs[i], &md[i], std::max<long long>(timeLeft, 0));
+        if (status == 0) return SOAPY_SDR_TIMEOUT;
+        if (status < 0) return SOAPY_SDR_STREAM_ERROR;
+        numElems[i] = status;
+
+        const uint64_t headTime = std::max(cmdTicks, md[0].timestamp);
+        if (md[i].timestamp < headTime) //fast forward to the head time
+        {
+            streamID[i]->ReleaseBuffer(std::min<uint64_t>(headTime - md[i].timestamp, status));
+            continue;
+        }
+        if (i != 0 and md[i].timestamp > headTime) //overflow on this channel, start over at ch0
+        {
+            streamID[i]->ReleaseBuffer(0);
+            streamID[0]->ReleaseBuffer(std::min<uint64_t>(md[i].timestamp - md[0].timestamp, numElems[0]));
+            for (size_t j = 1; j < i; j++)
+                streamID[j]->ReleaseBuffer(0);
+            i = 0;
+            continue;
+        }
+        i++;
+    }
+    size_t numRead = *std::min_element(numElems.begin(), numElems.end());
+    StreamChannel::Metadata &metadata = md[0];
+
+    //the command had a time, so we need to compare it to received time
+    if ((icstream->flags & SOAPY_SDR_HAS_TIME) != 0 and (metadata.flags & RingFIFO::SYNC_TIMESTAMP) != 0)
+    {
+        //our request time is now late, clear command and return error code
+        if (cmdTicks < metadata.timestamp)
+        {
+            for (auto i : streamID)
+                i->ReleaseBuffer(0);
+            icstream->hasCmd = false;
+            return SOAPY_SDR_TIME_ERROR;
+        }
+        icstream->flags &= ~SOAPY_SDR_HAS_TIME; //clear for next read
+    }
+
+    //handle finite burst request commands
+    if (icstream->numElems != 0)
+    {
+        numRead = std::min<size_t>(numRead, icstream->numElems);
+        icstream->numElems -= numRead;
+        if (icstream->numElems == 0)
+        {
+            icstream->hasCmd = false;
+            metadata.flags |= RingFIFO::END_BURST;
+        }
+    }
+
+    //output metadata
+    handle = 0;
+    icstream->numAcquired = numRead;
+    flags = 0;
+    if ((metadata.flags & RingFIFO::END_BURST) != 0) flags |= SOAPY_SDR_END_BURST;
+    if ((metadata.flags & RingFIFO::SYNC_TIMESTAMP) != 0) flags |= SOAPY_SDR_HAS_TIME;
+    timeNs = SoapySDR::ticksToTimeNs(metadata.timestamp, sampleRate);
+    return int(numRead);
+}
+
+void SoapyLMS7::releaseReadBuffer(
+    SoapySDR::Stream *stream,
+    const size_t handle)
+{
+    auto icstream = (IConnectionStream *)stream;
+    for (auto i : icstream->streamID)
+        i->ReleaseBuffer(icstream->numAcquired);
+    icstream->numAcquired = 0;
+}
+
+int SoapyLMS7::acquireWriteBuffer(
+    SoapySDR::Stream *stream,
+    size_t &handle,
+    void **buffs,
+    const long timeoutUs)
+{
+    auto icstream = (IConnectionStream *)stream;
+    const auto &streamID = icstream->streamID;
+    if (not icstream->directAccess) return SOAPY_SDR_NOT_SUPPORTED;
+
+    //acquire the 0th channel: get the number of samples available
+    StreamChannel::Metadata metadata;
+    int status = streamID[0]->AcquireBuffer(&buffs[0], &metadata, timeoutUs/1000);
+    if (status == 0) return SOAPY_SDR_TIMEOUT;
+    if (status < 0) return SOAPY_SDR_STREAM_ERROR;
+
+    //acquire subsequent channels with large timeout, their FIFOs are filled in lockstep
+    for (size_t i = 1; i < streamID.size(); i++)
+    {
+        int status_i = streamID[i]->AcquireBuffer(&buffs[i], &metadata, 1000/*1s*/);
+        if (status_i <= 0)
+        {
+            SoapySDR::logf(SOAPY_SDR_ERROR, "Multi-channel stream alignment failed!");
+            return SOAPY_SDR_CORRUPTION;
+        }
+        status = std::min(status, status_i);
+    }
+    handle = 0;
+    return status;
+}
+
+void SoapyLMS7::releaseWriteBuffer(
+    SoapySDR::Stream *stream,
+    const size_t handle,
+    const size_t numElems,
+    int &flags,
+    const long long timeNs)
+{
+    auto icstream = (IConnectionStream *)stream;
+
+    //input metadata
+    StreamChannel::Metadata metadata;
+    metadata.timestamp = SoapySDR::timeNsToTicks(timeNs, sampleRate);
+    metadata.flags = (flags & SOAPY_SDR_HAS_TIME) ? lime::RingFIFO::SYNC_TIMESTAMP : 0;
+    metadata.flags |= (flags & SOAPY_SDR_END_BURST) ? lime::RingFIFO::END_BURST : 0;
+
+    for (auto i : icstream->streamID)
+        i->ReleaseBuffer(numElems, &metadata);
+}
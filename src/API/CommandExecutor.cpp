@@ -0,0 +1,114 @@
+/**
+@file CommandExecutor.cpp
+@author Lime Microsystems
+@brief Queue executing device control commands on a worker thread
+*/
+
+#include "CommandExecutor.h"
+#include <chrono>
+
+using namespace lime;
+
+CommandExecutor::CommandExecutor() :
+    mBusy(false),
+    mTerminate(false)
+{
+}
+
+CommandExecutor::~CommandExecutor()
+{
+    {
+        std::lock_guard<std::mutex> lock(mLock);
+        mTerminate = true;
+    }
+    mQueueChanged.notify_all();
+    if (mWorker.joinable())
+        mWorker.join();
+}
+
+std::shared_future<int> CommandExecutor::Submit(uint64_t key, const Command &command, const Callback &callback)
+{
+    Item item;
+    item.key = key;
+    item.command = command;
+
+    std::unique_lock<std::mutex> lock(mLock);
+    if (key != 0)
+    {
+        for (auto iter = mQueue.begin(); iter != mQueue.end(); ++iter)
+        {
+            if (iter->key != key)
+                continue;
+            //newer value supersedes pending one, it is moved to the end to
+            //keep ordering relative to commands submitted in between
+            item.callbacks.swap(iter->callbacks);
+            item.promise = iter->promise;
+            item.future = iter->future;
+            mQueue.erase(iter);
+            break;
+        }
+    }
+    if (!item.promise)
+    {
+        item.promise = std::make_shared<std::promise<int> >();
+        item.future = item.promise->get_future().share();
+    }
+    if (callback)
+        item.callbacks.push_back(callback);
+    std::shared_future<int> future = item.future;
+    mQueue.push_back(std::move(item));
+
+    if (!mWorker.joinable())
+        mWorker = std::thread(&CommandExecutor::WorkerLoop, this);
+    lock.unlock();
+    mQueueChanged.notify_one();
+    return future;
+}
+
+bool CommandExecutor::Flush(int timeout_ms)
+{
+    std::unique_lock<std::mutex> lock(mLock);
+    auto idle = [this]{ return mQueue.empty() && !mBusy; };
+    if (timeout_ms < 0)
+    {
+        mIdle.wait(lock, idle);
+        return true;
+    }
+    return mIdle.wait_for(lock, std::chrono::milliseconds(timeout_ms), idle);
+}
+
+size_t CommandExecutor::Pending()
+{
+    std::lock_guard<std::mutex> lock(mLock);
+    return mQueue.size() + (mBusy ? 1 : 0);
+}
+
+void CommandExecutor::WorkerLoop()
+{
+    std::unique_lock<std::mutex> lock(mLock);
+    while (true)
+    {
+        mQueueChanged.wait(lock, [this]{ return mTerminate || !mQueue.empty(); });
+        //remaining commands are executed before terminating
+        if (mQueue.empty())
+            break;
+        Item item = std::move(mQueue.front());
+        mQueue.pop_front();
+        mBusy = true;
+        lock.unlock();
+
+        int status;
+        {
+            std::lock_guard<std::recursive_mutex> device(mDeviceLock);
+            status = item.command();
+        }
+        item.promise->set_value(status);
+        for (auto &callback : item.callbacks)
+            callback(status);
+
+        lock.lock();
+        mBusy = false;
+        if (mQueue.empty())
+            mIdle.notify_all();
+    }
+}
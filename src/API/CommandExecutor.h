@@ -0,0 +1,95 @@
+/**
+@file CommandExecutor.h
+@author Lime Microsystems
+@brief Queue executing device control commands on a worker thread
+*/
+
+#ifndef LMS7_COMMAND_EXECUTOR_H
+#define LMS7_COMMAND_EXECUTOR_H
+
+#include <stdint.h>
+#include <functional>
+#include <future>
+#include <memory>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <deque>
+#include <vector>
+
+namespace lime
+{
+
+/** @brief Serializes control commands of a device on a worker thread
+
+    Commands are executed in submission order, so the caller does not wait
+    for control port transfers. Commands with the same non zero key change
+    the same setting, a pending command is dropped when a newer one with the
+    same key is submitted and its waiters get the result of the newer one.
+*/
+class CommandExecutor
+{
+public:
+    typedef std::function<int()> Command;
+    typedef std::function<void(int status)> Callback;
+
+    //! @brief Key identifying setting of given channel, 0 is never coalesced
+    static uint64_t MakeKey(unsigned setting, bool tx, unsigned chan) {
+        return (uint64_t(setting) << 32) | (uint64_t(tx) << 31) | chan;
+    }
+
+    CommandExecutor();
+    //! @brief Executes commands still in queue and stops worker thread
+    ~CommandExecutor();
+
+    /** @brief Adds command to the queue
+        @param key setting changed by the command, 0 if it must not be dropped
+        @param command function executed on worker thread, returns status
+        @param callback called on worker thread with status after execution
+        @return future of command status
+    */
+    std::shared_future<int> Submit(uint64_t key, const Command &command, const Callback &callback = Callback());
+
+    /** @brief Waits until all submitted commands are executed
+        @param timeout_ms time limit, negative to wait indefinitely
+        @return true if queue was emptied in time
+    */
+    bool Flush(int timeout_ms = -1);
+
+    //! @brief Number of commands waiting for execution
+    size_t Pending();
+
+    /** @brief Locks the device for a synchronous call
+        Commands are executed while holding the same lock, so synchronous calls
+        run between queued commands instead of interleaving with them. The lock
+        is recursive, commands may use synchronous calls.
+    */
+    std::unique_lock<std::recursive_mutex> Lock() {
+        return std::unique_lock<std::recursive_mutex>(mDeviceLock);
+    }
+
+private:
+    struct Item
+    {
+        uint64_t key;
+        Command command;
+        std::vector<Callback> callbacks;
+        std::shared_ptr<std::promise<int> > promise;
+        std::shared_future<int> future;
+    };
+
+    void WorkerLoop();
+
+    std::mutex mLock;
+    std::recursive_mutex mDeviceLock;
+    std::condition_variable mQueueChanged;
+    std::condition_variable mIdle;
+    std::deque<Item> mQueue;
+    bool mBusy;
+    bool mTerminate;
+    std::thread mWorker;
+};
+
+}
+
+#endif
@@ -0,0 +1,123 @@
+/**
+@file GFIRCache.cpp
+@author Lime Microsystems
+@brief Cache of GFIR coefficients designed for LPF configuration
+*/
+
+#include "GFIRCache.h"
+#include "Logger.h"
+#include <map>
+#include <algorithm>
+#include <mutex>
+#include <vector>
+#include <fstream>
+#include <sstream>
+#include <cmath>
+#include <cerrno>
+
+using namespace lime;
+
+namespace
+{
+
+struct Coefficients
+{
+    int16_t gfir1[GFIRCache::gfir1Length];
+    int16_t gfir2[GFIRCache::gfir2Length];
+};
+
+//entries are small, limit only guards against unbounded growth
+const size_t maxEntries = 4096;
+
+std::mutex cacheLock;
+std::map<GFIRCache::Key, Coefficients> cache;
+
+}
+
+GFIRCache::Key::Key(double bandwidth, double interfaceRate, int ratio, int taps) :
+    bandwidth(llround(bandwidth)),
+    interfaceRate(llround(interfaceRate)),
+    ratio(ratio),
+    taps(taps)
+{
+}
+
+bool GFIRCache::Lookup(const Key &key, int16_t* gfir1, int16_t* gfir2)
+{
+    std::lock_guard<std::mutex> lock(cacheLock);
+    auto iter = cache.find(key);
+    if (iter == cache.end())
+        return false;
+    std::copy(iter->second.gfir1, iter->second.gfir1 + gfir1Length, gfir1);
+    std::copy(iter->second.gfir2, iter->second.gfir2 + gfir2Length, gfir2);
+    return true;
+}
+
+void GFIRCache::Insert(const Key &key, const int16_t* gfir1, const int16_t* gfir2)
+{
+    std::lock_guard<std::mutex> lock(cacheLock);
+    if (cache.size() >= maxEntries && cache.find(key) == cache.end())
+        cache.erase(cache.begin());
+    Coefficients &entry = cache[key];
+    std::copy(gfir1, gfir1 + gfir1Length, entry.gfir1);
+    std::copy(gfir2, gfir2 + gfir2Length, entry.gfir2);
+}
+
+void GFIRCache::Clear()
+{
+    std::lock_guard<std::mutex> lock(cacheLock);
+    cache.clear();
+}
+
+int GFIRCache::Save(const std::string &filename)
+{
+    std::ofstream file(filename);
+    if (!file.is_open())
+        return lime::ReportError(errno, "GFIRCache: cannot write %s", filename.c_str());
+    file << "#bandwidth interfaceRate ratio taps gfir2[" << gfir2Length << "] gfir1[" << gfir1Length << "]\n";
+    std::lock_guard<std::mutex> lock(cacheLock);
+    for (const auto &entry : cache)
+    {
+        file << entry.first.bandwidth << " " << entry.first.interfaceRate << " "
+             << entry.first.ratio << " " << entry.first.taps;
+        for (int i = 0; i < gfir2Length; ++i)
+            file << " " << entry.second.gfir2[i];
+        for (int i = 0; i < gfir1Length; ++i)
+            file << " " << entry.second.gfir1[i];
+        file << "\n";
+    }
+    if (!file.good())
+        return lime::ReportError(EIO, "GFIRCache: failed to write %s", filename.c_str());
+    return 0;
+}
+
+int GFIRCache::Load(const std::string &filename)
+{
+    std::ifstream file(filename);
+    if (!file.is_open())
+        return lime::ReportError(errno, "GFIRCache: cannot read %s", filename.c_str());
+
+    std::vector<std::pair<Key, Coefficients> > entries;
+    std::string line;
+    while (std::getline(file, line))
+    {
+        if (line.empty() || line[0] == '#')
+            continue;
+        std::istringstream ss(line);
+        double bandwidth, interfaceRate;
+        int ratio, taps;
+        Coefficients coefs;
+        ss >> bandwidth >> interfaceRate >> ratio >> taps;
+        for (int i = 0; i < gfir2Length; ++i)
+            ss >> coefs.gfir2[i];
+        for (int i = 0; i < gfir1Length; ++i)
+            ss >> coefs.gfir1[i];
+        if (ss.fail())
+            return lime::ReportError(EINVAL, "GFIRCache: invalid line in %s", filename.c_str());
+        entries.emplace_back(Key(bandwidth, interfaceRate, ratio, taps), coefs);
+    }
+
+    for (const auto &entry : entries)
+        Insert(entry.first, entry.second.gfir1, entry.second.gfir2);
+    return 0;
+}
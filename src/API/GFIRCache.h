@@ -0,0 +1,61 @@
+/**
+@file GFIRCache.h
+@author Lime Microsystems
+@brief Cache of GFIR coefficients designed for LPF configuration
+*/
+
+#ifndef LMS7_GFIR_CACHE_H
+#define LMS7_GFIR_CACHE_H
+
+#include <stdint.h>
+#include <string>
+#include <tuple>
+
+namespace lime
+{
+
+/** @brief Process wide cache of designed GFIR coefficients
+
+    Filter design is done by least squares optimization, which is too slow to
+    be repeated on every sample rate or bandwidth change. Results are keyed by
+    design parameters and can be saved to and loaded from a text file, so that
+    coefficients for all used configurations can be prepared in advance.
+*/
+class GFIRCache
+{
+public:
+    struct Key
+    {
+        Key(double bandwidth, double interfaceRate, int ratio, int taps);
+        int64_t bandwidth;      //requested LPF bandwidth, Hz
+        int64_t interfaceRate;  //TSP reference clock, Hz
+        int ratio;              //HBI/HBD ratio register value
+        int taps;               //coefficients per output sample
+        bool operator<(const Key &other) const {
+            return std::tie(bandwidth, interfaceRate, ratio, taps) <
+                std::tie(other.bandwidth, other.interfaceRate, other.ratio, other.taps);
+        }
+    };
+
+    static const int gfir1Length = 120;
+    static const int gfir2Length = 40;
+
+    /** @brief Finds stored coefficients
+        @param key design parameters
+        @param gfir1 GFIR3 coefficients, gfir1Length values are written
+        @param gfir2 GFIR1 and GFIR2 coefficients, gfir2Length values are written
+        @return true if coefficients were found
+    */
+    static bool Lookup(const Key &key, int16_t* gfir1, int16_t* gfir2);
+    static void Insert(const Key &key, const int16_t* gfir1, const int16_t* gfir2);
+    static void Clear();
+
+    //! @brief Writes all cached coefficients to file
+    static int Save(const std::string &filename);
+    //! @brief Adds coefficients from file previously written by Save()
+    static int Load(const std::string &filename);
+};
+
+}
+
+#endif
@@ -117,6 +117,7 @@ int LMS7_LimeSDR_mini::SetFrequency(bool isTx, unsigned chan, double f_Hz)
         if (isTx || (!tdd))
             if (lms->SetFrequencySX(isTx, center) != 0)
                 return -1;
+        ApplyStoredCalibration(isTx, 0, center);
         return 0;
     };
 
@@ -9,6 +9,8 @@
 #include "Logger.h"
 #include "LMS64CProtocol.h"
 #include "Streamer.h"
+#include "GFIRCache.h"
+#include "CommandExecutor.h"
 
 using namespace std;
 
@@ -68,6 +70,7 @@ API_EXPORT int CALL_CONV LMS_Close(lms_device_t * device)
         lime::error("Device cannot be NULL.");
         return -1;
     }
+    //not locked, destructor executes queued commands which take the lock
     lime::LMS7_Device* lms = (lime::LMS7_Device*)device;
     delete lms;
     return LMS_SUCCESS;
@@ -81,6 +84,8 @@ API_EXPORT int CALL_CONV LMS_Disconnect(lms_device_t *device)
         lime::ReportError(EINVAL, "Device cannot be NULL.");
         return -1;
     }
+    lime::LMS7_Device* lms = (lime::LMS7_Device*)device;
+    auto deviceLock = lms->GetCommandExecutor()->Lock();
     return 0;
 }
 
@@ -91,6 +96,7 @@ API_EXPORT bool CALL_CONV LMS_IsOpen(lms_device_t *device, int port)
         return false;
 
     lime::LMS7_Device* lms = (lime::LMS7_Device*)device;
+    auto deviceLock = lms->GetCommandExecutor()->Lock();
 
     auto conn = lms->GetConnection();
     if (conn != nullptr)
@@ -109,6 +115,7 @@ API_EXPORT int CALL_CONV LMS_Reset(lms_device_t *device)
     }
 
     lime::LMS7_Device* lms = (lime::LMS7_Device*)device;
+    auto deviceLock = lms->GetCommandExecutor()->Lock();
     return lms->Reset();
 }
 
@@ -121,6 +128,7 @@ API_EXPORT int CALL_CONV LMS_EnableChannel(lms_device_t * device, bool dir_tx, s
     }
 
     lime::LMS7_Device* lms = (lime::LMS7_Device*)device;
+    auto deviceLock = lms->GetCommandExecutor()->Lock();
 
     return lms->EnableChannel(dir_tx, chan,enabled);
 }
@@ -134,6 +142,7 @@ API_EXPORT int CALL_CONV LMS_SetSampleRate(lms_device_t * device, float_type rat
     }
 
    lime::LMS7_Device* lms = (lime::LMS7_Device*)device;
+   auto deviceLock = lms->GetCommandExecutor()->Lock();
 
    return lms->SetRate(rate, oversample);
 }
@@ -147,6 +156,7 @@ API_EXPORT int CALL_CONV LMS_SetSampleRateDir(lms_device_t *device, bool dir_tx,
     }
 
     lime::LMS7_Device* lms = (lime::LMS7_Device*)device;
+    auto deviceLock = lms->GetCommandExecutor()->Lock();
 
     return lms->SetRate(dir_tx,rate,oversample);
 }
@@ -160,6 +170,7 @@ API_EXPORT int CALL_CONV LMS_GetSampleRate(lms_device_t *device, bool dir_tx, si
     }
 
     lime::LMS7_Device* lms = (lime::LMS7_Device*)device;
+    auto deviceLock = lms->GetCommandExecutor()->Lock();
 
     if (chan >= lms->GetNumChannels(dir_tx))
     {
@@ -184,6 +195,7 @@ API_EXPORT int CALL_CONV LMS_GetSampleRateRange(lms_device_t *device, bool dir_t
     }
 
     lime::LMS7_Device* lms = (lime::LMS7_Device*)device;
+    auto deviceLock = lms->GetCommandExecutor()->Lock();
     auto retRange = lms->GetRateRange(dir_tx);
     range->min = retRange.min;
     range->max = retRange.max;
@@ -199,6 +211,7 @@ API_EXPORT int CALL_CONV LMS_Init(lms_device_t * device)
     }
 
     lime::LMS7_Device* lms = (lime::LMS7_Device*)device;
+    auto deviceLock = lms->GetCommandExecutor()->Lock();
 
     return lms->Init();
 }
@@ -212,6 +225,7 @@ API_EXPORT int CALL_CONV LMS_ReadCustomBoardParam(lms_device_t *device,
         return -1;
     }
     lime::LMS7_Device* lms = (lime::LMS7_Device*)device;
+    auto deviceLock = lms->GetCommandExecutor()->Lock();
     std::string str;
     auto conn = lms->GetConnection();
     if (conn == nullptr)
@@ -233,6 +247,7 @@ API_EXPORT int CALL_CONV LMS_WriteCustomBoardParam(lms_device_t *device,
         return -1;
     }
     lime::LMS7_Device* lms = (lime::LMS7_Device*)device;
+    auto deviceLock = lms->GetCommandExecutor()->Lock();
     auto conn = lms->GetConnection();
     if (conn == nullptr)
     {
@@ -245,11 +260,25 @@ API_EXPORT int CALL_CONV LMS_WriteCustomBoardParam(lms_device_t *device,
 
 API_EXPORT int CALL_CONV LMS_VCTCXOWrite(lms_device_t * device, uint16_t val)
 {
+    if (device == nullptr)
+    {
+        lime::ReportError(EINVAL, "Device cannot be NULL.");
+        return -1;
+    }
+    lime::LMS7_Device* lms = (lime::LMS7_Device*)device;
+    auto deviceLock = lms->GetCommandExecutor()->Lock();
     return LMS_WriteCustomBoardParam(device, 0, val, "");
 }
 
 API_EXPORT int CALL_CONV LMS_VCTCXORead(lms_device_t * device, uint16_t *val)
 {
+    if (device == nullptr)
+    {
+        lime::ReportError(EINVAL, "Device cannot be NULL.");
+        return -1;
+    }
+    lime::LMS7_Device* lms = (lime::LMS7_Device*)device;
+    auto deviceLock = lms->GetCommandExecutor()->Lock();
     lms_name_t units;
     double dval = 0.0;
     int ret= LMS_ReadCustomBoardParam(device, 0, &dval, units);
@@ -265,6 +294,7 @@ API_EXPORT int CALL_CONV LMS_GetClockFreq(lms_device_t *device, size_t clk_id, f
         return -1;
     }
     lime::LMS7_Device* lms = (lime::LMS7_Device*)device;
+    auto deviceLock = lms->GetCommandExecutor()->Lock();
     *freq = lms->GetClockFreq(clk_id);
     return *freq > 0 ? 0 : -1;
 }
@@ -277,6 +307,7 @@ API_EXPORT int CALL_CONV LMS_SetClockFreq(lms_device_t *device, size_t clk_id, f
         return -1;
     }
     lime::LMS7_Device* lms = (lime::LMS7_Device*)device;
+    auto deviceLock = lms->GetCommandExecutor()->Lock();
     return lms->SetClockFreq(clk_id, freq);
 }
 
@@ -288,7 +319,7 @@ API_EXPORT  int CALL_CONV LMS_Synchronize(lms_device_t *dev, bool toChip)
         return -1;
     }
     lime::LMS7_Device* lms = (lime::LMS7_Device*)dev;
-
+    auto deviceLock = lms->GetCommandExecutor()->Lock();
     return lms->Synchronize(toChip);
 }
 
@@ -300,6 +331,7 @@ API_EXPORT int CALL_CONV LMS_GPIORead(lms_device_t *dev,  uint8_t* buffer, size_
         return -1;
     }
     lime::LMS7_Device* lms = (lime::LMS7_Device*)dev;
+    auto deviceLock = lms->GetCommandExecutor()->Lock();
     auto conn = lms->GetConnection();
     if (conn == nullptr)
     {
@@ -317,6 +349,7 @@ API_EXPORT int CALL_CONV LMS_GPIOWrite(lms_device_t *dev, const uint8_t* buffer,
         return -1;
     }
      lime::LMS7_Device* lms = (lime::LMS7_Device*)dev;
+    auto deviceLock = lms->GetCommandExecutor()->Lock();
     auto conn = lms->GetConnection();
     if (conn == nullptr)
     {
@@ -334,6 +367,7 @@ API_EXPORT int CALL_CONV LMS_GPIODirRead(lms_device_t *dev,  uint8_t* buffer, si
         return -1;
     }
     lime::LMS7_Device* lms = (lime::LMS7_Device*)dev;
+    auto deviceLock = lms->GetCommandExecutor()->Lock();
     auto conn = lms->GetConnection();
     if (conn == nullptr)
     {
@@ -351,6 +385,7 @@ API_EXPORT int CALL_CONV LMS_GPIODirWrite(lms_device_t *dev, const uint8_t* buff
         return -1;
     }
      lime::LMS7_Device* lms = (lime::LMS7_Device*)dev;
+    auto deviceLock = lms->GetCommandExecutor()->Lock();
     auto conn = lms->GetConnection();
     if (conn == nullptr)
     {
@@ -369,6 +404,7 @@ API_EXPORT int CALL_CONV LMS_EnableCalibCache(lms_device_t *dev, bool enable)
     }
 
     lime::LMS7_Device* lms = (lime::LMS7_Device*)dev;
+    auto deviceLock = lms->GetCommandExecutor()->Lock();
     return lms->EnableCalibCache(enable);
 }
 
@@ -381,6 +417,7 @@ API_EXPORT int CALL_CONV LMS_GetChipTemperature(lms_device_t *dev, size_t ind, f
         return -1;
     }
     lime::LMS7_Device* lms = (lime::LMS7_Device*)dev;
+    auto deviceLock = lms->GetCommandExecutor()->Lock();
     if (lms->ReadLMSReg(0x2F) == 0x3840)
     {
         lime::ReportError(EINVAL, "Feature is not available on this chip revision");
@@ -399,6 +436,7 @@ API_EXPORT int CALL_CONV LMS_GetNumChannels(lms_device_t * device, bool dir_tx)
     }
 
     lime::LMS7_Device* lms = (lime::LMS7_Device*)device;
+    auto deviceLock = lms->GetCommandExecutor()->Lock();
     return lms->GetNumChannels(dir_tx);
 }
 
@@ -411,6 +449,7 @@ API_EXPORT int CALL_CONV LMS_SetLOFrequency(lms_device_t *device, bool dir_tx, s
     }
 
     lime::LMS7_Device* lms = (lime::LMS7_Device*)device;
+    auto deviceLock = lms->GetCommandExecutor()->Lock();
 
     if (chan >= lms->GetNumChannels(false))
     {
@@ -430,6 +469,7 @@ API_EXPORT int CALL_CONV LMS_GetLOFrequency(lms_device_t *device, bool dir_tx, s
     }
 
     lime::LMS7_Device* lms = (lime::LMS7_Device*)device;
+    auto deviceLock = lms->GetCommandExecutor()->Lock();
 
     if (chan >= lms->GetNumChannels(dir_tx))
     {
@@ -441,6 +481,33 @@ API_EXPORT int CALL_CONV LMS_GetLOFrequency(lms_device_t *device, bool dir_tx, s
     return LMS_SUCCESS;
 }
 
+API_EXPORT int CALL_CONV LMS_PrepareLOFrequencies(lms_device_t *device, bool dir_tx, size_t chan, const float_type *frequencies, size_t count)
+{
+    if (device == nullptr)
+    {
+        lime::ReportError(EINVAL, "Device cannot be NULL.");
+        return -1;
+    }
+
+    lime::LMS7_Device* lms = (lime::LMS7_Device*)device;
+    auto deviceLock = lms->GetCommandExecutor()->Lock();
+
+    if (chan >= lms->GetNumChannels(dir_tx))
+    {
+        lime::ReportError(EINVAL, "Invalid channel number.");
+        return -1;
+    }
+
+    if (frequencies == nullptr && count != 0)
+    {
+        lime::ReportError(EINVAL, "Frequencies cannot be NULL.");
+        return -1;
+    }
+
+    std::vector<double> list(frequencies, frequencies + count);
+    return lms->PrepareFrequencies(dir_tx, chan, list);
+}
+
 API_EXPORT int CALL_CONV LMS_GetLOFrequencyRange(lms_device_t *device, bool dir_tx, lms_range_t *range)
 {
     if (device == nullptr)
@@ -450,6 +517,7 @@ API_EXPORT int CALL_CONV LMS_GetLOFrequencyRange(lms_device_t *device, bool dir_
     }
 
     lime::LMS7_Device* lms = (lime::LMS7_Device*)device;
+    auto deviceLock = lms->GetCommandExecutor()->Lock();
     auto retRange = lms->GetFrequencyRange(dir_tx);
     range->min = retRange.min;
     range->max = retRange.max;
@@ -466,6 +534,7 @@ API_EXPORT int CALL_CONV LMS_GetAntennaList(lms_device_t *device, bool dir_tx, s
     }
 
     lime::LMS7_Device* lms = (lime::LMS7_Device*)device;
+    auto deviceLock = lms->GetCommandExecutor()->Lock();
 
     if (chan >= lms->GetNumChannels(false))
     {
@@ -492,6 +561,7 @@ API_EXPORT int CALL_CONV LMS_SetAntenna(lms_device_t *device, bool dir_tx, size_
     }
 
     lime::LMS7_Device* lms = (lime::LMS7_Device*)device;
+    auto deviceLock = lms->GetCommandExecutor()->Lock();
 
     if (chan >= lms->GetNumChannels(false))
     {
@@ -514,6 +584,7 @@ API_EXPORT int CALL_CONV LMS_GetAntenna(lms_device_t *device, bool dir_tx, size_
     }
 
     lime::LMS7_Device* lms = (lime::LMS7_Device*)device;
+    auto deviceLock = lms->GetCommandExecutor()->Lock();
 
     return lms->GetPath(dir_tx, chan);
 }
@@ -527,6 +598,7 @@ API_EXPORT int CALL_CONV LMS_GetAntennaBW(lms_device_t *device, bool dir_tx, siz
     }
 
     lime::LMS7_Device* lms = (lime::LMS7_Device*)device;
+    auto deviceLock = lms->GetCommandExecutor()->Lock();
     lime::LMS7_Device::Range ret;
     if (dir_tx)
         ret = lms->GetTxPathBand(path,chan);
@@ -549,6 +621,7 @@ API_EXPORT int CALL_CONV LMS_SetLPFBW(lms_device_t *device, bool dir_tx, size_t
     }
 
     lime::LMS7_Device* lms = (lime::LMS7_Device*)device;
+    auto deviceLock = lms->GetCommandExecutor()->Lock();
 
     if (chan >= lms->GetNumChannels(dir_tx))
     {
@@ -568,6 +641,7 @@ API_EXPORT int CALL_CONV LMS_GetLPFBW(lms_device_t *device, bool dir_tx, size_t
     }
 
     lime::LMS7_Device* lms = (lime::LMS7_Device*)device;
+    auto deviceLock = lms->GetCommandExecutor()->Lock();
 
     if (chan >= lms->GetNumChannels(dir_tx))
     {
@@ -587,6 +661,7 @@ API_EXPORT int CALL_CONV LMS_SetLPF(lms_device_t *device, bool dir_tx, size_t ch
     }
 
     lime::LMS7_Device* lms = (lime::LMS7_Device*)device;
+    auto deviceLock = lms->GetCommandExecutor()->Lock();
 
     if (chan >= lms->GetNumChannels(dir_tx))
     {
@@ -605,6 +680,7 @@ API_EXPORT int CALL_CONV LMS_SetGFIRLPF(lms_device_t *device, bool dir_tx, size_
     }
 
     lime::LMS7_Device* lms = (lime::LMS7_Device*)device;
+    auto deviceLock = lms->GetCommandExecutor()->Lock();
 
     if (chan >= lms->GetNumChannels(dir_tx))
     {
@@ -629,6 +705,7 @@ API_EXPORT int CALL_CONV LMS_GetLPFBWRange(lms_device_t *device, bool dir_tx, lm
     }
 
     lime::LMS7_Device* lms = (lime::LMS7_Device*)device;
+    auto deviceLock = lms->GetCommandExecutor()->Lock();
 
     auto ret = lms->GetLPFRange(dir_tx,0);
     range->max = ret.max;
@@ -647,6 +724,7 @@ API_EXPORT int CALL_CONV LMS_SetNormalizedGain(lms_device_t *device, bool dir_tx
     }
 
     lime::LMS7_Device* lms = (lime::LMS7_Device*)device;
+    auto deviceLock = lms->GetCommandExecutor()->Lock();
 
     if (chan >= lms->GetNumChannels(dir_tx))
     {
@@ -672,6 +750,7 @@ API_EXPORT int CALL_CONV LMS_SetGaindB(lms_device_t *device, bool dir_tx,
     }
 
     lime::LMS7_Device* lms = (lime::LMS7_Device*)device;
+    auto deviceLock = lms->GetCommandExecutor()->Lock();
 
     if (chan >= lms->GetNumChannels(dir_tx))
     {
@@ -691,6 +770,7 @@ API_EXPORT int CALL_CONV LMS_GetNormalizedGain(lms_device_t *device, bool dir_tx
     }
 
     lime::LMS7_Device* lms = (lime::LMS7_Device*)device;
+    auto deviceLock = lms->GetCommandExecutor()->Lock();
 
     if (chan >= lms->GetNumChannels(dir_tx))
     {
@@ -713,6 +793,7 @@ API_EXPORT int CALL_CONV LMS_GetGaindB(lms_device_t *device, bool dir_tx, size_t
     }
 
     lime::LMS7_Device* lms = (lime::LMS7_Device*)device;
+    auto deviceLock = lms->GetCommandExecutor()->Lock();
 
     if (chan >= lms->GetNumChannels(dir_tx))
     {
@@ -733,6 +814,7 @@ API_EXPORT int CALL_CONV LMS_Calibrate(lms_device_t *device, bool dir_tx, size_t
     }
 
     lime::LMS7_Device* lms = (lime::LMS7_Device*)device;
+    auto deviceLock = lms->GetCommandExecutor()->Lock();
 
     if (lms->ReadLMSReg(0x2F) == 0x3840)
     {
@@ -748,6 +830,45 @@ API_EXPORT int CALL_CONV LMS_Calibrate(lms_device_t *device, bool dir_tx, size_t
     return lms->Calibrate(dir_tx, chan, bw, flags);
 }
 
+API_EXPORT int CALL_CONV LMS_CalibrateMultiple(lms_device_t *device, lms_calib_request_t *requests, size_t count)
+{
+    if (device == nullptr)
+    {
+        lime::ReportError("Device cannot be NULL.");
+        return -1;
+    }
+
+    lime::LMS7_Device* lms = (lime::LMS7_Device*)device;
+    auto deviceLock = lms->GetCommandExecutor()->Lock();
+
+    if (lms->ReadLMSReg(0x2F) == 0x3840)
+    {
+        lime::ReportError("Calibration not supported");
+        return -1;
+    }
+
+    std::vector<lime::LMS7_Device::CalibrationRequest> jobs(count);
+    for (size_t i = 0; i < count; ++i)
+    {
+        if (requests[i].chan >= lms->GetNumChannels(requests[i].dir_tx))
+        {
+            lime::ReportError("Invalid channel number.");
+            return -1;
+        }
+        jobs[i].tx = requests[i].dir_tx;
+        jobs[i].chan = requests[i].chan;
+        jobs[i].bandwidth = requests[i].bw;
+        jobs[i].flags = requests[i].flags;
+    }
+    int ret = lms->Calibrate(jobs);
+    for (size_t i = 0; i < count; ++i)
+    {
+        requests[i].status = jobs[i].status;
+        requests[i].duration = jobs[i].duration;
+    }
+    return ret;
+}
+
 API_EXPORT int CALL_CONV LMS_LoadConfig(lms_device_t *device, const char *filename)
 {
     if (device == nullptr)
@@ -757,6 +878,7 @@ API_EXPORT int CALL_CONV LMS_LoadConfig(lms_device_t *device, const char *filena
     }
 
     lime::LMS7_Device* lms = (lime::LMS7_Device*)device;
+    auto deviceLock = lms->GetCommandExecutor()->Lock();
 
     return lms->LoadConfig(filename);
 }
@@ -770,6 +892,7 @@ API_EXPORT int CALL_CONV LMS_SaveConfig(lms_device_t *device, const char *filena
     }
 
     lime::LMS7_Device* lms = (lime::LMS7_Device*)device;
+    auto deviceLock = lms->GetCommandExecutor()->Lock();
 
     return lms->SaveConfig(filename);
 }
@@ -783,6 +906,7 @@ API_EXPORT int CALL_CONV LMS_SetTestSignal(lms_device_t *device, bool dir_tx, si
     }
 
     lime::LMS7_Device* lms = (lime::LMS7_Device*)device;
+    auto deviceLock = lms->GetCommandExecutor()->Lock();
 
     if (chan >= lms->GetNumChannels(dir_tx))
     {
@@ -810,6 +934,7 @@ API_EXPORT int CALL_CONV LMS_GetTestSignal(lms_device_t *device, bool dir_tx, si
     }
 
     lime::LMS7_Device* lms = (lime::LMS7_Device*)device;
+    auto deviceLock = lms->GetCommandExecutor()->Lock();
 
     if (chan >= lms->GetNumChannels(dir_tx))
     {
@@ -834,6 +959,7 @@ API_EXPORT int CALL_CONV LMS_SetNCOFrequency(lms_device_t *device, bool dir_tx,
     }
 
     lime::LMS7_Device* lms = (lime::LMS7_Device*)device;
+    auto deviceLock = lms->GetCommandExecutor()->Lock();
 
     if (ch >= lms->GetNumChannels(dir_tx))
     {
@@ -862,6 +988,7 @@ API_EXPORT int CALL_CONV LMS_GetNCOFrequency(lms_device_t *device, bool dir_tx,
     }
 
     lime::LMS7_Device* lms = (lime::LMS7_Device*)device;
+    auto deviceLock = lms->GetCommandExecutor()->Lock();
 
     if (chan >= lms->GetNumChannels(dir_tx))
     {
@@ -890,6 +1017,7 @@ API_EXPORT int CALL_CONV LMS_SetNCOPhase(lms_device_t *device, bool dir_tx, size
     }
 
     lime::LMS7_Device* lms = (lime::LMS7_Device*)device;
+    auto deviceLock = lms->GetCommandExecutor()->Lock();
 
     if (ch >= lms->GetNumChannels(dir_tx))
     {
@@ -920,6 +1048,7 @@ API_EXPORT int CALL_CONV LMS_GetNCOPhase(lms_device_t *device, bool dir_tx, size
     }
 
     lime::LMS7_Device* lms = (lime::LMS7_Device*)device;
+    auto deviceLock = lms->GetCommandExecutor()->Lock();
 
     if (ch >= lms->GetNumChannels(dir_tx))
     {
@@ -946,6 +1075,7 @@ API_EXPORT int CALL_CONV LMS_SetNCOIndex(lms_device_t *device, bool dir_tx, size
     }
 
     lime::LMS7_Device* lms = (lime::LMS7_Device*)device;
+    auto deviceLock = lms->GetCommandExecutor()->Lock();
 
     if (chan >= lms->GetNumChannels(dir_tx))
     {
@@ -977,6 +1107,7 @@ API_EXPORT int CALL_CONV LMS_GetNCOIndex(lms_device_t *device, bool dir_tx, size
     }
 
     lime::LMS7_Device* lms = (lime::LMS7_Device*)device;
+    auto deviceLock = lms->GetCommandExecutor()->Lock();
 
     if (chan >= lms->GetNumChannels(dir_tx))
     {
@@ -1001,6 +1132,7 @@ API_EXPORT int CALL_CONV LMS_ReadLMSReg(lms_device_t *device, uint32_t address,
     }
 
     lime::LMS7_Device* lms = (lime::LMS7_Device*)device;
+    auto deviceLock = lms->GetCommandExecutor()->Lock();
     *val = lms->ReadLMSReg(address);
     return 0;
 }
@@ -1014,6 +1146,7 @@ API_EXPORT int CALL_CONV LMS_WriteLMSReg(lms_device_t *device, uint32_t address,
     }
 
     lime::LMS7_Device* lms = (lime::LMS7_Device*)device;
+    auto deviceLock = lms->GetCommandExecutor()->Lock();
     return lms->WriteLMSReg(address, val);
 }
 
@@ -1026,6 +1159,7 @@ API_EXPORT int CALL_CONV LMS_ReadFPGAReg(lms_device_t *device, uint32_t address,
     }
 
     lime::LMS7_Device* lms = (lime::LMS7_Device*)device;
+    auto deviceLock = lms->GetCommandExecutor()->Lock();
     *val = lms->ReadFPGAReg(address);
     if (*val < 0)
         return *val;
@@ -1041,6 +1175,7 @@ API_EXPORT int CALL_CONV LMS_WriteFPGAReg(lms_device_t *device, uint32_t address
     }
 
     lime::LMS7_Device* lms = (lime::LMS7_Device*)device;
+    auto deviceLock = lms->GetCommandExecutor()->Lock();
     return lms->WriteFPGAReg(address,val);
 }
 
@@ -1052,6 +1187,7 @@ API_EXPORT int CALL_CONV LMS_ReadParam(lms_device_t *device, struct LMS7Paramete
         return -1;
     }
     lime::LMS7_Device* lms = (lime::LMS7_Device*)device;
+    auto deviceLock = lms->GetCommandExecutor()->Lock();
     *val = lms->ReadParam(param);
     return LMS_SUCCESS;;
 }
@@ -1064,6 +1200,7 @@ API_EXPORT int CALL_CONV LMS_WriteParam(lms_device_t *device, struct LMS7Paramet
         return -1;
     }
     lime::LMS7_Device* lms = (lime::LMS7_Device*)device;
+    auto deviceLock = lms->GetCommandExecutor()->Lock();
 
     return lms->WriteParam(param, val);
 }
@@ -1076,6 +1213,7 @@ API_EXPORT int CALL_CONV LMS_SetGFIRCoeff(lms_device_t * device, bool dir_tx, si
         return -1;
     }
     lime::LMS7_Device* lms = (lime::LMS7_Device*)device;
+    auto deviceLock = lms->GetCommandExecutor()->Lock();
 
     if (chan >= lms->GetNumChannels(false))
     {
@@ -1093,6 +1231,7 @@ API_EXPORT int CALL_CONV LMS_GetGFIRCoeff(lms_device_t * device, bool dir_tx, si
         return -1;
     }
     lime::LMS7_Device* lms = (lime::LMS7_Device*)device;
+    auto deviceLock = lms->GetCommandExecutor()->Lock();
 
     if (chan >= lms->GetNumChannels(false))
     {
@@ -1110,6 +1249,7 @@ API_EXPORT int CALL_CONV LMS_SetGFIR(lms_device_t * device, bool dir_tx, size_t
         return -1;
     }
     lime::LMS7_Device* lms = (lime::LMS7_Device*)device;
+    auto deviceLock = lms->GetCommandExecutor()->Lock();
 
     if (chan >= lms->GetNumChannels(false))
     {
@@ -1120,6 +1260,132 @@ API_EXPORT int CALL_CONV LMS_SetGFIR(lms_device_t * device, bool dir_tx, size_t
     return lms->SetGFIR(dir_tx,chan,filt,enabled);
 }
 
+API_EXPORT int CALL_CONV LMS_SaveGFIRCache(const char *filename)
+{
+    if (filename == nullptr)
+        return lime::ReportError(EINVAL, "filename is NULL.");
+    return lime::GFIRCache::Save(filename);
+}
+
+API_EXPORT int CALL_CONV LMS_LoadGFIRCache(const char *filename)
+{
+    if (filename == nullptr)
+        return lime::ReportError(EINVAL, "filename is NULL.");
+    return lime::GFIRCache::Load(filename);
+}
+
+namespace
+{
+//settings changed by asynchronous commands, pending commands of the same
+//setting and channel are replaced by newer ones
+enum AsyncSetting
+{
+    ASYNC_SAMPLE_RATE = 1,
+    ASYNC_LO_FREQUENCY,
+    ASYNC_ANTENNA,
+    ASYNC_GAIN,
+    ASYNC_LPF,
+    ASYNC_NCO,
+    ASYNC_NCO_PHASE
+};
+
+int SubmitAsync(lms_device_t *device, bool dir_tx, size_t chan, AsyncSetting setting,
+                const lime::CommandExecutor::Command &command,
+                lms_async_callback_t callback, void *user_data)
+{
+    if (device == nullptr)
+    {
+        lime::ReportError(EINVAL, "Device cannot be NULL.");
+        return -1;
+    }
+
+    lime::LMS7_Device* lms = (lime::LMS7_Device*)device;
+
+    if (chan >= lms->GetNumChannels(dir_tx))
+    {
+        lime::ReportError(EINVAL, "Invalid channel number.");
+        return -1;
+    }
+
+    lime::CommandExecutor::Callback done;
+    if (callback)
+        done = [device, callback, user_data](int status){ callback(device, status, user_data); };
+    const uint64_t key = lime::CommandExecutor::MakeKey(setting, dir_tx, chan);
+    lms->GetCommandExecutor()->Submit(key, command, done);
+    return 0;
+}
+}
+
+API_EXPORT int CALL_CONV LMS_SetSampleRateAsync(lms_device_t *device, float_type rate,
+        size_t oversample, lms_async_callback_t callback, void *user_data)
+{
+    return SubmitAsync(device, false, 0, ASYNC_SAMPLE_RATE,
+        [=]{ return LMS_SetSampleRate(device, rate, oversample); }, callback, user_data);
+}
+
+API_EXPORT int CALL_CONV LMS_SetLOFrequencyAsync(lms_device_t *device, bool dir_tx, size_t chan,
+        float_type frequency, lms_async_callback_t callback, void *user_data)
+{
+    return SubmitAsync(device, dir_tx, chan, ASYNC_LO_FREQUENCY,
+        [=]{ return LMS_SetLOFrequency(device, dir_tx, chan, frequency); }, callback, user_data);
+}
+
+API_EXPORT int CALL_CONV LMS_SetAntennaAsync(lms_device_t *device, bool dir_tx, size_t chan,
+        size_t index, lms_async_callback_t callback, void *user_data)
+{
+    return SubmitAsync(device, dir_tx, chan, ASYNC_ANTENNA,
+        [=]{ return LMS_SetAntenna(device, dir_tx, chan, index); }, callback, user_data);
+}
+
+API_EXPORT int CALL_CONV LMS_SetNormalizedGainAsync(lms_device_t *device, bool dir_tx, size_t chan,
+        float_type gain, lms_async_callback_t callback, void *user_data)
+{
+    return SubmitAsync(device, dir_tx, chan, ASYNC_GAIN,
+        [=]{ return LMS_SetNormalizedGain(device, dir_tx, chan, gain); }, callback, user_data);
+}
+
+API_EXPORT int CALL_CONV LMS_SetGaindBAsync(lms_device_t *device, bool dir_tx, size_t chan,
+        unsigned gain, lms_async_callback_t callback, void *user_data)
+{
+    return SubmitAsync(device, dir_tx, chan, ASYNC_GAIN,
+        [=]{ return LMS_SetGaindB(device, dir_tx, chan, gain); }, callback, user_data);
+}
+
+API_EXPORT int CALL_CONV LMS_SetLPFBWAsync(lms_device_t *device, bool dir_tx, size_t chan,
+        float_type bandwidth, lms_async_callback_t callback, void *user_data)
+{
+    return SubmitAsync(device, dir_tx, chan, ASYNC_LPF,
+        [=]{ return LMS_SetLPFBW(device, dir_tx, chan, bandwidth); }, callback, user_data);
+}
+
+API_EXPORT int CALL_CONV LMS_SetNCOFrequencyAsync(lms_device_t *device, bool dir_tx, size_t chan,
+        const float_type *freq, float_type pho, lms_async_callback_t callback, void *user_data)
+{
+    //frequencies are copied, caller's array may be reused immediately
+    std::vector<float_type> freqs;
+    if (freq != nullptr)
+        freqs.assign(freq, freq + LMS_NCO_VAL_COUNT);
+    //phase only change must not replace pending frequency change
+    return SubmitAsync(device, dir_tx, chan, freqs.empty() ? ASYNC_NCO_PHASE : ASYNC_NCO,
+        [=]{ return LMS_SetNCOFrequency(device, dir_tx, chan, freqs.empty() ? nullptr : freqs.data(), pho); },
+        callback, user_data);
+}
+
+API_EXPORT int CALL_CONV LMS_FlushAsync(lms_device_t *device, int timeout_ms)
+{
+    if (device == nullptr)
+    {
+        lime::ReportError(EINVAL, "Device cannot be NULL.");
+        return -1;
+    }
+
+    //not locked, queued commands take the lock on worker thread
+    lime::LMS7_Device* lms = (lime::LMS7_Device*)device;
+    if (!lms->GetCommandExecutor()->Flush(timeout_ms))
+        return lime::ReportError(ETIMEDOUT, "Asynchronous commands are still pending.");
+    return 0;
+}
+
 API_EXPORT int CALL_CONV LMS_SetupStream(lms_device_t *device, lms_stream_t *stream)
 {
     if(device == nullptr)
@@ -1128,6 +1394,7 @@ API_EXPORT int CALL_CONV LMS_SetupStream(lms_device_t *device, lms_stream_t *str
         return lime::ReportError(EINVAL, "stream is NULL.");
 
     lime::LMS7_Device* lms = (lime::LMS7_Device*)device;
+    auto deviceLock = lms->GetCommandExecutor()->Lock();
 
     lime::StreamConfig config;
     config.bufferLength = stream->fifoSize;
@@ -1158,21 +1425,75 @@ API_EXPORT int CALL_CONV LMS_DestroyStream(lms_device_t *device, lms_stream_t *s
         return lime::ReportError(EINVAL, "stream is NULL.");
 
     lime::LMS7_Device* lms = (lime::LMS7_Device*)device;
+    auto deviceLock = lms->GetCommandExecutor()->Lock();
     return lms->DestroyStream((lime::StreamChannel*)stream->handle);
 }
 
+API_EXPORT int CALL_CONV LMS_SetStreamZeroCopy(lms_stream_t *stream, bool enable)
+{
+    if (stream==nullptr || stream->handle==0)
+        return lime::ReportError(EINVAL, "stream is NULL.");
+    lime::StreamChannel* channel = reinterpret_cast<lime::StreamChannel*>(stream->handle);
+    if (channel->IsActive())
+        return lime::ReportError(EBUSY, "Cannot change zero-copy mode of active stream.");
+    if (stream->isTx && enable)
+        return lime::ReportError(EINVAL, "Zero-copy is supported only for Rx streams.");
+    channel->config.zeroCopy = enable;
+    return 0;
+}
+
+API_EXPORT int CALL_CONV LMS_SetStreamScheduling(lms_stream_t *stream, int priority, uint64_t cpu_affinity, bool numa_local)
+{
+    if (stream==nullptr || stream->handle==0)
+        return lime::ReportError(EINVAL, "stream is NULL.");
+    lime::StreamChannel* channel = reinterpret_cast<lime::StreamChannel*>(stream->handle);
+    return channel->SetScheduling(priority, cpu_affinity, numa_local);
+}
+
+API_EXPORT int CALL_CONV LMS_SetStreamMemory(lms_stream_t *stream, bool huge_pages, bool lock_memory)
+{
+    if (stream==nullptr || stream->handle==0)
+        return lime::ReportError(EINVAL, "stream is NULL.");
+    lime::StreamChannel* channel = reinterpret_cast<lime::StreamChannel*>(stream->handle);
+    return channel->SetMemoryOptions(huge_pages, lock_memory);
+}
+
+API_EXPORT int CALL_CONV LMS_GetStreamSchedulingInfo(lms_stream_t *stream, lms_stream_thread_info_t *info)
+{
+    if (stream==nullptr || stream->handle==0 || info==nullptr)
+        return lime::ReportError(EINVAL, "stream or info is NULL.");
+    lime::StreamChannel* channel = reinterpret_cast<lime::StreamChannel*>(stream->handle);
+    lime::StreamChannel::ThreadInfo applied = channel->GetThreadInfo();
+    info->priority = applied.priority;
+    info->affinity = applied.affinity;
+    info->bufferNode = applied.bufferNode;
+    info->fifoNode = applied.fifoNode;
+    return 0;
+}
+
+//! Locks device owning the stream, stream start/stop configures chip and FPGA
+static std::unique_lock<std::recursive_mutex> LockStreamDevice(const lime::StreamChannel* channel)
+{
+    lime::CommandExecutor* executor = channel->mStreamer->executor;
+    return executor ? executor->Lock() : std::unique_lock<std::recursive_mutex>();
+}
+
 API_EXPORT int CALL_CONV LMS_StartStream(lms_stream_t *stream)
 {
     if (stream==nullptr || stream->handle==0)
         return 0;
-    return reinterpret_cast<lime::StreamChannel*>(stream->handle)->Start();
+    lime::StreamChannel* channel = reinterpret_cast<lime::StreamChannel*>(stream->handle);
+    auto deviceLock = LockStreamDevice(channel);
+    return channel->Start();
 }
 
 API_EXPORT int CALL_CONV LMS_StopStream(lms_stream_t *stream)
 {
     if (stream==nullptr || stream->handle==0)
         return 0;
-    return reinterpret_cast<lime::StreamChannel*>(stream->handle)->Stop();
+    lime::StreamChannel* channel = reinterpret_cast<lime::StreamChannel*>(stream->handle);
+    auto deviceLock = LockStreamDevice(channel);
+    return channel->Stop();
 }
 
 API_EXPORT int CALL_CONV LMS_RecvStream(lms_stream_t *stream, void *samples, size_t sample_count, lms_stream_meta_t *meta, unsigned timeout_ms)
@@ -1213,11 +1534,95 @@ API_EXPORT int CALL_CONV LMS_SendStream(lms_stream_t *stream, const void *sample
     return channel->Write(samples, sample_count, &metadata, timeout_ms);
 }
 
+API_EXPORT int CALL_CONV LMS_RecvStreamAligned(lms_stream_t * const *streams, size_t stream_count, void * const *samples, size_t sample_count, lms_stream_meta_t *meta, unsigned timeout_ms)
+{
+    if (streams == nullptr || samples == nullptr || stream_count > lime::StreamChannel::maxAlignedStreams)
+        return lime::ReportError(EINVAL, "Invalid stream list.");
+    lime::StreamChannel* channels[lime::StreamChannel::maxAlignedStreams];
+    for (size_t i = 0; i < stream_count; i++)
+    {
+        if (streams[i] == nullptr || streams[i]->handle == 0)
+            return lime::ReportError(EINVAL, "Stream is not set up.");
+        channels[i] = (lime::StreamChannel*)streams[i]->handle;
+    }
+    lime::StreamChannel::Metadata metadata;
+    metadata.flags = 0;
+    if (meta)
+    {
+        metadata.flags |= meta->waitForTimestamp * lime::RingFIFO::SYNC_TIMESTAMP;
+        metadata.timestamp = meta->timestamp;
+    }
+    else metadata.timestamp = 0;
+
+    int status = lime::StreamChannel::ReadAligned(channels, stream_count, samples, sample_count, &metadata, timeout_ms);
+    if (meta)
+        meta->timestamp = metadata.timestamp;
+    return status;
+}
+
+API_EXPORT int CALL_CONV LMS_SendStreamAligned(lms_stream_t * const *streams, size_t stream_count, const void * const *samples, size_t sample_count, const lms_stream_meta_t *meta, unsigned timeout_ms)
+{
+    if (streams == nullptr || samples == nullptr || stream_count > lime::StreamChannel::maxAlignedStreams)
+        return lime::ReportError(EINVAL, "Invalid stream list.");
+    lime::StreamChannel* channels[lime::StreamChannel::maxAlignedStreams];
+    for (size_t i = 0; i < stream_count; i++)
+    {
+        if (streams[i] == nullptr || streams[i]->handle == 0)
+            return lime::ReportError(EINVAL, "Stream is not set up.");
+        channels[i] = (lime::StreamChannel*)streams[i]->handle;
+    }
+    lime::StreamChannel::Metadata metadata;
+    metadata.flags = 0;
+    if (meta)
+    {
+        metadata.flags |= meta->waitForTimestamp * lime::RingFIFO::SYNC_TIMESTAMP;
+        metadata.flags |= meta->flushPartialPacket * lime::RingFIFO::END_BURST;
+        metadata.timestamp = meta->timestamp;
+    }
+    else metadata.timestamp = 0;
+
+    return lime::StreamChannel::WriteAligned(channels, stream_count, samples, sample_count, &metadata, timeout_ms);
+}
+
+API_EXPORT int CALL_CONV LMS_AcquireStreamBuffer(lms_stream_t *stream, void **samples, lms_stream_meta_t *meta, unsigned timeout_ms)
+{
+    if (stream==nullptr || stream->handle==0)
+        return -1;
+    lime::StreamChannel* channel = (lime::StreamChannel*)stream->handle;
+    lime::StreamChannel::Metadata metadata;
+    metadata.flags = 0;
+    metadata.timestamp = 0;
+
+    int status = channel->AcquireBuffer(samples, &metadata, timeout_ms);
+    if (meta && !stream->isTx)
+        meta->timestamp = metadata.timestamp;
+    return status;
+}
+
+API_EXPORT int CALL_CONV LMS_ReleaseStreamBuffer(lms_stream_t *stream, size_t sample_count, const lms_stream_meta_t *meta)
+{
+    if (stream==nullptr || stream->handle==0)
+        return -1;
+    lime::StreamChannel* channel = (lime::StreamChannel*)stream->handle;
+    lime::StreamChannel::Metadata metadata;
+    metadata.flags = 0;
+    if (meta)
+    {
+        metadata.flags |= meta->waitForTimestamp * lime::RingFIFO::SYNC_TIMESTAMP;
+        metadata.flags |= meta->flushPartialPacket * lime::RingFIFO::END_BURST;
+        metadata.timestamp = meta->timestamp;
+    }
+    else metadata.timestamp = 0;
+
+    return channel->ReleaseBuffer(sample_count, &metadata);
+}
+
 API_EXPORT int CALL_CONV LMS_UploadWFM(lms_device_t *device,
                                          const void **samples, uint8_t chCount,
                                          size_t sample_count, int format)
 {
     lime::LMS7_Device* lms = (lime::LMS7_Device*)device;
+    auto deviceLock = lms->GetCommandExecutor()->Lock();
     lime::StreamConfig::StreamDataFormat fmt;
     switch(format)
     {
@@ -1239,6 +1644,14 @@ API_EXPORT int CALL_CONV LMS_UploadWFM(lms_device_t *device,
 
 API_EXPORT int CALL_CONV LMS_EnableTxWFM(lms_device_t *device, unsigned ch, bool active)
 {
+    if (device == nullptr)
+    {
+        lime::ReportError(EINVAL, "Device cannot be NULL.");
+        return -1;
+    }
+    //register read-modify-write is done under one lock
+    lime::LMS7_Device* lms = (lime::LMS7_Device*)device;
+    auto deviceLock = lms->GetCommandExecutor()->Lock();
     uint16_t regAddr = 0x000D;
     uint16_t regValue = 0;
     int status = 0;
@@ -1282,6 +1695,7 @@ API_EXPORT const lms_dev_info_t* CALL_CONV LMS_GetDeviceInfo(lms_device_t *devic
     }
 
     lime::LMS7_Device* lms = (lime::LMS7_Device*)device;
+    auto deviceLock = lms->GetCommandExecutor()->Lock();
     auto conn = lms->GetConnection();
     if (conn == nullptr)
     {
@@ -1306,6 +1720,7 @@ API_EXPORT int CALL_CONV LMS_GetProgramModes(lms_device_t *device, lms_name_t *l
     }
 
     lime::LMS7_Device* lms = (lime::LMS7_Device*)device;
+    auto deviceLock = lms->GetCommandExecutor()->Lock();
 
 
     auto names = lms->GetProgramModes();
@@ -1327,6 +1742,7 @@ API_EXPORT int CALL_CONV LMS_Program(lms_device_t *device, const char *data, siz
     }
 
     lime::LMS7_Device* lms = (lime::LMS7_Device*)device;
+    auto deviceLock = lms->GetCommandExecutor()->Lock();
     std::string prog_mode(mode);
     return lms->Program(prog_mode, data, size, callback);
 }
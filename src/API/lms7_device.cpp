@@ -12,9 +12,14 @@
 #include "LmsGeneric.h"
 #include "GFIR/lms_gfir.h"
 #include "IConnection.h"
+#include "CalibrationStore.h"
+#include "GFIRCache.h"
+#include "CommandExecutor.h"
 #include <cmath>
 #include "dataTypes.h"
 #include <chrono>
+#include <thread>
+#include <cstring>
 #include <iostream>
 #include <fstream>
 #include "MCU_BD.h"
@@ -69,7 +74,8 @@ LMS7_Device* LMS7_Device::CreateDevice(const lime::ConnectionHandle& handle, LMS
     return device;
 }
 
-LMS7_Device::LMS7_Device(LMS7_Device *obj) : connection(nullptr), lms_chip_id(0),fpga(nullptr)
+LMS7_Device::LMS7_Device(LMS7_Device *obj) : connection(nullptr), lms_chip_id(0),fpga(nullptr), mCalibrationStore(nullptr), mBoardSerial(0),
+    mExecutor(new lime::CommandExecutor())
 {
     if (obj != nullptr)
     {
@@ -92,6 +98,9 @@ LMS7_Device::LMS7_Device(LMS7_Device *obj) : connection(nullptr), lms_chip_id(0)
 
 LMS7_Device::~LMS7_Device()
 {
+    //finish queued commands while chips are still available
+    delete mExecutor;
+
     for (unsigned i = 0; i < lms_list.size();i++)
         delete lms_list[i];
 
@@ -112,6 +121,11 @@ lime::FPGA* LMS7_Device::GetFPGA()
     return fpga;
 }
 
+lime::CommandExecutor* LMS7_Device::GetCommandExecutor()
+{
+    return mExecutor;
+}
+
 lime::LMS7002M* LMS7_Device::SelectChannel(unsigned ch) const
 {
     lime::LMS7002M* lms = lms_list.at(ch/2);
@@ -124,6 +138,8 @@ int LMS7_Device::ConfigureGFIR(bool tx, unsigned ch, bool enabled, double bandwi
     double w,w2;
     int L;
     int div = 1;
+    double interface_MHz;
+    int ratio;
 
     bandwidth /= 1e6;
     lime::LMS7002M* lms = SelectChannel(ch);
@@ -157,10 +173,6 @@ int LMS7_Device::ConfigureGFIR(bool tx, unsigned ch, bool enabled, double bandwi
 
     if (enabled)
     {
-
-        double interface_MHz;
-        int ratio;
-
         if (tx)
         {
             ratio = lms->Get_SPI_Reg_bits(LMS7param(HBI_OVR_TXTSP));
@@ -195,46 +207,53 @@ int LMS7_Device::ConfigureGFIR(bool tx, unsigned ch, bool enabled, double bandwi
     }
     else return 0;
 
-  double coef[120];
-  double coef2[40];
-  short gfir1[120];
-  short gfir2[40];
-
-  GenerateFilter(L*15, w, w2, 1.0, 0, coef);
-  GenerateFilter(L*5, w, w2, 1.0, 0, coef2);
+    int16_t gfir1[lime::GFIRCache::gfir1Length];
+    int16_t gfir2[lime::GFIRCache::gfir2Length];
 
-    int sample = 0;
-    for(int i=0; i<15; i++)
+    //least squares design is slow, reuse coefficients of the same configuration
+    const lime::GFIRCache::Key key(bandwidth*1e6, interface_MHz*1e6, ratio, L);
+    if (!lime::GFIRCache::Lookup(key, gfir1, gfir2))
     {
-	for(int j=0; j<8; j++)
+        double coef[120];
+        double coef2[40];
+
+        GenerateFilter(L*15, w, w2, 1.0, 0, coef);
+        GenerateFilter(L*5, w, w2, 1.0, 0, coef2);
+
+        int sample = 0;
+        for(int i=0; i<15; i++)
         {
-            if( (j < L) && (sample < L*15) )
+            for(int j=0; j<8; j++)
             {
-                gfir1[i*8+j] = (coef[sample]*32767.0);
-		sample++;
+                if( (j < L) && (sample < L*15) )
+                {
+                    gfir1[i*8+j] = (coef[sample]*32767.0);
+                    sample++;
+                }
+                else
+                {
+                    gfir1[i*8+j] = 0;
+                }
             }
-            else
-            {
-		gfir1[i*8+j] = 0;
-            }
-	}
-    }
+        }
 
-    sample = 0;
-    for(int i=0; i<5; i++)
-    {
-	for(int j=0; j<8; j++)
+        sample = 0;
+        for(int i=0; i<5; i++)
         {
-            if( (j < L) && (sample < L*5) )
+            for(int j=0; j<8; j++)
             {
-                gfir2[i*8+j] = (coef2[sample]*32767.0);
-		sample++;
+                if( (j < L) && (sample < L*5) )
+                {
+                    gfir2[i*8+j] = (coef2[sample]*32767.0);
+                    sample++;
+                }
+                else
+                {
+                    gfir2[i*8+j] = 0;
+                }
             }
-            else
-            {
-		gfir2[i*8+j] = 0;
-            }
-	}
+        }
+        lime::GFIRCache::Insert(key, gfir1, gfir2);
     }
 
     L-=1;
@@ -1251,10 +1270,112 @@ int LMS7_Device::Calibrate(bool dir_tx, unsigned chan, double bw, unsigned flags
         ret = lms->CalibrateTx(bw, flags & 1);
     else
         ret = lms->CalibrateRx(bw, flags & 1);
+    if (ret == 0)
+    {
+        (dir_tx ? tx_channels : rx_channels)[chan].cal_bw = bw;
+        if (mCalibrationStore)
+            StoreCalibration(dir_tx, chan, bw);
+    }
     lms->SPI_write(0x20,reg20);
     return ret;
 }
 
+int LMS7_Device::Calibrate(std::vector<CalibrationRequest> &requests)
+{
+    //every chip has its own MCU, so chips are calibrated in parallel,
+    //external loopback is controlled by board wide register and can not be shared
+    std::vector<std::vector<CalibrationRequest*> > chipQueues(lms_list.size());
+    std::vector<CalibrationRequest*> serialQueue;
+    std::vector<std::string> errors(requests.size());
+    for (auto &request : requests)
+    {
+        request.status = -1;
+        request.duration = 0;
+        memset(&request.values, 0, sizeof(request.values));
+        if (request.chan >= GetNumChannels(request.tx) || request.chan/2 >= lms_list.size())
+            errors[&request - requests.data()] = "Invalid channel number.";
+        else if (request.flags & 1)
+            serialQueue.push_back(&request);
+        else
+            chipQueues[request.chan/2].push_back(&request);
+    }
+
+    auto run = [&](CalibrationRequest* request)
+    {
+        auto t1 = std::chrono::steady_clock::now();
+        request->status = Calibrate(request->tx, request->chan, request->bandwidth, request->flags);
+        if (request->status == 0)
+            SelectChannel(request->chan)->GetCalibrationValues(request->tx, request->values);
+        else
+            errors[request - requests.data()] = lime::GetLastErrorMessage();
+        request->duration = std::chrono::duration<double>(std::chrono::steady_clock::now() - t1).count();
+    };
+    auto runQueue = [&](const std::vector<CalibrationRequest*> &queue)
+    {
+        for (auto request : queue)
+            run(request);
+    };
+
+    std::vector<std::thread> workers;
+    std::vector<CalibrationRequest*>* lastQueue = nullptr;
+    for (auto &queue : chipQueues)
+    {
+        if (queue.empty())
+            continue;
+        if (lastQueue)
+            workers.push_back(std::thread(runQueue, std::cref(*lastQueue)));
+        lastQueue = &queue;
+    }
+    if (lastQueue)
+        runQueue(*lastQueue); //last chip is calibrated by calling thread
+    for (auto &worker : workers)
+        worker.join();
+    runQueue(serialQueue);
+
+    //errors are reported per thread, report first failure to the caller
+    for (size_t i = 0; i < requests.size(); ++i)
+        if (requests[i].status != 0)
+            return lime::ReportError(-1, "Calibration of %s channel %u failed: %s",
+                requests[i].tx ? "Tx" : "Rx", requests[i].chan, errors[i].c_str());
+    return 0;
+}
+
+void LMS7_Device::StoreCalibration(bool tx, unsigned chan, double bandwidth)
+{
+    lime::LMS7002M* lms = SelectChannel(chan);
+    lime::CalibrationStore::Entry entry;
+    if (lms->GetCalibrationValues(tx, entry.values) != 0)
+        return;
+    entry.boardSerial = mBoardSerial;
+    entry.channel = chan;
+    entry.tx = tx;
+    //same LO frequency that ApplyStoredCalibration() looks up, Rx can use Tx PLL in TDD mode
+    entry.frequency = GetFrequency(tx, chan) + (tx ? tx_channels : rx_channels)[chan].cF_offset_nco;
+    entry.bandwidth = bandwidth;
+    entry.gain = GetGain(tx, chan);
+    entry.temperature = lms->GetLastTemperature();
+    mCalibrationStore->Insert(entry);
+}
+
+/** @brief Applies stored calibration results for given LO frequency, if there are any
+*/
+void LMS7_Device::ApplyStoredCalibration(bool tx, unsigned chan, double loFreq)
+{
+    if (mCalibrationStore == nullptr)
+        return;
+    lime::LMS7002M* lms = SelectChannel(chan);
+    lime::CalibrationStore::Entry query;
+    query.boardSerial = mBoardSerial;
+    query.channel = chan;
+    query.tx = tx;
+    query.frequency = loFreq;
+    query.bandwidth = (tx ? tx_channels : rx_channels)[chan].cal_bw;
+    query.gain = GetGain(tx, chan);
+    query.temperature = lms->GetLastTemperature();
+    if (mCalibrationStore->Lookup(query))
+        lms->SetCalibrationValues(tx, query.values);
+}
+
 int LMS7_Device::SetFrequency(bool isTx, unsigned chan, double f_Hz)
 {
     lime::LMS7002M* lms = lms_list[chan / 2];
@@ -1272,6 +1393,8 @@ int LMS7_Device::SetFrequency(bool isTx, unsigned chan, double f_Hz)
         if (isTx || (!tdd))
             if (lms->SetFrequencySX(isTx, center) != 0)
                 return -1;
+        for (unsigned ch = chA; ch <= unsigned(chB) && ch < GetNumChannels(isTx); ++ch)
+            ApplyStoredCalibration(isTx, ch, center);
         return 0;
     };
 
@@ -1331,6 +1454,16 @@ double LMS7_Device::GetFrequency(bool tx, unsigned chan) const
    return lms->GetFrequencySX(tx) - offset;
 }
 
+int LMS7_Device::PrepareFrequencies(bool tx, unsigned chan, const std::vector<double> &frequencies)
+{
+    lime::LMS7002M* lms = lms_list[chan / 2];
+    std::vector<float_type> sxFrequencies;
+    //lower frequencies are set by tuning SX to 30 MHz and using NCO
+    for (double f_Hz : frequencies)
+        sxFrequencies.push_back(f_Hz < 30e6 ? 30e6 : f_Hz);
+    return lms->PrepareFrequenciesSX(tx, sxFrequencies);
+}
+
 LMS7_Device::Range LMS7_Device::GetFrequencyRange(bool tx) const
 {
     return Range(100e3, 3.8e9);
@@ -1635,6 +1768,9 @@ int LMS7_Device::EnableCalibCache(bool enable)
         lms_list[i]->EnableValuesCache(enable);
     if (fpga)
         fpga->EnableValuesCache(enable);
+    mCalibrationStore = enable ? &lime::CalibrationStore::Instance() : nullptr;
+    if (enable && connection)
+        mBoardSerial = connection->GetDeviceInfo().boardSerialNumber;
     return 0;
 }
 
@@ -1779,7 +1915,9 @@ lime::StreamChannel* LMS7_Device::SetupStream(const lime::StreamConfig &config)
 {
     if (config.channelID >= GetNumChannels())
         return nullptr;
-    return mStreamers[config.channelID/2]->SetupStream(config);
+    lime::Streamer* streamer = mStreamers[config.channelID/2];
+    streamer->executor = mExecutor;
+    return streamer->SetupStream(config);
 }
 
 int LMS7_Device::DestroyStream(lime::StreamChannel* streamID)
@@ -16,6 +16,9 @@
 
 namespace lime
 {
+class CalibrationStore;
+class CommandExecutor;
+
 class LIME_API LMS7_Device
 {
 public:
@@ -28,6 +31,11 @@ public:
     LMS7_Device(LMS7_Device *obj = nullptr);
     lime::IConnection* GetConnection(unsigned chan =0);
     lime::FPGA* GetFPGA();
+    /** @brief Returns queue for executing control commands asynchronously
+        Commands are executed on a worker thread one at a time, synchronous
+        calls take CommandExecutor::Lock() so they do not interleave with them.
+    */
+    lime::CommandExecutor* GetCommandExecutor();
     virtual int Init();
     virtual int EnableChannel(bool dir_tx, unsigned chan, bool enabled);
     int Reset();
@@ -43,6 +51,7 @@ public:
     int GetPath(bool tx, unsigned chan) const;
     virtual int SetFrequency(bool tx, unsigned chan, double f_Hz);
     double GetFrequency(bool tx, unsigned chan) const;
+    int PrepareFrequencies(bool tx, unsigned chan, const std::vector<double> &frequencies);
     virtual Range GetFrequencyRange(bool tx) const;
     virtual Range GetRxPathBand(unsigned path, unsigned chan) const;
     virtual Range GetTxPathBand(unsigned path, unsigned chan) const;
@@ -62,6 +71,23 @@ public:
     int SetNCOPhase(bool tx, unsigned ch, int ind, double phase);
     double GetNCOPhase(bool tx, unsigned ch, int ind) const;
     int Calibrate(bool dir_tx, unsigned chan, double bw, unsigned flags);
+
+    struct CalibrationRequest
+    {
+        bool tx;
+        unsigned chan;
+        double bandwidth;
+        unsigned flags;
+        int status; ///<result, 0 on success
+        double duration; ///<seconds spent on this calibration
+        lime::LMS7002M::CalibrationValues values; ///<resulting corrections
+    };
+    /** @brief Runs calibrations of different chips concurrently
+        Requests of the same chip are executed in given order, requests using
+        external loopback are executed one at a time after all the others.
+        @return 0 if all calibrations succeeded
+    */
+    int Calibrate(std::vector<CalibrationRequest> &requests);
     virtual std::vector<std::string> GetProgramModes() const;
     virtual int Program(const std::string& mode, const char* data, size_t len, lime::IConnection::ProgrammingCallback callback) const;
     double GetClockFreq(unsigned clk_id, int channel = -1) const;
@@ -101,11 +127,12 @@ protected:
     struct ChannelInfo
     {
     public:
-        ChannelInfo():lpf_bw(5e6),cF_offset_nco(0),sample_rate(30e6),freq(-1.0){}
+        ChannelInfo():lpf_bw(5e6),cF_offset_nco(0),sample_rate(30e6),freq(-1.0),cal_bw(0){}
         double lpf_bw;
         double cF_offset_nco;
         double sample_rate;
         double freq;
+        double cal_bw; //bandwidth of last calibration, 0 if not calibrated
     };
     lms_dev_info_t devInfo;
     std::vector<ChannelInfo> tx_channels;
@@ -114,9 +141,14 @@ protected:
     std::vector<lime::LMS7002M*> lms_list;
     lime::LMS7002M* SelectChannel(unsigned chan) const;
     int ConfigureTXLPF(bool enabled,int ch, double bandwidth);
+    void StoreCalibration(bool tx, unsigned chan, double bandwidth);
+    void ApplyStoredCalibration(bool tx, unsigned chan, double loFreq);
     unsigned lms_chip_id;
     std::vector<lime::Streamer*> mStreamers;
     lime::FPGA* fpga;
+    lime::CalibrationStore* mCalibrationStore; //null if calibration cache is disabled
+    uint64_t mBoardSerial;
+    lime::CommandExecutor* mExecutor;
 };
 
 }
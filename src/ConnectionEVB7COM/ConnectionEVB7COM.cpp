@@ -45,6 +45,7 @@ ConnectionEVB7COM::ConnectionEVB7COM(const char *comName, int baudrate)
 
 ConnectionEVB7COM::~ConnectionEVB7COM(void)
 {
+    StopAsyncControl();
     this->Close();
 }
 
@@ -62,6 +62,7 @@ ConnectionFT601::ConnectionFT601(void *arg, const ConnectionHandle &handle)
 */
 ConnectionFT601::~ConnectionFT601()
 {
+    StopAsyncControl();
     Close();
 }
 #ifdef __unix__
@@ -137,6 +137,9 @@ private:
     std::thread mUSBProcessingThread;
     void handle_libusb_events();
     std::atomic<bool> mProcessUSBEvents;
+    static int LIBUSB_CALL OnHotplug(libusb_context* ctx, libusb_device* dev, libusb_hotplug_event event, void* user_data);
+    libusb_hotplug_callback_handle mHotplugHandle;
+    bool mHotplugRegistered;
 #endif
 };
 
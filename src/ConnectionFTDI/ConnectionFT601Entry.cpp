@@ -20,6 +20,15 @@ void ConnectionFT601Entry::handle_libusb_events()
         if(r != 0) lime::error("error libusb_handle_events %s", libusb_strerror(libusb_error(r)));
     }
 }
+
+int LIBUSB_CALL ConnectionFT601Entry::OnHotplug(libusb_context* ctx, libusb_device* dev, libusb_hotplug_event event, void* user_data)
+{
+    libusb_device_descriptor desc;
+    if (libusb_get_device_descriptor(dev, &desc) == 0 && desc.idVendor != 0x0403)
+        return 0;
+    static_cast<ConnectionFT601Entry*>(user_data)->invalidateCache();
+    return 0;
+}
 #endif // __UNIX__
 
 //! make a static-initialized entry in the registry
@@ -42,6 +51,14 @@ ConnectionFT601Entry::ConnectionFT601Entry(void):
 #else
     libusb_set_option(ctx, LIBUSB_OPTION_LOG_LEVEL, 3); //set verbosity level to 3, as suggested in the documentation
 #endif
+    //with hotplug notifications enumeration results can be reused until devices change
+    mHotplugRegistered = libusb_has_capability(LIBUSB_CAP_HAS_HOTPLUG) &&
+        libusb_hotplug_register_callback(ctx,
+            libusb_hotplug_event(LIBUSB_HOTPLUG_EVENT_DEVICE_ARRIVED | LIBUSB_HOTPLUG_EVENT_DEVICE_LEFT),
+            LIBUSB_HOTPLUG_NO_FLAGS, LIBUSB_HOTPLUG_MATCH_ANY, LIBUSB_HOTPLUG_MATCH_ANY, LIBUSB_HOTPLUG_MATCH_ANY,
+            &ConnectionFT601Entry::OnHotplug, this, &mHotplugHandle) == LIBUSB_SUCCESS;
+    if (mHotplugRegistered)
+        enableCache();
     mProcessUSBEvents.store(true);
     mUSBProcessingThread = std::thread(&ConnectionFT601Entry::handle_libusb_events, this);
 #endif
@@ -52,6 +69,8 @@ ConnectionFT601Entry::~ConnectionFT601Entry(void)
 #ifndef __unix__
     //delete m_pDriver;
 #else
+    if (mHotplugRegistered)
+        libusb_hotplug_deregister_callback(ctx, mHotplugHandle);
     mProcessUSBEvents.store(false);
     mUSBProcessingThread.join();
     libusb_exit(ctx);
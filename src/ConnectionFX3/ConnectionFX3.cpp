@@ -70,7 +70,24 @@ ConnectionFX3::ConnectionFX3(void *arg, const std::string &vidpid, const std::st
 
 #else
     dev_handle = nullptr;
-    ctx = (libusb_context *)arg;
+    //each device gets its own session and event thread, so completions of
+    //different devices are not serialized in one thread
+    ctx = nullptr;
+    int r = libusb_init(&ctx);
+    if(r < 0)
+        lime::error("Init Error %i", r);
+#if LIBUSBX_API_VERSION < 0x01000106
+    libusb_set_debug(ctx, 3); //same verbosity as the enumeration session
+#else
+    libusb_set_option(ctx, LIBUSB_OPTION_LOG_LEVEL, 3); //same verbosity as the enumeration session
+#endif
+    for (int i = 0; i < USB_MAX_CONTEXTS; ++i)
+    {
+        contexts[i].completion = &mReadCompletion;
+        contextsToSend[i].completion = &mSendCompletion;
+    }
+    mProcessUSBEvents.store(true);
+    mUSBProcessingThread = std::thread(&ConnectionFX3::handle_libusb_events, this);
 #endif
     if (this->Open(vidpid, serial, index) != 0)
         lime::error("Failed to open device");
@@ -114,9 +131,14 @@ ConnectionFX3::ConnectionFX3(void *arg, const std::string &vidpid, const std::st
 */
 ConnectionFX3::~ConnectionFX3()
 {
+    StopAsyncControl();
     Close();
 #ifndef __unix__
     delete USBDevicePrimary;
+#else
+    mProcessUSBEvents.store(false);
+    mUSBProcessingThread.join();
+    libusb_exit(ctx);
 #endif
 }
 
@@ -207,8 +229,14 @@ int ConnectionFX3::Open(const std::string &vidpid, const std::string &serial, co
         return ReportError(-1, "libusb_get_device_list failed: %s", libusb_strerror(libusb_error(usbDeviceCount)));
     }
 
+    //enumerated handles carry bus number and device address in index,
+    //only that device is opened, otherwise every matching device is tried
+    const bool byAddress = index != unsigned(-1);
     for(int i=0; i<usbDeviceCount; ++i)
     {
+        if (byAddress && (libusb_get_bus_number(devs[i]) != ((index >> 8) & 0xFF) ||
+            libusb_get_device_address(devs[i]) != (index & 0xFF)))
+            continue;
         libusb_device_descriptor desc;
         int r = libusb_get_device_descriptor(devs[i], &desc);
         if(r<0) {
@@ -404,12 +432,25 @@ int ConnectionFX3::Read(unsigned char *buffer, const int length, int timeout_ms)
 }
 
 #ifdef __unix__
+/**	@brief Pumps libusb events of this device, transfer callbacks are run here
+*/
+void ConnectionFX3::handle_libusb_events()
+{
+    struct timeval tv;
+    tv.tv_sec = 0;
+    tv.tv_usec = 250000;
+    while(mProcessUSBEvents.load() == true)
+    {
+        int r = libusb_handle_events_timeout_completed(ctx, &tv, NULL);
+        if(r != 0) lime::error("error libusb_handle_events %s", libusb_strerror(libusb_error(r)));
+    }
+}
+
 /**	@brief Function for handling libusb callbacks
 */
 void callback_libusbtransfer(libusb_transfer *trans)
 {
 	USBTransferContext *context = reinterpret_cast<USBTransferContext*>(trans->user_data);
-	std::unique_lock<std::mutex> lck(context->transferLock);
 	switch(trans->status)
 	{
     case LIBUSB_TRANSFER_CANCELLED:
@@ -439,8 +480,7 @@ void callback_libusbtransfer(libusb_transfer *trans)
         lime::error("USB transfer no device");
         break;
 	}
-	lck.unlock();
-	context->cv.notify_one();
+	context->completion->Notify();
 }
 #endif
 
@@ -509,17 +549,7 @@ bool ConnectionFX3::WaitForReading(int contextHandle, unsigned int timeout_ms)
     status = contexts[contextHandle].EndPt->WaitForXfer(contexts[contextHandle].inOvLap, timeout_ms);
 	return status;
     #else
-    auto t1 = chrono::high_resolution_clock::now();
-    auto t2 = t1;
-
-    std::unique_lock<std::mutex> lck(contexts[contextHandle].transferLock);
-    while(contexts[contextHandle].done.load() == false && std::chrono::duration_cast<std::chrono::milliseconds>(t2 - t1).count() < timeout_ms)
-    {
-        //blocking not to waste CPU
-        contexts[contextHandle].cv.wait_for(lck, chrono::milliseconds(timeout_ms));
-        t2 = chrono::high_resolution_clock::now();
-    }
-    return contexts[contextHandle].done.load() == true;
+    return mReadCompletion.Wait(contexts[contextHandle].done, timeout_ms);
     #endif
     }
     else
@@ -644,17 +674,7 @@ bool ConnectionFX3::WaitForSending(int contextHandle, unsigned int timeout_ms)
 	status = contextsToSend[contextHandle].EndPt->WaitForXfer(contextsToSend[contextHandle].inOvLap, timeout_ms);
 	return status;
 #   else
-    auto t1 = chrono::high_resolution_clock::now();
-    auto t2 = t1;
-
-    std::unique_lock<std::mutex> lck(contextsToSend[contextHandle].transferLock);
-    while(contextsToSend[contextHandle].done.load() == false && std::chrono::duration_cast<std::chrono::milliseconds>(t2 - t1).count() < timeout_ms)
-    {
-        //blocking not to waste CPU
-        contextsToSend[contextHandle].cv.wait_for(lck, chrono::milliseconds(timeout_ms));
-        t2 = chrono::high_resolution_clock::now();
-    }
-	return contextsToSend[contextHandle].done == true;
+    return mSendCompletion.Wait(contextsToSend[contextHandle].done, timeout_ms);
 #   endif
     }
     return 0;
@@ -29,6 +29,49 @@
 namespace lime
 {
 
+#ifdef __unix__
+/** @brief Wakes threads waiting for asynchronous transfers of one direction
+    Transfer completion is published through the atomic done flag of the
+    context, the libusb event thread takes the lock and signals only when
+    some thread is actually sleeping, so transfers that are already complete
+    are collected without any locking or context switches.
+*/
+class USBCompletionEvent
+{
+public:
+    USBCompletionEvent() : waiters(0) {}
+
+    //! @brief Called by event thread after setting done flag of a transfer
+    void Notify()
+    {
+        //pairs with waiters increment, so a sleeping thread can not miss the update
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (waiters.load(std::memory_order_relaxed) == 0)
+            return;
+        std::lock_guard<std::mutex> lck(lock);
+        cv.notify_all();
+    }
+
+    //! @brief Waits until done is set, returns false on timeout
+    bool Wait(const std::atomic<bool> &done, unsigned int timeout_ms)
+    {
+        if (done.load(std::memory_order_acquire))
+            return true;
+        const auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeout_ms);
+        std::unique_lock<std::mutex> lck(lock);
+        waiters.fetch_add(1);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        const bool status = cv.wait_until(lck, deadline, [&done]{return done.load(std::memory_order_acquire);});
+        waiters.fetch_sub(1);
+        return status;
+    }
+private:
+    std::atomic<int> waiters;
+    std::mutex lock;
+    std::condition_variable cv;
+};
+#endif
+
 /** @brief Wrapper class for holding USB asynchronous transfers contexts
 */
 class USBTransferContext
@@ -46,6 +89,7 @@ public:
         transfer = libusb_alloc_transfer(0);
         bytesXfered = 0;
         done = 0;
+        completion = nullptr;
 #endif
     }
     ~USBTransferContext()
@@ -77,8 +121,7 @@ public:
     libusb_transfer* transfer;
     long bytesXfered;
     std::atomic<bool> done;
-    std::mutex transferLock;
-    std::condition_variable cv;
+    USBCompletionEvent* completion;
 #endif
 };
 
@@ -117,7 +160,7 @@ protected:
     int ResetStreamBuffers() override;
     eConnectionType GetType(void) {return USB_PORT;}
     
-    static const int USB_MAX_CONTEXTS = 16; //maximum number of contexts for asynchronous transfers
+    static const int USB_MAX_CONTEXTS = 32; //maximum number of contexts for asynchronous transfers
     
     USBTransferContext contexts[USB_MAX_CONTEXTS];
     USBTransferContext contextsToSend[USB_MAX_CONTEXTS];
@@ -139,7 +182,12 @@ protected:
     CCyUSBEndPoint* OutCtrlBulkEndPt;
 #else
     libusb_device_handle* dev_handle; //a device handle
-    libusb_context* ctx; //a libusb session
+    libusb_context* ctx; //a libusb session, owned by this connection
+    std::thread mUSBProcessingThread; //handles transfers of this device only
+    std::atomic<bool> mProcessUSBEvents;
+    USBCompletionEvent mReadCompletion;
+    USBCompletionEvent mSendCompletion;
+    void handle_libusb_events();
     int read_firmware_image(unsigned char *buf, int len);
     int fx3_usbboot_download(unsigned char *buf, int len);
     int ram_write(unsigned char *buf, unsigned int ramAddress, int len);
@@ -165,9 +213,12 @@ protected:
 #ifndef __unix__
     void *ctx; //not used, just for mirroring unix
 #else
-    libusb_context* ctx; //a libusb session
-    std::thread mUSBProcessingThread;
+    libusb_context* ctx; //a libusb session used for enumeration
+private:
+    static int LIBUSB_CALL OnHotplug(libusb_context* ctx, libusb_device* dev, libusb_hotplug_event event, void* user_data);
     void handle_libusb_events();
+    libusb_hotplug_callback_handle mHotplugHandle;
+    std::thread mUSBProcessingThread;
     std::atomic<bool> mProcessUSBEvents;
 #endif
 };
@@ -10,6 +10,8 @@
 using namespace lime;
 
 #ifdef __unix__
+/**	@brief Pumps libusb events of the enumeration session, hotplug callbacks are run here
+*/
 void ConnectionFX3Entry::handle_libusb_events()
 {
     struct timeval tv;
@@ -21,7 +23,16 @@ void ConnectionFX3Entry::handle_libusb_events()
         if(r != 0) lime::error("error libusb_handle_events %s", libusb_strerror(libusb_error(r)));
     }
 }
-#endif // __UNIX__
+
+int LIBUSB_CALL ConnectionFX3Entry::OnHotplug(libusb_context* ctx, libusb_device* dev, libusb_hotplug_event event, void* user_data)
+{
+    libusb_device_descriptor desc;
+    if (libusb_get_device_descriptor(dev, &desc) == 0 && desc.idVendor != 1204 && desc.idVendor != 7504)
+        return 0;
+    static_cast<ConnectionFX3Entry*>(user_data)->invalidateCache();
+    return 0;
+}
+#endif // __unix__
 
 //! make a static-initialized entry in the registry
 void __loadConnectionFX3Entry(void) //TODO fixme replace with LoadLibrary/dlopen
@@ -41,16 +52,30 @@ ConnectionFX3Entry::ConnectionFX3Entry(void):
 #else
     libusb_set_option(ctx, LIBUSB_OPTION_LOG_LEVEL, 3); //set verbosity level to 3, as suggested in the documentation
 #endif
-    mProcessUSBEvents.store(true);
-    mUSBProcessingThread = std::thread(&ConnectionFX3Entry::handle_libusb_events, this);
+    //with hotplug notifications enumeration results can be reused until devices change
+    mProcessUSBEvents.store(false);
+    if (libusb_has_capability(LIBUSB_CAP_HAS_HOTPLUG) &&
+        libusb_hotplug_register_callback(ctx,
+            libusb_hotplug_event(LIBUSB_HOTPLUG_EVENT_DEVICE_ARRIVED | LIBUSB_HOTPLUG_EVENT_DEVICE_LEFT),
+            LIBUSB_HOTPLUG_NO_FLAGS, LIBUSB_HOTPLUG_MATCH_ANY, LIBUSB_HOTPLUG_MATCH_ANY, LIBUSB_HOTPLUG_MATCH_ANY,
+            &ConnectionFX3Entry::OnHotplug, this, &mHotplugHandle) == LIBUSB_SUCCESS)
+    {
+        enableCache();
+        mProcessUSBEvents.store(true);
+        mUSBProcessingThread = std::thread(&ConnectionFX3Entry::handle_libusb_events, this);
+    }
 #endif
 }
 
 ConnectionFX3Entry::~ConnectionFX3Entry(void)
 {
 #ifdef __unix__
-    mProcessUSBEvents.store(false);
-    mUSBProcessingThread.join();
+    if (mProcessUSBEvents.load())
+    {
+        libusb_hotplug_deregister_callback(ctx, mHotplugHandle);
+        mProcessUSBEvents.store(false);
+        mUSBProcessingThread.join();
+    }
     libusb_exit(ctx);
 #endif
 }
@@ -121,6 +146,8 @@ std::vector<ConnectionHandle> ConnectionFX3Entry::enumerate(const ConnectionHand
                 continue;
 
             ConnectionHandle handle;
+            //bus number and device address, lets Open() skip other devices
+            handle.index = (libusb_get_bus_number(devs[i]) << 8) | libusb_get_device_address(devs[i]);
 
             //check operating speed
             int speed = libusb_get_device_speed(devs[i]);
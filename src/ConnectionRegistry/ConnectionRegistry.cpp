@@ -8,6 +8,7 @@
 #include "IConnection.h"
 #include <mutex>
 #include <map>
+#include <unordered_map>
 #include <memory>
 #include <iostream>
 #include <iso646.h> // alternative operators for visual c++: not, and, or...
@@ -26,6 +27,90 @@ static std::mutex &registryMutex(void)
 
 static std::map<std::string, ConnectionRegistryEntry *> registryEntries;
 
+/*******************************************************************
+ * Discovery cache
+ ******************************************************************/
+struct DiscoveryCache
+{
+    DiscoveryCache(void): enabled(false), valid(false), generation(0){}
+    bool enabled;
+    bool valid;
+    //incremented on every invalidation, so that results of
+    //an enumeration running during a hotplug event are not stored
+    unsigned long long generation;
+    std::vector<ConnectionHandle> handles;
+    std::unordered_map<std::string, std::vector<size_t>> bySerial;
+};
+
+//separate from the registry mutex, hotplug events must not wait for enumeration
+static std::mutex &cacheMutex(void)
+{
+    static std::mutex mutex;
+    return mutex;
+}
+
+static std::map<std::string, DiscoveryCache> discoveryCaches;
+
+static void invalidateDiscoveryCache(const std::string &name)
+{
+    std::lock_guard<std::mutex> lock(cacheMutex());
+    auto &cache = discoveryCaches[name];
+    cache.valid = false;
+    cache.generation++;
+}
+
+static std::vector<ConnectionHandle> filterBySerial(const DiscoveryCache &cache, const std::string &serial)
+{
+    if (serial.empty()) return cache.handles;
+    std::vector<ConnectionHandle> results;
+    const auto it = cache.bySerial.find(serial);
+    if (it != cache.bySerial.end())
+    {
+        for (const auto i : it->second) results.push_back(cache.handles[i]);
+    }
+    return results;
+}
+
+/*!
+ * Discover entry's handles, using cached results when the entry allows it.
+ * Must be called with the registry mutex held.
+ */
+static std::vector<ConnectionHandle> enumerateEntry(const std::string &name, ConnectionRegistryEntry *entry, const ConnectionHandle &hint, bool &fromCache)
+{
+    fromCache = false;
+    unsigned long long generation = 0;
+    {
+        std::lock_guard<std::mutex> lock(cacheMutex());
+        const auto it = discoveryCaches.find(name);
+        if (it == discoveryCaches.end() or not it->second.enabled) generation = ~0ull;
+        else if (it->second.valid)
+        {
+            fromCache = true;
+            return filterBySerial(it->second, hint.serial);
+        }
+        else generation = it->second.generation;
+    }
+    if (generation == ~0ull) return entry->enumerate(hint);
+
+    //refresh the whole list, so that later lookups by any serial are served from it
+    DiscoveryCache fresh;
+    fresh.handles = entry->enumerate(ConnectionHandle());
+    for (size_t i = 0; i < fresh.handles.size(); i++)
+    {
+        if (not fresh.handles[i].serial.empty()) fresh.bySerial[fresh.handles[i].serial].push_back(i);
+    }
+    const auto results = filterBySerial(fresh, hint.serial);
+
+    std::lock_guard<std::mutex> lock(cacheMutex());
+    auto &cache = discoveryCaches[name];
+    if (cache.enabled and cache.generation == generation)
+    {
+        cache.handles.swap(fresh.handles);
+        cache.bySerial.swap(fresh.bySerial);
+        cache.valid = true;
+    }
+    return results;
+}
 
 /*******************************************************************
  * Registry implementation
@@ -41,7 +126,8 @@ std::vector<ConnectionHandle> ConnectionRegistry::findConnections(const Connecti
         //filter by module name when specified
         if (not hint.module.empty() and hint.module != entry.first) continue;
 
-        for (auto handle : entry.second->enumerate(hint))
+        bool fromCache;
+        for (auto handle : enumerateEntry(entry.first, entry.second, hint, fromCache))
         {
             //insert the module name, which can be filtered on in makeConnection()
             handle.module = entry.first;
@@ -54,23 +140,44 @@ std::vector<ConnectionHandle> ConnectionRegistry::findConnections(const Connecti
 IConnection *ConnectionRegistry::makeConnection(const ConnectionHandle &handle)
 {
     __loadAllConnections();
-    std::lock_guard<std::mutex> lock(registryMutex());
 
-    //use the identifier as a hint to perform a discovery
-    //only identifiers from the discovery function itself is used in the factory
-    for (const auto &entry : registryEntries)
+    for (int attempt = 0; attempt < 2; attempt++)
     {
-        //filter by module name when specified
-        if (not handle.module.empty() and handle.module != entry.first) continue;
-
-        const auto r = entry.second->enumerate(handle);
-        if (r.empty()) continue;
-
-        auto realHandle = r.front(); //just pick the first
-        realHandle.module = entry.first;
+        ConnectionRegistryEntry *factory = nullptr;
+        ConnectionHandle realHandle;
+        bool fromCache = false;
+        {
+            std::lock_guard<std::mutex> lock(registryMutex());
+
+            //use the identifier as a hint to perform a discovery
+            //only identifiers from the discovery function itself is used in the factory
+            for (const auto &entry : registryEntries)
+            {
+                //filter by module name when specified
+                if (not handle.module.empty() and handle.module != entry.first) continue;
+
+                const auto r = enumerateEntry(entry.first, entry.second, handle, fromCache);
+                if (r.empty()) continue;
+
+                realHandle = r.front(); //just pick the first
+                realHandle.module = entry.first;
+                factory = entry.second;
+                break;
+            }
+        }
+        if (factory == nullptr) return nullptr;
 
-        return entry.second->make(realHandle);
+        //registry is not locked while connecting, so devices can be opened in parallel
+        IConnection *conn = factory->make(realHandle);
 
+        //cached device may have been replaced without notification, rediscover once
+        if (fromCache and attempt == 0 and (conn == nullptr or not conn->IsOpen()))
+        {
+            delete conn;
+            invalidateDiscoveryCache(realHandle.module);
+            continue;
+        }
+        return conn;
     }
 
     return nullptr;
@@ -81,8 +188,7 @@ void ConnectionRegistry::freeConnection(IConnection *conn)
     //some client code may end up freeing a null connection
     if (conn == nullptr) return;
 
-    std::lock_guard<std::mutex> lock(registryMutex());
-
+    //connections are independent, closing does not lock the registry
     delete conn;
 }
 
@@ -113,3 +219,14 @@ ConnectionRegistryEntry::~ConnectionRegistryEntry(void)
     std::lock_guard<std::mutex> lock(registryMutex());
     registryEntries.erase(_name);
 }
+
+void ConnectionRegistryEntry::enableCache(void)
+{
+    std::lock_guard<std::mutex> lock(cacheMutex());
+    discoveryCaches[_name].enabled = true;
+}
+
+void ConnectionRegistryEntry::invalidateCache(void)
+{
+    invalidateDiscoveryCache(_name);
+}
@@ -36,6 +36,7 @@ public:
     /*!
      * Create a connection from an identifying handle.
      * Return a null pointer when no factories are available.
+     * Connections to different devices may be made concurrently.
      * \param handle a connection handle with fields filled-in
      * \return a pointer to a connection instance (or null)
      */
@@ -93,6 +94,19 @@ public:
      */
     virtual IConnection *make(const ConnectionHandle &handle) = 0;
 
+protected:
+    /*!
+     * Allow the registry to keep results of enumerate().
+     * Only entries that are notified about device arrival and removal
+     * (e.g. by hotplug events) should enable the cache,
+     * and they must call invalidateCache() on every such event.
+     * Cached results are filtered only by the serial number of the hint.
+     */
+    void enableCache(void);
+
+    //! Drop cached results, next discovery calls enumerate() again
+    void invalidateCache(void);
+
 private:
     std::string _name;
 };
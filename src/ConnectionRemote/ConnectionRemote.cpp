@@ -1,70 +1,77 @@
 /**
     @file ConnectionRemote.cpp
     @author Lime Microsystems
-    @brief Implementation of EVB7 connection of serial COM port.
+    @brief Connection forwarding LMS64C control packets to remote server over TCP
 */
 
 #include "ConnectionRemote.h"
+#include "RemoteProtocol.h"
+#include "LMS64CCommands.h"
+#include "Logger.h"
 #include <string>
 #include "string.h"
-#include <fstream>
-#include <iostream>
-#include <stdio.h>
-#include "FPGA_common.h"
-#ifdef __unix__
-
+#include <algorithm>
+#include <thread>
 #include <errno.h>
-#include <unistd.h>
-#include <termios.h>
-#include <sys/types.h>
-#include <sys/stat.h>
-#include <fcntl.h>
-#include <stdlib.h>
-
-#include <termios.h>
-#include <unistd.h>
-#include <netinet/in.h>
-#include <arpa/inet.h>
-#include <fcntl.h>
-#else
-#include <Winsock.h>
-#endif // LINUX
 
 using namespace std;
 using namespace lime;
 
-ConnectionRemote::ConnectionRemote(const char *comName)
+static const int connectTimeout_ms = 3000;
+//replies include network round trip and remote device latency
+static const int minTimeout_ms = 1000;
+static const int probeTimeout_ms = 500;
+//connection unused for longer is checked before sending requests
+static const auto idleProbeInterval = std::chrono::seconds(2);
+static const int udpBufferSize = 4*1024*1024;
+
+ConnectionRemote::ConnectionRemote(const char *address) :
+    remotePort(remote::defaultPort),
+    socketFd(-1),
+    nextSequence(0),
+    expectedSequence(0),
+    udpStreaming(false)
 {
-    CloseRemote();
-    remoteIP = std::string(comName);
-    socketFd = -1;
-#ifndef __unix__
-    WSADATA wsaData;
-    if( int err = WSAStartup(0x0202, &wsaData))
-        printf("WSAStartup error %i\n", err);
-#endif
+    remoteHost = std::string(address);
+    const size_t slash = remoteHost.find('/');
+    if (slash != std::string::npos)
+    {
+        udpStreaming = remoteHost.substr(slash+1) == "udp";
+        remoteHost.erase(slash);
+    }
+    const size_t colon = remoteHost.rfind(':');
+    if (colon != std::string::npos && remoteHost.find(':') == colon)
+    {
+        remotePort = atoi(remoteHost.substr(colon+1).c_str());
+        remoteHost.erase(colon);
+    }
+    //server answers packets in order, TCP buffers the ones written ahead
+    mControlPipelineDepth = 8;
+    for (auto &link : streams)
+    {
+        link.fd = -1;
+        link.udpFd = -1;
+        for (auto &transfer : link.transfers)
+            transfer.used = false;
+    }
+    remote::InitSockets();
 }
 
 ConnectionRemote::~ConnectionRemote(void)
 {
+    StopAsyncControl();
+    for (int ep = 0; ep < MAX_EP_CNT; ++ep)
+    {
+        AbortTransfers(ep, false);
+        AbortTransfers(ep, true);
+    }
     Close();
-#ifndef __unix__
-    WSACleanup();
-#endif
+    remote::CleanupSockets();
 }
 
 void ConnectionRemote::Close(void)
 {
-    if(socketFd)
-    {
-#ifndef __unix__
-        //shutdown(socketFd, SD_BOTH);
-        closesocket(socketFd);
-#else
-        shutdown(socketFd, SHUT_RDWR);
-        close(socketFd);
-#endif
-    }
+    remote::CloseSocket(socketFd);
     socketFd = -1;
 }
 
@@ -75,101 +82,484 @@ bool ConnectionRemote::IsOpen(void)
 
 int ConnectionRemote::Open()
 {
+    if (socketFd >= 0 && std::chrono::steady_clock::now() - lastActivity > idleProbeInterval && !Ping())
+    {
+        lime::debug("Remote: connection to %s lost, reconnecting", remoteHost.c_str());
+        Close();
+    }
     if (socketFd < 0)
-        return Connect(remoteIP.c_str(), 5000);
+        return Connect();
     return 0;
 }
 
-int ConnectionRemote::Connect(const char* ip, uint16_t port)
+int ConnectionRemote::Connect()
 {
-    struct sockaddr_in clientService;
-    clientService.sin_family = AF_INET;
-    clientService.sin_addr.s_addr = inet_addr(ip);
-    clientService.sin_port = htons(port);
+    socketFd = remote::ConnectSocket(remoteHost, remotePort, connectTimeout_ms);
+    if (socketFd < 0)
+        return ReportError(ECONNREFUSED, "Remote: cannot connect to %s:%i", remoteHost.c_str(), int(remotePort));
+    expectedSequence = nextSequence;
+    lastActivity = std::chrono::steady_clock::now();
+    return 0;
+}
 
-    socketFd = socket(AF_INET, SOCK_STREAM, 0);
-    if(socketFd < 0)
+/** @brief Sends keep-alive frame and waits for its echo
+    @return true if server answered
+*/
+bool ConnectionRemote::Ping()
+{
+    uint8_t frame[remote::frameLength];
+    const uint32_t sequence = nextSequence++;
+    remote::EncodeFrame(frame, remote::FRAME_KEEPALIVE, sequence, nullptr);
+    if (remote::SendAll(socketFd, frame, sizeof(frame), probeTimeout_ms) != sizeof(frame))
+        return false;
+    while (remote::RecvAll(socketFd, frame, sizeof(frame), probeTimeout_ms) == sizeof(frame))
     {
-#ifndef __unix__
-        printf("socket failed with error: %d\n", WSAGetLastError());
-#else
-        printf("socket failed with error %i", socketFd);
-#endif
-
-        return -1;
+        remote::FrameType type;
+        uint32_t replySequence;
+        if (!remote::DecodeFrame(frame, type, replySequence))
+            return false;
+        //late replies of abandoned requests are skipped
+        if (type == remote::FRAME_KEEPALIVE && replySequence == sequence)
+        {
+            expectedSequence = nextSequence;
+            lastActivity = std::chrono::steady_clock::now();
+            return true;
+        }
     }
+    return false;
+}
 
-    if(int result = connect(socketFd, (struct sockaddr*)&clientService, sizeof(clientService)) )
+//! @brief Commands that only read, executing them twice does no harm
+static bool IsReadCommand(const eCMD_LMS cmd)
+{
+    switch (cmd)
     {
-#ifndef __unix__
-        printf("connect failed with error: %d\n", WSAGetLastError());
-        closesocket(socketFd);
-#else
-        printf("connect failed with error: %d\n", result);
-        close(socketFd);
-#endif
-        return -1;
+    case CMD_GET_INFO:
+    case CMD_SI5356_RD:
+    case CMD_SI5351_RD:
+    case CMD_TFP410_RD:
+    case CMD_LMS7002_RD:
+    case CMD_LMS6002_RD:
+    case CMD_PE636040_RD:
+    case CMD_GPIO_DIR_RD:
+    case CMD_GPIO_RD:
+    case CMD_ALTERA_FPGA_GW_RD:
+    case CMD_BRDSPI_RD:
+    case CMD_BRDSPI8_RD:
+    case CMD_BRDCONF_RD:
+    case CMD_ANALOG_VAL_RD:
+    case CMD_MYRIAD_RD:
+    case CMD_MEMORY_RD:
+        return true;
+    default:
+        return false;
     }
-    return 0;
 }
 
 int ConnectionRemote::TransferPacket(GenericPacket &pkt)
 {
-    int status;
     std::lock_guard<std::mutex> lock(mTransferLock);
-    if (Open() == 0)
-        status = LMS64CProtocol::TransferPacket(pkt);
-    else
-        status = -1;
-    Close();
-    return status;
+    const GenericPacket request = pkt;
+    for (int attempt = 0; ; ++attempt)
+    {
+        if (Open() != 0)
+            return -1;
+        const uint32_t firstSequence = nextSequence;
+        int status = LMS64CProtocol::TransferPacket(pkt);
+        //connection broke during transfer, repeat it once over a new one,
+        //unless server may have already executed the command
+        if (status != 0 && socketFd < 0 && attempt == 0
+            && (nextSequence == firstSequence || IsReadCommand(request.cmd)))
+        {
+            pkt = request;
+            continue;
+        }
+        return status;
+    }
 }
 
 int ConnectionRemote::Write(const unsigned char *data, int len, int timeout_ms)
 {
+    if (socketFd < 0)
+        return 0;
+    timeout_ms = std::max(timeout_ms, minTimeout_ms);
+    uint8_t frame[remote::frameLength];
+    uint8_t packet[remote::packetLength];
     int bytesWritten = 0;
-    while(bytesWritten < len)
+    while (bytesWritten < len)
     {
-        int wrBytes = send(socketFd, (char*)data+bytesWritten, len-bytesWritten, 0);
-        if(wrBytes < 0)
+        const int chunk = std::min(len - bytesWritten, remote::packetLength);
+        memset(packet, 0, sizeof(packet));
+        memcpy(packet, data + bytesWritten, chunk);
+        remote::EncodeFrame(frame, remote::FRAME_CONTROL, nextSequence, packet);
+        bool failed = false;
+        if (remote::SendAll(socketFd, frame, sizeof(frame), timeout_ms, &failed) != sizeof(frame))
         {
-            printf("Write failed\n");
-            return 0;
+            lime::debug("Remote: %s while sending request", failed ? "connection lost" : "timeout");
+            Close();
+            break;
         }
-        bytesWritten += wrBytes;
-        std::this_thread::yield();
+        ++nextSequence;
+        bytesWritten += chunk;
     }
+    lastActivity = std::chrono::steady_clock::now();
     return bytesWritten;
 }
 
 int ConnectionRemote::Read(unsigned char *response, int len, int timeout_ms)
 {
+    if (socketFd < 0)
+        return 0;
+    timeout_ms = std::max(timeout_ms, minTimeout_ms);
+    uint8_t frame[remote::frameLength];
     int bytesRead = 0;
-    while(bytesRead < len)
+    while (bytesRead < len)
     {
-        int rdBytes = recv(socketFd, (char*)response+bytesRead, len-bytesRead, 0);
-        if(rdBytes < 0)
+        bool failed = false;
+        const int received = remote::RecvAll(socketFd, frame, sizeof(frame), timeout_ms, &failed);
+        if (received != sizeof(frame))
+        {
+            lime::debug("Remote: %s while waiting for reply", failed ? "connection lost" : "timeout");
+            if (failed || received > 0) //frame boundary is lost
+                Close();
+            else //replies that are still on the way are skipped when they arrive
+                expectedSequence = nextSequence;
+            break;
+        }
+        remote::FrameType type;
+        uint32_t sequence;
+        if (!remote::DecodeFrame(frame, type, sequence))
+        {
+            lime::error("Remote: invalid frame received");
+            Close();
+            break;
+        }
+        const int32_t age = int32_t(sequence - expectedSequence);
+        if (type != remote::FRAME_CONTROL || age < 0)
+            continue; //keep-alive echo or late reply of abandoned request
+        if (age > 0)
         {
-            printf("Read failed\n");
-            return 0;
+            lime::error("Remote: reply to request %u is missing", expectedSequence);
+            Close();
+            break;
         }
-        bytesRead += rdBytes;
-        std::this_thread::yield();
+        const int chunk = std::min(len - bytesRead, remote::packetLength);
+        memcpy(response + bytesRead, &frame[remote::headerLength], chunk);
+        bytesRead += chunk;
+        ++expectedSequence;
     }
+    lastActivity = std::chrono::steady_clock::now();
     return bytesRead;
 }
 
 int ConnectionRemote::GetBuffersCount() const
 {
-    return 1;
+    return 16;
 }
 int ConnectionRemote::CheckStreamSize(int size) const
 {
     return size;
 }
 
+/** @brief Opens stream connection of given endpoint and direction
+    @return 0 on success
+*/
+int ConnectionRemote::OpenStream(StreamLink &link, int ep, bool tx)
+{
+    //server notices closing of previous stream connection with a delay
+    const auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(connectTimeout_ms);
+    int status;
+    while ((status = RequestStream(link, ep, tx)) == EBUSY && std::chrono::steady_clock::now() < deadline)
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    if (status > 0)
+        return ReportError(status, "Remote: server refused %s stream of endpoint %i", tx ? "Tx" : "Rx", ep);
+    return status;
+}
 
+/** @brief Connects to server and requests stream
+    @return 0 on success, error code received from server, -1 on other failures
+*/
+int ConnectionRemote::RequestStream(StreamLink &link, int ep, bool tx)
+{
+    link.fd = remote::ConnectSocket(remoteHost, remotePort, connectTimeout_ms);
+    if (link.fd < 0)
+        return ReportError(ECONNREFUSED, "Remote: cannot connect to %s:%i", remoteHost.c_str(), int(remotePort));
 
+    remote::StreamRequest request;
+    request.ep = ep;
+    request.tx = tx;
+    request.transport = (udpStreaming && !tx) ? remote::STREAM_UDP : remote::STREAM_TCP;
+    request.udpPort = 0;
+    request.credits = 0;
+    if (request.transport == remote::STREAM_UDP)
+    {
+        int bufferSize = udpBufferSize;
+        link.udpFd = remote::BindDatagramSocket(link.fd, request.udpPort, bufferSize);
+        if (link.udpFd < 0)
+        {
+            CloseStream(link);
+            return ReportError(EIO, "Remote: cannot open UDP socket");
+        }
+        //server sends no more than fits into socket buffer, excess is dropped on its side
+        request.credits = std::max(bufferSize / (2*remote::datagramLength), 4);
+    }
+    link.credits = request.credits;
+    link.granted = 0;
+    link.nextDatagram = 0;
 
+    uint8_t packet[remote::packetLength];
+    uint8_t frame[remote::frameLength];
+    remote::EncodeStreamRequest(packet, request);
+    remote::EncodeFrame(frame, remote::FRAME_STREAM, 0, packet);
+    remote::FrameType type;
+    uint32_t sequence;
+    if (remote::SendAll(link.fd, frame, sizeof(frame), connectTimeout_ms) != sizeof(frame)
+        || remote::RecvAll(link.fd, frame, sizeof(frame), connectTimeout_ms) != sizeof(frame)
+        || !remote::DecodeFrame(frame, type, sequence) || type != remote::FRAME_STREAM)
+    {
+        CloseStream(link);
+        return ReportError(EIO, "Remote: stream request failed");
+    }
+    const int status = frame[remote::headerLength];
+    if (status != 0)
+        CloseStream(link);
+    return status;
+}
 
+void ConnectionRemote::CloseStream(StreamLink &link)
+{
+    remote::CloseSocket(link.fd);
+    remote::CloseSocket(link.udpFd);
+    link.fd = -1;
+    link.udpFd = -1;
+}
 
+int ConnectionRemote::BeginTransfer(char* buffer, uint32_t length, int ep, bool tx)
+{
+    if (ep < 0 || ep >= MAX_EP_CNT)
+        return ReportError(EINVAL, "Remote: invalid stream endpoint %i", ep);
+    const int linkIndex = 2*ep + tx;
+    StreamLink &link = streams[linkIndex];
+    std::lock_guard<std::mutex> lock(link.lock);
+    if (link.fd < 0 && OpenStream(link, ep, tx) != 0)
+        return -1;
+    int slot = 0;
+    while (slot < MAX_TRANSFERS && link.transfers[slot].used)
+        ++slot;
+    if (slot == MAX_TRANSFERS)
+        return ReportError(EBUSY, "Remote: too many transfers in flight");
+    StreamTransfer &transfer = link.transfers[slot];
+    transfer.buffer = buffer;
+    transfer.length = length;
+    transfer.done = 0;
+    transfer.used = true;
+    transfer.failed = false;
+    link.queue.push_back(slot);
+    const int handle = linkIndex*MAX_TRANSFERS + slot;
+    if (tx) //start sending right away, the rest is sent while waiting
+        SendPackets(link, handle, 0);
+    return handle;
+}
+
+bool ConnectionRemote::WaitTransfer(int handle, unsigned timeout_ms)
+{
+    if (handle < 0 || handle >= 2*MAX_EP_CNT*MAX_TRANSFERS)
+        return true;
+    const int linkIndex = handle / MAX_TRANSFERS;
+    StreamLink &link = streams[linkIndex];
+    std::lock_guard<std::mutex> lock(link.lock);
+    if (linkIndex % 2)
+        return SendPackets(link, handle, timeout_ms);
+    return ReceivePackets(link, handle, timeout_ms);
+}
+
+/** @brief Releases transfer, cancels it if it is still in progress
+    @return number of bytes transferred
+*/
+int ConnectionRemote::FinishTransfer(int handle)
+{
+    if (handle < 0 || handle >= 2*MAX_EP_CNT*MAX_TRANSFERS)
+        return 0;
+    StreamLink &link = streams[handle / MAX_TRANSFERS];
+    std::lock_guard<std::mutex> lock(link.lock);
+    StreamTransfer &transfer = link.transfers[handle % MAX_TRANSFERS];
+    auto iter = std::find(link.queue.begin(), link.queue.end(), handle % MAX_TRANSFERS);
+    if (iter != link.queue.end())
+    {
+        link.queue.erase(iter);
+        //stream would continue in the middle of packet, start over with new connection
+        if (transfer.done % remote::streamPacketLength)
+        {
+            CloseStream(link);
+            for (int slot : link.queue)
+                link.transfers[slot].failed = true;
+            link.queue.clear();
+        }
+    }
+    transfer.used = false;
+    return transfer.done;
+}
+
+void ConnectionRemote::AbortTransfers(int ep, bool tx)
+{
+    if (ep < 0 || ep >= MAX_EP_CNT)
+        return;
+    StreamLink &link = streams[2*ep + tx];
+    std::lock_guard<std::mutex> lock(link.lock);
+    CloseStream(link);
+    link.queue.clear();
+    for (auto &transfer : link.transfers)
+        transfer.used = false;
+}
+
+/** @brief Fills queued transfers in order with received packets
+    @return true if transfer of given handle is completed
+*/
+bool ConnectionRemote::ReceivePackets(StreamLink &link, int handle, unsigned timeout_ms)
+{
+    const StreamTransfer &target = link.transfers[handle % MAX_TRANSFERS];
+    const auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeout_ms);
+    uint8_t datagram[remote::datagramLength];
+    while (!target.Completed() && !link.queue.empty())
+    {
+        const int left = std::chrono::duration_cast<std::chrono::milliseconds>(deadline - std::chrono::steady_clock::now()).count();
+        if (left < 0)
+            break;
+        StreamTransfer &head = link.transfers[link.queue.front()];
+        bool failed = false;
+        if (link.udpFd < 0)
+            head.done += remote::RecvAll(link.fd, head.buffer + head.done, head.length - head.done, left, &failed);
+        else
+        {
+            const int received = remote::RecvDatagram(link.udpFd, datagram, sizeof(datagram), left);
+            uint32_t sequence;
+            if (received == sizeof(datagram) && remote::DecodeDatagramHeader(datagram, sequence))
+            {
+                //reordered datagrams are dropped to keep timestamps increasing
+                if (int32_t(sequence - link.nextDatagram) >= 0)
+                {
+                    const uint32_t chunk = std::min<uint32_t>(head.length - head.done, remote::streamPacketLength);
+                    memcpy(head.buffer + head.done, &datagram[remote::datagramHeaderLength], chunk);
+                    head.done += chunk;
+                    link.nextDatagram = sequence + 1;
+                }
+                if (link.nextDatagram - link.granted >= std::max<uint32_t>(link.credits/4, 1))
+                {
+                    //allow server to send up to the limit, lost datagrams are granted again too
+                    const uint32_t limit = link.nextDatagram + link.credits;
+                    const uint8_t grant[4] = {uint8_t(limit >> 24), uint8_t(limit >> 16), uint8_t(limit >> 8), uint8_t(limit)};
+                    failed = remote::SendAll(link.fd, grant, sizeof(grant), minTimeout_ms) != sizeof(grant);
+                    link.granted = link.nextDatagram;
+                }
+            }
+            else if (received < 0)
+                failed = true;
+            else if (received == 0) //server does not send anything else over TCP, check if it is still there
+            {
+                uint8_t unused;
+                remote::RecvAll(link.fd, &unused, sizeof(unused), 0, &failed);
+            }
+        }
+        if (failed)
+        {
+            lime::error("Remote: stream connection lost");
+            for (int slot : link.queue)
+                link.transfers[slot].failed = true;
+            link.queue.clear();
+            CloseStream(link);
+            break;
+        }
+        if (head.Completed())
+            link.queue.pop_front();
+    }
+    return target.Completed();
+}
+
+/** @brief Sends queued transfers in order
+    @return true if transfer of given handle is completed
+*/
+bool ConnectionRemote::SendPackets(StreamLink &link, int handle, unsigned timeout_ms)
+{
+    const StreamTransfer &target = link.transfers[handle % MAX_TRANSFERS];
+    const auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeout_ms);
+    while (!target.Completed() && !link.queue.empty())
+    {
+        const int left = std::chrono::duration_cast<std::chrono::milliseconds>(deadline - std::chrono::steady_clock::now()).count();
+        if (left < 0)
+            break;
+        StreamTransfer &head = link.transfers[link.queue.front()];
+        bool failed = false;
+        head.done += remote::SendAll(link.fd, head.buffer + head.done, head.length - head.done, left, &failed);
+        if (failed)
+        {
+            lime::error("Remote: stream connection lost");
+            for (int slot : link.queue)
+                link.transfers[slot].failed = true;
+            link.queue.clear();
+            CloseStream(link);
+            break;
+        }
+        if (!head.Completed())
+            break;
+        link.queue.pop_front();
+    }
+    return target.Completed();
+}
+
+int ConnectionRemote::BeginDataReading(char* buffer, uint32_t length, int ep)
+{
+    return BeginTransfer(buffer, length, ep, false);
+}
+
+bool ConnectionRemote::WaitForReading(int contextHandle, unsigned int timeout_ms)
+{
+    return WaitTransfer(contextHandle, timeout_ms);
+}
+
+int ConnectionRemote::FinishDataReading(char* buffer, uint32_t length, int contextHandle)
+{
+    return FinishTransfer(contextHandle);
+}
+
+void ConnectionRemote::AbortReading(int ep)
+{
+    AbortTransfers(ep, false);
+}
+
+int ConnectionRemote::BeginDataSending(const char* buffer, uint32_t length, int ep)
+{
+    return BeginTransfer(const_cast<char*>(buffer), length, ep, true);
+}
+
+bool ConnectionRemote::WaitForSending(int contextHandle, uint32_t timeout_ms)
+{
+    return WaitTransfer(contextHandle, timeout_ms);
+}
+
+int ConnectionRemote::FinishDataSending(const char* buffer, uint32_t length, int contextHandle)
+{
+    return FinishTransfer(contextHandle);
+}
+
+void ConnectionRemote::AbortSending(int ep)
+{
+    AbortTransfers(ep, true);
+}
+
+int ConnectionRemote::ReceiveData(char* buffer, int length, int epIndex, int timeout)
+{
+    const int handle = BeginDataReading(buffer, length, epIndex);
+    if (handle < 0)
+        return -1;
+    WaitForReading(handle, timeout);
+    return FinishDataReading(buffer, length, handle);
+}
+
+int ConnectionRemote::SendData(const char* buffer, int length, int epIndex, int timeout)
+{
+    const int handle = BeginDataSending(buffer, length, epIndex);
+    if (handle < 0)
+        return -1;
+    WaitForSending(handle, timeout);
+    return FinishDataSending(buffer, length, handle);
+}
@@ -1,7 +1,7 @@
 /**
     @file ConnectionRemote.h
     @author Lime Microsystems
-    @brief Implementation of EVB7 connection of serial COM port.
+    @brief Connection forwarding LMS64C control packets to remote server over TCP
 */
 
 #pragma once
@@ -10,30 +10,39 @@
 #include <LMS64CProtocol.h>
 #include <vector>
 #include <string>
+#include <chrono>
+#include <deque>
+#include <mutex>
 #include "IConnection.h"
 
 namespace lime{
 
+/** @brief Persistent TCP connection to RemoteControlServer
+
+    Connection is opened on the first transfer and kept open. Requests are
+    tagged with sequence numbers, so several of them can be written ahead of
+    their replies and late replies of timed out requests are discarded.
+    Connection idle for a while is probed before use and reestablished if
+    server is no longer reachable.
+
+    Each stream endpoint and direction uses separate connection to the server,
+    which relays FPGA packets as they are, so timestamps and packed 12 bit
+    link format are kept. Received packets may be carried over UDP, packets
+    lost on the way show up as timestamp gaps and are counted by Streamer.
+*/
 class ConnectionRemote : public LMS64CProtocol
 {
 public:
-    struct Packet
-    {
-        uint8_t cmd;
-        uint8_t data[64];
-    };
-
-    ConnectionRemote(const char *comName);
+    /** @param address server address, "host[:port][/udp]", received
+        samples are carried over UDP when "/udp" is given
+    */
+    ConnectionRemote(const char *address);
     ~ConnectionRemote(void);
     int TransferPacket(GenericPacket &pkt) override;
     bool IsOpen(void);
     eConnectionType GetType(void) {return CONNECTION_UNDEFINED;};
-    //int TransactSPI(const int addr, const uint32_t *writeData, uint32_t *readData, const size_t size) override;
 
 protected:
-    int socketFd;
-    int Connect(const char* ip, uint16_t port);
-
     //! virtual write function to be implemented by the base class
     int Write(const unsigned char *buffer, int length, int timeout_ms = 100) override;
 
@@ -42,11 +51,70 @@ protected:
 
     int GetBuffersCount() const override;
     int CheckStreamSize(int size) const override;
+
+    int ReceiveData(char* buffer, int length, int epIndex, int timeout = 100) override;
+    int SendData(const char* buffer, int length, int epIndex, int timeout = 100) override;
+
+    int BeginDataReading(char* buffer, uint32_t length, int ep) override;
+    bool WaitForReading(int contextHandle, unsigned int timeout_ms) override;
+    int FinishDataReading(char* buffer, uint32_t length, int contextHandle) override;
+    void AbortReading(int ep) override;
+
+    int BeginDataSending(const char* buffer, uint32_t length, int ep) override;
+    bool WaitForSending(int contextHandle, uint32_t timeout_ms) override;
+    int FinishDataSending(const char* buffer, uint32_t length, int contextHandle) override;
+    void AbortSending(int ep) override;
 private:
     int Open();
+    int Connect();
     void Close(void);
+    bool Ping();
+
+    static const int MAX_EP_CNT = 4;
+    static const int MAX_TRANSFERS = 32;
+
+    struct StreamTransfer
+    {
+        char* buffer;
+        uint32_t length;
+        uint32_t done; //bytes transferred
+        bool used;
+        bool failed;
+        bool Completed() const {return failed || done == length;}
+    };
+
+    //! connection carrying one endpoint in one direction
+    struct StreamLink
+    {
+        std::mutex lock;
+        int fd;
+        int udpFd;
+        uint32_t credits; //datagrams server may send ahead
+        uint32_t granted; //sequence number the last grant was based on
+        uint32_t nextDatagram;
+        StreamTransfer transfers[MAX_TRANSFERS];
+        std::deque<int> queue; //unfinished transfers, in submission order
+    };
+
+    int BeginTransfer(char* buffer, uint32_t length, int ep, bool tx);
+    bool WaitTransfer(int handle, unsigned timeout_ms);
+    int FinishTransfer(int handle);
+    void AbortTransfers(int ep, bool tx);
+    int OpenStream(StreamLink &link, int ep, bool tx);
+    int RequestStream(StreamLink &link, int ep, bool tx);
+    void CloseStream(StreamLink &link);
+    bool ReceivePackets(StreamLink &link, int handle, unsigned timeout_ms);
+    bool SendPackets(StreamLink &link, int handle, unsigned timeout_ms);
+
     std::mutex mTransferLock;
-    std::string remoteIP;
+    std::string remoteHost;
+    uint16_t remotePort;
+    int socketFd;
+    uint32_t nextSequence; //tag of the next request
+    uint32_t expectedSequence; //tag of the next reply to be read
+    std::chrono::steady_clock::time_point lastActivity;
+    bool udpStreaming;
+    StreamLink streams[2*MAX_EP_CNT]; //index is 2*ep+tx
 };
 
 class ConnectionRemoteEntry : public ConnectionRegistryEntry
@@ -0,0 +1,139 @@
+/**
+    @file LimeStreamServer.cpp
+    @author Lime Microsystems
+    @brief Serves local device to ConnectionRemote clients over network
+*/
+
+#include "RemoteControlServer.h"
+#include "RemoteProtocol.h"
+#include "ConnectionRegistry.h"
+#include "IConnection.h"
+#include "Logger.h"
+#include <iostream>
+#include <cstdlib>
+#include <getopt.h>
+#include <signal.h>
+#include <string>
+#include <algorithm>
+#include <thread>
+#include <chrono>
+#include <atomic>
+
+using namespace std;
+using namespace lime;
+
+static atomic<bool> stopRequested(false);
+
+static void signalHandler(int)
+{
+    stopRequested = true;
+}
+
+int log_level = LOG_LEVEL_INFO;
+
+void log_func(const lime::LogLevel level, const char *message)
+{
+    if (level <= log_level)
+        cout << message << endl;
+}
+
+int printHelp(void)
+{
+    cout << "Usage LimeStreamServer [options]" << endl;
+    cout << "  --args \"<device args>\"  device to serve, first found by default" << endl;
+    cout << "  --port <port>           TCP port, default " << remote::defaultPort << endl;
+    cout << "  --loopback              serve test connection returning samples sent to it" << endl;
+    cout << "  --log <level>           log level, 0-5, default " << LOG_LEVEL_INFO << endl;
+    cout << "  --help                  show this help" << endl;
+    return EXIT_SUCCESS;
+}
+
+int main(int argc, char** argv)
+{
+    string args;
+    int port = remote::defaultPort;
+    bool loopback = false;
+
+    int c;
+    while (1)
+    {
+        static struct option long_options[] =
+        {
+            {"args",        required_argument, 0, 'a'},
+            {"port",        required_argument, 0, 'p'},
+            {"loopback",    no_argument, 0, 'b'},
+            {"log",         required_argument, 0, 'l'},
+            {"help",        no_argument, 0, 'h'},
+            {0, 0, 0, 0}
+        };
+        int option_index = 0;
+        c = getopt_long (argc, argv, "a:p:bl:h", long_options, &option_index);
+
+        if (c == -1)
+            break;
+        switch (c)
+        {
+        case 'a':
+            args = optarg;
+            break;
+        case 'p':
+            port = stoi(optarg);
+            break;
+        case 'b':
+            loopback = true;
+            break;
+        case 'l':
+            log_level = stoi(optarg);
+            break;
+        case 'h':
+            return printHelp();
+        default:
+            printHelp();
+            return EXIT_FAILURE;
+        }
+    }
+    lime::registerLogHandler(log_func);
+
+    IConnection* connection = nullptr;
+    if (!loopback)
+    {
+        auto handles = ConnectionRegistry::findConnections(ConnectionHandle(args));
+        //remote connection would only forward to itself
+        handles.erase(remove_if(handles.begin(), handles.end(),
+            [](const ConnectionHandle &handle){return handle.media == "TCP";}), handles.end());
+        if (handles.empty())
+        {
+            cerr << "No devices found" << endl;
+            return EXIT_FAILURE;
+        }
+        connection = ConnectionRegistry::makeConnection(handles[0]);
+        if (connection == nullptr || !connection->IsOpen())
+        {
+            cerr << "Failed to open " << handles[0].ToString() << endl;
+            ConnectionRegistry::freeConnection(connection);
+            return EXIT_FAILURE;
+        }
+        cout << "Serving " << handles[0].ToString() << endl;
+    }
+    else
+        cout << "Serving loopback test connection" << endl;
+
+    RemoteControlServer server(connection);
+    if (server.Start(port) != 0)
+    {
+        cerr << GetLastErrorMessage() << endl;
+        ConnectionRegistry::freeConnection(connection);
+        return EXIT_FAILURE;
+    }
+    cout << "Listening on port " << server.GetPort() << ", press Ctrl+C to stop" << endl;
+
+    signal(SIGINT, signalHandler);
+    signal(SIGTERM, signalHandler);
+    while (!stopRequested)
+        this_thread::sleep_for(chrono::milliseconds(200));
+
+    server.Stop();
+    if (connection)
+        ConnectionRegistry::freeConnection(connection);
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,533 @@
+/**
+    @file RemoteControlServer.cpp
+    @author Lime Microsystems
+    @brief Serves LMS64C control packets of remote clients using local connection
+*/
+
+#include "RemoteControlServer.h"
+#include "RemoteProtocol.h"
+#include "StreamLoopback.h"
+#include "IConnection.h"
+#include "LMS64CProtocol.h"
+#include "LMS64CCommands.h"
+#include "LMSBoards.h"
+#include "ADCUnits.h"
+#include "Logger.h"
+#include <cstring>
+#include <cmath>
+#include <cstdlib>
+#include <algorithm>
+#include <vector>
+#include <chrono>
+#include <errno.h>
+#ifdef __unix__
+#include <poll.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#else
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#define poll WSAPoll
+#endif
+
+using namespace lime;
+
+static const int sendTimeout_ms = 5000;
+static const int acceptPollInterval_ms = 200;
+static const int relayPollInterval_ms = 100;
+static const int relayBatch = 16; //packets in one transfer of served connection
+static const int relayDepth = 8; //transfers of served connection in flight
+static const auto grantTimeout = std::chrono::milliseconds(500);
+static const int dataLength = remote::packetLength - 8;
+static const char adcUnitsPrefix[] = " kMGTPEZyzafpnum";
+static const int adcUnitsExponent[] = {0, 3, 6, 9, 12, 15, 18, 21, -24, -21, -18, -15, -12, -9, -6, -3};
+
+/** @brief Splits units string returned by CustomParameterRead
+    @return units byte of ANALOG_VAL packet, prefix index in lower nibble
+*/
+static uint8_t EncodeUnits(const std::string &units)
+{
+    for (int prefixed = 1; prefixed >= 0; --prefixed)
+    {
+        if (prefixed && (units.empty() || strchr(adcUnitsPrefix, units[0]) == nullptr))
+            continue;
+        const std::string name = units.substr(prefixed);
+        for (unsigned unit = 0; unit < ADC_UNITS_COUNT; ++unit)
+            if (name == adcUnits2string(unit))
+                return (unit << 4) | (prefixed ? strchr(adcUnitsPrefix, units[0]) - adcUnitsPrefix : 0);
+    }
+    return RAW << 4;
+}
+
+RemoteControlServer::RemoteControlServer(IConnection* connection) :
+    loopback(connection ? nullptr : new StreamLoopback()),
+    connection(connection ? connection : loopback.get()),
+    running(false),
+    listenFd(-1),
+    listenPort(0)
+{
+    remote::InitSockets();
+}
+
+RemoteControlServer::~RemoteControlServer()
+{
+    Stop();
+    remote::CleanupSockets();
+}
+
+int RemoteControlServer::Start(uint16_t port)
+{
+    Stop();
+    listenFd = socket(AF_INET, SOCK_STREAM, 0);
+    if (listenFd < 0)
+        return ReportError(errno, "RemoteControlServer: cannot create socket");
+
+    int enable = 1;
+    setsockopt(listenFd, SOL_SOCKET, SO_REUSEADDR, (const char*)&enable, sizeof(enable));
+    sockaddr_in address;
+    memset(&address, 0, sizeof(address));
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = htonl(INADDR_ANY);
+    address.sin_port = htons(port);
+    socklen_t addressLength = sizeof(address);
+    if (bind(listenFd, (sockaddr*)&address, sizeof(address)) != 0
+        || listen(listenFd, 4) != 0
+        || getsockname(listenFd, (sockaddr*)&address, &addressLength) != 0)
+    {
+        const int err = errno;
+        remote::CloseSocket(listenFd);
+        listenFd = -1;
+        return ReportError(err, "RemoteControlServer: cannot listen on port %i", int(port));
+    }
+    listenPort = ntohs(address.sin_port);
+    running = true;
+    acceptThread = std::thread(&RemoteControlServer::AcceptLoop, this);
+    lime::debug("Remote control server listening on port %i", int(listenPort));
+    return 0;
+}
+
+void RemoteControlServer::Stop()
+{
+    running = false;
+    if (acceptThread.joinable())
+        acceptThread.join();
+    remote::CloseSocket(listenFd);
+    listenFd = -1;
+    ReapClients(true);
+}
+
+uint16_t RemoteControlServer::GetPort() const
+{
+    return listenPort;
+}
+
+void RemoteControlServer::AcceptLoop()
+{
+    while (running)
+    {
+        pollfd pfd;
+        pfd.fd = listenFd;
+        pfd.events = POLLIN;
+        pfd.revents = 0;
+        if (poll(&pfd, 1, acceptPollInterval_ms) <= 0)
+            continue;
+        const int fd = accept(listenFd, nullptr, nullptr);
+        if (fd < 0)
+            continue;
+        remote::ConfigureSocket(fd);
+        ReapClients(false);
+
+        std::lock_guard<std::mutex> lock(clientsLock);
+        Client* client = new Client;
+        client->fd = fd;
+        client->finished = false;
+        clients.emplace_back(client);
+        client->thread = std::thread(&RemoteControlServer::ServeClient, this, client);
+    }
+}
+
+/** @brief Joins threads of disconnected clients and closes their sockets
+    @param all disconnect and release every client
+*/
+void RemoteControlServer::ReapClients(bool all)
+{
+    std::lock_guard<std::mutex> lock(clientsLock);
+    for (auto iter = clients.begin(); iter != clients.end();)
+    {
+        Client* client = iter->get();
+        if (!all && !client->finished)
+        {
+            ++iter;
+            continue;
+        }
+        //socket is closed only after its thread exits, so descriptor can not be reused meanwhile
+        remote::ShutdownSocket(client->fd);
+        client->thread.join();
+        remote::CloseSocket(client->fd);
+        iter = clients.erase(iter);
+    }
+}
+
+void RemoteControlServer::ServeClient(Client* client)
+{
+    uint8_t request[remote::frameLength];
+    uint8_t reply[remote::frameLength];
+    while (running)
+    {
+        //blocks until request arrives, Stop() wakes it up by shutting down the socket
+        if (remote::RecvAll(client->fd, request, sizeof(request), -1) != sizeof(request))
+            break;
+        remote::FrameType type;
+        uint32_t sequence;
+        if (!remote::DecodeFrame(request, type, sequence))
+        {
+            lime::warning("RemoteControlServer: invalid frame, dropping client");
+            break;
+        }
+        if (type == remote::FRAME_STREAM)
+        {
+            ServeStream(client, &request[remote::headerLength]);
+            break;
+        }
+        if (type == remote::FRAME_CONTROL)
+        {
+            uint8_t packet[remote::packetLength];
+            ProcessPacket(&request[remote::headerLength], packet);
+            remote::EncodeFrame(reply, type, sequence, packet);
+        }
+        else
+            remote::EncodeFrame(reply, type, sequence, nullptr);
+        if (remote::SendAll(client->fd, reply, sizeof(reply), sendTimeout_ms) != sizeof(reply))
+            break;
+    }
+    client->finished = true;
+}
+
+/** @brief Answers stream request and relays samples until client disconnects
+    @param packet payload of FRAME_STREAM request
+*/
+void RemoteControlServer::ServeStream(Client* client, const uint8_t* packet)
+{
+    remote::StreamRequest request;
+    int status = 0;
+    int udpFd = -1;
+    if (!remote::DecodeStreamRequest(packet, request))
+        status = EINVAL;
+    const int key = 2*request.ep + request.tx;
+    if (status == 0)
+    {
+        std::lock_guard<std::mutex> lock(streamsLock);
+        if (!activeStreams.insert(key).second)
+            status = EBUSY;
+    }
+    if (status == 0 && request.transport == remote::STREAM_UDP)
+    {
+        udpFd = remote::ConnectDatagramSocket(client->fd, request.udpPort);
+        if (udpFd < 0)
+        {
+            status = EIO;
+            std::lock_guard<std::mutex> lock(streamsLock);
+            activeStreams.erase(key);
+        }
+    }
+
+    uint8_t answer[remote::packetLength];
+    uint8_t frame[remote::frameLength];
+    memset(answer, 0, sizeof(answer));
+    answer[0] = status;
+    remote::EncodeFrame(frame, remote::FRAME_STREAM, 0, answer);
+    const bool answered = remote::SendAll(client->fd, frame, sizeof(frame), sendTimeout_ms) == sizeof(frame);
+    if (status != 0)
+        return;
+    if (answered)
+    {
+        lime::debug("RemoteControlServer: %s stream of endpoint %i started", request.tx ? "Tx" : "Rx", int(request.ep));
+        if (request.tx)
+            RelayToDevice(client->fd, request);
+        else
+            RelayToClient(client->fd, udpFd, request);
+        lime::debug("RemoteControlServer: %s stream of endpoint %i stopped", request.tx ? "Tx" : "Rx", int(request.ep));
+    }
+    remote::CloseSocket(udpFd);
+    std::lock_guard<std::mutex> lock(streamsLock);
+    activeStreams.erase(key);
+}
+
+void RemoteControlServer::RelayToClient(int fd, int udpFd, const remote::StreamRequest &request)
+{
+    const int ep = request.ep;
+    const int depth = std::max(1, std::min(connection->GetBuffersCount(), relayDepth));
+    const int transferSize = std::max(1, connection->CheckStreamSize(relayBatch))*remote::streamPacketLength;
+    std::vector<char> buffers(depth*transferSize);
+    std::vector<int> handles(depth);
+    for (int i = 0; i < depth; ++i)
+        handles[i] = connection->BeginDataReading(&buffers[i*transferSize], transferSize, ep);
+
+    uint32_t limit = request.credits; //sequence number client is not ready for
+    uint32_t sequence = 0;
+    uint64_t dropped = 0;
+    uint8_t grant[4];
+    int grantBytes = 0;
+    auto lastGrant = std::chrono::steady_clock::now();
+    //collects limits granted by client, returns false when client disconnects
+    auto ReadGrants = [&]() -> bool
+    {
+        bool failed = false;
+        int received;
+        while ((received = remote::RecvAll(fd, &grant[grantBytes], sizeof(grant) - grantBytes, 0, &failed)) > 0)
+        {
+            grantBytes += received;
+            if (grantBytes < int(sizeof(grant)))
+                continue;
+            const uint32_t granted = (uint32_t(grant[0]) << 24) | (uint32_t(grant[1]) << 16) | (grant[2] << 8) | grant[3];
+            if (int32_t(granted - limit) > 0)
+                limit = granted;
+            grantBytes = 0;
+            lastGrant = std::chrono::steady_clock::now();
+        }
+        //the last datagrams before the limit were lost, client would not grant more
+        if (sequence == limit && std::chrono::steady_clock::now() - lastGrant > grantTimeout)
+        {
+            limit = sequence + std::max<uint32_t>(request.credits/4, 1);
+            lastGrant = std::chrono::steady_clock::now();
+        }
+        return !failed;
+    };
+
+    uint8_t datagram[remote::datagramLength];
+    bool linkUp = true;
+    int bi = 0;
+    while (running && linkUp)
+    {
+        if (handles[bi] < 0)
+        {
+            lime::error("RemoteControlServer: failed to read samples of endpoint %i", ep);
+            break;
+        }
+        if (!connection->WaitForReading(handles[bi], relayPollInterval_ms))
+        {
+            linkUp = ReadGrants();
+            continue;
+        }
+        //packets are left to the connection when client is gone, next client gets them
+        if (!(linkUp = ReadGrants()))
+            break;
+        char* buffer = &buffers[bi*transferSize];
+        const int bytes = connection->FinishDataReading(buffer, transferSize, handles[bi]);
+        const int packets = std::max(bytes, 0) / remote::streamPacketLength;
+        if (udpFd < 0)
+        {
+            const int length = packets*remote::streamPacketLength;
+            linkUp = remote::SendAll(fd, buffer, length, sendTimeout_ms) == length;
+        }
+        else
+        {
+            for (int i = 0; i < packets; ++i)
+            {
+                //client is not keeping up, packet would be lost in its socket buffer anyway
+                if (sequence == limit)
+                {
+                    ++dropped;
+                    continue;
+                }
+                remote::EncodeDatagramHeader(datagram, sequence++);
+                memcpy(&datagram[remote::datagramHeaderLength], &buffer[i*remote::streamPacketLength], remote::streamPacketLength);
+                remote::SendAll(udpFd, datagram, sizeof(datagram), relayPollInterval_ms);
+            }
+        }
+        handles[bi] = connection->BeginDataReading(buffer, transferSize, ep);
+        bi = (bi + 1) % depth;
+    }
+    connection->AbortReading(ep);
+    if (dropped)
+        lime::warning("RemoteControlServer: %llu Rx packets of endpoint %i dropped, client is too slow",
+            (unsigned long long)dropped, ep);
+}
+
+void RemoteControlServer::RelayToDevice(int fd, const remote::StreamRequest &request)
+{
+    const int ep = request.ep;
+    //bytes of incomplete packet are moved to the next buffer, so at least two are needed
+    const int depth = std::max(2, std::min(connection->GetBuffersCount(), relayDepth));
+    const int transferSize = std::max(1, connection->CheckStreamSize(relayBatch))*remote::streamPacketLength;
+    std::vector<char> buffers(depth*transferSize);
+    std::vector<int> handles(depth, -1);
+    std::vector<int> sizes(depth, 0);
+    uint64_t lost = 0;
+    auto Reclaim = [&](int i)
+    {
+        if (handles[i] < 0)
+            return;
+        connection->WaitForSending(handles[i], sendTimeout_ms);
+        const int sent = connection->FinishDataSending(&buffers[i*transferSize], sizes[i], handles[i]);
+        if (sent != sizes[i])
+            lost += (sizes[i] - std::max(sent, 0)) / remote::streamPacketLength;
+        handles[i] = -1;
+    };
+
+    int bi = 0;
+    int filled = 0;
+    while (running)
+    {
+        char* buffer = &buffers[bi*transferSize];
+        bool failed = false;
+        //wait for the first packet, then take whatever has already arrived
+        const int timeout = filled < remote::streamPacketLength ? relayPollInterval_ms : 0;
+        filled += remote::RecvAll(fd, buffer + filled, transferSize - filled, timeout, &failed);
+        if (failed)
+            break;
+        if (filled < remote::streamPacketLength)
+            continue;
+        const int bytes = filled - filled % remote::streamPacketLength;
+        const int next = (bi + 1) % depth;
+        Reclaim(next);
+        filled -= bytes;
+        memcpy(&buffers[next*transferSize], buffer + bytes, filled);
+        sizes[bi] = bytes;
+        handles[bi] = connection->BeginDataSending(buffer, bytes, ep);
+        bi = next;
+    }
+    for (int i = 1; i <= depth; ++i)
+        Reclaim((bi + i) % depth);
+    connection->AbortSending(ep);
+    if (lost)
+        lime::warning("RemoteControlServer: %llu Tx packets of endpoint %i were not sent to device",
+            (unsigned long long)lost, ep);
+}
+
+void RemoteControlServer::ProcessPacket(const uint8_t* request, uint8_t* reply)
+{
+    const uint8_t cmd = request[0];
+    const unsigned periphID = request[3];
+    const uint8_t* in = &request[8];
+    uint8_t* out = &reply[8];
+    memset(reply, 0, remote::packetLength);
+    reply[0] = cmd;
+    reply[2] = request[2];
+    reply[3] = request[3];
+
+    //LMS64C devices execute the packet as is, so every command is supported
+    LMS64CProtocol* lms64c = dynamic_cast<LMS64CProtocol*>(connection);
+    if (lms64c)
+    {
+        std::lock_guard<std::mutex> lock(lms64c->mControlPortLock);
+        if (lms64c->Write(request, remote::packetLength) != remote::packetLength
+            || lms64c->Read(reply, remote::packetLength) != remote::packetLength)
+            reply[1] = STATUS_ERROR_CMD;
+        return;
+    }
+
+    uint32_t addrs[dataLength];
+    uint32_t values[dataLength];
+    int status = 0;
+    size_t count;
+
+    std::lock_guard<std::mutex> lock(connectionLock);
+    switch (cmd)
+    {
+    case CMD_GET_INFO:
+    {
+        const DeviceInfo info = connection->GetDeviceInfo();
+        for (int i = LMS_DEV_UNKNOWN+1; i < LMS_DEV_COUNT; ++i)
+            if (info.deviceName == GetDeviceName(eLMS_DEV(i)))
+                out[1] = i;
+        for (int i = EXP_BOARD_UNKNOWN+1; i < EXP_BOARD_COUNT; ++i)
+            if (info.expansionName == GetExpansionBoardName(eEXP_BOARD(i)))
+                out[4] = i;
+        out[0] = atoi(info.firmwareVersion.c_str());
+        out[2] = atoi(info.protocolVersion.c_str());
+        out[3] = atoi(info.hardwareVersion.c_str());
+        for (int i = 0; i < 8; ++i)
+            out[10+i] = info.boardSerialNumber >> (8*(7-i));
+        break;
+    }
+    case CMD_LMS7002_RST:
+        status = connection->DeviceReset(periphID);
+        break;
+    case CMD_LMS7002_WR:
+        count = std::min<size_t>(request[2], dataLength/4);
+        for (size_t i = 0; i < count; ++i)
+            values[i] = (1u << 31) | (uint32_t(in[4*i]) << 24) | (uint32_t(in[4*i+1]) << 16) | (in[4*i+2] << 8) | in[4*i+3];
+        status = connection->WriteLMS7002MSPI(values, count, periphID);
+        break;
+    case CMD_LMS7002_RD:
+        count = std::min<size_t>(request[2], dataLength/4);
+        for (size_t i = 0; i < count; ++i)
+            addrs[i] = (uint32_t(in[2*i]) << 24) | (uint32_t(in[2*i+1]) << 16);
+        status = connection->ReadLMS7002MSPI(addrs, values, count, periphID);
+        for (size_t i = 0; i < count; ++i)
+        {
+            out[4*i] = in[2*i];
+            out[4*i+1] = in[2*i+1];
+            out[4*i+2] = values[i] >> 8;
+            out[4*i+3] = values[i];
+        }
+        break;
+    case CMD_BRDSPI_WR:
+        count = std::min<size_t>(request[2], dataLength/4);
+        for (size_t i = 0; i < count; ++i)
+        {
+            addrs[i] = (in[4*i] << 8) | in[4*i+1];
+            values[i] = (in[4*i+2] << 8) | in[4*i+3];
+        }
+        status = connection->WriteRegisters(addrs, values, count);
+        break;
+    case CMD_BRDSPI_RD:
+        count = std::min<size_t>(request[2], dataLength/4);
+        for (size_t i = 0; i < count; ++i)
+            addrs[i] = (in[2*i] << 8) | in[2*i+1];
+        status = connection->ReadRegisters(addrs, values, count);
+        for (size_t i = 0; i < count; ++i)
+        {
+            out[4*i] = addrs[i] >> 8;
+            out[4*i+1] = addrs[i];
+            out[4*i+2] = values[i] >> 8;
+            out[4*i+3] = values[i];
+        }
+        break;
+    case CMD_GPIO_WR:
+        status = connection->GPIOWrite(in, std::min<size_t>(request[2], dataLength));
+        break;
+    case CMD_GPIO_RD:
+        status = connection->GPIORead(out, std::min<size_t>(std::max<size_t>(request[2], 1), dataLength));
+        break;
+    case CMD_GPIO_DIR_WR:
+        status = connection->GPIODirWrite(in, std::min<size_t>(request[2], dataLength));
+        break;
+    case CMD_GPIO_DIR_RD:
+        status = connection->GPIODirRead(out, std::min<size_t>(std::max<size_t>(request[2], 1), dataLength));
+        break;
+    case CMD_ANALOG_VAL_WR:
+        count = std::min<size_t>(request[2], dataLength/4);
+        for (size_t i = 0; i < count && status == 0; ++i)
+        {
+            const uint8_t id = in[4*i];
+            const uint8_t units = in[4*i+1];
+            const double value = ((in[4*i+2] << 8) | in[4*i+3]) * pow(10, adcUnitsExponent[units & 0x0F]);
+            status = connection->CustomParameterWrite(&id, &value, 1, adcUnits2string(units >> 4));
+        }
+        break;
+    case CMD_ANALOG_VAL_RD:
+        count = std::min<size_t>(request[2], dataLength/4);
+        for (size_t i = 0; i < count && status == 0; ++i)
+        {
+            const uint8_t id = in[i];
+            double value = 0;
+            std::string units;
+            status = connection->CustomParameterRead(&id, &value, 1, &units);
+            const uint8_t unitsByte = EncodeUnits(units);
+            if ((unitsByte >> 4) == TEMPERATURE)
+                value *= 10;
+            const int16_t raw = std::max(-32768.0, std::min(32767.0, round(value)));
+            out[4*i] = id;
+            out[4*i+1] = unitsByte;
+            out[4*i+2] = raw >> 8;
+            out[4*i+3] = raw;
+        }
+        break;
+    default:
+        reply[1] = STATUS_UNKNOWN_CMD;
+        return;
+    }
+    reply[1] = status == 0 ? STATUS_COMPLETED_CMD : STATUS_ERROR_CMD;
+}
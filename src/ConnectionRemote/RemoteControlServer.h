@@ -0,0 +1,90 @@
+/**
+    @file RemoteControlServer.h
+    @author Lime Microsystems
+    @brief Serves LMS64C control packets of remote clients using local connection
+*/
+
+#pragma once
+#include <LimeSuiteConfig.h>
+#include <stdint.h>
+#include <atomic>
+#include <mutex>
+#include <thread>
+#include <list>
+#include <set>
+#include <memory>
+
+namespace lime{
+
+class IConnection;
+namespace remote{
+struct StreamRequest;
+}
+
+/** @brief TCP server for ConnectionRemote clients
+
+    Control packets received from clients are passed unchanged to LMS64C
+    connections, for other connections they are translated to calls of the
+    IConnection interface, so any local connection can be controlled remotely.
+    Each client is served by its own thread, requests are answered in order
+    and access to the connection is serialized between clients.
+
+    Clients may also open stream connections, which relay FPGA packets of one
+    endpoint between the connection and the client. If client can not keep
+    up with received samples, packets are dropped and client sees gaps in
+    their timestamps.
+*/
+class LIME_API RemoteControlServer
+{
+public:
+    /** @param connection connection to be served, nullptr serves loopback
+        test connection returning samples sent to it
+    */
+    RemoteControlServer(IConnection* connection);
+    ~RemoteControlServer();
+
+    /** @brief Starts listening for clients
+        @param port TCP port, 0 selects any free port
+        @return 0 on success
+    */
+    int Start(uint16_t port);
+    void Stop();
+
+    //! @brief Port the server listens on
+    uint16_t GetPort() const;
+
+    /** @brief Executes single LMS64C packet
+        @param request packet received from client
+        @param reply packet to be sent back, same size as request
+    */
+    void ProcessPacket(const uint8_t* request, uint8_t* reply);
+
+private:
+    struct Client
+    {
+        int fd;
+        std::thread thread;
+        std::atomic<bool> finished;
+    };
+
+    void AcceptLoop();
+    void ServeClient(Client* client);
+    void ReapClients(bool all);
+    void ServeStream(Client* client, const uint8_t* packet);
+    void RelayToClient(int fd, int udpFd, const remote::StreamRequest &request);
+    void RelayToDevice(int fd, const remote::StreamRequest &request);
+
+    std::unique_ptr<IConnection> loopback;
+    IConnection* connection;
+    std::mutex connectionLock;
+    std::mutex clientsLock;
+    std::list<std::unique_ptr<Client> > clients;
+    std::mutex streamsLock;
+    std::set<int> activeStreams; //2*endpoint+direction of streams in use
+    std::atomic<bool> running;
+    int listenFd;
+    uint16_t listenPort;
+    std::thread acceptThread;
+};
+
+}
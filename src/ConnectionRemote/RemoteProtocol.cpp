@@ -0,0 +1,376 @@
+/**
+    @file RemoteProtocol.cpp
+    @author Lime Microsystems
+    @brief Framing of LMS64C control packets exchanged over TCP
+*/
+
+#include "RemoteProtocol.h"
+#include <cstring>
+#include <chrono>
+#include <algorithm>
+#ifdef __unix__
+#include <errno.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+#else
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#define poll WSAPoll
+#endif
+
+namespace lime{
+namespace remote{
+
+static const uint8_t frameMagic[2] = {'L', 'R'};
+static const uint8_t datagramMagic[2] = {'L', 'D'};
+#ifdef MSG_NOSIGNAL
+static const int sendFlags = MSG_NOSIGNAL; //report closed connection as error instead of SIGPIPE
+#else
+static const int sendFlags = 0;
+#endif
+
+void EncodeFrame(uint8_t* frame, FrameType type, uint32_t sequence, const uint8_t* packet)
+{
+    frame[0] = frameMagic[0];
+    frame[1] = frameMagic[1];
+    frame[2] = type;
+    frame[3] = 0;
+    const uint32_t seq = htonl(sequence);
+    memcpy(&frame[4], &seq, sizeof(seq));
+    if (packet)
+        memcpy(&frame[headerLength], packet, packetLength);
+    else
+        memset(&frame[headerLength], 0, packetLength);
+}
+
+bool DecodeFrame(const uint8_t* frame, FrameType &type, uint32_t &sequence)
+{
+    if (frame[0] != frameMagic[0] || frame[1] != frameMagic[1])
+        return false;
+    if (frame[2] != FRAME_CONTROL && frame[2] != FRAME_KEEPALIVE && frame[2] != FRAME_STREAM)
+        return false;
+    type = FrameType(frame[2]);
+    uint32_t seq;
+    memcpy(&seq, &frame[4], sizeof(seq));
+    sequence = ntohl(seq);
+    return true;
+}
+
+void EncodeStreamRequest(uint8_t* packet, const StreamRequest &request)
+{
+    memset(packet, 0, packetLength);
+    packet[0] = request.ep;
+    packet[1] = request.tx;
+    packet[2] = request.transport;
+    const uint16_t port = htons(request.udpPort);
+    memcpy(&packet[4], &port, sizeof(port));
+    const uint32_t credits = htonl(request.credits);
+    memcpy(&packet[8], &credits, sizeof(credits));
+}
+
+bool DecodeStreamRequest(const uint8_t* packet, StreamRequest &request)
+{
+    if (packet[2] != STREAM_TCP && packet[2] != STREAM_UDP)
+        return false;
+    request.ep = packet[0];
+    request.tx = packet[1] != 0;
+    request.transport = StreamTransport(packet[2]);
+    uint16_t port;
+    memcpy(&port, &packet[4], sizeof(port));
+    request.udpPort = ntohs(port);
+    uint32_t credits;
+    memcpy(&credits, &packet[8], sizeof(credits));
+    request.credits = ntohl(credits);
+    //samples are sent to device over TCP only, lost ones could not be recovered
+    return !(request.tx && request.transport == STREAM_UDP);
+}
+
+void EncodeDatagramHeader(uint8_t* header, uint32_t sequence)
+{
+    header[0] = datagramMagic[0];
+    header[1] = datagramMagic[1];
+    header[2] = 0;
+    header[3] = 0;
+    const uint32_t seq = htonl(sequence);
+    memcpy(&header[4], &seq, sizeof(seq));
+}
+
+bool DecodeDatagramHeader(const uint8_t* header, uint32_t &sequence)
+{
+    if (header[0] != datagramMagic[0] || header[1] != datagramMagic[1])
+        return false;
+    uint32_t seq;
+    memcpy(&seq, &header[4], sizeof(seq));
+    sequence = ntohl(seq);
+    return true;
+}
+
+void InitSockets()
+{
+#ifndef __unix__
+    WSADATA wsaData;
+    WSAStartup(0x0202, &wsaData);
+#endif
+}
+
+void CleanupSockets()
+{
+#ifndef __unix__
+    WSACleanup();
+#endif
+}
+
+void ConfigureSocket(int fd)
+{
+    int enable = 1;
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, (const char*)&enable, sizeof(enable));
+    setsockopt(fd, SOL_SOCKET, SO_KEEPALIVE, (const char*)&enable, sizeof(enable));
+#ifdef TCP_KEEPIDLE
+    //detect dead peer within ~10 s instead of system default of hours
+    int idle = 5, interval = 1, count = 5;
+    setsockopt(fd, IPPROTO_TCP, TCP_KEEPIDLE, &idle, sizeof(idle));
+    setsockopt(fd, IPPROTO_TCP, TCP_KEEPINTVL, &interval, sizeof(interval));
+    setsockopt(fd, IPPROTO_TCP, TCP_KEEPCNT, &count, sizeof(count));
+#endif
+#ifdef __unix__
+    fcntl(fd, F_SETFL, fcntl(fd, F_GETFL, 0) | O_NONBLOCK);
+#else
+    u_long mode = 1;
+    ioctlsocket(fd, FIONBIO, &mode);
+#endif
+}
+
+static void ConfigureDatagramSocket(int fd)
+{
+#ifdef __unix__
+    fcntl(fd, F_SETFL, fcntl(fd, F_GETFL, 0) | O_NONBLOCK);
+#else
+    u_long mode = 1;
+    ioctlsocket(fd, FIONBIO, &mode);
+#endif
+}
+
+void CloseSocket(int fd)
+{
+    if (fd < 0)
+        return;
+#ifdef __unix__
+    shutdown(fd, SHUT_RDWR);
+    close(fd);
+#else
+    closesocket(fd);
+#endif
+}
+
+void ShutdownSocket(int fd)
+{
+#ifdef __unix__
+    shutdown(fd, SHUT_RDWR);
+#else
+    shutdown(fd, SD_BOTH);
+#endif
+}
+
+static bool WouldBlock()
+{
+#ifdef __unix__
+    return errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR;
+#else
+    return WSAGetLastError() == WSAEWOULDBLOCK;
+#endif
+}
+
+static bool ConnectInProgress()
+{
+#ifdef __unix__
+    return errno == EINPROGRESS;
+#else
+    return WSAGetLastError() == WSAEWOULDBLOCK;
+#endif
+}
+
+//! Waits for socket readiness, returns false on timeout or socket error
+static bool WaitSocket(int fd, short events, std::chrono::steady_clock::time_point deadline, int timeout_ms)
+{
+    int wait_ms = -1;
+    if (timeout_ms >= 0)
+    {
+        const auto left = std::chrono::duration_cast<std::chrono::milliseconds>(deadline - std::chrono::steady_clock::now()).count();
+        if (left < 0)
+            return false;
+        wait_ms = left;
+    }
+    pollfd pfd;
+    pfd.fd = fd;
+    pfd.events = events;
+    pfd.revents = 0;
+    const int ret = poll(&pfd, 1, wait_ms);
+    return ret > 0 || (ret < 0 && WouldBlock());
+}
+
+int ConnectSocket(const std::string &host, uint16_t port, int timeout_ms)
+{
+    addrinfo hints;
+    memset(&hints, 0, sizeof(hints));
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    addrinfo* result = nullptr;
+    if (getaddrinfo(host.c_str(), std::to_string(port).c_str(), &hints, &result) != 0)
+        return -1;
+
+    int fd = -1;
+    for (addrinfo* ai = result; ai != nullptr && fd < 0; ai = ai->ai_next)
+    {
+        fd = socket(ai->ai_family, ai->ai_socktype, ai->ai_protocol);
+        if (fd < 0)
+            continue;
+        ConfigureSocket(fd);
+        if (connect(fd, ai->ai_addr, ai->ai_addrlen) == 0)
+            break;
+        if (ConnectInProgress())
+        {
+            pollfd pfd;
+            pfd.fd = fd;
+            pfd.events = POLLOUT;
+            pfd.revents = 0;
+            int error = 0;
+            socklen_t errorLength = sizeof(error);
+            if (poll(&pfd, 1, timeout_ms) > 0 &&
+                getsockopt(fd, SOL_SOCKET, SO_ERROR, (char*)&error, &errorLength) == 0 && error == 0)
+                break;
+        }
+        CloseSocket(fd);
+        fd = -1;
+    }
+    freeaddrinfo(result);
+    return fd;
+}
+
+int BindDatagramSocket(int tcpFd, uint16_t &port, int &bufferSize)
+{
+    sockaddr_storage address;
+    socklen_t addressLength = sizeof(address);
+    if (getsockname(tcpFd, (sockaddr*)&address, &addressLength) != 0)
+        return -1;
+    if (address.ss_family == AF_INET)
+        ((sockaddr_in*)&address)->sin_port = 0;
+    else
+        ((sockaddr_in6*)&address)->sin6_port = 0;
+    int fd = socket(address.ss_family, SOCK_DGRAM, 0);
+    if (fd < 0)
+        return -1;
+    setsockopt(fd, SOL_SOCKET, SO_RCVBUF, (const char*)&bufferSize, sizeof(bufferSize));
+    socklen_t optionLength = sizeof(bufferSize);
+    if (bind(fd, (sockaddr*)&address, addressLength) != 0
+        || getsockname(fd, (sockaddr*)&address, &addressLength) != 0
+        || getsockopt(fd, SOL_SOCKET, SO_RCVBUF, (char*)&bufferSize, &optionLength) != 0)
+    {
+        CloseSocket(fd);
+        return -1;
+    }
+    if (address.ss_family == AF_INET)
+        port = ntohs(((sockaddr_in*)&address)->sin_port);
+    else
+        port = ntohs(((sockaddr_in6*)&address)->sin6_port);
+    ConfigureDatagramSocket(fd);
+    return fd;
+}
+
+int ConnectDatagramSocket(int tcpFd, uint16_t port)
+{
+    sockaddr_storage address;
+    socklen_t addressLength = sizeof(address);
+    if (getpeername(tcpFd, (sockaddr*)&address, &addressLength) != 0)
+        return -1;
+    if (address.ss_family == AF_INET)
+        ((sockaddr_in*)&address)->sin_port = htons(port);
+    else
+        ((sockaddr_in6*)&address)->sin6_port = htons(port);
+    int fd = socket(address.ss_family, SOCK_DGRAM, 0);
+    if (fd < 0)
+        return -1;
+    if (connect(fd, (sockaddr*)&address, addressLength) != 0)
+    {
+        CloseSocket(fd);
+        return -1;
+    }
+    ConfigureDatagramSocket(fd);
+    return fd;
+}
+
+int SendAll(int fd, const void* data, int length, int timeout_ms, bool* failed)
+{
+    const auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(std::max(timeout_ms, 0));
+    const char* src = (const char*)data;
+    int sent = 0;
+    while (sent < length)
+    {
+        const int ret = send(fd, src + sent, length - sent, sendFlags);
+        if (ret > 0)
+        {
+            sent += ret;
+            continue;
+        }
+        if (ret < 0 && WouldBlock())
+        {
+            if (!WaitSocket(fd, POLLOUT, deadline, timeout_ms))
+                break;
+            continue;
+        }
+        if (failed)
+            *failed = true;
+        break;
+    }
+    return sent;
+}
+
+int RecvAll(int fd, void* data, int length, int timeout_ms, bool* failed)
+{
+    const auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(std::max(timeout_ms, 0));
+    char* dest = (char*)data;
+    int received = 0;
+    while (received < length)
+    {
+        const int ret = recv(fd, dest + received, length - received, 0);
+        if (ret > 0)
+        {
+            received += ret;
+            continue;
+        }
+        if (ret < 0 && WouldBlock())
+        {
+            if (!WaitSocket(fd, POLLIN, deadline, timeout_ms))
+                break;
+            continue;
+        }
+        //connection closed by peer or broken
+        if (failed)
+            *failed = true;
+        break;
+    }
+    return received;
+}
+
+int RecvDatagram(int fd, void* data, int length, int timeout_ms)
+{
+    const auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(std::max(timeout_ms, 0));
+    while (true)
+    {
+        const int ret = recv(fd, (char*)data, length, 0);
+        if (ret >= 0)
+            return ret;
+        if (!WouldBlock())
+            return -1;
+        if (!WaitSocket(fd, POLLIN, deadline, timeout_ms))
+            return 0;
+    }
+}
+
+}
+}
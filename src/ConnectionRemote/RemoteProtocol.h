@@ -0,0 +1,119 @@
+/**
+    @file RemoteProtocol.h
+    @author Lime Microsystems
+    @brief Framing of LMS64C control packets exchanged over TCP
+*/
+
+#pragma once
+#include <stdint.h>
+#include <string>
+
+namespace lime{
+namespace remote{
+
+static const uint16_t defaultPort = 5000;
+static const int packetLength = 64; //LMS64C packet size
+
+/** Every request and reply is a fixed size frame: 2 magic bytes, frame type,
+    reserved byte, 32 bit sequence number in network byte order and one
+    LMS64C packet. Server answers requests in order, echoing their sequence
+    numbers, so client can write several requests ahead and recognize late
+    replies of requests it stopped waiting for.
+*/
+enum FrameType
+{
+    FRAME_CONTROL = 1, //payload is LMS64C packet
+    FRAME_KEEPALIVE = 2, //payload is ignored, server echoes the frame
+    FRAME_STREAM = 3, //payload is StreamRequest, connection then carries samples
+};
+
+static const int headerLength = 8;
+static const int frameLength = headerLength + packetLength;
+
+/** Stream connections start with FRAME_STREAM request, server answers with
+    FRAME_STREAM frame which has status in the first payload byte, 0 on success.
+    Afterwards connection carries raw FPGA packets of one endpoint in one
+    direction. Over UDP every datagram holds 8 byte header (2 magic bytes,
+    2 reserved, 32 bit sequence number) and single FPGA packet. Client limits
+    the sequence numbers server may send by sending 32 bit limits over the
+    TCP connection, server drops packets that are over the limit.
+*/
+enum StreamTransport
+{
+    STREAM_TCP = 0,
+    STREAM_UDP = 1,
+};
+
+struct StreamRequest
+{
+    uint8_t ep; //stream endpoint of remote connection
+    bool tx; //samples are sent to remote device
+    StreamTransport transport;
+    uint16_t udpPort; //client port receiving datagrams
+    uint32_t credits; //number of datagrams server may send ahead
+};
+
+static const int streamPacketLength = 4096; //FPGA_DataPacket size
+static const int datagramHeaderLength = 8;
+static const int datagramLength = datagramHeaderLength + streamPacketLength;
+
+void EncodeStreamRequest(uint8_t* packet, const StreamRequest &request);
+bool DecodeStreamRequest(const uint8_t* packet, StreamRequest &request);
+void EncodeDatagramHeader(uint8_t* header, uint32_t sequence);
+bool DecodeDatagramHeader(const uint8_t* header, uint32_t &sequence);
+
+void EncodeFrame(uint8_t* frame, FrameType type, uint32_t sequence, const uint8_t* packet);
+
+//! @return false if frame does not start with valid header
+bool DecodeFrame(const uint8_t* frame, FrameType &type, uint32_t &sequence);
+
+//! @brief Initializes socket library, required on Windows only
+void InitSockets();
+void CleanupSockets();
+
+//! @brief Makes socket non-blocking, disables Nagle's algorithm and enables keep-alive probes
+void ConfigureSocket(int fd);
+void CloseSocket(int fd);
+//! @brief Stops transfers of socket, wakes up threads waiting on it
+void ShutdownSocket(int fd);
+
+/** @brief Opens configured TCP connection
+    @return socket descriptor, -1 on failure
+*/
+int ConnectSocket(const std::string &host, uint16_t port, int timeout_ms);
+
+/** @brief Opens UDP socket on the local address of TCP connection
+    @param port set to the bound port number
+    @param bufferSize requested receive buffer size in bytes, set to the size
+    system has actually given
+    @return socket descriptor, -1 on failure
+*/
+int BindDatagramSocket(int tcpFd, uint16_t &port, int &bufferSize);
+
+/** @brief Opens UDP socket sending to the peer of TCP connection
+    @return socket descriptor, -1 on failure
+*/
+int ConnectDatagramSocket(int tcpFd, uint16_t port);
+
+/** @brief Waits and writes until whole buffer is sent
+    @param timeout_ms time limit, negative to wait indefinitely
+    @param failed set to true if connection is broken, unchanged on timeout
+    @return number of bytes sent, less than length on timeout or error
+*/
+int SendAll(int fd, const void* data, int length, int timeout_ms, bool* failed = nullptr);
+
+/** @brief Waits and reads until whole buffer is filled
+    @param timeout_ms time limit, negative to wait indefinitely
+    @param failed set to true if connection is broken or closed by peer,
+    unchanged on timeout
+    @return number of bytes received, less than length on timeout or failure
+*/
+int RecvAll(int fd, void* data, int length, int timeout_ms, bool* failed = nullptr);
+
+/** @brief Waits for single datagram
+    @return datagram length, 0 on timeout, -1 on failure
+*/
+int RecvDatagram(int fd, void* data, int length, int timeout_ms);
+
+}
+}
@@ -0,0 +1,175 @@
+/**
+    @file StreamLoopback.cpp
+    @author Lime Microsystems
+    @brief Connection returning stream packets sent to it, for network link tests
+*/
+
+#include "StreamLoopback.h"
+#include "Logger.h"
+#include <algorithm>
+#include <chrono>
+#include <errno.h>
+
+using namespace lime;
+
+static const size_t maxQueuedBytes = 8*1024*1024;
+static const size_t packetSize = 4096;
+
+StreamLoopback::StreamLoopback() :
+    nextOrder(0)
+{
+}
+
+StreamLoopback::~StreamLoopback()
+{
+}
+
+bool StreamLoopback::IsOpen()
+{
+    return true;
+}
+
+DeviceInfo StreamLoopback::GetDeviceInfo()
+{
+    DeviceInfo info;
+    info.deviceName = "Loopback";
+    info.boardSerialNumber = 0;
+    return info;
+}
+
+int StreamLoopback::WriteLMS7002MSPI(const uint32_t *writeData, size_t size, unsigned periphID)
+{
+    std::lock_guard<std::mutex> guard(lock);
+    for (size_t i = 0; i < size; ++i)
+        lmsRegisters[(periphID << 16) | ((writeData[i] >> 16) & 0x7FFF)] = writeData[i] & 0xFFFF;
+    return 0;
+}
+
+int StreamLoopback::ReadLMS7002MSPI(const uint32_t *writeData, uint32_t *readData, size_t size, unsigned periphID)
+{
+    std::lock_guard<std::mutex> guard(lock);
+    for (size_t i = 0; i < size; ++i)
+        readData[i] = lmsRegisters[(periphID << 16) | ((writeData[i] >> 16) & 0x7FFF)];
+    return 0;
+}
+
+int StreamLoopback::WriteRegisters(const uint32_t *addrs, const uint32_t *data, const size_t size)
+{
+    std::lock_guard<std::mutex> guard(lock);
+    for (size_t i = 0; i < size; ++i)
+        boardRegisters[addrs[i]] = data[i];
+    return 0;
+}
+
+int StreamLoopback::ReadRegisters(const uint32_t *addrs, uint32_t *data, const size_t size)
+{
+    std::lock_guard<std::mutex> guard(lock);
+    for (size_t i = 0; i < size; ++i)
+        data[i] = boardRegisters[addrs[i]];
+    return 0;
+}
+
+int StreamLoopback::GetBuffersCount() const
+{
+    return 8;
+}
+
+int StreamLoopback::CheckStreamSize(int size) const
+{
+    return size;
+}
+
+int StreamLoopback::BeginDataReading(char* buffer, uint32_t length, int ep)
+{
+    if (ep < 0 || ep >= MAX_EP_CNT)
+        return ReportError(EINVAL, "Loopback: invalid stream endpoint %i", ep);
+    std::lock_guard<std::mutex> guard(lock);
+    size_t slot = 0;
+    while (slot < transfers.size() && transfers[slot].used)
+        ++slot;
+    if (slot == transfers.size())
+        transfers.push_back(Transfer());
+    Transfer &transfer = transfers[slot];
+    transfer.buffer = buffer;
+    transfer.length = length;
+    transfer.done = 0;
+    transfer.ep = ep;
+    transfer.order = nextOrder++;
+    transfer.used = true;
+    return slot;
+}
+
+bool StreamLoopback::WaitForReading(int contextHandle, unsigned int timeout_ms)
+{
+    const auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeout_ms);
+    std::unique_lock<std::mutex> guard(lock);
+    if (contextHandle < 0 || contextHandle >= int(transfers.size()))
+        return true;
+    Transfer &transfer = transfers[contextHandle];
+    while (transfer.used && transfer.done < transfer.length)
+    {
+        std::deque<char> &fifo = queued[transfer.ep];
+        const size_t chunk = std::min<size_t>(fifo.size(), transfer.length - transfer.done);
+        std::copy(fifo.begin(), fifo.begin() + chunk, transfer.buffer + transfer.done);
+        fifo.erase(fifo.begin(), fifo.begin() + chunk);
+        transfer.done += chunk;
+        if (transfer.done < transfer.length && dataReady.wait_until(guard, deadline) == std::cv_status::timeout)
+            break;
+    }
+    //bursts may be shorter than transfer, packets received so far complete it
+    return !transfer.used || transfer.done > 0;
+}
+
+int StreamLoopback::FinishDataReading(char* buffer, uint32_t length, int contextHandle)
+{
+    std::lock_guard<std::mutex> guard(lock);
+    if (contextHandle < 0 || contextHandle >= int(transfers.size()))
+        return 0;
+    transfers[contextHandle].used = false;
+    return transfers[contextHandle].done;
+}
+
+void StreamLoopback::AbortReading(int ep)
+{
+    std::lock_guard<std::mutex> guard(lock);
+    std::vector<Transfer*> aborted;
+    for (auto &transfer : transfers)
+        if (transfer.used && transfer.ep == ep)
+            aborted.push_back(&transfer);
+    //packets taken by unfinished transfers are returned in order, so the next reader gets them
+    std::sort(aborted.begin(), aborted.end(), [](const Transfer* a, const Transfer* b) {return a->order > b->order;});
+    for (Transfer* transfer : aborted)
+    {
+        queued[ep].insert(queued[ep].begin(), transfer->buffer, transfer->buffer + transfer->done);
+        transfer->used = false;
+    }
+    dataReady.notify_all();
+}
+
+int StreamLoopback::BeginDataSending(const char* buffer, uint32_t length, int ep)
+{
+    if (ep < 0 || ep >= MAX_EP_CNT)
+        return ReportError(EINVAL, "Loopback: invalid stream endpoint %i", ep);
+    std::lock_guard<std::mutex> guard(lock);
+    std::deque<char> &fifo = queued[ep];
+    fifo.insert(fifo.end(), buffer, buffer + length);
+    if (fifo.size() > maxQueuedBytes)
+    {
+        //drop whole packets, keeping the rest aligned
+        const size_t excess = fifo.size() - maxQueuedBytes;
+        fifo.erase(fifo.begin(), fifo.begin() + std::min(fifo.size(), (excess + packetSize - 1) / packetSize * packetSize));
+    }
+    dataReady.notify_all();
+    return length;
+}
+
+bool StreamLoopback::WaitForSending(int contextHandle, uint32_t timeout_ms)
+{
+    return true;
+}
+
+int StreamLoopback::FinishDataSending(const char* buffer, uint32_t length, int contextHandle)
+{
+    //handle of sending is the number of bytes already queued
+    return contextHandle;
+}
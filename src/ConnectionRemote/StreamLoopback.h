@@ -0,0 +1,74 @@
+/**
+    @file StreamLoopback.h
+    @author Lime Microsystems
+    @brief Connection returning stream packets sent to it, for network link tests
+*/
+
+#pragma once
+#include <IConnection.h>
+#include <vector>
+#include <deque>
+#include <map>
+#include <mutex>
+#include <condition_variable>
+
+namespace lime{
+
+/** @brief Stand-in device of RemoteControlServer test mode
+
+    Packets sent to an endpoint are received back from the same endpoint, so
+    streaming over the network can be tested without hardware. Registers
+    only keep written values. When nobody reads, the oldest packets are
+    dropped, which shows up as timestamp gaps like overflow of real device.
+    Reading transfers complete with the packets received until timeout and
+    packets of aborted transfers are kept for the next reader.
+*/
+class StreamLoopback : public IConnection
+{
+public:
+    StreamLoopback();
+    ~StreamLoopback();
+
+    bool IsOpen() override;
+    DeviceInfo GetDeviceInfo() override;
+
+    int WriteLMS7002MSPI(const uint32_t *writeData, size_t size, unsigned periphID = 0) override;
+    int ReadLMS7002MSPI(const uint32_t *writeData, uint32_t *readData, size_t size, unsigned periphID = 0) override;
+    int WriteRegisters(const uint32_t *addrs, const uint32_t *data, const size_t size) override;
+    int ReadRegisters(const uint32_t *addrs, uint32_t *data, const size_t size) override;
+
+    int GetBuffersCount() const override;
+    int CheckStreamSize(int size) const override;
+
+    int BeginDataReading(char* buffer, uint32_t length, int ep) override;
+    bool WaitForReading(int contextHandle, unsigned int timeout_ms) override;
+    int FinishDataReading(char* buffer, uint32_t length, int contextHandle) override;
+    void AbortReading(int ep) override;
+
+    int BeginDataSending(const char* buffer, uint32_t length, int ep) override;
+    bool WaitForSending(int contextHandle, uint32_t timeout_ms) override;
+    int FinishDataSending(const char* buffer, uint32_t length, int contextHandle) override;
+
+private:
+    static const int MAX_EP_CNT = 4;
+
+    struct Transfer
+    {
+        char* buffer;
+        uint32_t length;
+        uint32_t done;
+        int ep;
+        uint64_t order; //submission order, data of aborted transfers is returned by it
+        bool used;
+    };
+
+    std::mutex lock;
+    std::condition_variable dataReady;
+    std::deque<char> queued[MAX_EP_CNT];
+    std::deque<Transfer> transfers; //deque keeps references valid while waiting
+    uint64_t nextOrder;
+    std::map<uint32_t, uint16_t> lmsRegisters; //key includes chip index
+    std::map<uint32_t, uint16_t> boardRegisters;
+};
+
+}
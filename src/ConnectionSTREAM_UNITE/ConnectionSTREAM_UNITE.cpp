@@ -27,6 +27,7 @@ ConnectionSTREAM_UNITE::ConnectionSTREAM_UNITE(void* ctx, const std::string &vid
 
 ConnectionSTREAM_UNITE::~ConnectionSTREAM_UNITE(void)
 {
+    StopAsyncControl();
     if(comPort)
         delete comPort;
 }
@@ -0,0 +1,492 @@
+/**
+    @file ConnectionVirtual.cpp
+    @author Lime Microsystems
+    @brief Emulated LimeSDR board for testing without hardware
+*/
+
+#include "ConnectionVirtual.h"
+#include "LMS7002M_parameters.h"
+#include "FPGA_common.h"
+#include "dataTypes.h"
+#include "LMSBoards.h"
+#include "Logger.h"
+#include <cmath>
+#include <cstring>
+#include <sstream>
+#include <algorithm>
+#include <errno.h>
+
+using namespace lime;
+
+extern std::vector<const LMS7Parameter*> LMS7parameterList;
+
+const char ConnectionVirtual::deviceName[] = "LimeSDR-Virtual";
+
+static const double refClock = 30.72e6;
+static const double fx3Clock = 100.6e6; //clock LMS7_Generic assumes when detecting reference
+static const double fx3Count = 16777210; //fixed reference clock detection period in FPGA
+static const uint16_t RX_EN = 1; //0x000A
+static const uint16_t SMPL_NR_CLR = 1; //0x0009
+static const uint16_t TXPCT_LOSS_CLR = 1 << 1; //0x0009
+static const int rxFifoPackets = 64; //packets board keeps when host is not reading
+static const int txFifoPackets = 16; //packets board accepts ahead of playing them
+static const int tonePackets = 16; //length of test tone table
+static const uint32_t packetSize = sizeof(FPGA_DataPacket);
+static const uint32_t payloadSize = sizeof(FPGA_DataPacket().data);
+
+static int GetBits(uint16_t value, const LMS7Parameter &param)
+{
+    return (value >> param.lsb) & ((1 << (param.msb - param.lsb + 1)) - 1);
+}
+
+ConnectionVirtual::ConnectionVirtual(const std::string &options) :
+    fpgaRegisters(0x10000, 0),
+    streaming(false),
+    sampleRate(0),
+    samplesInPacket(samples12InPkt),
+    clockBase(0),
+    rxTimestamp(0),
+    txPlayedAt(0),
+    txLate(false),
+    realtime(true),
+    lossProbability(0),
+    lateProbability(0),
+    toneFrequency(0),
+    chance(0.0, 1.0)
+{
+    for (auto &transfer : transfers)
+        transfer.used = false;
+
+    std::stringstream list(options);
+    std::string option;
+    while (std::getline(list, option, ';'))
+    {
+        if (option.empty())
+            continue;
+        const size_t separator = option.find('=');
+        const std::string key = option.substr(0, separator);
+        const std::string value = separator == std::string::npos ? "" : option.substr(separator + 1);
+        try
+        {
+            if (key == "realtime")
+                realtime = std::stoi(value) != 0;
+            else if (key == "loss")
+                lossProbability = std::stod(value);
+            else if (key == "late")
+                lateProbability = std::stod(value);
+            else if (key == "tone")
+                toneFrequency = std::stod(value);
+            else
+                lime::warning("Virtual: unknown option '%s'", key.c_str());
+        }
+        catch (const std::exception &)
+        {
+            lime::warning("Virtual: invalid value of option '%s'", key.c_str());
+        }
+    }
+
+    fpgaRegisters[0x0021] = 0x0005; //PLL configuration and phase search done
+    DeviceReset();
+}
+
+ConnectionVirtual::~ConnectionVirtual(void)
+{
+    AbortTransfers(false);
+    AbortTransfers(true);
+}
+
+bool ConnectionVirtual::IsOpen(void)
+{
+    return true;
+}
+
+DeviceInfo ConnectionVirtual::GetDeviceInfo(void)
+{
+    DeviceInfo info;
+    info.deviceName = deviceName;
+    info.expansionName = GetExpansionBoardName(EXP_BOARD_NO);
+    info.firmwareVersion = "0";
+    info.gatewareVersion = "0";
+    info.gatewareRevision = "0";
+    info.gatewareTargetBoard = deviceName;
+    info.hardwareVersion = "0";
+    info.protocolVersion = "1";
+    info.boardSerialNumber = 0;
+    return info;
+}
+
+int ConnectionVirtual::DeviceReset(int ind)
+{
+    std::lock_guard<std::mutex> guard(lock);
+    for (auto &bank : lmsRegisters)
+        bank.assign(0x8000, 0);
+    for (auto parameter : LMS7parameterList)
+    {
+        lmsRegisters[0][parameter->address] |= parameter->defaultValue << parameter->lsb;
+        if (parameter->address >= 0x0100)
+            lmsRegisters[1][parameter->address] |= parameter->defaultValue << parameter->lsb;
+    }
+    return 0;
+}
+
+uint16_t &ConnectionVirtual::LMSRegister(int channel, uint16_t addr)
+{
+    //only registers from 0x0100 are duplicated for channel B
+    return lmsRegisters[addr < 0x0100 ? 0 : channel][addr & 0x7FFF];
+}
+
+uint16_t ConnectionVirtual::ReadLMSRegister(uint16_t addr)
+{
+    const int channel = (lmsRegisters[0][0x0020] & 0x3) == 2 ? 1 : 0;
+    uint16_t value = LMSRegister(channel, addr);
+    //VCOs lock in the middle of capacitor bank, comparators report
+    //frequency too low (0), locked (2) or too high (3)
+    if (addr == LMS7_VCO_CMPHO_CGEN.address || addr == LMS7_VCO_CMPHO.address)
+    {
+        const LMS7Parameter &csw = addr == LMS7_VCO_CMPHO.address ? LMS7_CSW_VCO : LMS7_CSW_VCO_CGEN;
+        const int cswValue = GetBits(LMSRegister(channel, csw.address), csw);
+        const int comparators = cswValue < 96 ? 0 : (cswValue > 160 ? 3 : 2);
+        value = (value & ~0x3000) | (comparators << 12);
+    }
+    return value;
+}
+
+int ConnectionVirtual::WriteLMS7002MSPI(const uint32_t *writeData, size_t size, unsigned periphID)
+{
+    std::lock_guard<std::mutex> guard(lock);
+    for (size_t i = 0; i < size; ++i)
+    {
+        const uint16_t addr = (writeData[i] >> 16) & 0x7FFF;
+        const uint16_t mac = lmsRegisters[0][0x0020] & 0x3;
+        if (addr < 0x0100 || (mac & 1))
+            LMSRegister(0, addr) = writeData[i] & 0xFFFF;
+        if (addr >= 0x0100 && (mac & 2))
+            LMSRegister(1, addr) = writeData[i] & 0xFFFF;
+    }
+    return 0;
+}
+
+int ConnectionVirtual::ReadLMS7002MSPI(const uint32_t *writeData, uint32_t *readData, size_t size, unsigned periphID)
+{
+    std::lock_guard<std::mutex> guard(lock);
+    for (size_t i = 0; i < size; ++i)
+        readData[i] = ReadLMSRegister((writeData[i] >> 16) & 0x7FFF);
+    return 0;
+}
+
+int ConnectionVirtual::WriteRegisters(const uint32_t *addrs, const uint32_t *data, const size_t size)
+{
+    std::lock_guard<std::mutex> guard(lock);
+    for (size_t i = 0; i < size; ++i)
+        WriteFPGARegister(addrs[i] & 0xFFFF, data[i]);
+    return 0;
+}
+
+int ConnectionVirtual::ReadRegisters(const uint32_t *addrs, uint32_t *data, const size_t size)
+{
+    std::lock_guard<std::mutex> guard(lock);
+    for (size_t i = 0; i < size; ++i)
+        data[i] = fpgaRegisters[addrs[i] & 0xFFFF];
+    return 0;
+}
+
+void ConnectionVirtual::WriteFPGARegister(uint16_t addr, uint16_t value)
+{
+    const uint16_t previous = fpgaRegisters[addr];
+    const uint16_t rising = value & ~previous;
+    const auto now = std::chrono::steady_clock::now();
+    fpgaRegisters[addr] = value;
+    if (addr == 0x000A && (rising & RX_EN))
+    {
+        PrepareStream();
+        clockStart = now;
+        streaming = true;
+        transferDone.notify_all();
+    }
+    else if (addr == 0x000A && (previous & RX_EN) && !(value & RX_EN))
+    {
+        clockBase = SampleCounter();
+        streaming = false;
+    }
+    else if (addr == 0x0009)
+    {
+        if (rising & SMPL_NR_CLR)
+        {
+            clockBase = 0;
+            clockStart = now;
+            rxTimestamp = 0;
+            txPlayedAt = 0;
+        }
+        if (rising & TXPCT_LOSS_CLR)
+            txLate = false;
+    }
+    else if (addr == 0x0061 && (rising & 0x4))
+    {
+        //reference clock measurement completes immediately
+        const uint32_t count = refClock * fx3Count / fx3Clock;
+        fpgaRegisters[0x0065] |= 0x4;
+        fpgaRegisters[0x0072] = count & 0xFFFF;
+        fpgaRegisters[0x0073] = count >> 16;
+    }
+}
+
+double ConnectionVirtual::GetSampleRate()
+{
+    //same as LMS7002M::GetSampleRate() of channel A receiver
+    auto get = [this](const LMS7Parameter &param) {
+        return GetBits(LMSRegister(0, param.address), param);
+    };
+    const uint16_t gINT = LMSRegister(0, 0x0088) & 0x3FFF;
+    const uint32_t gFRAC = ((gINT & 0xF) << 16) | LMSRegister(0, 0x0087);
+    const double cgen = (refClock/2.0)/(get(LMS7_DIV_OUTCH_CGEN)+1) * ((gINT >> 4) + 1 + gFRAC/1048576.0);
+    double rate = cgen/4.0;
+    if (get(LMS7_EN_ADCCLKH_CLKGN) != 0)
+        rate /= std::pow(2.0, get(LMS7_CLKH_OV_CLKL_CGEN));
+    const int ratio = get(LMS7_HBD_OVR_RXTSP);
+    if (ratio != 7)
+        rate /= std::pow(2.0, ratio);
+    return rate/2.0;
+}
+
+void ConnectionVirtual::PrepareStream()
+{
+    sampleRate = GetSampleRate();
+    if (!(sampleRate > 0))
+    {
+        lime::warning("Virtual: invalid sample rate, using 1 MS/s");
+        sampleRate = 1e6;
+    }
+    const bool packed = fpgaRegisters[0x0008] & 0x2;
+    const bool mimo = (fpgaRegisters[0x0007] & 0x3) == 0x3;
+    samplesInPacket = (packed ? samples12InPkt : samples16InPkt)/(mimo ? 2 : 1);
+
+    //table holds whole number of tone periods, so it can be repeated
+    const int tableSamples = tonePackets*samplesInPacket;
+    const double frequency = toneFrequency != 0 ? toneFrequency : sampleRate/8;
+    const double periods = std::round(frequency/sampleRate*tableSamples);
+    const double amplitude = 0.5*(packed ? 2047 : 32767);
+    const double pi = std::acos(-1);
+    std::vector<complex16_t> samples[2];
+    for (auto &channel : samples)
+        channel.resize(tableSamples);
+    for (int n = 0; n < tableSamples; ++n)
+    {
+        const double phase = 2*pi*periods*n/tableSamples;
+        samples[0][n].i = std::lround(amplitude*std::cos(phase));
+        samples[0][n].q = std::lround(amplitude*std::sin(phase));
+        samples[1][n].i = samples[0][n].i;
+        samples[1][n].q = -samples[0][n].q;
+    }
+    tonePayloads.resize(tonePackets*payloadSize);
+    for (int p = 0; p < tonePackets; ++p)
+    {
+        const complex16_t* src[2] = {&samples[0][p*samplesInPacket], &samples[1][p*samplesInPacket]};
+        FPGA::Samples2FPGAPacketPayload(src, samplesInPacket, mimo, packed, &tonePayloads[p*payloadSize]);
+    }
+}
+
+uint64_t ConnectionVirtual::SampleCounter() const
+{
+    //without real time pacing board clock follows produced samples
+    if (!realtime)
+        return rxTimestamp;
+    if (!streaming)
+        return clockBase;
+    const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - clockStart;
+    return clockBase + uint64_t(elapsed.count()*sampleRate);
+}
+
+int ConnectionVirtual::ResetStreamBuffers()
+{
+    std::lock_guard<std::mutex> guard(lock);
+    const uint64_t counter = SampleCounter();
+    if (counter > rxTimestamp)
+        rxTimestamp += (counter - rxTimestamp)/samplesInPacket*samplesInPacket;
+    txPlayedAt = counter;
+    return 0;
+}
+
+int ConnectionVirtual::GetBuffersCount() const
+{
+    return 16;
+}
+
+int ConnectionVirtual::CheckStreamSize(int size) const
+{
+    return size;
+}
+
+int ConnectionVirtual::AllocateTransfer(uint32_t length, uint64_t readyAt, bool tx)
+{
+    for (int i = 0; i < MAX_TRANSFERS; ++i)
+    {
+        Transfer &transfer = transfers[i];
+        if (transfer.used)
+            continue;
+        transfer.length = length;
+        transfer.readyAt = readyAt;
+        transfer.tx = tx;
+        transfer.used = true;
+        transfer.aborted = false;
+        return i;
+    }
+    return ReportError(ENOMEM, "Virtual: too many transfers in progress");
+}
+
+int ConnectionVirtual::BeginDataReading(char* buffer, uint32_t length, int ep)
+{
+    if (ep != 0)
+        return ReportError(EINVAL, "Virtual: invalid stream endpoint %i", ep);
+    std::lock_guard<std::mutex> guard(lock);
+    if (tonePayloads.empty())
+        PrepareStream();
+    //board drops packets that were not read in time
+    const uint64_t counter = SampleCounter();
+    if (counter > rxTimestamp + rxFifoPackets*samplesInPacket)
+        rxTimestamp += (counter - rxTimestamp)/samplesInPacket*samplesInPacket;
+
+    const uint32_t packets = length/packetSize;
+    FPGA_DataPacket* pkt = reinterpret_cast<FPGA_DataPacket*>(buffer);
+    for (uint32_t i = 0; i < packets; ++i)
+    {
+        if (lossProbability > 0 && chance(random) < lossProbability)
+            rxTimestamp += samplesInPacket;
+        memset(pkt[i].reserved, 0, sizeof(pkt[i].reserved));
+        pkt[i].reserved[0] = txLate ? (1 << 3) : 0;
+        pkt[i].counter = rxTimestamp;
+        const int index = (rxTimestamp/samplesInPacket) % tonePackets;
+        memcpy(pkt[i].data, &tonePayloads[index*payloadSize], payloadSize);
+        rxTimestamp += samplesInPacket;
+    }
+    return AllocateTransfer(packets*packetSize, rxTimestamp, false);
+}
+
+bool ConnectionVirtual::WaitForReading(int contextHandle, unsigned int timeout_ms)
+{
+    return WaitTransfer(contextHandle, timeout_ms);
+}
+
+int ConnectionVirtual::FinishDataReading(char* buffer, uint32_t length, int contextHandle)
+{
+    return FinishTransfer(contextHandle);
+}
+
+void ConnectionVirtual::AbortReading(int ep)
+{
+    AbortTransfers(false);
+}
+
+int ConnectionVirtual::BeginDataSending(const char* buffer, uint32_t length, int ep)
+{
+    if (ep != 0)
+        return ReportError(EINVAL, "Virtual: invalid stream endpoint %i", ep);
+    std::lock_guard<std::mutex> guard(lock);
+    if (tonePayloads.empty())
+        PrepareStream();
+    const uint64_t fifoSamples = txFifoPackets*samplesInPacket;
+    uint64_t arrival = SampleCounter();
+
+    const uint32_t packets = length/packetSize;
+    const FPGA_DataPacket* pkt = reinterpret_cast<const FPGA_DataPacket*>(buffer);
+    for (uint32_t i = 0; i < packets; ++i)
+    {
+        //packet enters FIFO when there is space for it
+        if (txPlayedAt > arrival + fifoSamples)
+            arrival = txPlayedAt - fifoSamples;
+        uint64_t start = std::max(txPlayedAt, arrival);
+        const bool ignoreTimestamp = pkt[i].reserved[0] & (1 << 4);
+        if (!ignoreTimestamp)
+        {
+            //late packets are dropped and reported in received packets
+            if (pkt[i].counter < start || (lateProbability > 0 && chance(random) < lateProbability))
+            {
+                txLate = true;
+                continue;
+            }
+            start = pkt[i].counter;
+        }
+        txPlayedAt = start + samplesInPacket;
+    }
+    return AllocateTransfer(packets*packetSize, arrival, true);
+}
+
+bool ConnectionVirtual::WaitForSending(int contextHandle, uint32_t timeout_ms)
+{
+    return WaitTransfer(contextHandle, timeout_ms);
+}
+
+int ConnectionVirtual::FinishDataSending(const char* buffer, uint32_t length, int contextHandle)
+{
+    return FinishTransfer(contextHandle);
+}
+
+void ConnectionVirtual::AbortSending(int ep)
+{
+    AbortTransfers(true);
+}
+
+bool ConnectionVirtual::WaitTransfer(int handle, unsigned timeout_ms)
+{
+    if (handle < 0 || handle >= MAX_TRANSFERS)
+        return true;
+    const auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeout_ms);
+    std::unique_lock<std::mutex> guard(lock);
+    const Transfer &transfer = transfers[handle];
+    while (realtime && transfer.used && !transfer.aborted)
+    {
+        const uint64_t counter = SampleCounter();
+        if (counter >= transfer.readyAt)
+            break;
+        const auto now = std::chrono::steady_clock::now();
+        if (now >= deadline)
+            return false;
+        auto wakeup = deadline;
+        if (streaming)
+        {
+            const std::chrono::duration<double> left((transfer.readyAt - counter)/sampleRate);
+            wakeup = std::min(deadline, now + std::chrono::duration_cast<std::chrono::steady_clock::duration>(left));
+        }
+        transferDone.wait_until(guard, wakeup);
+    }
+    return true;
+}
+
+int ConnectionVirtual::FinishTransfer(int handle)
+{
+    if (handle < 0 || handle >= MAX_TRANSFERS)
+        return 0;
+    std::lock_guard<std::mutex> guard(lock);
+    Transfer &transfer = transfers[handle];
+    if (!transfer.used)
+        return 0;
+    transfer.used = false;
+    const bool completed = !realtime || SampleCounter() >= transfer.readyAt;
+    return (completed && !transfer.aborted) ? transfer.length : 0;
+}
+
+void ConnectionVirtual::AbortTransfers(bool tx)
+{
+    std::lock_guard<std::mutex> guard(lock);
+    for (auto &transfer : transfers)
+        if (transfer.used && transfer.tx == tx)
+            transfer.aborted = true;
+    transferDone.notify_all();
+}
+
+int ConnectionVirtual::ReceiveData(char* buffer, int length, int epIndex, int timeout)
+{
+    const int handle = BeginDataReading(buffer, length, epIndex);
+    if (handle < 0)
+        return -1;
+    WaitForReading(handle, timeout);
+    return FinishDataReading(buffer, length, handle);
+}
+
+int ConnectionVirtual::SendData(const char* buffer, int length, int epIndex, int timeout)
+{
+    const int handle = BeginDataSending(buffer, length, epIndex);
+    if (handle < 0)
+        return -1;
+    WaitForSending(handle, timeout);
+    return FinishDataSending(buffer, length, handle);
+}
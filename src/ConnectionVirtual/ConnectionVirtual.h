@@ -0,0 +1,132 @@
+/**
+    @file ConnectionVirtual.h
+    @author Lime Microsystems
+    @brief Emulated LimeSDR board for testing without hardware
+*/
+
+#pragma once
+#include <ConnectionRegistry.h>
+#include <IConnection.h>
+#include <vector>
+#include <string>
+#include <mutex>
+#include <chrono>
+#include <random>
+#include <condition_variable>
+
+namespace lime{
+
+/** @brief Virtual LimeSDR, streams test tone at configured sample rate
+
+    FPGA and LMS7002M registers only keep written values, except the ones
+    host polls for results (reference clock counters, PLL status, VCO
+    comparators), which report successful operation. Sample rate is derived
+    from CGEN and decimation settings, like on real board.
+
+    Received packets carry test tone (its complex conjugate on channel B)
+    and timestamps counted from the last timestamp reset. Transmitted packets
+    are played out from small FIFO, timestamped packets that arrive too late
+    are dropped and reported by late flag of received packets. Packets not
+    read in time are dropped, as on real board.
+
+    Options are given in connection address as "key=value" list separated
+    by ';':
+        - realtime=0 produces and consumes samples as fast as host can
+        - loss=<probability> drops received packets at random
+        - late=<probability> reports timestamped Tx packets as late at random
+        - tone=<Hz> test tone frequency, sample rate/8 by default
+*/
+class ConnectionVirtual : public IConnection
+{
+public:
+    ConnectionVirtual(const std::string &options);
+    ~ConnectionVirtual(void);
+
+    static const char deviceName[];
+
+    bool IsOpen(void) override;
+    DeviceInfo GetDeviceInfo(void) override;
+    int DeviceReset(int ind=0) override;
+
+    int WriteLMS7002MSPI(const uint32_t *writeData, size_t size, unsigned periphID = 0) override;
+    int ReadLMS7002MSPI(const uint32_t *writeData, uint32_t *readData, size_t size, unsigned periphID = 0) override;
+    int WriteRegisters(const uint32_t *addrs, const uint32_t *data, const size_t size) override;
+    int ReadRegisters(const uint32_t *addrs, uint32_t *data, const size_t size) override;
+
+protected:
+    int ResetStreamBuffers() override;
+    int GetBuffersCount() const override;
+    int CheckStreamSize(int size) const override;
+
+    int ReceiveData(char* buffer, int length, int epIndex, int timeout = 100) override;
+    int SendData(const char* buffer, int length, int epIndex, int timeout = 100) override;
+
+    int BeginDataReading(char* buffer, uint32_t length, int ep) override;
+    bool WaitForReading(int contextHandle, unsigned int timeout_ms) override;
+    int FinishDataReading(char* buffer, uint32_t length, int contextHandle) override;
+    void AbortReading(int ep) override;
+
+    int BeginDataSending(const char* buffer, uint32_t length, int ep) override;
+    bool WaitForSending(int contextHandle, uint32_t timeout_ms) override;
+    int FinishDataSending(const char* buffer, uint32_t length, int contextHandle) override;
+    void AbortSending(int ep) override;
+
+private:
+    static const int MAX_TRANSFERS = 64;
+
+    struct Transfer
+    {
+        uint32_t length; //bytes produced or consumed
+        uint64_t readyAt; //sample counter value at which transfer completes
+        bool tx;
+        bool used;
+        bool aborted;
+    };
+
+    uint16_t &LMSRegister(int channel, uint16_t addr);
+    uint16_t ReadLMSRegister(uint16_t addr);
+    void WriteFPGARegister(uint16_t addr, uint16_t value);
+    double GetSampleRate();
+    uint64_t SampleCounter() const;
+    void PrepareStream();
+    int AllocateTransfer(uint32_t length, uint64_t readyAt, bool tx);
+    bool WaitTransfer(int handle, unsigned timeout_ms);
+    int FinishTransfer(int handle);
+    void AbortTransfers(bool tx);
+
+    std::mutex lock;
+    std::condition_variable transferDone;
+    std::vector<uint16_t> lmsRegisters[2]; //channel A and B register banks
+    std::vector<uint16_t> fpgaRegisters;
+    Transfer transfers[MAX_TRANSFERS];
+
+    //stream configuration latched when streaming starts
+    bool streaming;
+    double sampleRate;
+    uint32_t samplesInPacket; //per channel
+    std::vector<uint8_t> tonePayloads; //test tone packets, whole number of periods
+
+    //sample clock, counts samples since the last timestamp reset
+    std::chrono::steady_clock::time_point clockStart;
+    uint64_t clockBase;
+    uint64_t rxTimestamp; //timestamp of the next received packet
+    uint64_t txPlayedAt; //counter value when queued Tx samples are played
+    bool txLate;
+
+    bool realtime;
+    double lossProbability;
+    double lateProbability;
+    double toneFrequency;
+    std::mt19937 random;
+    std::uniform_real_distribution<double> chance;
+};
+
+class ConnectionVirtualEntry : public ConnectionRegistryEntry
+{
+public:
+    ConnectionVirtualEntry(void);
+    std::vector<ConnectionHandle> enumerate(const ConnectionHandle &hint);
+    IConnection *make(const ConnectionHandle &handle);
+};
+
+}
@@ -0,0 +1,49 @@
+/**
+    @file ConnectionVirtualEntry.cpp
+    @author Lime Microsystems
+    @brief Registration of emulated LimeSDR board
+*/
+
+#include "ConnectionVirtual.h"
+#include <cstdlib>
+
+using namespace lime;
+
+//! make a static-initialized entry in the registry
+void __loadConnectionVirtualEntry(void) //TODO fixme replace with LoadLibrary/dlopen
+{
+    static ConnectionVirtualEntry virtualEntry;
+}
+
+ConnectionVirtualEntry::ConnectionVirtualEntry(void):
+    ConnectionRegistryEntry("Virtual") //listed after hardware connections
+{
+    return;
+}
+
+std::vector<ConnectionHandle> ConnectionVirtualEntry::enumerate(const ConnectionHandle &hint)
+{
+    std::vector<ConnectionHandle> result;
+
+    ConnectionHandle handle;
+    handle.media = "Virtual";
+    handle.name = ConnectionVirtual::deviceName;
+    //hints aimed at other connections must not open the virtual board
+    if (!hint.media.empty() && hint.media != handle.media)
+        return result;
+    if (!hint.name.empty() && hint.name != handle.name && hint.name != handle.media)
+        return result;
+    if (!hint.serial.empty() && hint.serial != handle.serial)
+        return result;
+    //LMS_Open() only matches listed handles, allow options from environment
+    const char* options = std::getenv("LIME_VIRTUAL_OPTIONS");
+    handle.addr = (hint.addr.empty() && options) ? options : hint.addr;
+    result.push_back(handle);
+
+    return result;
+}
+
+IConnection *ConnectionVirtualEntry::make(const ConnectionHandle &handle)
+{
+    return new ConnectionVirtual(handle.addr);
+}
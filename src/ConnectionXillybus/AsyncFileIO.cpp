@@ -0,0 +1,301 @@
+/**
+    @file AsyncFileIO.cpp
+    @author Lime Microsystems
+    @brief Asynchronous transfers on non-blocking file descriptors
+*/
+
+#ifdef __unix__
+#include "AsyncFileIO.h"
+#include "Logger.h"
+#include <unistd.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <algorithm>
+#include <chrono>
+#include <cerrno>
+
+using namespace lime;
+
+AsyncFileIO::AsyncFileIO(unsigned maxTransfers, bool flushWrites) :
+    mFlushWrites(flushWrites),
+    mTransfers(maxTransfers),
+    mTerminate(false),
+    mRunning(false)
+{
+    for (auto &t : mTransfers)
+        t.used = false;
+    mEpoll = epoll_create1(EPOLL_CLOEXEC);
+    mWakeup = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (mEpoll < 0 || mWakeup < 0)
+    {
+        lime::ReportError(errno, "AsyncFileIO: failed to create epoll instance");
+        return;
+    }
+    epoll_event ev = {};
+    ev.events = EPOLLIN;
+    ev.data.fd = mWakeup;
+    epoll_ctl(mEpoll, EPOLL_CTL_ADD, mWakeup, &ev);
+    mRunning = true;
+    mEventThread = std::thread(&AsyncFileIO::EventLoop, this);
+}
+
+AsyncFileIO::~AsyncFileIO()
+{
+    if (mEventThread.joinable())
+    {
+        {
+            std::lock_guard<std::mutex> lock(mLock);
+            mTerminate = true;
+        }
+        const uint64_t one = 1;
+        if (write(mWakeup, &one, sizeof(one)) < 0)
+            lime::warning("AsyncFileIO: failed to wake event thread");
+        mEventThread.join();
+    }
+    if (mWakeup >= 0)
+        close(mWakeup);
+    if (mEpoll >= 0)
+        close(mEpoll);
+}
+
+int AsyncFileIO::Submit(int fd, bool write, char* buffer, uint32_t length)
+{
+    std::lock_guard<std::mutex> lock(mLock);
+    if (!mRunning)
+        return lime::ReportError(ENODEV, "AsyncFileIO: event thread is not running");
+    auto iter = std::find_if(mTransfers.begin(), mTransfers.end(), [](const Transfer &t){ return !t.used; });
+    if (iter == mTransfers.end())
+        return lime::ReportError(EBUSY, "AsyncFileIO: too many pending transfers");
+
+    iter->used = true;
+    iter->done = false;
+    iter->write = write;
+    iter->fd = fd;
+    iter->buffer = buffer;
+    iter->length = length;
+    iter->transferred = 0;
+    const int handle = iter - mTransfers.begin();
+
+    File &file = mFiles[fd];
+    if (file.failed || length == 0)
+    {
+        iter->done = true;
+        return handle;
+    }
+    file.queue.push_back(handle);
+    if (!file.leftover.empty()) //data kept from cancelled read comes first
+    {
+        if (Service(fd, file))
+            mTransferDone.notify_all();
+    }
+    else if (!file.watched)
+        Watch(fd, file, true);
+    return handle;
+}
+
+bool AsyncFileIO::Wait(int handle, unsigned timeout_ms)
+{
+    std::unique_lock<std::mutex> lock(mLock);
+    if (handle < 0 || handle >= int(mTransfers.size()) || !mTransfers[handle].used)
+        return true;
+    const Transfer &t = mTransfers[handle];
+    return mTransferDone.wait_for(lock, std::chrono::milliseconds(timeout_ms), [&t]{ return t.done; });
+}
+
+int AsyncFileIO::Finish(int handle)
+{
+    std::lock_guard<std::mutex> lock(mLock);
+    if (handle < 0 || handle >= int(mTransfers.size()) || !mTransfers[handle].used)
+        return -1;
+    Transfer &t = mTransfers[handle];
+    if (!t.done)
+    {
+        auto fileIter = mFiles.find(t.fd);
+        if (fileIter != mFiles.end())
+        {
+            File &file = fileIter->second;
+            file.queue.erase(std::remove(file.queue.begin(), file.queue.end(), handle), file.queue.end());
+            //only the oldest read can be partially filled, keeping its data
+            //keeps the byte stream, and so packet boundaries, intact
+            if (!t.write && t.transferred > 0)
+            {
+                file.leftover.insert(file.leftover.begin(), t.buffer, t.buffer + t.transferred);
+                t.transferred = 0;
+                if (!file.queue.empty() && Service(t.fd, file))
+                    mTransferDone.notify_all();
+            }
+            if (file.queue.empty() && file.watched)
+                Watch(t.fd, file, false);
+        }
+    }
+    t.used = false;
+    return t.transferred;
+}
+
+void AsyncFileIO::Cancel(int fd)
+{
+    {
+        std::lock_guard<std::mutex> lock(mLock);
+        auto iter = mFiles.find(fd);
+        if (iter == mFiles.end())
+            return;
+        Complete(iter->second, true);
+        if (iter->second.watched)
+            Watch(fd, iter->second, false);
+        mFiles.erase(iter);
+    }
+    mTransferDone.notify_all();
+}
+
+//! Marks the first or all pending transfers of file as done, mLock must be held
+void AsyncFileIO::Complete(File &file, bool all)
+{
+    while (!file.queue.empty())
+    {
+        mTransfers[file.queue.front()].done = true;
+        file.queue.pop_front();
+        if (!all)
+            break;
+    }
+}
+
+//! Adds file to epoll set or removes it, mLock must be held
+void AsyncFileIO::Watch(int fd, File &file, bool enable)
+{
+    epoll_event ev = {};
+    if (enable)
+    {
+        //all transfers of a descriptor are expected to be in the same direction
+        ev.events = mTransfers[file.queue.front()].write ? EPOLLOUT : EPOLLIN;
+        ev.data.fd = fd;
+    }
+    if (epoll_ctl(mEpoll, enable ? EPOLL_CTL_ADD : EPOLL_CTL_DEL, fd, &ev) != 0)
+    {
+        if (enable)
+        {
+            lime::ReportError(errno, "AsyncFileIO: cannot watch file descriptor %i", fd);
+            file.failed = true;
+            Complete(file, true);
+            mTransferDone.notify_all();
+        }
+        file.watched = false;
+        return;
+    }
+    file.watched = enable;
+}
+
+/** @brief Moves data of pending transfers until descriptor would block, mLock must be held
+    @return true if any transfer was completed
+*/
+bool AsyncFileIO::Service(int fd, File &file)
+{
+    bool completed = false;
+    while (!file.queue.empty())
+    {
+        Transfer &t = mTransfers[file.queue.front()];
+        ssize_t ret;
+        if (t.write)
+            ret = ::write(fd, t.buffer + t.transferred, t.length - t.transferred);
+        else if (!file.leftover.empty())
+        {
+            ret = std::min<size_t>(file.leftover.size(), t.length - t.transferred);
+            std::copy(file.leftover.begin(), file.leftover.begin() + ret, t.buffer + t.transferred);
+            file.leftover.erase(file.leftover.begin(), file.leftover.begin() + ret);
+        }
+        else
+            ret = ::read(fd, t.buffer + t.transferred, t.length - t.transferred);
+        if (ret < 0)
+        {
+            if (errno == EINTR)
+                continue;
+            if (errno == EAGAIN || errno == EWOULDBLOCK)
+                break;
+            lime::ReportError(errno, "AsyncFileIO: %s failed", t.write ? "write" : "read");
+            file.failed = true;
+        }
+        else if (ret == 0 && !t.write)
+            file.failed = true; //end of file, nothing more will arrive
+        if (file.failed)
+        {
+            Complete(file, true);
+            completed = true;
+            break;
+        }
+
+        t.transferred += ret;
+        if (t.transferred < t.length)
+            continue;
+        if (t.write && mFlushWrites)
+        {
+            while (::write(fd, nullptr, 0) < 0 && errno == EINTR)
+                ;
+        }
+        Complete(file, false);
+        completed = true;
+    }
+    if (file.queue.empty() && file.watched)
+        Watch(fd, file, false);
+    else if (!file.queue.empty() && !file.watched && !file.failed)
+        Watch(fd, file, true);
+    return completed;
+}
+
+//! Fails transfers of all descriptors when events can't be received, mLock must be held
+void AsyncFileIO::FailAll()
+{
+    mRunning = false;
+    for (auto &iter : mFiles)
+    {
+        File &file = iter.second;
+        file.failed = true;
+        Complete(file, true);
+        if (file.watched)
+            Watch(iter.first, file, false);
+    }
+    mTransferDone.notify_all();
+}
+
+void AsyncFileIO::EventLoop()
+{
+    const int maxEvents = 16;
+    epoll_event events[maxEvents];
+    while (true)
+    {
+        const int count = epoll_wait(mEpoll, events, maxEvents, -1);
+        if (count < 0)
+        {
+            if (errno == EINTR)
+                continue;
+            lime::ReportError(errno, "AsyncFileIO: epoll_wait failed");
+            std::lock_guard<std::mutex> lock(mLock);
+            FailAll();
+            break;
+        }
+
+        bool completed = false;
+        {
+            std::lock_guard<std::mutex> lock(mLock);
+            if (mTerminate)
+                break;
+            for (int i = 0; i < count; ++i)
+            {
+                const int fd = events[i].data.fd;
+                if (fd == mWakeup)
+                {
+                    uint64_t value;
+                    while (read(mWakeup, &value, sizeof(value)) > 0)
+                        ;
+                    continue;
+                }
+                //descriptor could have been cancelled after the event was reported
+                auto iter = mFiles.find(fd);
+                if (iter != mFiles.end() && iter->second.watched)
+                    completed |= Service(fd, iter->second);
+            }
+        }
+        if (completed)
+            mTransferDone.notify_all();
+    }
+}
+
+#endif
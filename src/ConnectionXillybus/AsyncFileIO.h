@@ -0,0 +1,93 @@
+/**
+    @file AsyncFileIO.h
+    @author Lime Microsystems
+    @brief Asynchronous transfers on non-blocking file descriptors
+*/
+
+#pragma once
+#include <stdint.h>
+#include <vector>
+#include <deque>
+#include <map>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+
+namespace lime{
+
+/** @brief Queues reads and writes of character devices and completes them
+    from an epoll event thread
+
+    Each file descriptor has a queue of transfers which are filled in
+    submission order whenever the descriptor becomes ready, so several
+    transfers per endpoint can be outstanding without the caller spinning on
+    EAGAIN. Descriptors have to be opened with O_NONBLOCK, they are watched
+    only while they have pending transfers.
+*/
+class AsyncFileIO
+{
+public:
+    /** @param maxTransfers number of transfers that can be pending at once
+        @param flushWrites issue zero length write after each completed write,
+        Xillybus uses it to push partially filled DMA buffer to the FPGA
+    */
+    AsyncFileIO(unsigned maxTransfers, bool flushWrites);
+    ~AsyncFileIO();
+
+    /** @brief Queues transfer
+        @return transfer handle, -1 on failure
+    */
+    int Submit(int fd, bool write, char* buffer, uint32_t length);
+
+    //! @brief Waits for transfer to complete, returns false on timeout
+    bool Wait(int handle, unsigned timeout_ms);
+
+    /** @brief Releases transfer handle, pending transfer is cancelled
+        Data of a partially filled read is not lost, it is delivered first
+        to the next read of the descriptor.
+        @return number of bytes transferred, -1 on invalid handle
+    */
+    int Finish(int handle);
+
+    //! @brief Completes all pending transfers of descriptor, must be called before closing it
+    void Cancel(int fd);
+
+private:
+    struct Transfer
+    {
+        bool used;
+        bool done;
+        bool write;
+        int fd;
+        char* buffer;
+        uint32_t length;
+        uint32_t transferred;
+    };
+    struct File
+    {
+        File() : watched(false), failed(false) {}
+        std::deque<int> queue; //indexes of pending transfers
+        std::vector<char> leftover; //data of cancelled partial read
+        bool watched; //registered in epoll
+        bool failed; //read/write error or end of file
+    };
+
+    void EventLoop();
+    bool Service(int fd, File &file);
+    void Complete(File &file, bool all);
+    void Watch(int fd, File &file, bool enable);
+    void FailAll();
+
+    const bool mFlushWrites;
+    std::mutex mLock;
+    std::condition_variable mTransferDone;
+    std::vector<Transfer> mTransfers;
+    std::map<int, File> mFiles;
+    int mEpoll;
+    int mWakeup;
+    bool mTerminate;
+    bool mRunning; //event thread is processing events
+    std::thread mEventThread;
+};
+
+}
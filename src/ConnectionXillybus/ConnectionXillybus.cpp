@@ -9,11 +9,14 @@
 #include "Windows.h"
 #else
 #include <unistd.h>
+#include <poll.h>
+#include "AsyncFileIO.h"
 #endif
 #include <sys/types.h>
 #include <sys/stat.h>
 #include <fcntl.h>
 #include <cstring>
+#include <cstdlib>
 #include <iostream>
 #include "Si5351C.h"
 #include <FPGA_common.h>
@@ -44,20 +47,36 @@ const ConnectionXillybus::EPConfig ConnectionXillybus::deviceConfigs[] = {
     }
 #else
     {
-        "/dev/xillybus_read_8",
-        "/dev/xillybus_write_8",
-        {"/dev/xillybus_read_32", "/dev/xillybus_read_32", "/dev/xillybus_read_32"},
-        {"/dev/xillybus_write_32", "/dev/xillybus_write_32", "/dev/xillybus_write_32"}
+        "xillybus_read_8",
+        "xillybus_write_8",
+        {"xillybus_read_32", "xillybus_read_32", "xillybus_read_32"},
+        {"xillybus_write_32", "xillybus_write_32", "xillybus_write_32"}
     },
     {
-        "/dev/xillybus_control0_read_32",
-        "/dev/xillybus_control0_write_32",
-        {"/dev/xillybus_stream0_read_32", "/dev/xillybus_stream1_read_32", "/dev/xillybus_stream2_read_32"},
-        {"/dev/xillybus_stream0_write_32", "/dev/xillybus_stream1_write_32", "/dev/xillybus_stream2_write_32"}
+        "xillybus_control0_read_32",
+        "xillybus_control0_write_32",
+        {"xillybus_stream0_read_32", "xillybus_stream1_read_32", "xillybus_stream2_read_32"},
+        {"xillybus_stream0_write_32", "xillybus_stream1_write_32", "xillybus_stream2_write_32"}
     }
 #endif
 };
 
+#ifdef __unix__
+std::string ConnectionXillybus::DevicePath(const std::string &name)
+{
+    const char* dir = std::getenv("LIME_XILLYBUS_DIR");
+    return std::string(dir != nullptr ? dir : "/dev") + "/" + name;
+}
+
+//! Waits until non-blocking descriptor is ready instead of retrying the call
+static void WaitReady(int fd, short events, std::chrono::high_resolution_clock::time_point start, int timeout_ms)
+{
+    const auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(chrono::high_resolution_clock::now() - start).count();
+    pollfd pfd = {fd, events, 0};
+    poll(&pfd, 1, std::max<int>(timeout_ms - elapsed, 0));
+}
+#endif
+
 /** @brief Initializes port type and object necessary to communicate to usb device.
 */
 ConnectionXillybus::ConnectionXillybus(const unsigned index)
@@ -73,7 +92,10 @@ ConnectionXillybus::ConnectionXillybus(const unsigned index)
     hRead = -1;
     for (int i = 0; i < MAX_EP_CNT; i++)
         hWriteStream[i] = hReadStream[i] = -1;
+    streamIO = new AsyncFileIO(2*MAX_EP_CNT*streamBuffersCount, true);
 #endif
+    //control pipes are driver buffered FIFOs, gateware answers packets in order
+    mControlPipelineDepth = 4;
     Open(index);
     isConnected = true;
 
@@ -101,7 +123,11 @@ ConnectionXillybus::ConnectionXillybus(const unsigned index)
 */
 ConnectionXillybus::~ConnectionXillybus()
 {
+    StopAsyncControl();
     Close();
+#ifdef __unix__
+    delete streamIO;
+#endif
 }
 
 /** @brief Tries to open connected USB device and find communication endpoints.
@@ -131,6 +157,15 @@ int ConnectionXillybus::Open(const unsigned index)
         readStreamPort[i] = deviceConfigs[index].streamRead[i];
         writeStreamPort[i] = deviceConfigs[index].streamWrite[i];
     }
+#ifdef __unix__
+    writeCtrlPort = DevicePath(writeCtrlPort);
+    readCtrlPort = DevicePath(readCtrlPort);
+    for (int i = 0; i < MAX_EP_CNT; i++)
+    {
+        readStreamPort[i] = DevicePath(readStreamPort[i]);
+        writeStreamPort[i] = DevicePath(writeStreamPort[i]);
+    }
+#endif
     return 0;
 }
 
@@ -159,12 +194,8 @@ void ConnectionXillybus::Close()
     CloseControl();
     for (int i = 0; i < MAX_EP_CNT; i++)
     {
-        if( hWriteStream[i] >= 0)
-            close(hWriteStream[i]);
-        hWriteStream[i] = -1;
-        if( hReadStream[i] >= 0)
-            close(hReadStream[i]);
-        hReadStream[i] = -1;
+        AbortSending(i);
+        AbortReading(i);
     }
 #endif
 }
@@ -279,6 +310,8 @@ int ConnectionXillybus::Write(const unsigned char *buffer, const int length, int
         int bytesSent;
         if ((bytesSent  = write(hWrite, buffer+ totalBytesWritten, bytesToWrite))<0)
         {
+            if (errno == EAGAIN)
+                WaitReady(hWrite, POLLOUT, t1, timeout_ms);
             if(errno == EINTR || errno == EAGAIN)
                  continue;
             ReportError(errno);
@@ -365,6 +398,8 @@ int ConnectionXillybus::Read(unsigned char *buffer, const int length, int timeou
         int bytesReceived;
         if ((bytesReceived = read(hRead, buffer+ totalBytesReaded, bytesToRead))<0)
         {
+           if (errno == EAGAIN)
+               WaitReady(hRead, POLLIN, t1, timeout_ms);
            if(errno == EINTR || errno == EAGAIN)
                continue;
            ReportError(errno);
@@ -396,7 +431,11 @@ int ConnectionXillybus::Read(unsigned char *buffer, const int length, int timeou
 
 int ConnectionXillybus::GetBuffersCount() const 
 {
+#ifdef __unix__
+    return streamBuffersCount;
+#else
     return 1;
+#endif
 };
 
 int ConnectionXillybus::CheckStreamSize(int size) const 
@@ -404,6 +443,7 @@ int ConnectionXillybus::CheckStreamSize(int size) const
     return size < 4 ? 4 : size;
 };
 
+#ifndef __unix__
 /**
     @brief Reads data from board
     @param buffer array where to store received data
@@ -413,7 +453,6 @@ int ConnectionXillybus::CheckStreamSize(int size) const
 */
 int ConnectionXillybus::ReceiveData(char *buffer, int length, int epIndex, int timeout_ms)
 {
-#ifndef __unix__
     if (hReadStream[epIndex] == INVALID_HANDLE_VALUE)
     {
         hReadStream[epIndex] = CreateFileA(readStreamPort[epIndex].c_str(), GENERIC_READ, 0, 0, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_OVERLAPPED, 0);
@@ -423,16 +462,6 @@ int ConnectionXillybus::ReceiveData(char *buffer, int length, int epIndex, int t
             return -1;
         }
     }
-#else
-    if (hReadStream[epIndex] == -1)
-    {
-       if (( hReadStream[epIndex] = open(readStreamPort[epIndex].c_str(), O_RDONLY | O_NOCTTY | O_NONBLOCK))==-1)
-       {
-            ReportError(errno);
-            return -1;
-       }
-    }
-#endif
 
     int totalBytesReaded = 0;
     int bytesToRead = length;
@@ -440,7 +469,6 @@ int ConnectionXillybus::ReceiveData(char *buffer, int length, int epIndex, int t
 
     do
     {
- #ifndef __unix__
         DWORD bytesReceived = 0;
         OVERLAPPED	vOverlapped;
         memset(&vOverlapped, 0, sizeof(OVERLAPPED));
@@ -465,16 +493,6 @@ int ConnectionXillybus::ReceiveData(char *buffer, int length, int epIndex, int t
             bytesReceived = 0;
         }
         CloseHandle(vOverlapped.hEvent);
-#else
-        int bytesReceived;
-        if ((bytesReceived = read(hReadStream[epIndex], buffer+ totalBytesReaded, bytesToRead))<0)
-        {
-            if(errno == EINTR || errno == EAGAIN)
-                continue;
-            ReportError(errno);
-            return totalBytesReaded;
-        }
-#endif
         totalBytesReaded += bytesReceived;
         if (totalBytesReaded < length)
             bytesToRead -= bytesReceived;
@@ -491,19 +509,11 @@ int ConnectionXillybus::ReceiveData(char *buffer, int length, int epIndex, int t
 */
 void ConnectionXillybus::AbortReading(int epIndex)
 {
-#ifndef __unix__
     if (hReadStream[epIndex] != INVALID_HANDLE_VALUE)
     {
         CloseHandle(hReadStream[epIndex]);
 	hReadStream[epIndex] = INVALID_HANDLE_VALUE;
     }
-#else
-    if (hReadStream[epIndex] >= 0)
-    {
-        close(hReadStream[epIndex]);
-        hReadStream[epIndex] =-1;
-    }
-#endif
 }
 
 /**
@@ -515,7 +525,6 @@ void ConnectionXillybus::AbortReading(int epIndex)
 */
 int ConnectionXillybus::SendData(const char *buffer, int length, int epIndex, int timeout_ms)
 {
-#ifndef __unix__
     if (hWriteStream[epIndex] == INVALID_HANDLE_VALUE)
     {
         hWriteStream[epIndex] = CreateFileA(writeStreamPort[epIndex].c_str(), GENERIC_WRITE, 0, 0, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_OVERLAPPED, 0);
@@ -525,23 +534,12 @@ int ConnectionXillybus::SendData(const char *buffer, int length, int epIndex, in
             return -1;
         }
     }
-#else
-    if (hWriteStream[epIndex] == -1)
-    {
-       if ((hWriteStream[epIndex] = open(writeStreamPort[epIndex].c_str(), O_WRONLY | O_NOCTTY | O_NONBLOCK))==-1)
-       {
-            ReportError(errno);
-            return -1;
-       }
-    }
-#endif
     int totalBytesWritten = 0;
     int bytesToWrite = length;
     auto t1 = chrono::high_resolution_clock::now();
 
     do
     {
-#ifndef __unix__
         DWORD bytesSent = 0;
         OVERLAPPED	vOverlapped;
         memset(&vOverlapped, 0, sizeof(OVERLAPPED));
@@ -566,16 +564,6 @@ int ConnectionXillybus::SendData(const char *buffer, int length, int epIndex, in
             bytesSent = 0;
         }
         CloseHandle(vOverlapped.hEvent);
-#else
-        int bytesSent;
-        if ((bytesSent  = write(hWriteStream[epIndex], buffer+ totalBytesWritten, bytesToWrite))<0)
-        {
-            if(errno == EINTR || errno == EAGAIN)
-                continue;
-            ReportError(errno);
-            return totalBytesWritten;
-        }
-#endif
         totalBytesWritten += bytesSent;
         if (totalBytesWritten < length)
             bytesToWrite -= bytesSent;
@@ -583,16 +571,6 @@ int ConnectionXillybus::SendData(const char *buffer, int length, int epIndex, in
             break;
 
     }while (std::chrono::duration_cast<std::chrono::milliseconds>(chrono::high_resolution_clock::now() - t1).count() < timeout_ms);
-    //Flush data to FPGA
-#ifdef __unix__
-    while (write(hWriteStream[epIndex], NULL, 0)<0)
-    {
-        if (errno == EINTR)
-            continue;
-        ReportError(errno);
-        break;
-    }
-#endif
     return totalBytesWritten;
 }
 
@@ -601,19 +579,11 @@ int ConnectionXillybus::SendData(const char *buffer, int length, int epIndex, in
 */
 void ConnectionXillybus::AbortSending(int epIndex)
 {
-#ifndef __unix__
     if (hWriteStream[epIndex] != INVALID_HANDLE_VALUE)
     {
         CloseHandle(hWriteStream[epIndex]);
         hWriteStream[epIndex] = INVALID_HANDLE_VALUE;
     }
-#else
-    if (hWriteStream[epIndex] >= 0)
-    {
-        close(hWriteStream[epIndex]);
-        hWriteStream[epIndex] = -1;
-    }
-#endif
 }
 
 int ConnectionXillybus::BeginDataReading(char* buffer, uint32_t length, int ep) 
@@ -641,3 +611,116 @@ int ConnectionXillybus::FinishDataSending(const char* buffer, uint32_t length, i
 {
     return contextHandle;
 }
+#else
+/**
+    @brief Returns descriptor of stream endpoint, opens it on first use
+    @return file descriptor, -1 on failure
+*/
+int ConnectionXillybus::OpenStream(int epIndex, bool tx)
+{
+    int &fd = tx ? hWriteStream[epIndex] : hReadStream[epIndex];
+    if (fd == -1)
+    {
+        const std::string &port = tx ? writeStreamPort[epIndex] : readStreamPort[epIndex];
+        if ((fd = open(port.c_str(), (tx ? O_WRONLY : O_RDONLY) | O_NOCTTY | O_NONBLOCK)) == -1)
+            ReportError(errno);
+    }
+    return fd;
+}
+
+/**
+    @brief Reads data from board
+    @param buffer array where to store received data
+    @param length number of bytes to read
+    @param timeout read timeout in milliseconds
+    @return number of bytes received
+*/
+int ConnectionXillybus::ReceiveData(char *buffer, int length, int epIndex, int timeout_ms)
+{
+    const int handle = BeginDataReading(buffer, length, epIndex);
+    if (handle < 0)
+        return -1;
+    WaitForReading(handle, timeout_ms);
+    //unfinished transfer is cancelled, returns bytes received so far
+    return FinishDataReading(buffer, length, handle);
+}
+
+/**
+    @brief Aborts reading operations
+*/
+void ConnectionXillybus::AbortReading(int epIndex)
+{
+    if (hReadStream[epIndex] >= 0)
+    {
+        streamIO->Cancel(hReadStream[epIndex]);
+        close(hReadStream[epIndex]);
+        hReadStream[epIndex] =-1;
+    }
+}
+
+/**
+    @brief  sends data to board
+    @param *buffer buffer to send
+    @param length number of bytes to send
+    @param timeout data write timeout in milliseconds
+    @return number of bytes sent
+*/
+int ConnectionXillybus::SendData(const char *buffer, int length, int epIndex, int timeout_ms)
+{
+    const int handle = BeginDataSending(buffer, length, epIndex);
+    if (handle < 0)
+        return -1;
+    WaitForSending(handle, timeout_ms);
+    return FinishDataSending(buffer, length, handle);
+}
+
+/**
+	@brief Aborts sending operations
+*/
+void ConnectionXillybus::AbortSending(int epIndex)
+{
+    if (hWriteStream[epIndex] >= 0)
+    {
+        streamIO->Cancel(hWriteStream[epIndex]);
+        close(hWriteStream[epIndex]);
+        hWriteStream[epIndex] = -1;
+    }
+}
+
+/**
+    @brief Queues read of stream endpoint, several reads can be pending
+    @return transfer handle, -1 on failure
+*/
+int ConnectionXillybus::BeginDataReading(char* buffer, uint32_t length, int ep) 
+{
+    const int fd = OpenStream(ep, false);
+    if (fd < 0)
+        return -1;
+    return streamIO->Submit(fd, false, buffer, length);
+}
+bool ConnectionXillybus::WaitForReading(int contextHandle, unsigned int timeout_ms) 
+{
+    return streamIO->Wait(contextHandle, timeout_ms);
+}
+int ConnectionXillybus::FinishDataReading(char* buffer, uint32_t length, int contextHandle)
+{
+    return streamIO->Finish(contextHandle);
+}
+
+int ConnectionXillybus::BeginDataSending(const char* buffer, uint32_t length, int ep) 
+{
+    const int fd = OpenStream(ep, true);
+    if (fd < 0)
+        return -1;
+    return streamIO->Submit(fd, true, const_cast<char*>(buffer), length);
+}
+bool ConnectionXillybus::WaitForSending(int contextHandle, uint32_t timeout_ms) 
+{
+    return streamIO->Wait(contextHandle, timeout_ms);
+}
+int ConnectionXillybus::FinishDataSending(const char* buffer, uint32_t length, int contextHandle) 
+{
+    //failed submission counts as nothing sent
+    return contextHandle < 0 ? 0 : streamIO->Finish(contextHandle);
+}
+#endif
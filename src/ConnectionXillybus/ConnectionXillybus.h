@@ -23,6 +23,8 @@
 
 namespace lime{
 
+class AsyncFileIO;
+
 class ConnectionXillybus : public LMS64CProtocol
 {
 public:
@@ -40,6 +42,12 @@ public:
 #ifdef __unix__
     int TransferPacket(GenericPacket &pkt) override;
     int ProgramWrite(const char *data_src, const size_t length, const int prog_mode, const int device, ProgrammingCallback callback)override;
+
+    /** @brief Returns path of Xillybus device node
+        Nodes are looked up in /dev, LIME_XILLYBUS_DIR environment variable
+        can point to directory with stand-ins (e.g. named pipes) for testing.
+    */
+    static std::string DevicePath(const std::string &name);
 #endif
 protected:
     int GetBuffersCount() const override;
@@ -84,6 +92,9 @@ private:
 #else
     int OpenControl();
     void CloseControl();
+    int OpenStream(int epIndex, bool tx);
+    static const int streamBuffersCount = 16; //transfers in flight per endpoint and direction
+    AsyncFileIO* streamIO;
     int hWrite;
     int hRead;
     int hWriteStream[MAX_EP_CNT];
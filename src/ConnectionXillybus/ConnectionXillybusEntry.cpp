@@ -52,14 +52,14 @@ std::vector<ConnectionHandle> ConnectionXillybusEntry::enumerate(const Connectio
         CloseHandle(fh);
     }
 #else
-    if( access("/dev/xillybus_control0_write_32", F_OK ) != -1 )
+    if( access(ConnectionXillybus::DevicePath("xillybus_control0_write_32").c_str(), F_OK ) != -1 )
     {
         handle.name = "LimeSDR-QPCIe";
         handle.index = 1;
         handles.push_back(handle);
     }
 
-    if( access("/dev/xillybus_write_8", F_OK ) != -1 )
+    if( access(ConnectionXillybus::DevicePath("xillybus_write_8").c_str(), F_OK ) != -1 )
     {
         handle.name = "LimeSDR-PCIe";
         handle.index = 0;
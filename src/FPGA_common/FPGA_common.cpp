@@ -504,91 +504,6 @@ int FPGA::SetDirectClocking(int clockIndex)
     return 0;
 }
 
-/** @brief Parses FPGA packet payload into samples
-*/
-int FPGA::FPGAPacketPayload2Samples(const uint8_t* buffer, int bufLen, bool mimo, bool compressed, complex16_t** samples)
-{
-    if(compressed) //compressed samples
-    {
-        int16_t sample;
-        int collected = 0;
-        for(int b=0; b<bufLen;collected++)
-        {
-            //I sample
-            sample = buffer[b++];
-            sample |= (buffer[b] << 8);
-            sample <<= 4;
-            samples[0][collected].i = sample >> 4;
-            //Q sample
-            sample =  buffer[b++];
-            sample |= buffer[b++] << 8;
-            samples[0][collected].q = sample >> 4;
-            if (mimo)
-            {
-                //I sample
-                sample = buffer[b++];
-                sample |= (buffer[b] << 8);
-                sample <<= 4;
-                samples[1][collected].i = sample >> 4;
-                //Q sample
-                sample =  buffer[b++];
-                sample |= buffer[b++] << 8;
-                samples[1][collected].q = sample >> 4;
-            }
-        }
-        return collected;
-    }
-
-    if (mimo) //uncompressed samples
-    {
-        complex16_t* ptr = (complex16_t*)buffer;
-        const int collected = bufLen/sizeof(complex16_t)/2;
-        for(int i=0; i<collected;i++)
-        {
-            samples[0][i] = *ptr++;
-            samples[1][i] = *ptr++;
-        }
-        return collected;
-    }
-
-    memcpy(samples[0],buffer,bufLen);
-    return bufLen/sizeof(complex16_t);
-}
-
-int FPGA::Samples2FPGAPacketPayload(const complex16_t* const* samples, int samplesCount, bool mimo, bool compressed, uint8_t* buffer)
-{
-    if(compressed)
-    {
-        int b=0;
-        for(int src=0; src<samplesCount; ++src)
-        {
-            buffer[b++] = samples[0][src].i;
-            buffer[b++] = ((samples[0][src].i >> 8) & 0x0F) | (samples[0][src].q << 4);
-            buffer[b++] = samples[0][src].q >> 4;
-            if (mimo)
-            {
-                buffer[b++] = samples[1][src].i;
-                buffer[b++] = ((samples[1][src].i >> 8) & 0x0F) | (samples[1][src].q << 4);
-                buffer[b++] = samples[1][src].q >> 4;
-            }
-        }
-        return b;
-    }
-
-    if (mimo)
-    {
-        complex16_t* ptr = (complex16_t*)buffer;
-        for(int src=0; src<samplesCount; ++src)
-        {
-            *ptr++ = samples[0][src];
-            *ptr++ = samples[1][src];
-        }
-        return samplesCount*2*sizeof(complex16_t);
-    }
-    memcpy(buffer,samples[0],samplesCount*sizeof(complex16_t));
-    return samplesCount*sizeof(complex16_t);
-}
-
 int FPGA::UploadWFM(const void* const* samples, uint8_t chCount, size_t sample_count, StreamConfig::StreamDataFormat format, int epIndex)
 {
     bool comp = (epIndex==2 && format!=StreamConfig::FMT_INT12) ? false : true;
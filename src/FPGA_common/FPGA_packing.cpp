@@ -0,0 +1,509 @@
+/**
+@file FPGA_packing.cpp
+@author Lime Microsystems
+@brief Conversion between FPGA packet payload and complex16_t samples.
+The scalar implementation is the reference, SIMD kernels are selected at
+runtime and produce bit-identical results.
+*/
+
+#include "FPGA_packing.h"
+#include "FPGA_common.h"
+#include "Logger.h"
+#include <string.h>
+
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86)
+#define LIME_PACKING_X86
+#include <immintrin.h>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#define LIME_PACKING_NEON
+#include <arm_neon.h>
+#endif
+
+#if defined(__GNUC__)
+#define LIME_TARGET(isa) __attribute__((target(isa)))
+#else
+#define LIME_TARGET(isa)
+#endif
+
+namespace lime
+{
+
+namespace
+{
+
+/***********************************************************************
+ * Scalar reference, also used for the tails of SIMD kernels
+ **********************************************************************/
+int Unpack12Scalar(const uint8_t* buffer, int bufLen, bool mimo, complex16_t* chA, complex16_t* chB)
+{
+    int16_t sample;
+    int collected = 0;
+    for(int b=0; b<bufLen;collected++)
+    {
+        //I sample
+        sample = buffer[b++];
+        sample |= (buffer[b] << 8);
+        sample <<= 4;
+        chA[collected].i = sample >> 4;
+        //Q sample
+        sample =  buffer[b++];
+        sample |= buffer[b++] << 8;
+        chA[collected].q = sample >> 4;
+        if (mimo)
+        {
+            //I sample
+            sample = buffer[b++];
+            sample |= (buffer[b] << 8);
+            sample <<= 4;
+            chB[collected].i = sample >> 4;
+            //Q sample
+            sample =  buffer[b++];
+            sample |= buffer[b++] << 8;
+            chB[collected].q = sample >> 4;
+        }
+    }
+    return collected;
+}
+
+int Unpack16MIMOScalar(const uint8_t* buffer, int bufLen, complex16_t* chA, complex16_t* chB)
+{
+    const complex16_t* ptr = (const complex16_t*)buffer;
+    const int collected = bufLen/sizeof(complex16_t)/2;
+    for(int i=0; i<collected;i++)
+    {
+        chA[i] = *ptr++;
+        chB[i] = *ptr++;
+    }
+    return collected;
+}
+
+int Pack12Scalar(const complex16_t* chA, const complex16_t* chB, int samplesCount, bool mimo, uint8_t* buffer)
+{
+    int b=0;
+    for(int src=0; src<samplesCount; ++src)
+    {
+        buffer[b++] = chA[src].i;
+        buffer[b++] = ((chA[src].i >> 8) & 0x0F) | (chA[src].q << 4);
+        buffer[b++] = chA[src].q >> 4;
+        if (mimo)
+        {
+            buffer[b++] = chB[src].i;
+            buffer[b++] = ((chB[src].i >> 8) & 0x0F) | (chB[src].q << 4);
+            buffer[b++] = chB[src].q >> 4;
+        }
+    }
+    return b;
+}
+
+int Pack16MIMOScalar(const complex16_t* chA, const complex16_t* chB, int samplesCount, uint8_t* buffer)
+{
+    complex16_t* ptr = (complex16_t*)buffer;
+    for(int src=0; src<samplesCount; ++src)
+    {
+        *ptr++ = chA[src];
+        *ptr++ = chB[src];
+    }
+    return samplesCount*2*sizeof(complex16_t);
+}
+
+const PacketKernels scalarKernels = {
+    "scalar", Unpack12Scalar, Unpack16MIMOScalar, Pack12Scalar, Pack16MIMOScalar
+};
+
+#ifdef LIME_PACKING_X86
+/***********************************************************************
+ * SSE2/SSSE3 kernels
+ * 12 bit unpacking needs byte shuffles, which are only available from SSSE3
+ **********************************************************************/
+
+//! 4x 3 byte groups -> 4x complex16_t
+LIME_TARGET("ssse3")
+static inline __m128i Decode12x4(const uint8_t* src)
+{
+    const __m128i shuffle = _mm_setr_epi8(0,1,1,2, 3,4,4,5, 6,7,7,8, 9,10,10,11);
+    const __m128i maskI = _mm_set1_epi32(0x0000FFFF);
+    const __m128i v = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i*)src), shuffle);
+    const __m128i i = _mm_srai_epi16(_mm_slli_epi16(v, 4), 4);
+    const __m128i q = _mm_srai_epi16(v, 4);
+    return _mm_or_si128(_mm_and_si128(maskI, i), _mm_andnot_si128(maskI, q));
+}
+
+//! 4x complex16_t -> 4x 3 byte groups in the lower 12 bytes
+LIME_TARGET("ssse3")
+static inline __m128i Encode12x4(const __m128i v)
+{
+    const __m128i shuffle = _mm_setr_epi8(0,1,2, 4,5,6, 8,9,10, 12,13,14, -1,-1,-1,-1);
+    const __m128i lo = _mm_and_si128(v, _mm_set1_epi32(0x0FFF));
+    const __m128i hi = _mm_slli_epi32(_mm_srli_epi32(v, 16), 12);
+    return _mm_shuffle_epi8(_mm_or_si128(lo, hi), shuffle);
+}
+
+LIME_TARGET("ssse3")
+int Unpack12SSSE3(const uint8_t* buffer, int bufLen, bool mimo, complex16_t* chA, complex16_t* chB)
+{
+    int b = 0;
+    int collected = 0;
+    if (mimo)
+    {
+        //loads are 16 bytes wide, stay within the buffer
+        for (; b + 28 <= bufLen; b += 24, collected += 4)
+        {
+            //A0 B0 A1 B1 -> A0 A1 B0 B1
+            const __m128i v0 = _mm_shuffle_epi32(Decode12x4(buffer + b), _MM_SHUFFLE(3,1,2,0));
+            const __m128i v1 = _mm_shuffle_epi32(Decode12x4(buffer + b + 12), _MM_SHUFFLE(3,1,2,0));
+            _mm_storeu_si128((__m128i*)(chA + collected), _mm_unpacklo_epi64(v0, v1));
+            _mm_storeu_si128((__m128i*)(chB + collected), _mm_unpackhi_epi64(v0, v1));
+        }
+        return collected + Unpack12Scalar(buffer + b, bufLen - b, true, chA + collected, chB + collected);
+    }
+    for (; b + 16 <= bufLen; b += 12, collected += 4)
+        _mm_storeu_si128((__m128i*)(chA + collected), Decode12x4(buffer + b));
+    return collected + Unpack12Scalar(buffer + b, bufLen - b, false, chA + collected, nullptr);
+}
+
+LIME_TARGET("sse2")
+int Unpack16MIMOSSE2(const uint8_t* buffer, int bufLen, complex16_t* chA, complex16_t* chB)
+{
+    const int total = bufLen/sizeof(complex16_t)/2;
+    int collected = 0;
+    for (; collected + 4 <= total; collected += 4)
+    {
+        const __m128i* src = (const __m128i*)(buffer + collected*2*sizeof(complex16_t));
+        const __m128i v0 = _mm_shuffle_epi32(_mm_loadu_si128(src), _MM_SHUFFLE(3,1,2,0));
+        const __m128i v1 = _mm_shuffle_epi32(_mm_loadu_si128(src + 1), _MM_SHUFFLE(3,1,2,0));
+        _mm_storeu_si128((__m128i*)(chA + collected), _mm_unpacklo_epi64(v0, v1));
+        _mm_storeu_si128((__m128i*)(chB + collected), _mm_unpackhi_epi64(v0, v1));
+    }
+    const int offset = collected*2*sizeof(complex16_t);
+    return collected + Unpack16MIMOScalar(buffer + offset, bufLen - offset, chA + collected, chB + collected);
+}
+
+LIME_TARGET("ssse3")
+int Pack12SSSE3(const complex16_t* chA, const complex16_t* chB, int samplesCount, bool mimo, uint8_t* buffer)
+{
+    //stores are 16 bytes wide, stay within the produced payload
+    const int outLen = samplesCount * (mimo ? 6 : 3);
+    int b = 0;
+    int src = 0;
+    if (mimo)
+    {
+        for (; src + 4 <= samplesCount && b + 28 <= outLen; src += 4, b += 24)
+        {
+            const __m128i a = _mm_loadu_si128((const __m128i*)(chA + src));
+            const __m128i bb = _mm_loadu_si128((const __m128i*)(chB + src));
+            _mm_storeu_si128((__m128i*)(buffer + b), Encode12x4(_mm_unpacklo_epi32(a, bb)));
+            _mm_storeu_si128((__m128i*)(buffer + b + 12), Encode12x4(_mm_unpackhi_epi32(a, bb)));
+        }
+        return b + Pack12Scalar(chA + src, chB + src, samplesCount - src, true, buffer + b);
+    }
+    for (; src + 4 <= samplesCount && b + 16 <= outLen; src += 4, b += 12)
+        _mm_storeu_si128((__m128i*)(buffer + b), Encode12x4(_mm_loadu_si128((const __m128i*)(chA + src))));
+    return b + Pack12Scalar(chA + src, nullptr, samplesCount - src, false, buffer + b);
+}
+
+LIME_TARGET("sse2")
+int Pack16MIMOSSE2(const complex16_t* chA, const complex16_t* chB, int samplesCount, uint8_t* buffer)
+{
+    int src = 0;
+    for (; src + 4 <= samplesCount; src += 4)
+    {
+        const __m128i a = _mm_loadu_si128((const __m128i*)(chA + src));
+        const __m128i b = _mm_loadu_si128((const __m128i*)(chB + src));
+        __m128i* dst = (__m128i*)(buffer + src*2*sizeof(complex16_t));
+        _mm_storeu_si128(dst, _mm_unpacklo_epi32(a, b));
+        _mm_storeu_si128(dst + 1, _mm_unpackhi_epi32(a, b));
+    }
+    const int offset = src*2*sizeof(complex16_t);
+    return offset + Pack16MIMOScalar(chA + src, chB + src, samplesCount - src, buffer + offset);
+}
+
+const PacketKernels ssse3Kernels = {
+    "SSSE3", Unpack12SSSE3, Unpack16MIMOSSE2, Pack12SSSE3, Pack16MIMOSSE2
+};
+
+/***********************************************************************
+ * AVX2 kernels
+ **********************************************************************/
+
+//! 2x 12 byte blocks -> 8x complex16_t
+LIME_TARGET("avx2")
+static inline __m256i Decode12x8(const uint8_t* src)
+{
+    const __m256i shuffle = _mm256_setr_epi8(0,1,1,2, 3,4,4,5, 6,7,7,8, 9,10,10,11,
+                                             0,1,1,2, 3,4,4,5, 6,7,7,8, 9,10,10,11);
+    const __m256i maskI = _mm256_set1_epi32(0x0000FFFF);
+    __m256i v = _mm256_castsi128_si256(_mm_loadu_si128((const __m128i*)src));
+    v = _mm256_inserti128_si256(v, _mm_loadu_si128((const __m128i*)(src + 12)), 1);
+    v = _mm256_shuffle_epi8(v, shuffle);
+    const __m256i i = _mm256_srai_epi16(_mm256_slli_epi16(v, 4), 4);
+    const __m256i q = _mm256_srai_epi16(v, 4);
+    return _mm256_or_si256(_mm256_and_si256(maskI, i), _mm256_andnot_si256(maskI, q));
+}
+
+//! 8x complex16_t -> 12 byte blocks in the lower part of each 128 bit lane
+LIME_TARGET("avx2")
+static inline __m256i Encode12x8(const __m256i v)
+{
+    const __m256i shuffle = _mm256_setr_epi8(0,1,2, 4,5,6, 8,9,10, 12,13,14, -1,-1,-1,-1,
+                                             0,1,2, 4,5,6, 8,9,10, 12,13,14, -1,-1,-1,-1);
+    const __m256i lo = _mm256_and_si256(v, _mm256_set1_epi32(0x0FFF));
+    const __m256i hi = _mm256_slli_epi32(_mm256_srli_epi32(v, 16), 12);
+    return _mm256_shuffle_epi8(_mm256_or_si256(lo, hi), shuffle);
+}
+
+LIME_TARGET("avx2")
+static inline void Store12x8(uint8_t* dst, const __m256i v)
+{
+    _mm_storeu_si128((__m128i*)dst, _mm256_castsi256_si128(v));
+    _mm_storeu_si128((__m128i*)(dst + 12), _mm256_extracti128_si256(v, 1));
+}
+
+LIME_TARGET("avx2")
+int Unpack12AVX2(const uint8_t* buffer, int bufLen, bool mimo, complex16_t* chA, complex16_t* chB)
+{
+    int b = 0;
+    int collected = 0;
+    if (mimo)
+    {
+        for (; b + 28 <= bufLen; b += 24, collected += 4)
+        {
+            //A0 B0 A1 B1 | A2 B2 A3 B3 -> A0 A1 B0 B1 | A2 A3 B2 B3 -> A0..A3 | B0..B3
+            __m256i v = _mm256_shuffle_epi32(Decode12x8(buffer + b), _MM_SHUFFLE(3,1,2,0));
+            v = _mm256_permute4x64_epi64(v, _MM_SHUFFLE(3,1,2,0));
+            _mm_storeu_si128((__m128i*)(chA + collected), _mm256_castsi256_si128(v));
+            _mm_storeu_si128((__m128i*)(chB + collected), _mm256_extracti128_si256(v, 1));
+        }
+        return collected + Unpack12Scalar(buffer + b, bufLen - b, true, chA + collected, chB + collected);
+    }
+    for (; b + 28 <= bufLen; b += 24, collected += 8)
+        _mm256_storeu_si256((__m256i*)(chA + collected), Decode12x8(buffer + b));
+    return collected + Unpack12Scalar(buffer + b, bufLen - b, false, chA + collected, nullptr);
+}
+
+LIME_TARGET("avx2")
+int Pack12AVX2(const complex16_t* chA, const complex16_t* chB, int samplesCount, bool mimo, uint8_t* buffer)
+{
+    const int outLen = samplesCount * (mimo ? 6 : 3);
+    int b = 0;
+    int src = 0;
+    if (mimo)
+    {
+        for (; src + 4 <= samplesCount && b + 28 <= outLen; src += 4, b += 24)
+        {
+            const __m128i a = _mm_loadu_si128((const __m128i*)(chA + src));
+            const __m128i bb = _mm_loadu_si128((const __m128i*)(chB + src));
+            __m256i v = _mm256_castsi128_si256(_mm_unpacklo_epi32(a, bb));
+            v = _mm256_inserti128_si256(v, _mm_unpackhi_epi32(a, bb), 1);
+            Store12x8(buffer + b, Encode12x8(v));
+        }
+        return b + Pack12Scalar(chA + src, chB + src, samplesCount - src, true, buffer + b);
+    }
+    for (; src + 8 <= samplesCount && b + 28 <= outLen; src += 8, b += 24)
+        Store12x8(buffer + b, Encode12x8(_mm256_loadu_si256((const __m256i*)(chA + src))));
+    return b + Pack12Scalar(chA + src, nullptr, samplesCount - src, false, buffer + b);
+}
+
+const PacketKernels avx2Kernels = {
+    "AVX2", Unpack12AVX2, Unpack16MIMOSSE2, Pack12AVX2, Pack16MIMOSSE2
+};
+
+bool CpuSupports(bool avx2)
+{
+#if defined(_MSC_VER)
+    int info[4];
+    __cpuid(info, 0);
+    const int maxLeaf = info[0];
+    __cpuid(info, 1);
+    const bool ssse3 = (info[2] & (1 << 9)) != 0;
+    if (!avx2)
+        return ssse3;
+    const bool osxsave = (info[2] & (1 << 27)) != 0;
+    const bool avx = (info[2] & (1 << 28)) != 0;
+    if (maxLeaf < 7 || !osxsave || !avx || (_xgetbv(0) & 0x6) != 0x6)
+        return false;
+    __cpuidex(info, 7, 0);
+    return (info[1] & (1 << 5)) != 0;
+#elif defined(__GNUC__)
+    __builtin_cpu_init();
+    return avx2 ? __builtin_cpu_supports("avx2") : __builtin_cpu_supports("ssse3");
+#else
+    return false;
+#endif
+}
+#endif //LIME_PACKING_X86
+
+#ifdef LIME_PACKING_NEON
+/***********************************************************************
+ * NEON kernels
+ **********************************************************************/
+static inline void Decode12x8(const uint8_t* src, int16x8_t &i, int16x8_t &q)
+{
+    const uint8x8x3_t v = vld3_u8(src);
+    i = vreinterpretq_s16_u16(vorrq_u16(vmovl_u8(v.val[0]), vshll_n_u8(v.val[1], 8)));
+    i = vshrq_n_s16(vshlq_n_s16(i, 4), 4);
+    q = vreinterpretq_s16_u16(vorrq_u16(vmovl_u8(v.val[1]), vshll_n_u8(v.val[2], 8)));
+    q = vshrq_n_s16(q, 4);
+}
+
+static inline void Encode12x8(uint8_t* dst, const int16x8_t i, const int16x8_t q)
+{
+    const uint16x8_t iu = vreinterpretq_u16_s16(i);
+    const uint16x8_t qu = vreinterpretq_u16_s16(q);
+    uint8x8x3_t v;
+    v.val[0] = vmovn_u16(iu);
+    v.val[1] = vmovn_u16(vorrq_u16(vandq_u16(vshrq_n_u16(iu, 8), vdupq_n_u16(0x0F)), vshlq_n_u16(qu, 4)));
+    v.val[2] = vmovn_u16(vshrq_n_u16(qu, 4));
+    vst3_u8(dst, v);
+}
+
+int Unpack12NEON(const uint8_t* buffer, int bufLen, bool mimo, complex16_t* chA, complex16_t* chB)
+{
+    int b = 0;
+    int collected = 0;
+    int16x8_t i, q;
+    if (mimo)
+    {
+        for (; b + 24 <= bufLen; b += 24, collected += 4)
+        {
+            Decode12x8(buffer + b, i, q);
+            //A0 B0 A1 B1 A2 B2 A3 B3 -> A0..A3, B0..B3
+            const int16x4x2_t iu = vuzp_s16(vget_low_s16(i), vget_high_s16(i));
+            const int16x4x2_t qu = vuzp_s16(vget_low_s16(q), vget_high_s16(q));
+            int16x4x2_t a, bb;
+            a.val[0] = iu.val[0];
+            a.val[1] = qu.val[0];
+            bb.val[0] = iu.val[1];
+            bb.val[1] = qu.val[1];
+            vst2_s16((int16_t*)(chA + collected), a);
+            vst2_s16((int16_t*)(chB + collected), bb);
+        }
+        return collected + Unpack12Scalar(buffer + b, bufLen - b, true, chA + collected, chB + collected);
+    }
+    for (; b + 24 <= bufLen; b += 24, collected += 8)
+    {
+        Decode12x8(buffer + b, i, q);
+        int16x8x2_t v;
+        v.val[0] = i;
+        v.val[1] = q;
+        vst2q_s16((int16_t*)(chA + collected), v);
+    }
+    return collected + Unpack12Scalar(buffer + b, bufLen - b, false, chA + collected, nullptr);
+}
+
+int Unpack16MIMONEON(const uint8_t* buffer, int bufLen, complex16_t* chA, complex16_t* chB)
+{
+    const int total = bufLen/sizeof(complex16_t)/2;
+    int collected = 0;
+    for (; collected + 4 <= total; collected += 4)
+    {
+        const uint32x4x2_t v = vld2q_u32((const uint32_t*)(buffer + collected*2*sizeof(complex16_t)));
+        vst1q_u32((uint32_t*)(chA + collected), v.val[0]);
+        vst1q_u32((uint32_t*)(chB + collected), v.val[1]);
+    }
+    const int offset = collected*2*sizeof(complex16_t);
+    return collected + Unpack16MIMOScalar(buffer + offset, bufLen - offset, chA + collected, chB + collected);
+}
+
+int Pack12NEON(const complex16_t* chA, const complex16_t* chB, int samplesCount, bool mimo, uint8_t* buffer)
+{
+    int b = 0;
+    int src = 0;
+    if (mimo)
+    {
+        for (; src + 4 <= samplesCount; src += 4, b += 24)
+        {
+            const int16x4x2_t a = vld2_s16((const int16_t*)(chA + src));
+            const int16x4x2_t bb = vld2_s16((const int16_t*)(chB + src));
+            const int16x4x2_t i = vzip_s16(a.val[0], bb.val[0]);
+            const int16x4x2_t q = vzip_s16(a.val[1], bb.val[1]);
+            Encode12x8(buffer + b, vcombine_s16(i.val[0], i.val[1]), vcombine_s16(q.val[0], q.val[1]));
+        }
+        return b + Pack12Scalar(chA + src, chB + src, samplesCount - src, true, buffer + b);
+    }
+    for (; src + 8 <= samplesCount; src += 8, b += 24)
+    {
+        const int16x8x2_t v = vld2q_s16((const int16_t*)(chA + src));
+        Encode12x8(buffer + b, v.val[0], v.val[1]);
+    }
+    return b + Pack12Scalar(chA + src, nullptr, samplesCount - src, false, buffer + b);
+}
+
+int Pack16MIMONEON(const complex16_t* chA, const complex16_t* chB, int samplesCount, uint8_t* buffer)
+{
+    int src = 0;
+    for (; src + 4 <= samplesCount; src += 4)
+    {
+        uint32x4x2_t v;
+        v.val[0] = vld1q_u32((const uint32_t*)(chA + src));
+        v.val[1] = vld1q_u32((const uint32_t*)(chB + src));
+        vst2q_u32((uint32_t*)(buffer + src*2*sizeof(complex16_t)), v);
+    }
+    const int offset = src*2*sizeof(complex16_t);
+    return offset + Pack16MIMOScalar(chA + src, chB + src, samplesCount - src, buffer + offset);
+}
+
+const PacketKernels neonKernels = {
+    "NEON", Unpack12NEON, Unpack16MIMONEON, Pack12NEON, Pack16MIMONEON
+};
+#endif //LIME_PACKING_NEON
+
+const PacketKernels& SelectKernels()
+{
+    const PacketKernels* kernels = GetPacketKernels().back();
+    lime::debug("FPGA packet conversion uses %s kernels", kernels->name);
+    return *kernels;
+}
+
+//! Kernels are selected once, on first use
+const PacketKernels& GetKernels()
+{
+    static const PacketKernels& kernels = SelectKernels();
+    return kernels;
+}
+
+} //anonymous namespace
+
+std::vector<const PacketKernels*> GetPacketKernels()
+{
+    std::vector<const PacketKernels*> kernels(1, &scalarKernels);
+#if defined(LIME_PACKING_X86)
+    if (CpuSupports(false))
+        kernels.push_back(&ssse3Kernels);
+    if (CpuSupports(true))
+        kernels.push_back(&avx2Kernels);
+#elif defined(LIME_PACKING_NEON)
+    kernels.push_back(&neonKernels);
+#endif
+    return kernels;
+}
+
+/** @brief Parses FPGA packet payload into samples
+*/
+int FPGA::FPGAPacketPayload2Samples(const uint8_t* buffer, int bufLen, bool mimo, bool compressed, complex16_t** samples)
+{
+    if(compressed) //compressed samples
+        return GetKernels().unpack12(buffer, bufLen, mimo, samples[0], mimo ? samples[1] : nullptr);
+
+    if (mimo) //uncompressed samples
+        return GetKernels().unpack16mimo(buffer, bufLen, samples[0], samples[1]);
+
+    memcpy(samples[0],buffer,bufLen);
+    return bufLen/sizeof(complex16_t);
+}
+
+int FPGA::Samples2FPGAPacketPayload(const complex16_t* const* samples, int samplesCount, bool mimo, bool compressed, uint8_t* buffer)
+{
+    if(compressed)
+        return GetKernels().pack12(samples[0], mimo ? samples[1] : nullptr, samplesCount, mimo, buffer);
+
+    if (mimo)
+        return GetKernels().pack16mimo(samples[0], samples[1], samplesCount, buffer);
+
+    memcpy(buffer,samples[0],samplesCount*sizeof(complex16_t));
+    return samplesCount*sizeof(complex16_t);
+}
+
+} //namespace lime
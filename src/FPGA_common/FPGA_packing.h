@@ -0,0 +1,35 @@
+/**
+@file FPGA_packing.h
+@author Lime Microsystems
+@brief Kernels converting between FPGA packet payload and complex16_t samples
+*/
+
+#ifndef LMS_FPGA_PACKING_H
+#define LMS_FPGA_PACKING_H
+
+#include "LimeSuiteConfig.h"
+#include "dataTypes.h"
+#include <vector>
+
+namespace lime
+{
+
+//! One implementation of the packet payload conversions
+struct PacketKernels
+{
+    const char* name;
+    int (*unpack12)(const uint8_t* buffer, int bufLen, bool mimo, complex16_t* chA, complex16_t* chB);
+    int (*unpack16mimo)(const uint8_t* buffer, int bufLen, complex16_t* chA, complex16_t* chB);
+    int (*pack12)(const complex16_t* chA, const complex16_t* chB, int samplesCount, bool mimo, uint8_t* buffer);
+    int (*pack16mimo)(const complex16_t* chA, const complex16_t* chB, int samplesCount, uint8_t* buffer);
+};
+
+/** @brief Returns kernels supported by this CPU, scalar reference first
+    FPGA::FPGAPacketPayload2Samples() and FPGA::Samples2FPGAPacketPayload()
+    use the last one, the others are listed for comparison in tests.
+*/
+LIME_API std::vector<const PacketKernels*> GetPacketKernels();
+
+}
+
+#endif
@@ -93,8 +93,8 @@ int **bincode, **csdcode, **csdcoder;
 {
 
 	/* All this is for  solving a linear system */
-	/* of equations by LU decomposition */
-	double **A, d;
+	/* of equations by Cholesky (or LU) decomposition */
+	double **A, d, *diag;
 	int *index;
 
 	/* Parameters of real function Hr(w) */
@@ -104,7 +104,14 @@ int **bincode, **csdcode, **csdcoder;
 	
 	int parity;		/* Parity of the filter (ODD or EVEN) */
 	int i, j, k;		/* Loop counters */
-	double fwki, fwkj;	/* Used for equation formulation */
+
+	/* A[i][j] = 0.5*(c[|i-j|] + sign*c[i+j+shift]), where c[m] is */
+	/* weighted sum of cos(2*pi*w*m) over the grid, so the matrix is */
+	/* Toeplitz plus Hankel and only 2L+1 sums have to be calculated */
+	double *c;		/* Weighted cosine sums */
+	int shift;		/* Hankel part index offset */
+	double sign;		/* Hankel part sign */
+	double c1, cm, cm1, cm2;	/* Cosine recurrence */
 
 	/* Check the correctness of inputs */
 	if( (hr == NULL) || (w == NULL) || 
@@ -123,13 +130,13 @@ int **bincode, **csdcode, **csdcoder;
 
 	/* Find which trigonometric function to use depending on filter type */
 	if( (symmetry == POSITIVE) && (parity == ODD) ) { 		/* Case 1 */
-		f = Case1F; 
+		f = Case1F; shift = -2; sign = 1.0;
 	} else if( (symmetry == POSITIVE) && (parity == EVEN) ) {	/* Case 2 */
-		f = Case2F;
-	} else if( (symmetry == NEGATIVE) && (parity == ODD) ) {	/* Case 2 */
-		f = Case3F;
-	} else if( (symmetry == NEGATIVE) && (parity == EVEN) ) {	/* Case 2 */
-		f = Case4F;
+		f = Case2F; shift = -1; sign = 1.0;
+	} else if( (symmetry == NEGATIVE) && (parity == ODD) ) {	/* Case 3 */
+		f = Case3F; shift = 0; sign = -1.0;
+	} else if( (symmetry == NEGATIVE) && (parity == EVEN) ) {	/* Case 4 */
+		f = Case4F; shift = -1; sign = -1.0;
 	} else {	/* This should never happen but ... */
 		return(-1);
 	}
@@ -140,31 +147,50 @@ int **bincode, **csdcode, **csdcoder;
 	a = vector(1, L);
 	A = matrix(1, L, 1, L);
 	index = ivector(1, L);
+	diag = vector(1, L);
+	c = vector(0, 2*L);
 
-	/* Set A, a and index all to zeroes */
-	for(j=1; j <= L; j++) {
-		a[j] = 0.0;
-		index[j] = 0;
-		for(i=1; i <= L; i++) A[i][j] = 0.0;
-	}
+	for(j=1; j <= L; j++) a[j] = 0.0;
+	for(i=0; i <= 2*L; i++) c[i] = 0.0;
 
-	/* OK, ready to fill up the equations */
+	/* Weighted cosine sums, using cos((m+1)x) = 2cos(x)cos(mx) - cos((m-1)x) */
 	for(k=0; k<p; k++) {
-		for(j=1; j <= L; j++) {
-			fwkj = (f)(w[k], j);
-			A[j][j] += weight[k]*fwkj*fwkj;
-			a[j] += weight[k]*des[k]*fwkj;
-			for(i=j+1; i <= L; i++) {
-				fwki = (f)(w[k], i);
-				A[i][j] += weight[k]*fwki*fwkj;
-				A[j][i] += weight[k]*fwkj*fwki;
-			}
+		if(weight[k] == 0.0) continue;
+		c1 = cos(2.0*M_PI*w[k]);
+		cm2 = 1.0;
+		cm1 = c1;
+		c[0] += weight[k];
+		c[1] += weight[k]*c1;
+		for(i=2; i <= 2*L; i++) {
+			cm = 2.0*c1*cm1 - cm2;
+			c[i] += weight[k]*cm;
+			cm2 = cm1;
+			cm1 = cm;
 		}
 	}
 
-	/* Solve the equations */
-	ludcmp(A, L, index, &d); 
-	lubksb(A, L, index, a);
+	/* Right hand side, stop band usually has zero desired response */
+	for(k=0; k<p; k++) {
+		if(weight[k]*des[k] == 0.0) continue;
+		for(j=1; j <= L; j++) a[j] += weight[k]*des[k]*(f)(w[k], j);
+	}
+
+	/* Fill up the equations */
+	for(j=1; j <= L; j++)
+		for(i=j; i <= L; i++)
+			A[i][j] = A[j][i] = 0.5*(c[i-j] + sign*c[i+j+shift]);
+
+	/* Solve the equations, matrix is symmetric positive definite, */
+	/* LU decomposition is used if rounding errors break that */
+	if(choldc(A, L, diag) == 0) {
+		cholsl(A, L, diag, a);
+	} else {
+		for(j=1; j <= L; j++)
+			for(i=j; i <= L; i++)
+				A[i][j] = A[j][i] = 0.5*(c[i-j] + sign*c[i+j+shift]);
+		ludcmp(A, L, index, &d); 
+		lubksb(A, L, index, a);
+	}
 
 	/* Calculate impulse response h[] from a[] */
 	for(i=0; i<n; i++) hr[i] = 0.0;
@@ -186,6 +212,8 @@ int **bincode, **csdcode, **csdcoder;
 	free_vector(a, 1, L);
 	free_matrix(A, 1, L, 1, L);
 	free_ivector(index, 1, L);
+	free_vector(diag, 1, L);
+	free_vector(c, 0, 2*L);
 
 	/* That's all, let's go home */
 	return(0);
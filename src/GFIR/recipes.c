@@ -1,7 +1,7 @@
 /* *******************************************************************
 FILE:		recipes.c
 DESCRIPTION:	Routines for vector and matrix allocation/free.
-		Linear system solving by LU decomposition.
+		Linear system solving by LU and Cholesky decomposition.
 		All are from "Numerical Recipes in C".
 
 CONTAINTS:	
@@ -37,6 +37,14 @@ CONTAINTS:
 		double **a,b[];
 		int n,indx[];
 
+		int choldc(a,n,p)
+		double **a,p[];
+		int n;
+
+		void cholsl(a,n,p,b)
+		double **a,p[],b[];
+		int n;
+
 DATE:		
 AUTHOR:		From "Numerical Recipes in C"
 REVISIONS:	February 01, 1994: File created.
@@ -249,3 +257,53 @@ int n,indx[];
 
 }   /*  end of lubksb() */
 
+/* ******************************************************************** */
+/* Cholesky decomposition of a symmetric positive definite matrix	*/
+/*	a[1:n][1:n]		system matrix, only upper triangle is	*/
+/*				used, factor is returned in lower one,	*/
+/*	n			problem dimension,			*/
+/*	p[1:n]			diagonal of the factor.			*/
+/*	Returns -1 if matrix is not positive definite.			*/
+/* ******************************************************************** */
+int choldc(a,n,p)
+double **a,p[];
+int n;
+{
+	int i,j,k;
+	double sum;
+
+	for (i=1;i<=n;i++) {
+		for (j=i;j<=n;j++) {
+			sum=a[i][j];
+			for (k=i-1;k>=1;k--) sum -= a[i][k]*a[j][k];
+			if (i == j) {
+				if (sum <= 0.0) return(-1);
+				p[i]=sqrt(sum);
+			} else a[j][i]=sum/p[i];
+		}
+	}
+	return(0);
+
+} /* end of choldc() */
+
+/* ******************************************************************** */
+/* Solve system of equations decomposed by choldc()			*/
+/*	b[1:n]			right hand side, replaced by solution.	*/
+/* ******************************************************************** */
+void cholsl(a,n,p,b)
+double **a,p[],b[];
+int n;
+{
+	int i,k;
+	double sum;
+
+	for (i=1;i<=n;i++) {
+		for (sum=b[i],k=i-1;k>=1;k--) sum -= a[i][k]*b[k];
+		b[i]=sum/p[i];
+	}
+	for (i=n;i>=1;i--) {
+		for (sum=b[i],k=i+1;k<=n;k++) sum -= a[k][i]*b[k];
+		b[i]=sum/p[i];
+	}
+
+}   /*  end of cholsl() */
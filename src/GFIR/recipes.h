@@ -14,6 +14,10 @@ int ludcmp(double ** a, int n, int * indx, double * d);
 
 void lubksb(double ** a, int n, int * indx, double * b); 
 
+int choldc(double ** a, int n, double * p);
+
+void cholsl(double ** a, int n, double * p, double * b);
+
 void free_vector(double * v, int nl, int nh); 
 void free_ivector(int * v, int nl, int nh);
 void free_matrix(double ** m, int nrl, int nrh, int ncl, int nch);
@@ -0,0 +1,65 @@
+/**
+    @file conversion.cpp
+    @author Lime Microsystems
+    @brief Benchmarks of integer and floating point samples conversion
+*/
+
+#include <benchmark/benchmark.h>
+#include "SamplesConversion.h"
+#include <vector>
+#include <random>
+
+using namespace lime;
+
+static const float fullScale = 2047.0f;
+
+//! Args: samples count
+static void BM_ConvertToFloat32(benchmark::State &state)
+{
+    const uint32_t count = state.range(0);
+    std::vector<complex16_t> src(count);
+    std::vector<complex32f_t> dest(count);
+    std::mt19937 random(1);
+    std::uniform_int_distribution<int> value(-2048, 2047);
+    for (auto &s : src)
+    {
+        s.i = value(random);
+        s.q = value(random);
+    }
+
+    for (auto _ : state)
+    {
+        ConvertToFloat32(dest.data(), src.data(), count, fullScale);
+        benchmark::DoNotOptimize(dest.data());
+        benchmark::ClobberMemory();
+    }
+    state.SetItemsProcessed(state.iterations()*count);
+    state.SetBytesProcessed(state.iterations()*count*(sizeof(complex16_t)+sizeof(complex32f_t)));
+}
+BENCHMARK(BM_ConvertToFloat32)->ArgName("samples")->Arg(samples16InPkt)->Arg(samples12InPkt)->Arg(8192)->Arg(65536);
+
+//! Args: samples count
+static void BM_ConvertFromFloat32(benchmark::State &state)
+{
+    const uint32_t count = state.range(0);
+    std::vector<complex32f_t> src(count);
+    std::vector<complex16_t> dest(count);
+    std::mt19937 random(1);
+    //slightly over full scale to exercise saturation
+    std::uniform_real_distribution<float> value(-1.1f, 1.1f);
+    for (auto &s : src)
+    {
+        s.i = value(random);
+        s.q = value(random);
+    }
+
+    for (auto _ : state)
+    {
+        ConvertFromFloat32(dest.data(), src.data(), count, fullScale);
+        benchmark::DoNotOptimize(dest.data());
+        benchmark::ClobberMemory();
+    }
+    state.SetItemsProcessed(state.iterations()*count);
+    state.SetBytesProcessed(state.iterations()*count*(sizeof(complex16_t)+sizeof(complex32f_t)));
+}
+BENCHMARK(BM_ConvertFromFloat32)->ArgName("samples")->Arg(samples16InPkt)->Arg(samples12InPkt)->Arg(8192)->Arg(65536);
@@ -0,0 +1,143 @@
+/**
+    @file fifo.cpp
+    @author Lime Microsystems
+    @brief Benchmarks of samples FIFOs with concurrent producer and consumer
+*/
+
+#include <benchmark/benchmark.h>
+#include "fifo.h"
+#include <vector>
+#include <thread>
+#include <atomic>
+#include <memory>
+
+using namespace lime;
+
+namespace
+{
+
+//! Power of two packets, as LockFreeRingFIFO requires
+const uint32_t fifoCapacity = 64*SamplesPacket::maxSamplesInPacket;
+
+void FillRamp(std::vector<complex16_t> &samples)
+{
+    for (size_t n = 0; n < samples.size(); ++n)
+    {
+        const int16_t value = n & 0x7FF;
+        samples[n].i = value;
+        samples[n].q = -value;
+    }
+}
+
+/** @brief Keeps FIFO filled from another thread, as streaming thread does
+    for Tx, or Rx thread does for Read()
+*/
+class Producer
+{
+public:
+    //! packetCount 0 pushes with push_samples(), otherwise batches of packetCount packets
+    Producer(SamplesFIFO &fifo, const uint32_t samplesCount, const uint32_t packetCount) :
+        samples(samplesCount*(packetCount ? packetCount : 1)), stop(false)
+    {
+        FillRamp(samples);
+        thread = std::thread([this, &fifo, samplesCount, packetCount]()
+        {
+            std::vector<SamplesFIFO::PacketInfo> packets(packetCount);
+            uint64_t timestamp = 0;
+            while (!stop.load(std::memory_order_relaxed))
+            {
+                if (packetCount == 0)
+                {
+                    timestamp += fifo.push_samples(samples.data(), samplesCount, 1, timestamp, 10);
+                    continue;
+                }
+                for (auto &pkt : packets)
+                {
+                    pkt.timestamp = timestamp;
+                    pkt.flags = 0;
+                    pkt.count = samplesCount;
+                    timestamp += samplesCount;
+                }
+                fifo.push_packets(samples.data(), samplesCount, packets.data(), packetCount, 10);
+            }
+        });
+    }
+
+    ~Producer()
+    {
+        stop.store(true);
+        thread.join();
+    }
+
+private:
+    std::vector<complex16_t> samples;
+    std::atomic<bool> stop;
+    std::thread thread;
+};
+
+} //anonymous namespace
+
+/** @brief pop_samples() while another thread pushes
+    Args: samples count of each call, 1 to pop converting to float
+*/
+template<class FIFO>
+static void BM_FIFOSamples(benchmark::State &state)
+{
+    const uint32_t count = state.range(0);
+    const bool toFloat = state.range(1) != 0;
+    std::unique_ptr<SamplesFIFO> fifo(new FIFO(fifoCapacity));
+    std::vector<complex16_t> dest(count);
+    std::vector<complex32f_t> destFloat(count);
+    Producer producer(*fifo, count, 0);
+
+    for (auto _ : state)
+    {
+        uint64_t timestamp;
+        uint32_t flags;
+        uint32_t popped;
+        if (toFloat)
+            popped = fifo->pop_samples(destFloat.data(), count, 1, &timestamp, 1000, &flags, 2047.0f);
+        else
+            popped = fifo->pop_samples(dest.data(), count, 1, &timestamp, 1000, &flags);
+        if (popped != count)
+        {
+            state.SkipWithError("FIFO pop timed out");
+            break;
+        }
+    }
+    state.SetItemsProcessed(state.iterations()*count);
+}
+BENCHMARK_TEMPLATE(BM_FIFOSamples, RingFIFO)->ArgNames({"samples", "float"})
+    ->ArgsProduct({{samples12InPkt, 8192}, {0, 1}})->UseRealTime();
+BENCHMARK_TEMPLATE(BM_FIFOSamples, LockFreeRingFIFO)->ArgNames({"samples", "float"})
+    ->ArgsProduct({{samples12InPkt, 8192}, {0, 1}})->UseRealTime();
+
+/** @brief pop_packets() while another thread pushes batches of the same size
+    Args: packets count of each batch
+*/
+template<class FIFO>
+static void BM_FIFOPackets(benchmark::State &state)
+{
+    const uint32_t packetCount = state.range(0);
+    const uint32_t samplesPerPacket = SamplesPacket::maxSamplesInPacket;
+    std::unique_ptr<SamplesFIFO> fifo(new FIFO(fifoCapacity));
+    std::vector<complex16_t> dest(samplesPerPacket*packetCount);
+    std::vector<SamplesFIFO::PacketInfo> packets(packetCount);
+    Producer producer(*fifo, samplesPerPacket, packetCount);
+
+    int64_t samplesCount = 0;
+    for (auto _ : state)
+    {
+        const uint32_t popped = fifo->pop_packets(dest.data(), samplesPerPacket, packets.data(), packetCount, 1000);
+        if (popped == 0)
+        {
+            state.SkipWithError("FIFO pop timed out");
+            break;
+        }
+        for (uint32_t i = 0; i < popped; ++i)
+            samplesCount += packets[i].count;
+    }
+    state.SetItemsProcessed(samplesCount);
+}
+BENCHMARK_TEMPLATE(BM_FIFOPackets, RingFIFO)->ArgName("packets")->Arg(1)->Arg(8)->Arg(32)->UseRealTime();
+BENCHMARK_TEMPLATE(BM_FIFOPackets, LockFreeRingFIFO)->ArgName("packets")->Arg(1)->Arg(8)->Arg(32)->UseRealTime();
@@ -0,0 +1,43 @@
+/**
+    @file main.cpp
+    @author Lime Microsystems
+    @brief Streaming data path benchmarks
+
+    Results can be stored for comparison between releases with
+    --benchmark_out=<file> --benchmark_out_format=json, library version is
+    recorded in the context section of the output.
+*/
+
+#include <benchmark/benchmark.h>
+#include "Logger.h"
+#include "VersionInfo.h"
+#include <cstdio>
+#include <cstdlib>
+
+static void log_func(const lime::LogLevel level, const char *message)
+{
+    if (level <= lime::LOG_LEVEL_ERROR)
+        fprintf(stderr, "%s\n", message);
+}
+
+int main(int argc, char **argv)
+{
+    //end to end benchmarks stream from virtual board without real time pacing,
+    //set before the first device enumeration, as LMS_Open() uses listed handles
+#ifdef _WIN32
+    if (getenv("LIME_VIRTUAL_OPTIONS") == nullptr)
+        _putenv_s("LIME_VIRTUAL_OPTIONS", "realtime=0");
+#else
+    setenv("LIME_VIRTUAL_OPTIONS", "realtime=0", 0);
+#endif
+    lime::registerLogHandler(log_func);
+
+    benchmark::Initialize(&argc, argv);
+    if (benchmark::ReportUnrecognizedArguments(argc, argv))
+        return EXIT_FAILURE;
+    benchmark::AddCustomContext("limesuite_version", lime::GetLibraryVersion());
+    benchmark::AddCustomContext("limesuite_build", lime::GetBuildTimestamp());
+    benchmark::RunSpecifiedBenchmarks();
+    benchmark::Shutdown();
+    return EXIT_SUCCESS;
+}
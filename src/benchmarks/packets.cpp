@@ -0,0 +1,92 @@
+/**
+    @file packets.cpp
+    @author Lime Microsystems
+    @brief Benchmarks of FPGA packet payload packing and unpacking
+*/
+
+#include <benchmark/benchmark.h>
+#include "FPGA_common.h"
+#include "dataTypes.h"
+#include <vector>
+#include <random>
+
+using namespace lime;
+
+namespace
+{
+
+//! Per channel samples count of one packet payload
+int SamplesPerChannel(bool mimo, bool compressed)
+{
+    const int samples = compressed ? samples12InPkt : samples16InPkt;
+    return mimo ? samples/2 : samples;
+}
+
+void FillRandom(std::vector<complex16_t> &samples, bool compressed)
+{
+    std::mt19937 random(1);
+    const int range = compressed ? 2047 : 32767;
+    std::uniform_int_distribution<int> value(-range-1, range);
+    for (auto &s : samples)
+    {
+        s.i = value(random);
+        s.q = value(random);
+    }
+}
+
+} //anonymous namespace
+
+//! Args: channels count, sample width in bits
+static void BM_PayloadToSamples(benchmark::State &state)
+{
+    const bool mimo = state.range(0) == 2;
+    const bool compressed = state.range(1) == 12;
+    const int samplesCount = SamplesPerChannel(mimo, compressed);
+
+    std::vector<complex16_t> channels[2];
+    for (auto &ch : channels)
+    {
+        ch.resize(samplesCount);
+        FillRandom(ch, compressed);
+    }
+    const complex16_t* src[2] = {channels[0].data(), channels[1].data()};
+    FPGA_DataPacket pkt;
+    const int payloadSize = FPGA::Samples2FPGAPacketPayload(src, samplesCount, mimo, compressed, pkt.data);
+
+    complex16_t* dest[2] = {channels[0].data(), channels[1].data()};
+    for (auto _ : state)
+    {
+        benchmark::DoNotOptimize(FPGA::FPGAPacketPayload2Samples(pkt.data, payloadSize, mimo, compressed, dest));
+        benchmark::ClobberMemory();
+    }
+    state.SetItemsProcessed(state.iterations()*samplesCount*(mimo ? 2 : 1));
+    state.SetBytesProcessed(state.iterations()*payloadSize);
+}
+BENCHMARK(BM_PayloadToSamples)->ArgNames({"channels", "bits"})->ArgsProduct({{1, 2}, {12, 16}});
+
+//! Args: channels count, sample width in bits
+static void BM_SamplesToPayload(benchmark::State &state)
+{
+    const bool mimo = state.range(0) == 2;
+    const bool compressed = state.range(1) == 12;
+    const int samplesCount = SamplesPerChannel(mimo, compressed);
+
+    std::vector<complex16_t> channels[2];
+    for (auto &ch : channels)
+    {
+        ch.resize(samplesCount);
+        FillRandom(ch, compressed);
+    }
+    const complex16_t* src[2] = {channels[0].data(), channels[1].data()};
+    FPGA_DataPacket pkt;
+    int payloadSize = 0;
+    for (auto _ : state)
+    {
+        payloadSize = FPGA::Samples2FPGAPacketPayload(src, samplesCount, mimo, compressed, pkt.data);
+        benchmark::DoNotOptimize(pkt.data);
+        benchmark::ClobberMemory();
+    }
+    state.SetItemsProcessed(state.iterations()*samplesCount*(mimo ? 2 : 1));
+    state.SetBytesProcessed(state.iterations()*payloadSize);
+}
+BENCHMARK(BM_SamplesToPayload)->ArgNames({"channels", "bits"})->ArgsProduct({{1, 2}, {12, 16}});
@@ -0,0 +1,185 @@
+/**
+    @file streaming.cpp
+    @author Lime Microsystems
+    @brief End to end LMS_RecvStream()/LMS_SendStream() benchmarks
+
+    Samples come from and go to the virtual board (ENABLE_VIRTUAL), which
+    produces and consumes packets in process, so results show the cost of
+    the host side data path without USB or PCIe transfers.
+*/
+
+#include <benchmark/benchmark.h>
+#include "lime/LimeSuite.h"
+#include <vector>
+#include <cstring>
+
+namespace
+{
+
+const int samplesPerCall = 8192;
+
+//! Args value of each stream data format
+const int fmtF32 = 0;
+const int fmtI16 = 1;
+const int fmtI12 = 2;
+const char* const fmtNames[] = {"F32", "I16", "I12"};
+
+/** @brief Virtual board with one stream per enabled channel
+    Opening fails, and benchmark is skipped, if library is built without
+    virtual connection.
+*/
+class VirtualStreams
+{
+public:
+    VirtualStreams(benchmark::State &state, const bool tx, const int channels, const int format) :
+        device(nullptr)
+    {
+        lms_info_str_t list[32];
+        const int count = LMS_GetDeviceList(list);
+        for (int i = 0; i < count && device == nullptr; ++i)
+            if (strstr(list[i], "media=Virtual") != nullptr && LMS_Open(&device, list[i], nullptr) != 0)
+                device = nullptr;
+        if (device == nullptr)
+        {
+            state.SkipWithError("Virtual board not available, enable ENABLE_VIRTUAL");
+            return;
+        }
+        if (Setup(tx, channels, format) != 0)
+        {
+            state.SkipWithError(LMS_GetLastErrorMessage());
+            Close();
+            return;
+        }
+        for (auto &stream : streams)
+            LMS_StartStream(&stream);
+        state.SetLabel(fmtNames[format]);
+    }
+
+    ~VirtualStreams()
+    {
+        Close();
+    }
+
+    bool IsReady() const
+    {
+        return device != nullptr;
+    }
+
+    //! Stores dropped packets and FIFO underruns/overruns of the first stream as counters
+    void ReportStatus(benchmark::State &state)
+    {
+        lms_stream_status_t status;
+        if (streams.empty() || LMS_GetStreamStatus(&streams[0], &status) != 0)
+            return;
+        state.counters["dropped"] = status.droppedPackets;
+        state.counters["underrun"] = status.underrun;
+        state.counters["overrun"] = status.overrun;
+    }
+
+    lms_device_t* device;
+    std::vector<lms_stream_t> streams;
+
+private:
+    int Setup(const bool tx, const int channels, const int format)
+    {
+        if (LMS_Init(device) != 0 || LMS_SetSampleRate(device, 30.72e6, 2) != 0)
+            return -1;
+        for (int ch = 0; ch < channels; ++ch)
+            if (LMS_EnableChannel(device, tx, ch, true) != 0)
+                return -1;
+
+        for (int ch = 0; ch < channels; ++ch)
+        {
+            lms_stream_t stream;
+            stream.channel = ch;
+            stream.isTx = tx;
+            stream.fifoSize = 1024*1024;
+            stream.throughputVsLatency = 1.0;
+            stream.dataFmt = format == fmtF32 ? lms_stream_t::LMS_FMT_F32 :
+                (format == fmtI16 ? lms_stream_t::LMS_FMT_I16 : lms_stream_t::LMS_FMT_I12);
+            if (LMS_SetupStream(device, &stream) != 0)
+                return -1;
+            streams.push_back(stream);
+        }
+        return 0;
+    }
+
+    void Close()
+    {
+        if (device == nullptr)
+            return;
+        for (auto &stream : streams)
+        {
+            LMS_StopStream(&stream);
+            LMS_DestroyStream(device, &stream);
+        }
+        LMS_Close(device);
+        device = nullptr;
+    }
+};
+
+} //anonymous namespace
+
+//! Args: channels count, stream data format
+static void BM_RecvStream(benchmark::State &state)
+{
+    const int channels = state.range(0);
+    VirtualStreams board(state, false, channels, state.range(1));
+    if (!board.IsReady())
+        return;
+    //large enough for interleaved I/Q samples of any format
+    std::vector<std::vector<float>> buffers(channels, std::vector<float>(2*samplesPerCall));
+
+    for (auto _ : state)
+    {
+        bool failed = false;
+        for (int ch = 0; ch < channels; ++ch)
+        {
+            lms_stream_meta_t meta;
+            if (LMS_RecvStream(&board.streams[ch], buffers[ch].data(), samplesPerCall, &meta, 1000) != samplesPerCall)
+                failed = true;
+        }
+        if (failed)
+        {
+            state.SkipWithError("LMS_RecvStream timed out");
+            break;
+        }
+    }
+    state.SetItemsProcessed(state.iterations()*samplesPerCall*channels);
+    board.ReportStatus(state);
+}
+BENCHMARK(BM_RecvStream)->ArgNames({"channels", "format"})
+    ->ArgsProduct({{1, 2}, {fmtF32, fmtI16, fmtI12}})->UseRealTime()->Unit(benchmark::kMicrosecond);
+
+//! Args: channels count, stream data format
+static void BM_SendStream(benchmark::State &state)
+{
+    const int channels = state.range(0);
+    VirtualStreams board(state, true, channels, state.range(1));
+    if (!board.IsReady())
+        return;
+    std::vector<std::vector<float>> buffers(channels, std::vector<float>(2*samplesPerCall));
+
+    for (auto _ : state)
+    {
+        bool failed = false;
+        for (int ch = 0; ch < channels; ++ch)
+        {
+            lms_stream_meta_t meta;
+            meta.timestamp = 0;
+            meta.waitForTimestamp = false;
+            meta.flushPartialPacket = false;
+            if (LMS_SendStream(&board.streams[ch], buffers[ch].data(), samplesPerCall, &meta, 1000) != samplesPerCall)
+                failed = true;
+        }
+        if (failed)
+        {
+            state.SkipWithError("LMS_SendStream timed out");
+            break;
+        }
+    }
+    state.SetItemsProcessed(state.iterations()*samplesPerCall*channels);
+    board.ReportStatus(state);
+}
+BENCHMARK(BM_SendStream)->ArgNames({"channels", "format"})
+    ->ArgsProduct({{1, 2}, {fmtF32, fmtI16, fmtI12}})->UseRealTime()->Unit(benchmark::kMicrosecond);
@@ -287,6 +287,25 @@ API_EXPORT int CALL_CONV LMS_SetLOFrequency(lms_device_t *device, bool dir_tx,
 API_EXPORT int CALL_CONV LMS_GetLOFrequency(lms_device_t *device, bool dir_tx,
                                             size_t chan, float_type *frequency);
 
+/**
+ * Tune LO to each of the given frequencies in advance and keep the VCO tuning
+ * results. Later LMS_SetLOFrequency() to any of these frequencies only writes
+ * the stored PLL settings instead of searching for VCO tuning, which makes
+ * frequency hopping and scanning much faster. Tuning results are discarded
+ * when they no longer lock, or when chip temperature has changed
+ * significantly since they were obtained. Current LO frequency is restored.
+ *
+ * @param   device      Device handle previously obtained by LMS_Open().
+ * @param   dir_tx      Select RX or TX
+ * @param   chan        Channel index
+ * @param   frequencies Array of RF center frequencies in Hz
+ * @param   count       Number of frequencies in array
+ *
+ * @return  0 on success, (-1) if some of the frequencies can not be tuned
+ */
+API_EXPORT int CALL_CONV LMS_PrepareLOFrequencies(lms_device_t *device, bool dir_tx,
+                        size_t chan, const float_type *frequencies, size_t count);
+
 /**
  * Obtain the supported RF center frequency range in Hz.
  *
@@ -518,6 +537,35 @@ API_EXPORT int CALL_CONV LMS_SetGFIRLPF(lms_device_t *device, bool dir_tx,
 API_EXPORT int CALL_CONV LMS_Calibrate(lms_device_t *device, bool dir_tx,
                                         size_t chan, double bw, unsigned flags);
 
+/**Calibration request for LMS_CalibrateMultiple()*/
+typedef struct
+{
+    bool dir_tx;        ///<Select RX or TX
+    size_t chan;        ///<Channel index
+    float_type bw;      ///<Calibration bandwidth
+    unsigned flags;     ///<Additional calibration flags (normally should be 0)
+    int status;         ///<Output: 0 on success, (-1) on failure
+    float_type duration;///<Output: time spent on calibration in seconds
+}lms_calib_request_t;
+
+/**
+ * Perform automatic calibration of multiple RX/TX channels. Channels of
+ * different RF chips (e.g. LimeSDR-QPCIe) are calibrated concurrently,
+ * channels of the same chip are calibrated in the given order. Calibrations
+ * using external loopback are performed one at a time.
+ *
+ * @pre Device should be configured
+ *
+ * @param   device      Device handle previously obtained by LMS_Open().
+ * @param   requests    array of calibration requests, status and duration
+ *                      fields are filled on return
+ * @param   count       number of requests
+ *
+ * @return  0 if all calibrations succeeded, (-1) on failure
+ */
+API_EXPORT int CALL_CONV LMS_CalibrateMultiple(lms_device_t *device,
+                                lms_calib_request_t *requests, size_t count);
+
 /**
  * Load LMS chip configuration from a file
  *
@@ -764,9 +812,40 @@ API_EXPORT int CALL_CONV LMS_GetGFIRCoeff(lms_device_t * device, bool dir_tx,
 API_EXPORT int CALL_CONV LMS_SetGFIR(lms_device_t * device, bool dir_tx,
                                     size_t chan, lms_gfir_t filt, bool enabled);
 
+/**
+ * Saves GFIR coefficients designed by LMS_SetGFIRLPF() to a file.
+ *
+ * Coefficients designed for LPF configuration are cached by bandwidth,
+ * interface rate, interpolation/decimation and number of taps. Loading
+ * previously saved file with LMS_LoadGFIRCache() avoids filter design delay
+ * when sample rate or bandwidth is changed.
+ *
+ * @param filename  path to file
+ *
+ * @return      0 on success, (-1) on failure
+ */
+API_EXPORT int CALL_CONV LMS_SaveGFIRCache(const char *filename);
+
+/**
+ * Adds GFIR coefficients saved by LMS_SaveGFIRCache() to the cache.
+ *
+ * @param filename  path to file
+ *
+ * @return      0 on success, (-1) on failure
+ */
+API_EXPORT int CALL_CONV LMS_LoadGFIRCache(const char *filename);
+
 /**
  *  Enables or disable caching of calibration values.
  *
+ *  When enabled, register values are cached and DC/IQ corrections obtained
+ *  by LMS_Calibrate() are saved to calibration database file, together with
+ *  board serial number, channel, LO frequency, bandwidth, gain and last
+ *  measured chip temperature. When LO frequency is changed, stored results
+ *  of similar conditions are interpolated and applied without recalibrating.
+ *  Database file is $HOME/.local/share/LimeSuite/calibrations.txt on Linux,
+ *  it can be changed by LIME_CALIBRATION_STORE environment variable.
+ *
  * @param   dev         Device handle previously obtained by LMS_Open().
  * @param   enable      true to enable cache
  *
@@ -776,6 +855,157 @@ API_EXPORT int CALL_CONV LMS_EnableCalibCache(lms_device_t *dev, bool enable);
 
 /** @} (End FN_ADVANCED) */
 
+/**
+ * @defgroup FN_ASYNC    Asynchronous control functions
+ *
+ * The functions in this section queue settings to be applied by a worker
+ * thread of the device and return without waiting for the control port, so
+ * they can be called from time critical threads. Commands are executed one at
+ * a time in the order of submission. If a setting of the same channel is
+ * changed again before the previous command has started, the previous command
+ * is dropped and its callback receives the result of the newer one.
+ *
+ * Synchronous control functions can be called while asynchronous commands
+ * are pending, they are executed between two queued commands, not after all
+ * of them. Use LMS_FlushAsync() first if they have to observe queued changes.
+ * @{
+ */
+
+/**
+ * Completion callback of asynchronous commands. It is called from the worker
+ * thread, LMS_GetLastErrorMessage() returns error message of the failed
+ * command when called from the callback. Callback must not call
+ * LMS_FlushAsync().
+ *
+ * @param device    device the command was queued for
+ * @param status    0 on success, (-1) on failure
+ * @param user_data pointer passed when the command was queued
+ */
+typedef void (*lms_async_callback_t)(lms_device_t *device, int status, void *user_data);
+
+/**
+ * Queue LMS_SetSampleRate() call.
+ *
+ * @param device        Device handle previously obtained by LMS_Open().
+ * @param rate          sampling rate in Hz to set
+ * @param oversample    RF oversampling ratio.
+ * @param callback      function called after completion, can be NULL.
+ * @param user_data     pointer passed to callback.
+ *
+ * @return  0 if command was queued, (-1) on failure
+ */
+API_EXPORT int CALL_CONV LMS_SetSampleRateAsync(lms_device_t *device, float_type rate,
+        size_t oversample, lms_async_callback_t callback, void *user_data);
+
+/**
+ * Queue LMS_SetLOFrequency() call.
+ *
+ * @param device        Device handle previously obtained by LMS_Open().
+ * @param dir_tx        Select RX or TX
+ * @param chan          Channel index
+ * @param frequency     Desired RF center frequency in Hz
+ * @param callback      function called after completion, can be NULL.
+ * @param user_data     pointer passed to callback.
+ *
+ * @return  0 if command was queued, (-1) on failure
+ */
+API_EXPORT int CALL_CONV LMS_SetLOFrequencyAsync(lms_device_t *device, bool dir_tx, size_t chan,
+        float_type frequency, lms_async_callback_t callback, void *user_data);
+
+/**
+ * Queue LMS_SetAntenna() call.
+ *
+ * @param device        Device handle previously obtained by LMS_Open().
+ * @param dir_tx        Select RX or TX
+ * @param chan          Channel index
+ * @param index         Index of antenna to select
+ * @param callback      function called after completion, can be NULL.
+ * @param user_data     pointer passed to callback.
+ *
+ * @return  0 if command was queued, (-1) on failure
+ */
+API_EXPORT int CALL_CONV LMS_SetAntennaAsync(lms_device_t *device, bool dir_tx, size_t chan,
+        size_t index, lms_async_callback_t callback, void *user_data);
+
+/**
+ * Queue LMS_SetNormalizedGain() call. Replaces pending gain change of the
+ * same channel queued by this function or LMS_SetGaindBAsync().
+ *
+ * @param device        Device handle previously obtained by LMS_Open().
+ * @param dir_tx        Select RX or TX
+ * @param chan          Channel index
+ * @param gain          Desired gain, range [0, 1.0], where 1.0 indicates the
+ *                      maximum gain
+ * @param callback      function called after completion, can be NULL.
+ * @param user_data     pointer passed to callback.
+ *
+ * @return  0 if command was queued, (-1) on failure
+ */
+API_EXPORT int CALL_CONV LMS_SetNormalizedGainAsync(lms_device_t *device, bool dir_tx, size_t chan,
+        float_type gain, lms_async_callback_t callback, void *user_data);
+
+/**
+ * Queue LMS_SetGaindB() call. Replaces pending gain change of the same
+ * channel queued by this function or LMS_SetNormalizedGainAsync().
+ *
+ * @param device        Device handle previously obtained by LMS_Open().
+ * @param dir_tx        Select RX or TX
+ * @param chan          Channel index
+ * @param gain          Desired gain, range [0, 73]
+ * @param callback      function called after completion, can be NULL.
+ * @param user_data     pointer passed to callback.
+ *
+ * @return  0 if command was queued, (-1) on failure
+ */
+API_EXPORT int CALL_CONV LMS_SetGaindBAsync(lms_device_t *device, bool dir_tx, size_t chan,
+        unsigned gain, lms_async_callback_t callback, void *user_data);
+
+/**
+ * Queue LMS_SetLPFBW() call.
+ *
+ * @param device        Device handle previously obtained by LMS_Open().
+ * @param dir_tx        Select RX or TX
+ * @param chan          Channel index
+ * @param bandwidth     LPF bandwidth in Hz
+ * @param callback      function called after completion, can be NULL.
+ * @param user_data     pointer passed to callback.
+ *
+ * @return  0 if command was queued, (-1) on failure
+ */
+API_EXPORT int CALL_CONV LMS_SetLPFBWAsync(lms_device_t *device, bool dir_tx, size_t chan,
+        float_type bandwidth, lms_async_callback_t callback, void *user_data);
+
+/**
+ * Queue LMS_SetNCOFrequency() call. Frequencies are copied, the array can be
+ * reused when the function returns. Phase only changes (freq is NULL) do not
+ * replace pending frequency changes.
+ *
+ * @param device        Device handle previously obtained by LMS_Open().
+ * @param dir_tx        Select RX or TX
+ * @param chan          Channel index
+ * @param freq          List of NCO frequencies, LMS_NCO_VAL_COUNT values.
+ *                      Can be NULL to change only phase.
+ * @param pho           NCO phase offset in deg
+ * @param callback      function called after completion, can be NULL.
+ * @param user_data     pointer passed to callback.
+ *
+ * @return  0 if command was queued, (-1) on failure
+ */
+API_EXPORT int CALL_CONV LMS_SetNCOFrequencyAsync(lms_device_t *device, bool dir_tx, size_t chan,
+        const float_type *freq, float_type pho, lms_async_callback_t callback, void *user_data);
+
+/**
+ * Wait until all asynchronous commands of the device are executed.
+ *
+ * @param device        Device handle previously obtained by LMS_Open().
+ * @param timeout_ms    time limit in milliseconds, negative to wait indefinitely
+ *
+ * @return  0 on success, (-1) on timeout
+ */
+API_EXPORT int CALL_CONV LMS_FlushAsync(lms_device_t *device, int timeout_ms);
+
+/** @} (End FN_ASYNC) */
+
 /** @} (End FN_HIGH_LVL) */
 
 /**
@@ -1131,6 +1361,74 @@ API_EXPORT int CALL_CONV LMS_SetupStream(lms_device_t *device, lms_stream_t *str
  */
 API_EXPORT int CALL_CONV LMS_DestroyStream(lms_device_t *dev, lms_stream_t *stream);
 
+/**
+ * Enable zero-copy receive for the stream. When enabled, LMS_RecvStream()
+ * decodes received USB transfers directly into the supplied sample buffer
+ * instead of passing them through a streaming thread and FIFO.
+ * Takes effect only when all active Rx streams of the device have it enabled.
+ * Must be called before LMS_StartStream().
+ *
+ * @param stream    Rx stream previously initialized with LMS_SetupStream().
+ * @param enable    true - enable zero-copy, false - use FIFO (default)
+ *
+ * @return 0 on success, (-1) on failure
+ */
+API_EXPORT int CALL_CONV LMS_SetStreamZeroCopy(lms_stream_t *stream, bool enable);
+
+/**Streaming thread scheduling applied to the stream*/
+typedef struct
+{
+    int priority;       ///<Realtime priority of streaming thread, 0 - default
+    uint64_t affinity;  ///<CPU mask of streaming thread, 0 - not pinned
+    int bufferNode;     ///<NUMA node of transfer buffers, (-1) if not bound
+    int fifoNode;       ///<NUMA node of stream FIFO, (-1) if not bound
+}lms_stream_thread_info_t;
+
+/**
+ * Set scheduling of the streaming thread that serves the stream. When several
+ * streams of the same direction are used, settings of the first one apply.
+ * Realtime priority usually requires elevated privileges, failures are
+ * reported as warnings and can be checked with LMS_GetStreamSchedulingInfo().
+ * Must be called before LMS_StartStream().
+ *
+ * @param stream        stream previously initialized with LMS_SetupStream().
+ * @param priority      realtime priority 1-99, 0 - default scheduling
+ * @param cpu_affinity  bit mask of allowed CPUs, 0 - any CPU
+ * @param numa_local    allocate FIFO and transfer buffers on the NUMA node
+ *                      of the CPUs in cpu_affinity
+ *
+ * @return 0 on success, (-1) on failure
+ */
+API_EXPORT int CALL_CONV LMS_SetStreamScheduling(lms_stream_t *stream,
+                        int priority, uint64_t cpu_affinity, bool numa_local);
+
+/**
+ * Select memory used for stream FIFO and transfer buffers. Buffers are
+ * allocated from a pool that keeps them faulted in across stream restarts.
+ * Must be called before LMS_StartStream().
+ *
+ * @param stream        stream previously initialized with LMS_SetupStream().
+ * @param huge_pages    use huge pages, falls back to transparent huge pages
+ *                      when none are reserved
+ * @param lock_memory   lock buffers in RAM (subject to memlock limits)
+ *
+ * @return 0 on success, (-1) on failure
+ */
+API_EXPORT int CALL_CONV LMS_SetStreamMemory(lms_stream_t *stream,
+                                        bool huge_pages, bool lock_memory);
+
+/**
+ * Get scheduling that was actually applied to the stream. Thread values are
+ * valid only after the stream has been started.
+ *
+ * @param stream    stream previously initialized with LMS_SetupStream().
+ * @param info      applied scheduling
+ *
+ * @return 0 on success, (-1) on failure
+ */
+API_EXPORT int CALL_CONV LMS_GetStreamSchedulingInfo(lms_stream_t *stream,
+                                               lms_stream_thread_info_t *info);
+
 /**
  * Start stream
  *
@@ -1189,6 +1487,80 @@ API_EXPORT int CALL_CONV LMS_SendStream(lms_stream_t *stream,
                             const void *samples,size_t sample_count,
                             const lms_stream_meta_t *meta, unsigned timeout_ms);
 
+/**
+ * Read timestamp aligned samples from several RX streams in one call.
+ *
+ * Streams may belong to different RF chips of the board. All buffers are
+ * filled with samples starting at the same timestamp, samples received
+ * earlier on some of the streams are dropped. Reading stops early if samples
+ * were lost, so that returned blocks are always contiguous.
+ *
+ * @param streams       array of up to 16 RX streams set up with the same
+ *                      data format.
+ * @param stream_count  number of streams.
+ * @param samples       array of sample buffers, one for each stream.
+ * @param sample_count  number of samples to read into each buffer.
+ * @param meta          Metadata. If waitForTimestamp is set, samples older
+ *                      than timestamp are dropped. Returns timestamp of the
+ *                      first sample.
+ * @param timeout_ms    how long to wait for data before timing out.
+ *
+ * @return number of samples read into each buffer, (-1) on failure
+ */
+API_EXPORT int CALL_CONV LMS_RecvStreamAligned(lms_stream_t * const *streams,
+                size_t stream_count, void * const *samples, size_t sample_count,
+                lms_stream_meta_t *meta, unsigned timeout_ms);
+
+/**
+ * Write samples to several TX streams in one call, all streams are given
+ * the same metadata, so that they are transmitted at the same time.
+ *
+ * @param streams       array of TX streams.
+ * @param stream_count  number of streams.
+ * @param samples       array of sample buffers, one for each stream.
+ * @param sample_count  number of samples to write from each buffer.
+ * @param meta          Metadata. See the ::lms_stream_meta_t description.
+ * @param timeout_ms    how long to wait for free space before timing out.
+ *
+ * @return number of samples accepted by all streams, (-1) on failure
+ */
+API_EXPORT int CALL_CONV LMS_SendStreamAligned(lms_stream_t * const *streams,
+                size_t stream_count, const void * const *samples, size_t sample_count,
+                const lms_stream_meta_t *meta, unsigned timeout_ms);
+
+/**
+ * Get direct access to samples stored in the FIFO of the specified stream,
+ * without copying them. For RX streams the buffer contains the oldest received
+ * samples, for TX streams it is free space to be filled with samples.
+ * Only LMS_FMT_I16 and LMS_FMT_I12 stream formats are supported.
+ * Buffer has to be returned with LMS_ReleaseStreamBuffer() before acquiring
+ * the next one or calling LMS_RecvStream()/LMS_SendStream().
+ *
+ * @param stream        structure previously initialized with LMS_SetupStream().
+ * @param samples       returns pointer to the samples buffer.
+ * @param meta          RX: returns timestamp of the first sample. TX: not used.
+ * @param timeout_ms    how long to wait for data (RX) or free space (TX).
+ *
+ * @return number of samples in buffer (RX) or buffer capacity in samples (TX),
+ *         0 on timeout, (-1) on failure
+ */
+API_EXPORT int CALL_CONV LMS_AcquireStreamBuffer(lms_stream_t *stream,
+                            void **samples, lms_stream_meta_t *meta,
+                            unsigned timeout_ms);
+
+/**
+ * Return buffer previously obtained by LMS_AcquireStreamBuffer().
+ *
+ * @param stream        structure previously initialized with LMS_SetupStream().
+ * @param sample_count  RX: number of samples consumed, remaining samples are
+ *                      returned by the next read. TX: number of samples written.
+ * @param meta          TX: Metadata of written samples. RX: not used.
+ *
+ * @return  0 on success, (-1) on failure
+ */
+API_EXPORT int CALL_CONV LMS_ReleaseStreamBuffer(lms_stream_t *stream,
+                            size_t sample_count, const lms_stream_meta_t *meta);
+
 /**
  * Uploads waveform to on board memory for later use
  * @param device        Device handle previously obtained by LMS_Open().
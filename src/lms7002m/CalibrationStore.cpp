@@ -0,0 +1,261 @@
+/**
+@file CalibrationStore.cpp
+@author Lime Microsystems
+@brief On-disk database of DC/IQ calibration results
+*/
+
+#include "CalibrationStore.h"
+#include "SystemResources.h"
+#include "Logger.h"
+#include <fstream>
+#include <sstream>
+#include <cmath>
+#include <cstdlib>
+#include <cstdio>
+#include <cerrno>
+#include <sys/stat.h>
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#endif
+
+using namespace lime;
+
+//lookup limits
+static const double maxBandwidthDeviation = 0.25; //relative to requested bandwidth
+static const double maxGainDeviation = 6; //dB
+static const double maxTemperatureDeviation = 10; //degrees C
+static const double maxInterpolationSpan = 200e6; //distance between entries being interpolated
+static const double maxExtrapolation = 20e6; //distance to nearest entry if there is only one side
+
+CalibrationStore &CalibrationStore::Instance()
+{
+    static CalibrationStore store(DefaultFilename());
+    return store;
+}
+
+std::string CalibrationStore::DefaultFilename()
+{
+    const char* filename = std::getenv("LIME_CALIBRATION_STORE");
+    if (filename != nullptr)
+        return filename;
+    return lime::getAppDataDirectory() + "/calibrations.txt";
+}
+
+CalibrationStore::CalibrationStore(const std::string &filename) :
+    mFilename(filename)
+{
+    Load();
+}
+
+bool CalibrationStore::Matches(const Entry &entry, const Entry &query)
+{
+    if (entry.boardSerial != query.boardSerial || entry.channel != query.channel || entry.tx != query.tx)
+        return false;
+    //bandwidth is not constrained if query does not specify it
+    if (query.bandwidth > 0 && fabs(entry.bandwidth - query.bandwidth) > maxBandwidthDeviation*query.bandwidth)
+        return false;
+    if (fabs(entry.gain - query.gain) > maxGainDeviation)
+        return false;
+    //unknown temperature (NAN) always passes
+    if (fabs(entry.temperature - query.temperature) > maxTemperatureDeviation)
+        return false;
+    return true;
+}
+
+//! Penalty of using entry for the query other than LO frequency difference
+double CalibrationStore::Distance(const Entry &entry, const Entry &query)
+{
+    double distance = 0;
+    if (query.bandwidth > 0)
+        distance += fabs(entry.bandwidth - query.bandwidth)/(maxBandwidthDeviation*query.bandwidth);
+    distance += fabs(entry.gain - query.gain)/maxGainDeviation;
+    if (!std::isnan(entry.temperature) && !std::isnan(query.temperature))
+        distance += fabs(entry.temperature - query.temperature)/maxTemperatureDeviation;
+    return distance;
+}
+
+int CalibrationStore::Insert(const Entry &entry)
+{
+    {
+        std::lock_guard<std::mutex> lock(mLock);
+        bool replaced = false;
+        for (auto &stored : mEntries)
+        {
+            if (stored.boardSerial != entry.boardSerial || stored.channel != entry.channel || stored.tx != entry.tx)
+                continue;
+            if (fabs(stored.frequency - entry.frequency) > 1e3 || fabs(stored.bandwidth - entry.bandwidth) > 1e3)
+                continue;
+            if (fabs(stored.gain - entry.gain) > 0.5 || fabs(stored.temperature - entry.temperature) > maxTemperatureDeviation/2)
+                continue;
+            stored = entry;
+            replaced = true;
+            break;
+        }
+        if (!replaced)
+            mEntries.push_back(entry);
+    }
+    return Save();
+}
+
+bool CalibrationStore::Lookup(Entry &query)
+{
+    std::lock_guard<std::mutex> lock(mLock);
+    const Entry* lower = nullptr;
+    const Entry* upper = nullptr;
+    for (const auto &entry : mEntries)
+    {
+        if (!Matches(entry, query))
+            continue;
+        //nearest frequency on each side, closest conditions when frequencies are equal
+        if (entry.frequency <= query.frequency)
+        {
+            if (lower == nullptr || entry.frequency > lower->frequency ||
+                (entry.frequency == lower->frequency && Distance(entry, query) < Distance(*lower, query)))
+                lower = &entry;
+        }
+        if (entry.frequency >= query.frequency)
+        {
+            if (upper == nullptr || entry.frequency < upper->frequency ||
+                (entry.frequency == upper->frequency && Distance(entry, query) < Distance(*upper, query)))
+                upper = &entry;
+        }
+    }
+
+    if (lower && upper && upper->frequency - lower->frequency <= maxInterpolationSpan)
+    {
+        const double span = upper->frequency - lower->frequency;
+        const double k = span > 0 ? (query.frequency - lower->frequency)/span : 0;
+        auto interpolate = [k](int16_t a, int16_t b)->int16_t {
+            return (int16_t)lround(a + k*(b - a));
+        };
+        query.values.dcI = interpolate(lower->values.dcI, upper->values.dcI);
+        query.values.dcQ = interpolate(lower->values.dcQ, upper->values.dcQ);
+        query.values.gainI = interpolate(lower->values.gainI, upper->values.gainI);
+        query.values.gainQ = interpolate(lower->values.gainQ, upper->values.gainQ);
+        query.values.phase = interpolate(lower->values.phase, upper->values.phase);
+        return true;
+    }
+
+    const Entry* nearest = nullptr;
+    if (lower && query.frequency - lower->frequency <= maxExtrapolation)
+        nearest = lower;
+    if (upper && upper->frequency - query.frequency <= maxExtrapolation &&
+        (nearest == nullptr || upper->frequency - query.frequency < query.frequency - nearest->frequency))
+        nearest = upper;
+    if (nearest == nullptr)
+        return false;
+    query.values = nearest->values;
+    return true;
+}
+
+void CalibrationStore::Clear()
+{
+    {
+        std::lock_guard<std::mutex> lock(mLock);
+        mEntries.clear();
+    }
+    Save();
+}
+
+std::vector<CalibrationStore::Entry> CalibrationStore::GetEntries()
+{
+    std::lock_guard<std::mutex> lock(mLock);
+    return mEntries;
+}
+
+int CalibrationStore::Load()
+{
+    std::ifstream file(mFilename);
+    if (!file.is_open())
+        return 0; //nothing stored yet
+
+    std::vector<Entry> entries;
+    std::string line;
+    while (std::getline(file, line))
+    {
+        if (line.empty() || line[0] == '#')
+            continue;
+        std::istringstream ss(line);
+        std::string serial, dir, temperature;
+        Entry entry;
+        int values[5];
+        ss >> serial >> entry.channel >> dir >> entry.frequency >> entry.bandwidth >> entry.gain >> temperature;
+        for (int &value : values)
+            ss >> value;
+        if (ss.fail())
+        {
+            lime::warning("CalibrationStore: skipping invalid line in %s", mFilename.c_str());
+            continue;
+        }
+        entry.boardSerial = std::strtoull(serial.c_str(), nullptr, 16);
+        entry.tx = (dir == "tx");
+        entry.temperature = (temperature == "-") ? NAN : std::strtod(temperature.c_str(), nullptr);
+        entry.values.dcI = values[0];
+        entry.values.dcQ = values[1];
+        entry.values.gainI = values[2];
+        entry.values.gainQ = values[3];
+        entry.values.phase = values[4];
+        entries.push_back(entry);
+    }
+
+    std::lock_guard<std::mutex> lock(mLock);
+    mEntries.swap(entries);
+    return 0;
+}
+
+int CalibrationStore::Save()
+{
+    std::lock_guard<std::mutex> lock(mLock);
+
+    //create directory if it does not exist yet
+    const size_t separator = mFilename.find_last_of("/\\");
+    if (separator != std::string::npos)
+    {
+        const std::string dir = mFilename.substr(0, separator);
+        struct stat s;
+        if (stat(dir.c_str(), &s) != 0)
+        {
+            #ifdef __unix__
+            const std::string mkdirCmd("mkdir -p \""+dir+"\"");
+            #else
+            const std::string mkdirCmd("md.exe \""+dir+"\"");
+            #endif
+            std::system(mkdirCmd.c_str());
+        }
+    }
+
+    //write to temporary file first, so that interrupted save does not lose stored results
+    const std::string tmpFilename = mFilename + ".tmp";
+    {
+        std::ofstream file(tmpFilename);
+        if (!file.is_open())
+            return lime::ReportError(errno, "CalibrationStore: cannot write %s", tmpFilename.c_str());
+        file << "#serial channel direction frequency bandwidth gain temperature dcI dcQ gainI gainQ phase\n";
+        char line[256];
+        for (const auto &entry : mEntries)
+        {
+            char temperature[32] = "-";
+            if (!std::isnan(entry.temperature))
+                snprintf(temperature, sizeof(temperature), "%.1f", entry.temperature);
+            snprintf(line, sizeof(line), "%016llX %u %s %.0f %.0f %.1f %s %i %i %i %i %i\n",
+                (unsigned long long)entry.boardSerial, entry.channel, entry.tx ? "tx" : "rx",
+                entry.frequency, entry.bandwidth, entry.gain, temperature,
+                entry.values.dcI, entry.values.dcQ, entry.values.gainI, entry.values.gainQ, entry.values.phase);
+            file << line;
+        }
+        if (!file.good())
+            return lime::ReportError(EIO, "CalibrationStore: failed to write %s", tmpFilename.c_str());
+    }
+    //replace in one step, so the old file stays intact if anything fails
+#ifdef _WIN32
+    if (!MoveFileExA(tmpFilename.c_str(), mFilename.c_str(), MOVEFILE_REPLACE_EXISTING))
+        return lime::ReportError(EIO, "CalibrationStore: cannot write %s", mFilename.c_str());
+#else
+    if (std::rename(tmpFilename.c_str(), mFilename.c_str()) != 0)
+        return lime::ReportError(errno, "CalibrationStore: cannot write %s", mFilename.c_str());
+#endif
+    return 0;
+}
@@ -0,0 +1,75 @@
+/**
+@file CalibrationStore.h
+@author Lime Microsystems
+@brief On-disk database of DC/IQ calibration results
+*/
+
+#ifndef LMS7_CALIBRATION_STORE_H
+#define LMS7_CALIBRATION_STORE_H
+
+#include "LMS7002M.h"
+#include <string>
+#include <vector>
+#include <mutex>
+
+namespace lime
+{
+
+/** @brief Keeps DC offset and IQ correction values obtained by calibrations
+
+    Entries are identified by board serial number, channel and direction and
+    are recorded together with LO frequency, calibration bandwidth, gain and
+    chip temperature. Lookups interpolate between entries of the nearest LO
+    frequencies, so corrections can be applied after retuning without
+    running the calibration again. Results are stored in a text file.
+*/
+class CalibrationStore
+{
+public:
+    struct Entry
+    {
+        uint64_t boardSerial;
+        unsigned channel;
+        bool tx;
+        double frequency;   //LO frequency, Hz
+        double bandwidth;   //calibration bandwidth, Hz, any if not positive in lookup
+        double gain;        //channel gain, dB
+        double temperature; //chip temperature, NAN if not known
+        LMS7002M::CalibrationValues values;
+    };
+
+    //! @brief Returns store shared by all devices, backed by default file
+    static CalibrationStore &Instance();
+
+    //! @brief Default file, LIME_CALIBRATION_STORE environment variable overrides it
+    static std::string DefaultFilename();
+
+    CalibrationStore(const std::string &filename);
+
+    //! @brief Adds entry replacing previous result for the same conditions, saves file
+    int Insert(const Entry &entry);
+
+    /** @brief Finds corrections for given conditions
+        @param query conditions to look for, values are filled on success
+        @return true if suitable entries were found
+    */
+    bool Lookup(Entry &query);
+
+    void Clear();
+    int Load();
+    int Save();
+
+    std::vector<Entry> GetEntries();
+
+private:
+    static bool Matches(const Entry &entry, const Entry &query);
+    static double Distance(const Entry &entry, const Entry &query);
+
+    std::string mFilename;
+    std::vector<Entry> mEntries;
+    std::mutex mLock;
+};
+
+}
+
+#endif
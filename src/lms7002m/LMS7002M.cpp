@@ -11,6 +11,7 @@
 #include "LMS7002M.h"
 #include <stdio.h>
 #include <set>
+#include <map>
 #include "IConnection.h"
 #include "INI.h"
 #include <cmath>
@@ -41,6 +42,8 @@ extern std::vector<const LMS7Parameter*> LMS7parameterList;
 //module addresses needs to be sorted in ascending order
 const uint16_t LMS7002M::readOnlyRegisters[] =      { 0x002F, 0x008C, 0x00A8, 0x00A9, 0x00AA, 0x00AB, 0x00AC, 0x0123, 0x0209, 0x020A, 0x020B, 0x040E, 0x040F };
 const uint16_t LMS7002M::readOnlyRegistersMasks[] = { 0x0000, 0x0FFF, 0x007F, 0x0000, 0x0000, 0x0000, 0x0000, 0x003F, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000 };
+//registers containing read only registers, which values can change
+const uint16_t LMS7002M::volatileRegisters[] = { 0, 1, 2, 3, 4, 5, 6, 0x002F, 0x008C, 0x00A8, 0x00A9, 0x00AA, 0x00AB, 0x00AC, 0x0123, 0x0209, 0x020A, 0x020B, 0x040E, 0x040F, 0x05C3, 0x05C4, 0x05C5, 0x05C6, 0x05C7, 0x05C8, 0x05C9, 0x05CA};
 
 /** @brief Simple logging function to print status messages
     @param text message to print
@@ -125,6 +128,9 @@ LMS7002M::LMS7002M() :
     controlPort(nullptr),
     mdevIndex(0),
     mSelfCalDepth(0),
+    mBatchDepth(0),
+    mBatchPrevious(0),
+    mTemperature(NAN),
     _cachedRefClockRate(30.72e6)
 {
     mCalibrationByMCU = true;
@@ -197,6 +203,10 @@ LMS7002M::LMS7002M() :
     MemorySectionAddresses[RSSI_DC_CONFIG][1] = 0x0641;
 
     mRegistersMap->InitializeDefaultValues(LMS7parameterList);
+    for (const uint16_t address : readOnlyRegisters)
+        mRegistersMap->SetFlags(address, LMS7002M_RegistersMap::READ_ONLY);
+    for (const uint16_t address : volatileRegisters)
+        mRegistersMap->SetFlags(address, mRegistersMap->GetFlags(address) | LMS7002M_RegistersMap::VOLATILE);
     mcuControl = new MCU_BD();
     mcuControl->Initialize(nullptr);
 }
@@ -369,9 +379,9 @@ int LMS7002M::EnableChannel(const bool isTx, const bool enable)
 */
 int LMS7002M::ResetChip()
 {
-    int status = 0;
+    int status = FlushBatch(); //buffered writes go out in order, before reset
     if (controlPort)
-        status = controlPort->DeviceReset(mdevIndex);
+        status |= controlPort->DeviceReset(mdevIndex);
     else
         lime::warning("No device connected");
     mRegistersMap->InitializeDefaultValues(LMS7parameterList);
@@ -1454,9 +1464,6 @@ const LMS7Parameter* LMS7002M::GetParam(const std::string &name)
 */
 int LMS7002M::SetFrequencySX(bool tx, float_type freq_Hz, SX_details* output)
 {
-    static map<float_type, int8_t> tuning_cache_sel_vco;
-    static map<float_type, int16_t> tuning_cache_csw_value;
-
     const char* vcoNames[] = {"VCOL", "VCOM", "VCOH"};
     const uint8_t sxVCO_N = 2; //number of entries in VCO frequencies
     const float_type m_dThrF = 5500e6; //threshold to enable additional divider
@@ -1489,6 +1496,8 @@ int LMS7002M::SetFrequencySX(bool tx, float_type freq_Hz, SX_details* output)
     fractionalPart = (uint32_t)((VCOfreq / (refClk_Hz * (1 + (VCOfreq > m_dThrF))) - (uint32_t)(VCOfreq / (refClk_Hz * (1 + (VCOfreq > m_dThrF))))) * 1048576);
 
     Channel ch = this->GetActiveChannel();
+    //settings are sent together with cached tuning values, or before tuning starts
+    BeginBatch();
     this->SetActiveChannel(tx?ChSXT:ChSXR);
     Modify_SPI_Reg_bits(LMS7param(EN_INTONLY_SDM), 0);
     Modify_SPI_Reg_bits(LMS7param(INT_SDM), integerPart); //INT_SDM
@@ -1520,14 +1529,27 @@ int LMS7002M::SetFrequencySX(bool tx, float_type freq_Hz, SX_details* output)
     Modify_SPI_Reg_bits(LMS7param(PD_VCO_COMP), 0);
 
     // try setting tuning values from the cache, if it fails perform full tuning
-    if  (useCache && tuning_cache_sel_vco.count(freq_Hz) > 0)
+    const auto cacheKey = std::make_tuple(tx, (int64_t)llround(refClk_Hz), (int64_t)llround(freq_Hz));
+    auto cached = mVCOTuningCache.find(cacheKey);
+    //VCO characteristics drift with temperature, retune if it has changed too much
+    //or if temperature is known only for one of the cached and current settings
+    if (cached != mVCOTuningCache.end() && (std::isnan(cached->second.temperature) != std::isnan(mTemperature)
+        || fabs(cached->second.temperature - mTemperature) > 20))
+    {
+        mVCOTuningCache.erase(cached);
+        cached = mVCOTuningCache.end();
+    }
+    if (cached != mVCOTuningCache.end())
     {
-        Modify_SPI_Reg_bits(LMS7param(SEL_VCO), tuning_cache_sel_vco[freq_Hz]);
-        Modify_SPI_Reg_bits(LMS7param(CSW_VCO).address, LMS7param(CSW_VCO).msb, LMS7param(CSW_VCO).lsb, tuning_cache_csw_value[freq_Hz]);
+        sel_vco = cached->second.sel_vco;
+        csw_value = cached->second.csw;
+        Modify_SPI_Reg_bits(LMS7param(SEL_VCO), sel_vco);
+        Modify_SPI_Reg_bits(LMS7param(CSW_VCO), csw_value);
+        Commit();
         this_thread::sleep_for(chrono::microseconds(50)); // probably no need for this as the interface is already very slow..
         auto cmphl = (uint8_t)Get_SPI_Reg_bits(LMS7param(VCO_CMPHO).address, 13, 12, true);
         if(cmphl == 2) {
-            lime::info("Fast Tune success; vco=%d value=%d", tuning_cache_sel_vco[freq_Hz], tuning_cache_csw_value[freq_Hz]);
+            lime::debug("Fast Tune success; vco=%d value=%d", sel_vco, csw_value);
             this->SetActiveChannel(ch); //restore used channel
             if (output)
             {
@@ -1537,7 +1559,10 @@ int LMS7002M::SetFrequencySX(bool tx, float_type freq_Hz, SX_details* output)
             }
             return 0;
         }
+        mVCOTuningCache.erase(cached);
     }
+    else
+        Commit();
 
     canDeliverFrequency = false;
     int tuneScore[] = { -128, -128, -128 }; //best is closest to 0
@@ -1584,9 +1609,11 @@ int LMS7002M::SetFrequencySX(bool tx, float_type freq_Hz, SX_details* output)
     Modify_SPI_Reg_bits(LMS7param(CSW_VCO), csw_value);
 
     // save successful tuning results in cache
-    if (useCache && canDeliverFrequency) {
-        tuning_cache_sel_vco[freq_Hz] = sel_vco;
-        tuning_cache_csw_value[freq_Hz] = csw_value;
+    if (canDeliverFrequency) {
+        VCOTuning &tuning = mVCOTuningCache[cacheKey];
+        tuning.sel_vco = sel_vco;
+        tuning.csw = csw_value;
+        tuning.temperature = mTemperature;
     }
 
     this->SetActiveChannel(ch); //restore used channel
@@ -1598,6 +1625,28 @@ int LMS7002M::SetFrequencySX(bool tx, float_type freq_Hz, SX_details* output)
     return 0;
 }
 
+/** @brief Tunes SX to given frequencies to fill VCO tuning cache
+    @param tx Rx/Tx module selection
+    @param frequencies frequencies in Hz
+    @return 0-success, other-some of the frequencies can not be delivered
+*/
+int LMS7002M::PrepareFrequenciesSX(bool tx, const std::vector<float_type> &frequencies)
+{
+    const float_type current = GetFrequencySX(tx);
+    int status = 0;
+    for (const float_type freq : frequencies)
+        if (SetFrequencySX(tx, freq) != 0)
+            status = -1;
+    if (current > 0)
+        SetFrequencySX(tx, current);
+    return status;
+}
+
+void LMS7002M::ClearVCOTuningCache()
+{
+    mVCOTuningCache.clear();
+}
+
 /** @brief Sets SX frequency with Reference clock spur cancelation
     @param Tx Rx/Tx module selection
     @param freq_Hz desired frequency in Hz
@@ -1867,6 +1916,10 @@ int LMS7002M::SPI_write(uint16_t address, uint16_t data, bool toChip)
 {
     if(address == 0x0640 || address == 0x0641)
     {
+        //MCU accesses SPI directly, so these writes can not be batched
+        const int batchDepth = mBatchDepth;
+        FlushBatch();
+        mBatchDepth = 0;
         MCU_BD* mcu = GetMCUControls();
         mcu->RunProcedure(MCU_FUNCTION_GET_PROGRAM_ID);
         if(mcu->WaitForMCU(100) != MCU_ID_CALIBRATIONS_SINGLE_IMAGE)
@@ -1875,6 +1928,7 @@ int LMS7002M::SPI_write(uint16_t address, uint16_t data, bool toChip)
         SPI_write(0x020C, data);
         mcu->RunProcedure(7);
         mcu->WaitForMCU(50);
+        mBatchDepth = batchDepth;
         return SPI_read(0x040B) == data ? 0 : -1;
     }
     else
@@ -1889,15 +1943,10 @@ int LMS7002M::SPI_write(uint16_t address, uint16_t data, bool toChip)
 */
 uint16_t LMS7002M::SPI_read(uint16_t address, bool fromChip, int *status)
 {
-    fromChip |= !useCache;
-    //registers containing read only registers, which values can change
-    const uint16_t readOnlyRegs[] = { 0, 1, 2, 3, 4, 5, 6, 0x002F, 0x008C, 0x00A8, 0x00A9, 0x00AA, 0x00AB, 0x00AC, 0x0123, 0x0209, 0x020A, 0x020B, 0x040E, 0x040F, 0x05C3, 0x05C4, 0x05C5, 0x05C6, 0x05C7, 0x05C8, 0x05C9, 0x05CA};
-    for (unsigned i = 0; i < sizeof(readOnlyRegs) / sizeof(uint16_t); ++i)
-        if (address == readOnlyRegs[i])
-        {
-            fromChip = true;
-            break;
-        }
+    //inside batch register cache is used for read-modify-write even if caching is disabled
+    fromChip |= !useCache && mBatchDepth == 0;
+    if (mRegistersMap->GetFlags(address) & LMS7002M_RegistersMap::VOLATILE)
+        fromChip = true;
     if (!controlPort || fromChip == false)
     {
         if (status && !controlPort)
@@ -1913,11 +1962,15 @@ uint16_t LMS7002M::SPI_read(uint16_t address, bool fromChip, int *status)
         int st;
         if(address == 0x0640 || address == 0x0641)
         {
+            const int batchDepth = mBatchDepth;
+            FlushBatch();
+            mBatchDepth = 0;
             MCU_BD* mcu = GetMCUControls();
             mcu->RunProcedure(MCU_FUNCTION_GET_PROGRAM_ID);
             if(mcu->WaitForMCU(100) != MCU_ID_CALIBRATIONS_SINGLE_IMAGE)
                 mcu->Program_MCU(mcu_program_lms7_dc_iq_calibration_bin, IConnection::MCU_PROG_MODE::SRAM);
             SPI_write(0x002D, address);
+            mBatchDepth = batchDepth;
             mcu->RunProcedure(8);
             mcu->WaitForMCU(50);
             uint16_t rdVal = SPI_read(0x040B, true, status);
@@ -1958,7 +2011,11 @@ int LMS7002M::SPI_write_batch(const uint16_t* spiAddr, const uint16_t* spiData,
                 continue;
         }
 
-        data.push_back ((1 << 31) | (uint32_t(spiAddr[i]) << 16) | spiData[i]); //msbit 1=SPI write
+        const uint32_t word = (1 << 31) | (uint32_t(spiAddr[i]) << 16) | spiData[i]; //msbit 1=SPI write
+        if (mBatchDepth > 0)
+            AppendBatchWrite(word, mRegistersMap->GetValue(wr0 ? 0 : 1, spiAddr[i]));
+        else
+            data.push_back(word);
         if (wr0) mRegistersMap->SetValue(0, spiAddr[i], spiData[i]);
         if (wr1) mRegistersMap->SetValue(1, spiAddr[i], spiData[i]);
 
@@ -1992,6 +2049,10 @@ int LMS7002M::SPI_read_batch(const uint16_t* spiAddr, uint16_t* spiData, uint16_
         return -1;
     }
 
+    //reads must observe all buffered writes
+    int status = FlushBatch();
+    if (status != 0) return status;
+
     std::vector<uint32_t> dataWr(cnt);
     std::vector<uint32_t> dataRd(cnt);
     for (size_t i = 0; i < cnt; ++i)
@@ -2000,7 +2061,7 @@ int LMS7002M::SPI_read_batch(const uint16_t* spiAddr, uint16_t* spiData, uint16_
     }
 
 
-    int status = controlPort->ReadLMS7002MSPI(dataWr.data(), dataRd.data(), cnt,mdevIndex);
+    status = controlPort->ReadLMS7002MSPI(dataWr.data(), dataRd.data(), cnt,mdevIndex);
     if (status != 0) return status;
 
     int mac = mRegistersMap->GetValue(0, LMS7param(MAC).address) & 0x0003;
@@ -2020,6 +2081,61 @@ int LMS7002M::SPI_read_batch(const uint16_t* spiAddr, uint16_t* spiData, uint16_
     return 0;
 }
 
+void LMS7002M::BeginBatch()
+{
+    ++mBatchDepth;
+}
+
+int LMS7002M::Commit()
+{
+    if (mBatchDepth == 0)
+        return 0;
+    if (--mBatchDepth > 0)
+        return 0;
+    return FlushBatch();
+}
+
+/** @brief Adds SPI write to batch, merging it with preceding write to the same register
+    @param word SPI write word
+    @param previous register value before this write
+*/
+void LMS7002M::AppendBatchWrite(uint32_t word, uint16_t previous)
+{
+    //only directly consecutive writes to the same register are merged, any write
+    //in between (MAC, strobes of other registers) has to observe the old value.
+    //A bit that toggles and returns (e.g. load strobe 0->1->0) prevents merging.
+    if (!mBatchWrites.empty() && (mBatchWrites.back() >> 16) == (word >> 16))
+    {
+        const uint16_t v1 = mBatchWrites.back() & 0xFFFF;
+        const uint16_t v2 = word & 0xFFFF;
+        if (((v1 ^ mBatchPrevious) & (v1 ^ v2)) == 0)
+        {
+            mBatchWrites.back() = word;
+            return;
+        }
+    }
+    mBatchPrevious = previous;
+    mBatchWrites.push_back(word);
+}
+
+/** @brief Sends all buffered writes to chip
+    @return 0-success, other-failure
+*/
+int LMS7002M::FlushBatch()
+{
+    if (mBatchWrites.empty())
+        return 0;
+    std::vector<uint32_t> data;
+    data.swap(mBatchWrites);
+    if (!controlPort)
+    {
+        if (useCache) return 0;
+        lime::error("No device connected");
+        return -1;
+    }
+    return controlPort->WriteLMS7002MSPI(data.data(), data.size(), mdevIndex);
+}
+
 /** @brief Performs registers test by writing known data and confirming readback data
     @return 0-registers test passed, other-failure
 */
@@ -2234,6 +2350,7 @@ bool LMS7002M::IsSynced()
 {
     if (!controlPort || controlPort->IsOpen() == false)
         return false;
+    FlushBatch();
     bool isSynced = true;
     int status;
 
@@ -2262,7 +2379,7 @@ bool LMS7002M::IsSynced()
     for (uint16_t i = 0; i < addrToRead.size(); ++i)
     {
         uint16_t regValue = mRegistersMap->GetValue(0, addrToRead[i]);
-        if(addrToRead[i] <= readOnlyRegisters[sizeof(readOnlyRegisters)/sizeof(uint16_t)-1] && addrToRead[i] >= readOnlyRegisters[0])
+        if(mRegistersMap->GetFlags(addrToRead[i]) & LMS7002M_RegistersMap::READ_ONLY)
         {
             //mask out readonly bits
             for (uint16_t j = 0; j < sizeof(readOnlyRegisters) / sizeof(uint16_t); ++j)
@@ -2301,7 +2418,7 @@ bool LMS7002M::IsSynced()
     for (uint16_t i = 0; i < addrToRead.size(); ++i)
     {
         uint16_t regValue = mRegistersMap->GetValue(1, addrToRead[i]);
-        if(addrToRead[i] <= readOnlyRegisters[sizeof(readOnlyRegisters)/sizeof(uint16_t)-1] && addrToRead[i] >= readOnlyRegisters[0])
+        if(mRegistersMap->GetFlags(addrToRead[i]) & LMS7002M_RegistersMap::READ_ONLY)
         {
             //mask out readonly bits
             for (uint16_t j = 0; j < sizeof(readOnlyRegisters) / sizeof(uint16_t); ++j)
@@ -2666,6 +2783,7 @@ float_type LMS7002M::GetTemperature()
     float Vdiff = Vptat-Vtemp;
     Vdiff /= 3.9;
     float temperature = 50.7+Vdiff;
+    mTemperature = temperature;
     Modify_SPI_Reg_bits(LMS7_MUX_BIAS_OUT, biasMux);
     lime::debug("Vtemp 0x%04X, Vptat 0x%04X, Vdiff = %.2f, temp= %.3f", (reg606 >> 8) & 0xFF, reg606 & 0xFF, Vdiff, temperature);
     return temperature;
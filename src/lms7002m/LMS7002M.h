@@ -14,6 +14,8 @@
 #include <stdarg.h>
 #include <functional>
 #include <vector>
+#include <map>
+#include <tuple>
 
 namespace lime{
 class IConnection;
@@ -153,6 +155,20 @@ public:
     int Modify_SPI_Reg_bits(uint16_t address, uint8_t msb, uint8_t lsb, uint16_t value, bool fromChip = false);
     int SPI_write(uint16_t address, uint16_t data, bool toChip = false);
     uint16_t SPI_read(uint16_t address, bool fromChip = false, int *status = 0);
+
+    /*!
+     * Starts buffering register writes, calls can be nested.
+     * Writes update register cache immediately, but are sent to chip
+     * by the outermost Commit() in as few SPI transactions as possible.
+     * Register reads are served from cache unless fromChip is requested,
+     * reading from chip sends pending writes first.
+     */
+    void BeginBatch();
+    /*!
+     * Ends batch started by BeginBatch()
+     * @return 0-success, other-failure of any buffered write
+     */
+    int Commit();
     int RegistersTest(const char* fileName = "registersTest.txt");
     static const LMS7Parameter* GetParam(const std::string &name);
     ///@}
@@ -160,6 +176,20 @@ public:
     ///@name Transmitter, Receiver calibrations
     int CalibrateRx(float_type bandwidth, const bool useExtLoopback = false);
     int CalibrateTx(float_type bandwidth, const bool useExtLoopback = false);
+
+    ///DC and IQ correction values produced by CalibrateRx()/CalibrateTx()
+    struct CalibrationValues
+    {
+        int16_t dcI;
+        int16_t dcQ;
+        int16_t gainI;
+        int16_t gainQ;
+        int16_t phase;
+    };
+    ///Reads correction values of active channel from chip
+    int GetCalibrationValues(bool tx, CalibrationValues &values);
+    ///Writes correction values of active channel
+    int SetCalibrationValues(bool tx, const CalibrationValues &values);
     ///@}
 
     ///@name Filters tuning
@@ -290,6 +320,13 @@ public:
     int SetFrequencySX(bool tx, float_type freq_Hz, SX_details* output = nullptr);
     int SetFrequencySXWithSpurCancelation(bool tx, float_type freq_Hz, float_type BW);
     bool GetSXLocked(bool tx);
+    /*!
+     * Tunes SX to each of given frequencies and keeps the results, so that later
+     * SetFrequencySX() to any of them is one register write transaction and
+     * lock check instead of VCO tuning. Previous SX frequency is restored.
+     */
+    int PrepareFrequenciesSX(bool tx, const std::vector<float_type> &frequencies);
+    void ClearVCOTuningCache();
     ///VCO modules available for tuning
     enum VCO_Module
     {
@@ -416,6 +453,8 @@ public:
     MCU_BD* GetMCUControls() const;
     void EnableCalibrationByMCU(bool enabled);
     float_type GetTemperature();
+    ///Returns temperature from last GetTemperature() call, NAN if not measured
+    float_type GetLastTemperature() const {return mTemperature;}
 
     enum LogType
     {
@@ -436,6 +475,7 @@ protected:
 
     static const uint16_t readOnlyRegisters[];
     static const uint16_t readOnlyRegistersMasks[];
+    static const uint16_t volatileRegisters[];
 
 
     uint16_t MemorySectionAddresses[MEMORY_SECTIONS_COUNT][2];
@@ -475,6 +515,8 @@ protected:
     int RegistersTestInterval(uint16_t startAddr, uint16_t endAddr, uint16_t pattern, std::stringstream &ss);
     int SPI_write_batch(const uint16_t* spiAddr, const uint16_t* spiData, uint16_t cnt, bool toChip = false);
     int SPI_read_batch(const uint16_t* spiAddr, uint16_t* spiData, uint16_t cnt);
+    void AppendBatchWrite(uint32_t word, uint16_t previous);
+    int FlushBatch();
     int Modify_SPI_Reg_mask(const uint16_t *addr, const uint16_t *masks, const uint16_t *values, uint8_t start, uint8_t stop);
     ///@}
 
@@ -495,6 +537,19 @@ protected:
     IConnection* controlPort;
     unsigned mdevIndex;
     size_t mSelfCalDepth;
+    int mBatchDepth;
+    std::vector<uint32_t> mBatchWrites; //buffered SPI write words
+    uint16_t mBatchPrevious; //register value before last buffered write
+
+    struct VCOTuning
+    {
+        int8_t sel_vco;
+        int16_t csw;
+        float_type temperature; //chip temperature when tuned, NAN if unknown
+    };
+    ///SX tuning results, key: tx, reference clock and frequency in Hz
+    std::map<std::tuple<bool, int64_t, int64_t>, VCOTuning> mVCOTuningCache;
+    float_type mTemperature; //last measured chip temperature, NAN if unknown
     int opt_gain_tbb[2];
     double _cachedRefClockRate;
     int LoadConfigLegacyFile(const char* filename);
@@ -2,7 +2,8 @@
 #include "LMS7002M_parameters.h"
 using namespace lime;
 
-LMS7002M_RegistersMap::LMS7002M_RegistersMap()
+LMS7002M_RegistersMap::LMS7002M_RegistersMap() :
+    mTable(std::make_shared<Table>())
 {
 
 }
@@ -12,11 +13,39 @@ LMS7002M_RegistersMap::~LMS7002M_RegistersMap()
 
 }
 
+const LMS7002M_RegistersMap::Register* LMS7002M_RegistersMap::Find(uint8_t channel, uint16_t address) const
+{
+    if (channel > 1)
+        return nullptr;
+    const auto &pages = mTable->pages[channel];
+    const size_t index = address / PAGE_SIZE;
+    if (index >= pages.size() || !pages[index])
+        return nullptr;
+    return &pages[index]->regs[address % PAGE_SIZE];
+}
+
+/** @brief Returns writable register, unsharing table and page if they are used by copies
+*/
+LMS7002M_RegistersMap::Register &LMS7002M_RegistersMap::Modify(uint8_t channel, uint16_t address)
+{
+    if (mTable.use_count() > 1)
+        mTable = std::make_shared<Table>(*mTable);
+    auto &pages = mTable->pages[channel];
+    const size_t index = address / PAGE_SIZE;
+    if (index >= pages.size())
+        pages.resize(index + 1);
+    if (!pages[index])
+        pages[index] = std::make_shared<Page>(Page());
+    else if (pages[index].use_count() > 1)
+        pages[index] = std::make_shared<Page>(*pages[index]);
+    return pages[index]->regs[address % PAGE_SIZE];
+}
+
 uint16_t LMS7002M_RegistersMap::GetDefaultValue(uint16_t address) const
 {
-    auto iter = mChannelA.find(address);
-    if( iter != mChannelA.end())
-        return iter->second.defaultValue;
+    const Register* reg = Find(0, address);
+    if (reg && (reg->flags & USED))
+        return reg->defaultValue;
     else
         return 0;
 }
@@ -25,24 +54,31 @@ void LMS7002M_RegistersMap::InitializeDefaultValues(const std::vector<const LMS7
 {
     for(auto parameter : parameterList)
     {
-        uint16_t regValue = mChannelA[parameter->address].defaultValue;
-        mChannelA[parameter->address].defaultValue = regValue | (parameter->defaultValue << parameter->lsb);
-        mChannelA[parameter->address].value = mChannelA[parameter->address].defaultValue;
+        Register &regA = Modify(0, parameter->address);
+        regA.flags |= USED;
+        regA.defaultValue |= (parameter->defaultValue << parameter->lsb);
+        regA.value = regA.defaultValue;
         if(parameter->address >= 0x0100)
-            mChannelB[parameter->address].value = mChannelA[parameter->address].value;
+        {
+            Register &regB = Modify(1, parameter->address);
+            regB.flags |= USED;
+            regB.value = regA.value;
+        }
     }
     //add NCO/PHO registers
     const uint16_t addr = 0x0242;
     for (int i = 0; i < 32; ++i)
     {
-        mChannelA[addr + i].defaultValue = 0;
-        mChannelA[addr + i].value = 0;
-        mChannelB[addr + i].defaultValue = 0;
-        mChannelB[addr + i].value = 0;
-        mChannelA[addr + i + 0x0200].defaultValue = 0;
-        mChannelA[addr + i + 0x0200].value = 0;
-        mChannelB[addr + i + 0x0200].defaultValue = 0;
-        mChannelB[addr + i + 0x0200].value = 0;
+        for (int ch = 0; ch < 2; ++ch)
+        {
+            for (uint16_t offset : {0x0000, 0x0200})
+            {
+                Register &reg = Modify(ch, addr + i + offset);
+                reg.flags |= USED;
+                reg.defaultValue = 0;
+                reg.value = 0;
+            }
+        }
     }
 
     //add GFIRS
@@ -57,40 +93,37 @@ void LMS7002M_RegistersMap::InitializeDefaultValues(const std::vector<const LMS7
     {
         for(int i=range.first; i<=range.second; ++i)
         {
-            mChannelA[i].defaultValue = 0;
-            mChannelA[i].value = 0;
-            mChannelB[i].defaultValue = 0;
-            mChannelB[i].value = 0;
-
-            mChannelA[i+0x0200].defaultValue = 0;
-            mChannelA[i+0x0200].value = 0;
-            mChannelB[i+0x0200].defaultValue = 0;
-            mChannelB[i+0x0200].value = 0;
+            for (int ch = 0; ch < 2; ++ch)
+            {
+                for (uint16_t offset : {0x0000, 0x0200})
+                {
+                    Register &reg = Modify(ch, i + offset);
+                    reg.flags |= USED;
+                    reg.defaultValue = 0;
+                    reg.value = 0;
+                }
+            }
         }
     }
 }
 
 void LMS7002M_RegistersMap::SetValue(uint8_t channel, const uint16_t address, const uint16_t value)
 {
-    if(channel == 0)
-        mChannelA[address].value = value;
-    else if(channel == 1)
-        mChannelB[address].value = value;
+    if (channel > 1)
+        return;
+    const Register* reg = Find(channel, address);
+    if (reg && (reg->flags & USED) && reg->value == value)
+        return; //do not unshare page when nothing changes
+    Register &modified = Modify(channel, address);
+    modified.value = value;
+    modified.flags |= USED;
 }
 
 uint16_t LMS7002M_RegistersMap::GetValue(uint8_t channel, uint16_t address) const
 {
-    const std::map<const uint16_t, Register> *regMap(nullptr);
-    if(channel == 0)
-        regMap = &mChannelA;
-    else if(channel == 1)
-        regMap = &mChannelB;
-    else
-        return 0;
-    std::map<const uint16_t, Register>::const_iterator iter;
-    iter = regMap->find(address);
-    if (iter != regMap->end())
-        return iter->second.value;
+    const Register* reg = Find(channel, address);
+    if (reg && (reg->flags & USED))
+        return reg->value;
     else
         return 0;
 }
@@ -98,11 +131,52 @@ uint16_t LMS7002M_RegistersMap::GetValue(uint8_t channel, uint16_t address) cons
 std::vector<uint16_t> LMS7002M_RegistersMap::GetUsedAddresses(const uint8_t channel) const
 {
     std::vector<uint16_t> addresses;
-    if(channel == 0)
-        for(auto iter : mChannelA)
-            addresses.push_back(iter.first);
-    else if(channel == 1)
-        for(auto iter : mChannelB)
-            addresses.push_back(iter.first);
+    if (channel > 1)
+        return addresses;
+    const auto &pages = mTable->pages[channel];
+    for (size_t p = 0; p < pages.size(); ++p)
+    {
+        if (!pages[p])
+            continue;
+        for (int i = 0; i < PAGE_SIZE; ++i)
+            if (pages[p]->regs[i].flags & USED)
+                addresses.push_back(p * PAGE_SIZE + i);
+    }
+    return addresses;
+}
+
+std::vector<uint16_t> LMS7002M_RegistersMap::GetChangedAddresses(const uint8_t channel, const LMS7002M_RegistersMap &other) const
+{
+    std::vector<uint16_t> addresses;
+    if (channel > 1)
+        return addresses;
+    const auto &pages = mTable->pages[channel];
+    const auto &otherPages = other.mTable->pages[channel];
+    for (size_t p = 0; p < pages.size(); ++p)
+    {
+        if (!pages[p])
+            continue;
+        //page still shared with the other map, nothing was modified
+        if (p < otherPages.size() && pages[p] == otherPages[p])
+            continue;
+        for (int i = 0; i < PAGE_SIZE; ++i)
+        {
+            const uint16_t address = p * PAGE_SIZE + i;
+            if ((pages[p]->regs[i].flags & USED) && pages[p]->regs[i].value != other.GetValue(channel, address))
+                addresses.push_back(address);
+        }
+    }
     return addresses;
 }
+
+uint16_t LMS7002M_RegistersMap::GetFlags(uint16_t address) const
+{
+    const Register* reg = Find(0, address);
+    return reg ? reg->flags : 0;
+}
+
+void LMS7002M_RegistersMap::SetFlags(uint16_t address, uint16_t flags)
+{
+    Register &reg = Modify(0, address);
+    reg.flags = (reg.flags & USED) | (flags & ~USED);
+}
@@ -2,21 +2,33 @@
 #define LMS7002M_REGISTERS_MAP_H
 
 #include <vector>
-#include <map>
+#include <memory>
 #include <cstdint>
 struct LMS7Parameter;
 namespace lime{
 
 
+/** @brief Local copy of LMS7002M registers
 
+    Registers are kept in flat pages indexed by address, only pages containing
+    used addresses are allocated. Copies share the pages and a page is
+    duplicated only when it is modified, so copying the whole map is O(1).
+*/
 class LMS7002M_RegistersMap
 {
 public:
+    enum Flags
+    {
+        USED = 1,      ///<register is part of the map
+        READ_ONLY = 2, ///<register contains read only bits
+        VOLATILE = 4,  ///<value is changed by chip, must be read from chip
+    };
+
     struct Register
     {
         uint16_t value;
         uint16_t defaultValue;
-        uint16_t mask;
+        uint16_t flags;
     };
 
     LMS7002M_RegistersMap();
@@ -28,17 +40,28 @@ public:
     void InitializeDefaultValues(const std::vector<const LMS7Parameter*> parameterList);
     uint16_t GetDefaultValue(uint16_t address) const;
     std::vector<uint16_t> GetUsedAddresses(const uint8_t channel) const;
+    //! @brief Returns used addresses whose values differ from other map
+    std::vector<uint16_t> GetChangedAddresses(const uint8_t channel, const LMS7002M_RegistersMap &other) const;
 
-    LMS7002M_RegistersMap &operator=(const LMS7002M_RegistersMap &other)
-    {
-        mChannelA.insert(other.mChannelA.begin(), other.mChannelA.end());
-        mChannelB.insert(other.mChannelB.begin(), other.mChannelB.end());
-        return *this;
-    }
+    //! @brief Flags are property of address and are common for both channels
+    uint16_t GetFlags(uint16_t address) const;
+    void SetFlags(uint16_t address, uint16_t flags);
 
 protected:
-    std::map<const uint16_t, Register> mChannelA;
-    std::map<const uint16_t, Register> mChannelB;
+    static const int PAGE_SIZE = 64;
+    struct Page
+    {
+        Register regs[PAGE_SIZE];
+    };
+    struct Table
+    {
+        std::vector<std::shared_ptr<Page> > pages[2];
+    };
+
+    const Register* Find(uint8_t channel, uint16_t address) const;
+    Register &Modify(uint8_t channel, uint16_t address);
+
+    std::shared_ptr<Table> mTable;
 };
 
 }
@@ -391,6 +391,66 @@ int LMS7002M::CalibrateRx(float_type bandwidth_Hz, bool useExtLoopback)
     return 0;
 }
 
+/** @brief Reads DC offset and IQ correction values of active channel
+    @param tx Transmitter or receiver corrections
+    @param values read values
+    @return 0-success, other-failure
+*/
+int LMS7002M::GetCalibrationValues(bool tx, CalibrationValues &values)
+{
+    uint8_t ch = (uint8_t)Get_SPI_Reg_bits(LMS7_MAC);
+    if(ch == 0 || ch == 3)
+        return ReportError(EINVAL, "Incorrect channel selection MAC %i", ch);
+    const bool chB = (ch == 2);
+    if (tx)
+    {
+        values.dcI = ReadAnalogDC(this, chB ? LMS7_DC_TXBI : LMS7_DC_TXAI);
+        values.dcQ = ReadAnalogDC(this, chB ? LMS7_DC_TXBQ : LMS7_DC_TXAQ);
+        values.gainI = Get_SPI_Reg_bits(LMS7_GCORRI_TXTSP, true);
+        values.gainQ = Get_SPI_Reg_bits(LMS7_GCORRQ_TXTSP, true);
+        values.phase = signextIqCorr(Get_SPI_Reg_bits(LMS7_IQCORR_TXTSP, true));
+    }
+    else
+    {
+        values.dcI = ReadAnalogDC(this, chB ? LMS7_DC_RXBI : LMS7_DC_RXAI);
+        values.dcQ = ReadAnalogDC(this, chB ? LMS7_DC_RXBQ : LMS7_DC_RXAQ);
+        values.gainI = Get_SPI_Reg_bits(LMS7_GCORRI_RXTSP, true);
+        values.gainQ = Get_SPI_Reg_bits(LMS7_GCORRQ_RXTSP, true);
+        values.phase = signextIqCorr(Get_SPI_Reg_bits(LMS7_IQCORR_RXTSP, true));
+    }
+    return 0;
+}
+
+/** @brief Writes DC offset and IQ correction values of active channel
+    @param tx Transmitter or receiver corrections
+    @param values correction values, as returned by GetCalibrationValues()
+    @return 0-success, other-failure
+*/
+int LMS7002M::SetCalibrationValues(bool tx, const CalibrationValues &values)
+{
+    uint8_t ch = (uint8_t)Get_SPI_Reg_bits(LMS7_MAC);
+    if(ch == 0 || ch == 3)
+        return ReportError(EINVAL, "Incorrect channel selection MAC %i", ch);
+    const bool chB = (ch == 2);
+    if (tx)
+    {
+        WriteAnalogDC(this, chB ? LMS7_DC_TXBI : LMS7_DC_TXAI, values.dcI);
+        WriteAnalogDC(this, chB ? LMS7_DC_TXBQ : LMS7_DC_TXAQ, values.dcQ);
+        Modify_SPI_Reg_bits(LMS7_GCORRI_TXTSP, values.gainI);
+        Modify_SPI_Reg_bits(LMS7_GCORRQ_TXTSP, values.gainQ);
+        Modify_SPI_Reg_bits(LMS7_IQCORR_TXTSP, values.phase);
+    }
+    else
+    {
+        WriteAnalogDC(this, chB ? LMS7_DC_RXBI : LMS7_DC_RXAI, values.dcI);
+        WriteAnalogDC(this, chB ? LMS7_DC_RXBQ : LMS7_DC_RXAQ, values.dcQ);
+        Modify_SPI_Reg_bits(LMS7_GCORRI_RXTSP, values.gainI);
+        Modify_SPI_Reg_bits(LMS7_GCORRQ_RXTSP, values.gainQ);
+        Modify_SPI_Reg_bits(LMS7_IQCORR_RXTSP, values.phase);
+    }
+    return 0;
+}
+
 /** @brief Loads given DC_REG values into registers
     @param tx TxTSP or RxTSP selection
     @param I DC_REG I value
@@ -398,6 +458,7 @@ int LMS7002M::CalibrateRx(float_type bandwidth_Hz, bool useExtLoopback)
 */
 int LMS7002M::LoadDC_REG_IQ(bool tx, int16_t I, int16_t Q)
 {
+    BeginBatch();
     if(tx)
     {
         Modify_SPI_Reg_bits(LMS7_DC_REG_TXTSP, I);
@@ -420,5 +481,5 @@ int LMS7002M::LoadDC_REG_IQ(bool tx, int16_t I, int16_t Q)
         Modify_SPI_Reg_bits(LMS7_TSGDCLDQ_RXTSP, 1);
         Modify_SPI_Reg_bits(LMS7_TSGDCLDQ_RXTSP, 0);
     }
-    return 0;
+    return Commit();
 }
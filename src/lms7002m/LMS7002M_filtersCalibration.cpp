@@ -46,19 +46,18 @@ void LMS7002M::RestoreRegisterMap(LMS7002M_RegistersMap *backup)
     //RestoreAllRegisters(); return;
     Channel chBck = this->GetActiveChannel();
 
+    BeginBatch();
     for (int ch = 0; ch < 2; ch++)
     {
         //determine addresses that have been changed
         //and restore backup to the main register map
         std::vector<uint16_t> restoreAddrs, restoreData;
-        for (const uint16_t addr : mRegistersMap->GetUsedAddresses(ch))
+        for (const uint16_t addr : mRegistersMap->GetChangedAddresses(ch, *backup))
         {
             uint16_t original = backup->GetValue(ch, addr);
-            uint16_t current = mRegistersMap->GetValue(ch, addr);
             mRegistersMap->SetValue(ch, addr, original);
 
             if (ch == 1 and addr < 0x0100) continue;
-            if (original == current) continue;
             restoreAddrs.push_back(addr);
             restoreData.push_back(original);
         }
@@ -72,6 +71,7 @@ void LMS7002M::RestoreRegisterMap(LMS7002M_RegistersMap *backup)
     delete backup;
     backup = nullptr;
     this->SetActiveChannel(chBck);
+    Commit();
 }
 
 int LMS7002M::TuneRxFilter(float_type rx_lpf_freq_RF)
@@ -14,11 +14,16 @@ using namespace std;
 #include <assert.h>
 #include <thread>
 #include <list>
+#include <mutex>
 #include "LMS7002M.h"
 #include "Logger.h"
 
 using namespace lime;
 
+//programming sequence is split into numbered packets, chips being
+//calibrated concurrently must not interleave them
+static std::mutex programmingLock;
+
 MCU_BD::MCU_BD()
 {
     mLoadedProgramFilename = "";
@@ -583,6 +588,7 @@ int MCU_BD::Program_MCU(const uint8_t* buffer, const IConnection::MCU_PROG_MODE
     if(!m_serPort)
         return ReportError(ENOLINK, "Device not connected");
 
+    std::lock_guard<std::mutex> lock(programmingLock);
     if (byte_array_size <= 8192)
         return m_serPort->ProgramMCU(buffer, byte_array_size, mode, callback);
 #ifndef NDEBUG
@@ -39,21 +39,19 @@ static int convertStatus(const int &status, const LMS64CProtocol::GenericPacket
     return ReportError(EPROTO, status2string(pkt.status));
 }
 
-LMS64CProtocol::LMS64CProtocol(void)
+LMS64CProtocol::LMS64CProtocol(void) :
+    mControlPipelineDepth(1),
+    mAsyncQueued(0),
+    mAsyncDone(0),
+    mAsyncStop(false)
 {
     //set a sane-default for the rate
     _cachedRefClockRate = 61.44e6/2;
-#ifdef REMOTE_CONTROL
-    InitRemote();
-#endif
-
 }
 
 LMS64CProtocol::~LMS64CProtocol(void)
 {
-#ifdef REMOTE_CONTROL
-    CloseRemote();
-#endif
+    StopAsyncControl();
     return;
 }
 
@@ -125,6 +123,7 @@ int LMS64CProtocol::ReadI2C(const int addr, const size_t numBytes, std::string &
  **********************************************************************/
 int LMS64CProtocol::WriteLMS7002MSPI(const uint32_t *writeData, size_t size, unsigned periphID)
 {
+    WaitAsyncIdle();
     GenericPacket pkt;
     pkt.cmd = CMD_LMS7002_WR;
     pkt.periphID = periphID;
@@ -145,6 +144,7 @@ int LMS64CProtocol::WriteLMS7002MSPI(const uint32_t *writeData, size_t size, uns
 
 int LMS64CProtocol::ReadLMS7002MSPI(const uint32_t *writeData, uint32_t *readData, size_t size, unsigned periphID)
 {
+    WaitAsyncIdle();
     GenericPacket pkt;
     pkt.cmd = CMD_LMS7002_RD;
     pkt.periphID = periphID;
@@ -236,6 +236,7 @@ int LMS64CProtocol::ReadADF4002SPI(const uint32_t *writeData, uint32_t *readData
  **********************************************************************/
 int LMS64CProtocol::WriteRegisters(const uint32_t *addrs, const uint32_t *data, const size_t size)
 {
+    WaitAsyncIdle();
     GenericPacket pkt;
     pkt.cmd = CMD_BRDSPI_WR;
     for (size_t i = 0; i < size; ++i)
@@ -253,6 +254,7 @@ int LMS64CProtocol::WriteRegisters(const uint32_t *addrs, const uint32_t *data,
 
 int LMS64CProtocol::ReadRegisters(const uint32_t *addrs, uint32_t *data, const size_t size)
 {
+    WaitAsyncIdle();
     GenericPacket pkt;
     pkt.cmd = CMD_BRDSPI_RD;
     for (size_t i = 0; i < size; ++i)
@@ -274,6 +276,161 @@ int LMS64CProtocol::ReadRegisters(const uint32_t *addrs, uint32_t *data, const s
     return convertStatus(status, pkt);
 }
 
+/***********************************************************************
+ * Asynchronous register access
+ **********************************************************************/
+std::future<int> LMS64CProtocol::WriteRegistersAsync(const uint32_t *addrs, const uint32_t *data, const size_t size)
+{
+    AsyncRequest request;
+    request.type = ASYNC_BRDSPI_WR;
+    request.periphID = 0;
+    request.addrs.assign(addrs, addrs+size);
+    request.data.assign(data, data+size);
+    request.readData = nullptr;
+    return EnqueueAsync(request);
+}
+
+std::future<int> LMS64CProtocol::ReadRegistersAsync(const uint32_t *addrs, uint32_t *data, const size_t size)
+{
+    AsyncRequest request;
+    request.type = ASYNC_BRDSPI_RD;
+    request.periphID = 0;
+    request.addrs.assign(addrs, addrs+size);
+    request.readData = data;
+    return EnqueueAsync(request);
+}
+
+std::future<int> LMS64CProtocol::WriteLMS7002MSPIAsync(const uint32_t *writeData, size_t size, unsigned periphID)
+{
+    AsyncRequest request;
+    request.type = ASYNC_LMS7002_WR;
+    request.periphID = periphID;
+    request.addrs.assign(writeData, writeData+size);
+    request.readData = nullptr;
+    return EnqueueAsync(request);
+}
+
+std::future<int> LMS64CProtocol::ReadLMS7002MSPIAsync(const uint32_t *writeData, uint32_t *readData, size_t size, unsigned periphID)
+{
+    AsyncRequest request;
+    request.type = ASYNC_LMS7002_RD;
+    request.periphID = periphID;
+    request.addrs.assign(writeData, writeData+size);
+    request.readData = readData;
+    return EnqueueAsync(request);
+}
+
+std::future<int> LMS64CProtocol::EnqueueAsync(AsyncRequest &request)
+{
+    std::future<int> result = request.result.get_future();
+    std::lock_guard<std::mutex> lock(mAsyncLock);
+    if (mAsyncStop)
+    {
+        request.result.set_value(ReportError(ENOTCONN, "connection is closing"));
+        return result;
+    }
+    if (!mAsyncThread.joinable())
+        mAsyncThread = std::thread(&LMS64CProtocol::AsyncControlLoop, this);
+    mAsyncQueue.push_back(std::move(request));
+    ++mAsyncQueued;
+    mAsyncWork.notify_one();
+    return result;
+}
+
+void LMS64CProtocol::FlushAsync()
+{
+    std::unique_lock<std::mutex> lock(mAsyncLock);
+    const uint64_t target = mAsyncQueued;
+    mAsyncIdle.wait(lock, [this, target]{return mAsyncDone >= target;});
+}
+
+/** Keeps synchronous calls ordered after the requests queued before them.
+    Requests queued later do not delay the caller, so steady async traffic
+    can not starve it. Control thread itself passes through.
+*/
+void LMS64CProtocol::WaitAsyncIdle()
+{
+    std::unique_lock<std::mutex> lock(mAsyncLock);
+    if (std::this_thread::get_id() == mAsyncThread.get_id())
+        return;
+    const uint64_t target = mAsyncQueued;
+    mAsyncIdle.wait(lock, [this, target]{return mAsyncDone >= target;});
+}
+
+void LMS64CProtocol::StopAsyncControl()
+{
+    {
+        std::lock_guard<std::mutex> lock(mAsyncLock);
+        mAsyncStop = true;
+        mAsyncWork.notify_one();
+    }
+    if (mAsyncThread.joinable())
+        mAsyncThread.join();
+}
+
+void LMS64CProtocol::AsyncControlLoop()
+{
+    std::unique_lock<std::mutex> lock(mAsyncLock);
+    for (;;)
+    {
+        mAsyncWork.wait(lock, [this]{return !mAsyncQueue.empty() || mAsyncStop;});
+        if (mAsyncQueue.empty())
+            return;
+        std::deque<AsyncRequest> requests;
+        requests.swap(mAsyncQueue);
+        lock.unlock();
+        const size_t total = requests.size();
+        while (!requests.empty())
+        {
+            //merge run of requests that can share one transaction
+            size_t count = 1;
+            while (count < requests.size() && requests[count].type == requests[0].type
+                && requests[count].periphID == requests[0].periphID)
+                ++count;
+            ExecuteAsync(requests, count);
+        }
+        lock.lock();
+        mAsyncDone += total;
+        mAsyncIdle.notify_all();
+    }
+}
+
+void LMS64CProtocol::ExecuteAsync(std::deque<AsyncRequest> &requests, size_t count)
+{
+    const AsyncRequestType type = requests[0].type;
+    const unsigned periphID = requests[0].periphID;
+    std::vector<uint32_t> addrs;
+    std::vector<uint32_t> data;
+    for (size_t i = 0; i < count; ++i)
+    {
+        addrs.insert(addrs.end(), requests[i].addrs.begin(), requests[i].addrs.end());
+        if (type == ASYNC_BRDSPI_WR)
+            data.insert(data.end(), requests[i].data.begin(), requests[i].data.end());
+    }
+    if (type == ASYNC_BRDSPI_RD || type == ASYNC_LMS7002_RD)
+        data.resize(addrs.size(), 0);
+
+    int status = 0;
+    if (!addrs.empty()) switch (type)
+    {
+    case ASYNC_BRDSPI_WR: status = this->WriteRegisters(addrs.data(), data.data(), addrs.size()); break;
+    case ASYNC_BRDSPI_RD: status = this->ReadRegisters(addrs.data(), data.data(), addrs.size()); break;
+    case ASYNC_LMS7002_WR: status = this->WriteLMS7002MSPI(addrs.data(), addrs.size(), periphID); break;
+    case ASYNC_LMS7002_RD: status = this->ReadLMS7002MSPI(addrs.data(), data.data(), addrs.size(), periphID); break;
+    }
+
+    size_t pos = 0;
+    for (size_t i = 0; i < count; ++i)
+    {
+        AsyncRequest &request = requests.front();
+        if (request.readData)
+            std::copy(data.begin()+pos, data.begin()+pos+request.addrs.size(), request.readData);
+        pos += request.addrs.size();
+        request.result.set_value(status);
+        requests.pop_front();
+    }
+}
+
 /***********************************************************************
  * Device Information
  **********************************************************************/
@@ -386,13 +543,13 @@ int LMS64CProtocol::TransferPacket(GenericPacket& pkt)
         packetLen = 0;
         return ReportError("Unknown protocol type %d", int(protocol));
     }
-    int outLen = 0;
-    unsigned char* outBuffer = NULL;
-    outBuffer = PreparePacket(pkt, outLen, protocol);
-    unsigned char* inBuffer = new unsigned char[outLen];
+    int outLen = PreparePacket(pkt, mOutBuffer, protocol);
+    if (int(mInBuffer.size()) < std::max(outLen, 1))
+        mInBuffer.resize(std::max(outLen, 1));
+    unsigned char* const outBuffer = mOutBuffer.data();
+    unsigned char* const inBuffer = mInBuffer.data();
     memset(inBuffer, 0, outLen);
 
-    int outBufPos = 0;
     int inDataPos = 0;
     if(outLen == 0)
         outLen = 1;
@@ -440,49 +597,54 @@ int LMS64CProtocol::TransferPacket(GenericPacket& pkt)
     }
     else
     {
-        for(int i=0; i<outLen; i+=packetLen)
+        //keep up to mControlPipelineDepth packets in flight, replies come in order
+        const int packetCount = (outLen + packetLen - 1) / packetLen;
+        const int depth = std::max(mControlPipelineDepth, 1);
+        int sent = 0;
+        int received = 0;
+        while (received < packetCount && status == 0)
         {
-            int bytesToSend = packetLen;
-            if (callback_logData)
-                callback_logData(true, &outBuffer[outBufPos], bytesToSend);
-            if( Write(&outBuffer[outBufPos], bytesToSend) )
+            while (sent < packetCount && sent - received < depth)
             {
-                outBufPos += packetLen;
-                long readLen = packetLen;
-                int bread = Read(&inBuffer[inDataPos], readLen);
-                if(bread != readLen && protocol != LMS_PROTOCOL_NOVENA)
+                unsigned char* const pktOut = &outBuffer[sent*packetLen];
+                if (callback_logData)
+                    callback_logData(true, pktOut, packetLen);
+                if (!Write(pktOut, packetLen))
                 {
-                    status = ReportError(EIO, "Read(%d bytes) failed", (int)readLen);
+                    status = ReportError(EIO, "Write(%d bytes) failed", (int)packetLen);
                     break;
                 }
-                if (callback_logData)
-                    callback_logData(false, &inBuffer[inDataPos], bread);
-                inDataPos += bread;
+                ++sent;
             }
-            else
+            if (received == sent)
+                break;
+            int bread = Read(&inBuffer[inDataPos], packetLen);
+            if(bread != packetLen)
             {
-                status = ReportError(EIO, "Write(%d bytes) failed", (int)bytesToSend);
+                status = ReportError(EIO, "Read(%d bytes) failed", (int)packetLen);
                 break;
             }
+            if (callback_logData)
+                callback_logData(false, &inBuffer[inDataPos], bread);
+            inDataPos += bread;
+            ++received;
         }
         ParsePacket(pkt, inBuffer, inDataPos, protocol);
     }
-    delete[] outBuffer;
-    delete[] inBuffer;
     return convertStatus(status, pkt);
 }
 
 /** @brief Takes generic packet and converts to specific protocol buffer
     @param pkt generic data packet to convert
-    @param length returns length of returned buffer
+    @param buffer destination buffer, resized as needed
     @param protocol which protocol to use for data
-    @return pointer to data buffer, must be manually deleted after use
+    @return length of data in buffer
 */
-unsigned char* LMS64CProtocol::PreparePacket(const GenericPacket& pkt, int& length, const eLMS_PROTOCOL protocol)
+int LMS64CProtocol::PreparePacket(const GenericPacket& pkt, std::vector<unsigned char> &buffer, const eLMS_PROTOCOL protocol)
 {
-    unsigned char* buffer = NULL;
+    int length = 0;
     if(protocol == LMS_PROTOCOL_UNDEFINED)
-        return NULL;
+        return 0;
 
     if(protocol == LMS_PROTOCOL_LMS64C)
     {
@@ -530,8 +692,7 @@ unsigned char* LMS64CProtocol::PreparePacket(const GenericPacket& pkt, int& leng
         bufLen *= packet.pktLength;
         if(bufLen == 0)
             bufLen = packet.pktLength;
-        buffer = new unsigned char[bufLen];
-        memset(buffer, 0, bufLen);
+        buffer.assign(bufLen, 0);
         unsigned int srcPos = 0;
         for(int j=0; j*packet.pktLength<bufLen; ++j)
         {
@@ -557,7 +718,7 @@ unsigned char* LMS64CProtocol::PreparePacket(const GenericPacket& pkt, int& leng
     {
         if(pkt.cmd == CMD_LMS7002_RST)
         {
-            buffer = new unsigned char[8];
+            buffer.resize(8);
             buffer[0] = 0x88;
             buffer[1] = 0x06;
             buffer[2] = 0x00;
@@ -570,8 +731,7 @@ unsigned char* LMS64CProtocol::PreparePacket(const GenericPacket& pkt, int& leng
         }
         else
         {
-            buffer = new unsigned char[pkt.outBuffer.size()];
-            memcpy(buffer, &pkt.outBuffer[0], pkt.outBuffer.size());
+            buffer.assign(pkt.outBuffer.begin(), pkt.outBuffer.end());
             if (pkt.cmd == CMD_LMS7002_WR)
             {
                 for(size_t i=0; i<pkt.outBuffer.size(); i+=4)
@@ -580,7 +740,7 @@ unsigned char* LMS64CProtocol::PreparePacket(const GenericPacket& pkt, int& leng
             length = pkt.outBuffer.size();
         }
     }
-    return buffer;
+    return length;
 }
 
 /** @brief Parses given data buffer into generic packet
@@ -10,9 +10,14 @@
 #include <LMS64CCommands.h>
 #include <LMSBoards.h>
 #include <thread>
+#include <future>
+#include <deque>
+#include <condition_variable>
 
 namespace lime{
 
+class RemoteControlServer;
+
 /*!
  * Implement the LMS64CProtocol.
  * The LMS64CProtocol is an IConnection that implements
@@ -46,6 +51,22 @@ public:
     //! ReadRegisters (BRDSPI) implemented by LMS64C
     int ReadRegisters(const uint32_t *addrs, uint32_t *data, const size_t size);
 
+    /*!
+     * Asynchronous register access. Requests are executed in order by the
+     * control thread of the connection, consecutive requests of the same kind
+     * are merged into a single multi-packet transaction. Write data is copied,
+     * read buffers must stay valid until the returned future is ready.
+     * Synchronous register access waits for requests queued before it.
+     * @return future of the status that the synchronous call would return
+     */
+    std::future<int> WriteRegistersAsync(const uint32_t *addrs, const uint32_t *data, const size_t size);
+    std::future<int> ReadRegistersAsync(const uint32_t *addrs, uint32_t *data, const size_t size);
+    std::future<int> WriteLMS7002MSPIAsync(const uint32_t *writeData, size_t size, unsigned periphID = 0);
+    std::future<int> ReadLMS7002MSPIAsync(const uint32_t *writeData, uint32_t *readData, size_t size, unsigned periphID = 0);
+
+    //! Waits until asynchronous requests queued so far are completed
+    void FlushAsync();
+
     /// Supported connection types.
     enum eConnectionType
     {
@@ -186,14 +207,16 @@ public:
     int WriteLMS7002MSPI(const uint32_t *writeData, size_t size,unsigned periphID = 0) override;
     int ReadLMS7002MSPI(const uint32_t *writeData, uint32_t *readData, size_t size, unsigned periphID = 0) override;
 protected:
-#ifdef REMOTE_CONTROL
-    void InitRemote();
-    void CloseRemote();
-    void ProcessConnections();
-    bool remoteOpen;
-    int socketFd;
-    std::thread remoteThread;
-#endif
+    //! Completes queued asynchronous requests and stops the control thread,
+    //! derived connections call it before closing the device
+    void StopAsyncControl();
+
+    //! number of 64 byte packets written ahead of reading their replies,
+    //! transports that buffer requests and replies in order may raise it
+    //! (Xillybus pipes, remote connection), USB control endpoints keep 1
+    int mControlPipelineDepth;
+    //! forwards packets of remote clients as they are
+    friend class RemoteControlServer;
 private:
     int WriteSi5351I2C(const std::string &data);
     int ReadSi5351I2C(const size_t numBytes, std::string &data);
@@ -201,9 +224,42 @@ private:
     int WriteADF4002SPI(const uint32_t *writeData, const size_t size);
     int ReadADF4002SPI(const uint32_t *writeData, uint32_t *readData, const size_t size);
 
-    unsigned char* PreparePacket(const GenericPacket &pkt, int &length, const eLMS_PROTOCOL protocol);
+    int PreparePacket(const GenericPacket &pkt, std::vector<unsigned char> &buffer, const eLMS_PROTOCOL protocol);
     int ParsePacket(GenericPacket &pkt, const unsigned char* buffer, const int length, const eLMS_PROTOCOL protocol);
     std::mutex mControlPortLock;
+    std::vector<unsigned char> mOutBuffer; //reused by TransferPacket, guarded by mControlPortLock
+    std::vector<unsigned char> mInBuffer;
     double _cachedRefClockRate;
+
+    enum AsyncRequestType
+    {
+        ASYNC_BRDSPI_WR,
+        ASYNC_BRDSPI_RD,
+        ASYNC_LMS7002_WR,
+        ASYNC_LMS7002_RD,
+    };
+
+    struct AsyncRequest
+    {
+        AsyncRequestType type;
+        unsigned periphID;
+        std::vector<uint32_t> addrs; //BRDSPI addresses or LMS7002M SPI words
+        std::vector<uint32_t> data;  //BRDSPI write values
+        uint32_t* readData;
+        std::promise<int> result;
+    };
+
+    std::future<int> EnqueueAsync(AsyncRequest &request);
+    void AsyncControlLoop();
+    void ExecuteAsync(std::deque<AsyncRequest> &requests, size_t count);
+    void WaitAsyncIdle();
+    std::thread mAsyncThread;
+    std::mutex mAsyncLock;
+    std::condition_variable mAsyncWork;
+    std::condition_variable mAsyncIdle;
+    std::deque<AsyncRequest> mAsyncQueue;
+    uint64_t mAsyncQueued; //requests queued since start
+    uint64_t mAsyncDone;   //requests completed since start, in queue order
+    bool mAsyncStop;
 };
 }
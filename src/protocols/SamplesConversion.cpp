@@ -0,0 +1,91 @@
+/**
+@file SamplesConversion.cpp
+@author Lime Microsystems
+@brief Conversion between integer and floating point sample formats
+*/
+
+#include "SamplesConversion.h"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define LIME_CONVERSION_SSE2
+#include <emmintrin.h>
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#define LIME_CONVERSION_NEON
+#include <arm_neon.h>
+#endif
+
+namespace lime
+{
+
+static inline int16_t FloatToInt16(const float value)
+{
+    if (value >= 32767.0f)
+        return 32767;
+    if (value <= -32768.0f)
+        return -32768;
+    return int16_t(value);
+}
+
+void ConvertToFloat32(complex32f_t* dest, const complex16_t* src, uint32_t count, float fullScale)
+{
+    const float scale = 1.0f/fullScale;
+    const int16_t* in = (const int16_t*)src;
+    float* out = (float*)dest;
+    const uint32_t values = 2*count;
+    uint32_t i = 0;
+#if defined(LIME_CONVERSION_SSE2)
+    const __m128 vscale = _mm_set1_ps(scale);
+    for (; i + 8 <= values; i += 8)
+    {
+        const __m128i v = _mm_loadu_si128((const __m128i*)(in + i));
+        //sign extend int16 to int32
+        const __m128i lo = _mm_srai_epi32(_mm_unpacklo_epi16(v, v), 16);
+        const __m128i hi = _mm_srai_epi32(_mm_unpackhi_epi16(v, v), 16);
+        _mm_storeu_ps(out + i, _mm_mul_ps(_mm_cvtepi32_ps(lo), vscale));
+        _mm_storeu_ps(out + i + 4, _mm_mul_ps(_mm_cvtepi32_ps(hi), vscale));
+    }
+#elif defined(LIME_CONVERSION_NEON)
+    const float32x4_t vscale = vdupq_n_f32(scale);
+    for (; i + 8 <= values; i += 8)
+    {
+        const int16x8_t v = vld1q_s16(in + i);
+        vst1q_f32(out + i, vmulq_f32(vcvtq_f32_s32(vmovl_s16(vget_low_s16(v))), vscale));
+        vst1q_f32(out + i + 4, vmulq_f32(vcvtq_f32_s32(vmovl_s16(vget_high_s16(v))), vscale));
+    }
+#endif
+    for (; i < values; ++i)
+        out[i] = in[i]*scale;
+}
+
+void ConvertFromFloat32(complex16_t* dest, const complex32f_t* src, uint32_t count, float fullScale)
+{
+    const float* in = (const float*)src;
+    int16_t* out = (int16_t*)dest;
+    const uint32_t values = 2*count;
+    uint32_t i = 0;
+#if defined(LIME_CONVERSION_SSE2)
+    const __m128 vscale = _mm_set1_ps(fullScale);
+    const __m128 vmax = _mm_set1_ps(32767.0f);
+    const __m128 vmin = _mm_set1_ps(-32768.0f);
+    for (; i + 8 <= values; i += 8)
+    {
+        //clamp before conversion, out of range values would become INT_MIN
+        const __m128 lo = _mm_max_ps(_mm_min_ps(_mm_mul_ps(_mm_loadu_ps(in + i), vscale), vmax), vmin);
+        const __m128 hi = _mm_max_ps(_mm_min_ps(_mm_mul_ps(_mm_loadu_ps(in + i + 4), vscale), vmax), vmin);
+        _mm_storeu_si128((__m128i*)(out + i), _mm_packs_epi32(_mm_cvttps_epi32(lo), _mm_cvttps_epi32(hi)));
+    }
+#elif defined(LIME_CONVERSION_NEON)
+    const float32x4_t vscale = vdupq_n_f32(fullScale);
+    for (; i + 8 <= values; i += 8)
+    {
+        //conversion truncates toward zero and saturates, narrowing saturates to int16
+        const int32x4_t lo = vcvtq_s32_f32(vmulq_f32(vld1q_f32(in + i), vscale));
+        const int32x4_t hi = vcvtq_s32_f32(vmulq_f32(vld1q_f32(in + i + 4), vscale));
+        vst1q_s16(out + i, vcombine_s16(vqmovn_s32(lo), vqmovn_s32(hi)));
+    }
+#endif
+    for (; i < values; ++i)
+        out[i] = FloatToInt16(in[i]*fullScale);
+}
+
+}
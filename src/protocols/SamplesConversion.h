@@ -0,0 +1,35 @@
+/**
+@file SamplesConversion.h
+@author Lime Microsystems
+@brief Conversion between integer and floating point sample formats
+*/
+
+#ifndef LMS_SAMPLES_CONVERSION_H
+#define LMS_SAMPLES_CONVERSION_H
+
+#include "LimeSuiteConfig.h"
+#include "dataTypes.h"
+
+namespace lime
+{
+
+/** @brief Converts integer samples to float, dest = src/fullScale
+    @param dest destination buffer, may not overlap with src
+    @param src source samples
+    @param count number of complex samples
+    @param fullScale integer value corresponding to 1.0f
+*/
+LIME_API void ConvertToFloat32(complex32f_t* dest, const complex16_t* src, uint32_t count, float fullScale);
+
+/** @brief Converts float samples to integer, dest = src*fullScale
+    Values are truncated toward zero and saturated to int16 range.
+    @param dest destination buffer, may not overlap with src
+    @param src source samples
+    @param count number of complex samples
+    @param fullScale integer value corresponding to 1.0f
+*/
+LIME_API void ConvertFromFloat32(complex16_t* dest, const complex32f_t* src, uint32_t count, float fullScale);
+
+}
+
+#endif
@@ -0,0 +1,259 @@
+/**
+@file StreamMemory.cpp
+@author Lime Microsystems
+@brief Pooled page-aligned memory for stream FIFOs and transfer buffers
+*/
+
+#include "StreamMemory.h"
+#include "ThreadScheduling.h"
+#include "Logger.h"
+#include <mutex>
+#include <atomic>
+#include <vector>
+#include <map>
+#include <new>
+#include <string.h>
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <unistd.h>
+#if !defined(MAP_ANONYMOUS) && defined(MAP_ANON)
+#define MAP_ANONYMOUS MAP_ANON
+#endif
+#endif
+
+using namespace lime;
+
+namespace
+{
+
+struct Block
+{
+    void* ptr;
+    size_t size;    //mapped size
+    unsigned flags; //requested flags, used to match cached blocks
+    int node;       //NUMA node of the thread that faulted pages in, -1 if unknown
+    bool locked;
+};
+
+const size_t hugePageSize = 2*1024*1024;
+
+std::mutex poolLock;
+std::map<void*, Block> blocksInUse;
+std::vector<Block> cachedBlocks; //oldest first
+size_t cachedBytes = 0;
+size_t cacheLimit = 256*1024*1024;
+std::atomic<bool> lockWarningShown(false);
+
+size_t PageSize()
+{
+#ifdef _WIN32
+    SYSTEM_INFO info;
+    GetSystemInfo(&info);
+    return info.dwPageSize;
+#else
+    return sysconf(_SC_PAGESIZE);
+#endif
+}
+
+size_t RoundUp(size_t bytes, size_t alignment)
+{
+    return (bytes + alignment - 1) / alignment * alignment;
+}
+
+bool MapBlock(Block &block, size_t bytes)
+{
+    block.locked = false;
+#ifdef _WIN32
+    if (block.flags & StreamMemory::HUGE_PAGES)
+    {
+        //requires SeLockMemoryPrivilege, large pages are always locked
+        const size_t largePage = GetLargePageMinimum();
+        if (largePage)
+        {
+            block.size = RoundUp(bytes, largePage);
+            block.ptr = VirtualAlloc(NULL, block.size, MEM_RESERVE | MEM_COMMIT | MEM_LARGE_PAGES, PAGE_READWRITE);
+            if (block.ptr)
+            {
+                block.locked = true;
+                return true;
+            }
+        }
+    }
+    block.size = RoundUp(bytes, PageSize());
+    block.ptr = VirtualAlloc(NULL, block.size, MEM_RESERVE | MEM_COMMIT, PAGE_READWRITE);
+    return block.ptr != NULL;
+#else
+#ifdef MAP_HUGETLB
+    if (block.flags & StreamMemory::HUGE_PAGES)
+    {
+        block.size = RoundUp(bytes, hugePageSize);
+        block.ptr = mmap(NULL, block.size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+        if (block.ptr != MAP_FAILED)
+            return true;
+    }
+#endif
+    block.size = RoundUp(bytes, (block.flags & StreamMemory::HUGE_PAGES) ? hugePageSize : PageSize());
+    block.ptr = mmap(NULL, block.size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (block.ptr == MAP_FAILED)
+    {
+        block.ptr = nullptr;
+        return false;
+    }
+#ifdef MADV_HUGEPAGE
+    //no reserved huge pages, let the kernel back the block with transparent ones
+    if (block.flags & StreamMemory::HUGE_PAGES)
+        madvise(block.ptr, block.size, MADV_HUGEPAGE);
+#endif
+    return true;
+#endif
+}
+
+void UnmapBlock(const Block &block)
+{
+#ifdef _WIN32
+    if (block.locked)
+        VirtualUnlock(block.ptr, block.size);
+    VirtualFree(block.ptr, 0, MEM_RELEASE);
+#else
+    if (block.locked)
+        munlock(block.ptr, block.size);
+    munmap(block.ptr, block.size);
+#endif
+}
+
+void LockBlock(Block &block)
+{
+    if (block.locked || !(block.flags & StreamMemory::LOCK_PAGES))
+        return;
+#ifdef _WIN32
+    block.locked = VirtualLock(block.ptr, block.size) != 0;
+#else
+    block.locked = mlock(block.ptr, block.size) == 0;
+#endif
+    if (!block.locked && !lockWarningShown.exchange(true))
+    {
+        lime::warning("Failed to lock stream buffers in memory, check memlock limits");
+    }
+}
+
+//must be called with poolLock held
+void TrimCache(size_t limit)
+{
+    while (cachedBytes > limit && !cachedBlocks.empty())
+    {
+        UnmapBlock(cachedBlocks.front());
+        cachedBytes -= cachedBlocks.front().size;
+        cachedBlocks.erase(cachedBlocks.begin());
+    }
+}
+
+}
+
+void* StreamMemory::Allocate(size_t bytes, unsigned flags)
+{
+    if (bytes == 0)
+        return nullptr;
+    //pages stay on the node they were first touched from, so only blocks
+    //faulted in from the node of the calling thread can be reused
+    const int node = GetCurrentNumaNode();
+    Block block;
+    bool cached = false;
+    {
+        std::lock_guard<std::mutex> lock(poolLock);
+        //reuse smallest cached block that fits without wasting more than half of it
+        int best = -1;
+        for (size_t i = 0; i < cachedBlocks.size(); ++i)
+        {
+            const Block &candidate = cachedBlocks[i];
+            if (candidate.flags != flags || candidate.node != node || candidate.size < bytes || candidate.size/2 > bytes)
+                continue;
+            if (best < 0 || candidate.size < cachedBlocks[best].size)
+                best = i;
+        }
+        if (best >= 0)
+        {
+            block = cachedBlocks[best];
+            cachedBlocks.erase(cachedBlocks.begin() + best);
+            cachedBytes -= block.size;
+            blocksInUse[block.ptr] = block;
+            cached = true;
+        }
+    }
+    //memory is cleared without holding the pool lock, so allocations of
+    //other streams do not wait for page faults of this one
+    if (cached)
+    {
+        memset(block.ptr, 0, bytes);
+        return block.ptr;
+    }
+
+    block.flags = flags;
+    block.node = node;
+    if (!MapBlock(block, bytes))
+    {
+        //unused blocks may be holding the memory, drop them and retry once
+        {
+            std::lock_guard<std::mutex> lock(poolLock);
+            TrimCache(0);
+        }
+        if (!MapBlock(block, bytes))
+            return nullptr;
+    }
+    LockBlock(block);
+    //fault all pages in now, from the thread that is going to use them
+    memset(block.ptr, 0, block.size);
+    std::lock_guard<std::mutex> lock(poolLock);
+    blocksInUse[block.ptr] = block;
+    return block.ptr;
+}
+
+void StreamMemory::Release(void* ptr)
+{
+    if (ptr == nullptr)
+        return;
+    std::lock_guard<std::mutex> lock(poolLock);
+    auto iter = blocksInUse.find(ptr);
+    if (iter == blocksInUse.end())
+    {
+        lime::error("StreamMemory: releasing unknown block");
+        return;
+    }
+    cachedBlocks.push_back(iter->second);
+    cachedBytes += iter->second.size;
+    blocksInUse.erase(iter);
+    TrimCache(cacheLimit);
+}
+
+void StreamMemory::Trim()
+{
+    std::lock_guard<std::mutex> lock(poolLock);
+    TrimCache(0);
+}
+
+void StreamMemory::SetCacheLimit(size_t bytes)
+{
+    std::lock_guard<std::mutex> lock(poolLock);
+    cacheLimit = bytes;
+    TrimCache(cacheLimit);
+}
+
+void StreamBuffer::Allocate(size_t bytes, unsigned flags)
+{
+    Free();
+    mData = static_cast<char*>(StreamMemory::Allocate(bytes, flags));
+    if (mData == nullptr && bytes != 0)
+        throw std::bad_alloc();
+    mSize = bytes;
+}
+
+void StreamBuffer::Free()
+{
+    StreamMemory::Release(mData);
+    mData = nullptr;
+    mSize = 0;
+}
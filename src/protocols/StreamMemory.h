@@ -0,0 +1,75 @@
+/**
+@file StreamMemory.h
+@author Lime Microsystems
+@brief Pooled page-aligned memory for stream FIFOs and transfer buffers
+*/
+
+#ifndef LMS_STREAM_MEMORY_H
+#define LMS_STREAM_MEMORY_H
+
+#include "LimeSuiteConfig.h"
+#include <stddef.h>
+
+namespace lime
+{
+
+/** @brief Process wide pool of large streaming buffers
+
+    Blocks are mapped directly from the OS, optionally backed by huge pages
+    and locked in RAM, and are pre-faulted by the allocating thread. Released
+    blocks are kept in the pool and handed out again to allocations of the
+    same kind made from the same NUMA node, so restarting a stream does not
+    fault its memory in again.
+*/
+class LIME_API StreamMemory
+{
+public:
+    enum Flags
+    {
+        HUGE_PAGES = 1, ///<use huge pages if available, transparent huge pages otherwise
+        LOCK_PAGES = 2, ///<lock memory in RAM (mlock/VirtualLock)
+    };
+
+    /** @brief Returns zero filled, page aligned memory
+        @param bytes requested size
+        @param flags combination of Flags
+        @return pointer to memory, nullptr if it could not be allocated
+    */
+    static void* Allocate(size_t bytes, unsigned flags = 0);
+
+    //! @brief Returns memory obtained by Allocate() to the pool
+    static void Release(void* ptr);
+
+    //! @brief Unmaps all blocks that are not currently in use
+    static void Trim();
+
+    //! @brief Sets maximum amount of unused memory kept in the pool
+    static void SetCacheLimit(size_t bytes);
+};
+
+/** @brief Owning handle of a StreamMemory block
+*/
+class LIME_API StreamBuffer
+{
+public:
+    StreamBuffer() : mData(nullptr), mSize(0) {}
+    ~StreamBuffer() {StreamMemory::Release(mData);}
+
+    //! @brief Replaces buffer with a new block, throws std::bad_alloc on failure
+    void Allocate(size_t bytes, unsigned flags = 0);
+    void Free();
+
+    char* data() {return mData;}
+    size_t size() const {return mSize;}
+    char &operator[](size_t i) {return mData[i];}
+    const char &operator[](size_t i) const {return mData[i];}
+private:
+    StreamBuffer(const StreamBuffer&);
+    StreamBuffer &operator=(const StreamBuffer&);
+    char* mData;
+    size_t mSize;
+};
+
+}
+
+#endif
@@ -6,10 +6,20 @@
 #include "Streamer.h"
 #include "IConnection.h"
 #include <complex>
+#include "SamplesConversion.h"
+#include "TransferTuner.h"
+#include "ThreadScheduling.h"
 
 namespace lime
 {
 
+static const int legacyDepth = 16; //transfers in flight before tuning was introduced
+
+static unsigned MemoryFlags(const StreamConfig &config)
+{
+    return (config.hugePages ? StreamMemory::HUGE_PAGES : 0) | (config.lockMemory ? StreamMemory::LOCK_PAGES : 0);
+}
+
 StreamChannel::StreamChannel(Streamer* streamer) :
     mActive(false)
 {
@@ -18,6 +28,7 @@ StreamChannel::StreamChannel(Streamer* streamer) :
     underflow = 0;
     pktLost = 0;
     fifo = nullptr;
+    fifoNode = -1;
     used = false;
 }
 
@@ -43,9 +54,65 @@ void StreamChannel::Setup(StreamConfig conf)
             fifoSize <<= 1;
         this->config.bufferLength = fifoSize*SamplesPacket::maxSamplesInPacket;
     }
+    AllocateFIFO();
+}
+
+void StreamChannel::AllocateFIFO()
+{
     if (fifo)
         delete fifo;
-    fifo = new RingFIFO(config.bufferLength);
+    fifo = nullptr;
+    fifoNode = -1;
+    auto allocate = [this]()
+    {
+        const unsigned memoryFlags = MemoryFlags(config);
+        if (config.fifoType == StreamConfig::FIFO_LOCKFREE)
+            fifo = new LockFreeRingFIFO(config.bufferLength, config.fifoWaitPolicy, memoryFlags);
+        else
+            fifo = new RingFIFO(config.bufferLength, memoryFlags);
+    };
+    if (config.numaLocal && config.cpuAffinity)
+        fifoNode = RunOnCPUs(config.cpuAffinity, allocate);
+    else
+        allocate();
+}
+
+/** @brief Changes streaming thread scheduling options of inactive stream
+    FIFO is reallocated if NUMA local allocation is requested.
+*/
+int StreamChannel::SetScheduling(int priority, uint64_t cpuAffinity, bool numaLocal)
+{
+    if (mActive)
+        return ReportError(EBUSY, "Cannot change scheduling of active stream");
+    const bool reallocate = numaLocal != config.numaLocal || (numaLocal && cpuAffinity != config.cpuAffinity);
+    config.threadPriority = priority;
+    config.cpuAffinity = cpuAffinity;
+    config.numaLocal = numaLocal;
+    if (reallocate)
+        AllocateFIFO();
+    return 0;
+}
+
+/** @brief Changes memory backing of inactive stream, FIFO is reallocated
+*/
+int StreamChannel::SetMemoryOptions(bool hugePages, bool lockMemory)
+{
+    if (mActive)
+        return ReportError(EBUSY, "Cannot change memory options of active stream");
+    if (hugePages == config.hugePages && lockMemory == config.lockMemory)
+        return 0;
+    config.hugePages = hugePages;
+    config.lockMemory = lockMemory;
+    AllocateFIFO();
+    return 0;
+}
+
+StreamChannel::ThreadInfo StreamChannel::GetThreadInfo()
+{
+    std::lock_guard<std::mutex> lock(mStreamer->threadInfoLock);
+    ThreadInfo info = config.isTx ? mStreamer->txThreadInfo : mStreamer->rxThreadInfo;
+    info.fifoNode = fifoNode;
+    return info;
 }
 
 void StreamChannel::Close()
@@ -60,51 +127,271 @@ void StreamChannel::Close()
 
 int StreamChannel::Write(const void* samples, const uint32_t count, const Metadata *meta, const int32_t timeout_ms)
 {
-    int pushed = 0;
     if(config.format == StreamConfig::FMT_FLOAT32 && config.isTx)
     {
-        const float* samplesFloat = (const float*)samples;
-        int16_t* samplesShort = new int16_t[2*count];
-        for(size_t i=0; i<2*count; ++i)
-            samplesShort[i] = samplesFloat[i]*32767.0f;
-        const complex16_t* ptr = (const complex16_t*)samplesShort ;
-        pushed = fifo->push_samples(ptr, count, 1, meta->timestamp, timeout_ms, meta->flags);
-        delete[] samplesShort;
+        //samples are converted while being copied into the FIFO
+        const complex32f_t* ptr = (const complex32f_t*)samples;
+        return fifo->push_samples(ptr, count, 1, meta->timestamp, timeout_ms, meta->flags, config.fullScale);
     }
-    else
-    {
-        const complex16_t* ptr = (const complex16_t*)samples;
-        pushed = fifo->push_samples(ptr, count, 1, meta->timestamp, timeout_ms, meta->flags);
-    }
-    return pushed;
+    const complex16_t* ptr = (const complex16_t*)samples;
+    return fifo->push_samples(ptr, count, 1, meta->timestamp, timeout_ms, meta->flags);
+}
+
+/** @brief Writes whole transfer worth of packets with a single FIFO synchronization
+    Used by streaming threads, samples are in FIFO (int16) format.
+    @param stride distance between packets, in samples
+    @return number of packets written completely
+*/
+int StreamChannel::WritePackets(const complex16_t* samples, const uint32_t stride, const SamplesFIFO::PacketInfo* packets, const uint32_t count, const int32_t timeout_ms)
+{
+    return fifo->push_packets(samples, stride, packets, count, timeout_ms);
+}
+
+/** @brief Reads up to count packets of samplesPerPacket samples with a single
+    FIFO synchronization, stops after end of burst
+    @return number of packets read, last one may be incomplete
+*/
+int StreamChannel::ReadPackets(complex16_t* samples, const uint32_t samplesPerPacket, SamplesFIFO::PacketInfo* packets, const uint32_t count, const int32_t timeout_ms)
+{
+    return fifo->pop_packets(samples, samplesPerPacket, packets, count, timeout_ms);
 }
 
 int StreamChannel::Read(void* samples, const uint32_t count, Metadata* meta, const int32_t timeout_ms)
 {
-    int popped = 0;
+    if (config.zeroCopy && !config.isTx && mStreamer->directRx.active)
+    {
+        StreamChannel* stream = this;
+        return mStreamer->ReadDirect(&stream, &samples, 1, count, meta, timeout_ms);
+    }
     if(config.format == StreamConfig::FMT_FLOAT32 && !config.isTx)
     {
-        //in place conversion
-        complex16_t* ptr = (complex16_t*)samples;
-        int16_t* samplesShort = (int16_t*)samples;
-        float* samplesFloat = (float*)samples;
-        popped = fifo->pop_samples(ptr, count, 1, &meta->timestamp, timeout_ms, &meta->flags);
-        for(int i=2*popped-1; i>=0; --i)
-            samplesFloat[i] = (float)samplesShort[i]/32767.0f;
+        //samples are converted while being copied out of the FIFO
+        complex32f_t* ptr = (complex32f_t*)samples;
+        return fifo->pop_samples(ptr, count, 1, &meta->timestamp, timeout_ms, &meta->flags, config.fullScale);
     }
-    else
+    complex16_t* ptr = (complex16_t*)samples;
+    return fifo->pop_samples(ptr, count, 1, &meta->timestamp, timeout_ms, &meta->flags);
+}
+
+/** @brief Gives direct access to samples stored in the stream FIFO
+    Rx streams return the oldest received samples, Tx streams return free space
+    for samples to be transmitted. Only integer sample formats are supported.
+    @return number of samples available in buffer, 0 on timeout, -1 on error
+*/
+int StreamChannel::AcquireBuffer(void** samples, Metadata* meta, const int32_t timeout_ms)
+{
+    if (config.format == StreamConfig::FMT_FLOAT32)
+        return lime::ReportError(ENOTSUP, "Direct buffer access is not supported for float samples");
+    if (config.isTx)
+        return fifo->acquire_write((complex16_t**)samples, timeout_ms);
+    if (config.zeroCopy && mStreamer->directRx.active)
+        return lime::ReportError(ENOTSUP, "Direct buffer access is not supported for zero-copy Rx streams");
+    return fifo->acquire_read((const complex16_t**)samples, &meta->timestamp, &meta->flags, timeout_ms);
+}
+
+/** @brief Returns buffer obtained by AcquireBuffer()
+    @param count number of samples consumed (Rx) or written (Tx)
+    @param meta timestamp and flags of written samples, used only by Tx streams
+*/
+int StreamChannel::ReleaseBuffer(const uint32_t count, const Metadata* meta)
+{
+    if (config.isTx)
     {
-        complex16_t* ptr = (complex16_t*)samples;
-        popped = fifo->pop_samples(ptr, count, 1, &meta->timestamp, timeout_ms, &meta->flags);
+        fifo->release_write(count, meta ? meta->timestamp : 0, meta ? meta->flags : 0);
+        return 0;
     }
-    return popped;
+    fifo->release_read(count);
+    return 0;
+}
+
+int StreamChannel::ReadAligned(StreamChannel* const* streams, unsigned streamCount, void* const* samples, const uint32_t count, Metadata* meta, const int32_t timeout_ms)
+{
+    if (streamCount == 0)
+        return 0;
+    if (streamCount > maxAlignedStreams)
+        return lime::ReportError(EINVAL, "ReadAligned: too many streams");
+    Streamer* streamer = streams[0]->mStreamer;
+    bool sameStreamer = true;
+    bool fifosEmpty = true;
+    for (unsigned i = 0; i < streamCount; ++i)
+    {
+        if (streams[i]->config.isTx || streams[i]->fifo == nullptr)
+            return lime::ReportError(EINVAL, "ReadAligned: all streams have to be set up Rx streams");
+        if (streams[i]->config.format != streams[0]->config.format)
+            return lime::ReportError(EINVAL, "ReadAligned: all streams have to use the same sample format");
+        sameStreamer &= streams[i]->mStreamer == streamer;
+        fifosEmpty &= streams[i]->fifo->GetInfo().itemsFilled == 0;
+    }
+    const bool toFloat = streams[0]->config.format == StreamConfig::FMT_FLOAT32;
+    const bool hasRequest = (meta->flags & RingFIFO::SYNC_TIMESTAMP) != 0;
+    const uint64_t requested = meta->timestamp;
+
+    //channels of one chip arrive in the same packets, zero-copy read
+    //unpacks them into caller's buffers already aligned
+    if (sameStreamer && fifosEmpty && !hasRequest && streams[0]->config.zeroCopy && streamer->directRx.active)
+        return streamer->ReadDirect(streams, samples, streamCount, count, meta, timeout_ms);
+
+    const complex16_t* heads[maxAlignedStreams];
+    uint64_t timestamps[maxAlignedStreams];
+    uint32_t available[maxAlignedStreams];
+    const auto t1 = std::chrono::high_resolution_clock::now();
+    uint64_t start = 0;
+    uint32_t flags = 0;
+    uint32_t filled = 0;
+
+    while (filled < count && !(flags & RingFIFO::END_BURST))
+    {
+        const int32_t elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::high_resolution_clock::now() - t1).count();
+        const int32_t remaining = std::max(timeout_ms - elapsed, 0);
+
+        //look at head packets of all streams without waiting, so that no
+        //stream is held acquired while waiting for samples of another
+        int empty = -1;
+        for (unsigned i = 0; i < streamCount; ++i)
+        {
+            uint32_t pktFlags = 0;
+            available[i] = streams[i]->fifo->acquire_read(&heads[i], &timestamps[i], &pktFlags, 0);
+            if (available[i] == 0 && empty < 0)
+                empty = i;
+            if (available[i])
+                flags |= pktFlags & RingFIFO::END_BURST;
+        }
+        if (empty >= 0)
+        {
+            for (unsigned i = 0; i < streamCount; ++i)
+                streams[i]->fifo->release_read(0);
+            StreamChannel* stream = streams[empty];
+            bool received;
+            if (stream->config.zeroCopy && stream->mStreamer->directRx.active)
+                received = stream->mStreamer->PumpDirect(remaining);
+            else
+            {
+                const complex16_t* head;
+                received = stream->fifo->acquire_read(&head, nullptr, nullptr, remaining) != 0;
+                stream->fifo->release_read(0);
+            }
+            if (!received)
+                break;
+            continue;
+        }
+
+        uint64_t newest = timestamps[0];
+        for (unsigned i = 1; i < streamCount; ++i)
+            newest = std::max(newest, timestamps[i]);
+        if (filled == 0 && hasRequest)
+            newest = std::max(newest, requested);
+        else if (filled > 0 && newest != start + filled)
+        {
+            //samples were lost, return contiguous block read so far
+            for (unsigned i = 0; i < streamCount; ++i)
+                streams[i]->fifo->release_read(0);
+            break;
+        }
+
+        //drop samples older than the newest head
+        bool aligned = true;
+        uint32_t n = count - filled;
+        for (unsigned i = 0; i < streamCount; ++i)
+        {
+            if (timestamps[i] < newest)
+            {
+                streams[i]->fifo->release_read(std::min<uint64_t>(available[i], newest - timestamps[i]));
+                aligned = false;
+            }
+            n = std::min(n, available[i]);
+        }
+        if (!aligned)
+        {
+            for (unsigned i = 0; i < streamCount; ++i)
+                if (timestamps[i] >= newest)
+                    streams[i]->fifo->release_read(0);
+            continue;
+        }
+
+        for (unsigned i = 0; i < streamCount; ++i)
+        {
+            if (toFloat)
+                ConvertToFloat32((complex32f_t*)samples[i] + filled, heads[i], n, streams[i]->config.fullScale);
+            else
+                memcpy((complex16_t*)samples[i] + filled, heads[i], n*sizeof(complex16_t));
+            streams[i]->fifo->release_read(n);
+        }
+        if (filled == 0)
+            start = newest;
+        filled += n;
+    }
+
+    meta->timestamp = start;
+    meta->flags = filled ? (flags | RingFIFO::SYNC_TIMESTAMP) : 0;
+    return filled;
+}
+
+int StreamChannel::WriteAligned(StreamChannel* const* streams, unsigned streamCount, const void* const* samples, const uint32_t count, const Metadata* meta, const int32_t timeout_ms)
+{
+    for (unsigned i = 0; i < streamCount; ++i)
+        if (!streams[i]->config.isTx || streams[i]->fifo == nullptr)
+            return lime::ReportError(EINVAL, "WriteAligned: all streams have to be set up Tx streams");
+
+    //every stream gets the same timestamp, so Tx threads of all chips
+    //transmit the blocks at the same time. Samples are written in chunks that
+    //fit into every FIFO, so a timeout can't leave one stream ahead of others.
+    //Chunks are whole packets, FIFO contents are the same as with single push.
+    const auto t1 = std::chrono::high_resolution_clock::now();
+    uint32_t written = 0;
+    while (written < count)
+    {
+        uint32_t chunk = count - written;
+        int full = -1;
+        if (!(meta->flags & RingFIFO::OVERWRITE_OLD))
+        {
+            for (unsigned i = 0; i < streamCount; ++i)
+            {
+                const SamplesFIFO::BufferInfo info = streams[i]->fifo->GetInfo();
+                const uint32_t space = info.size - info.itemsFilled;
+                if (space == 0 && full < 0)
+                    full = i;
+                if (space < chunk)
+                    chunk = space;
+            }
+        }
+        if (full >= 0)
+        {
+            const int32_t elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::high_resolution_clock::now() - t1).count();
+            const int32_t remaining = std::max(timeout_ms - elapsed, 0);
+            if (remaining == 0)
+                break;
+            //wait for Tx thread to free a packet, the slot itself is not used
+            complex16_t* slot;
+            if (streams[full]->fifo->acquire_write(&slot, remaining) == 0)
+                break;
+            continue;
+        }
+
+        Metadata chunkMeta = *meta;
+        chunkMeta.timestamp = meta->timestamp + written;
+        if (written + chunk < count) //end of burst belongs to the last packet
+            chunkMeta.flags &= ~RingFIFO::END_BURST;
+        uint32_t chunkWritten = chunk;
+        for (unsigned i = 0; i < streamCount; ++i)
+        {
+            const size_t sampleSize = streams[i]->config.format == StreamConfig::FMT_FLOAT32 ? sizeof(complex32f_t) : sizeof(complex16_t);
+            const int ret = streams[i]->Write((const uint8_t*)samples[i] + written*sampleSize, chunk, &chunkMeta, timeout_ms);
+            if (ret < 0)
+                return ret;
+            chunkWritten = std::min<uint32_t>(chunkWritten, ret);
+        }
+        written += chunkWritten;
+        if (chunkWritten < chunk)
+            break;
+    }
+    return written;
 }
 
 StreamChannel::Info StreamChannel::GetInfo()
 {
     Info stats;
     memset(&stats,0,sizeof(stats));
-    RingFIFO::BufferInfo info = fifo->GetInfo();
+    SamplesFIFO::BufferInfo info = fifo->GetInfo();
     stats.fifoSize = info.size;
     stats.fifoItemsCount = info.itemsFilled;
     stats.active = mActive;
@@ -167,11 +454,19 @@ Streamer::Streamer(FPGA* f, LMS7002M* chip, int id) : mRxStreams(2, this), mTxSt
     txDataRate_Bps = 0;
     txBatchSize = 1;
     rxBatchSize = 1;
+    txMaxBatchSize = 1;
+    rxMaxBatchSize = 1;
+    txLateEvents = 0;
+    executor = nullptr;
+    rxThreadInfo = txThreadInfo = {0, 0, -1, -1};
     streamSize = 1;
+    directRx.active = false;
 }
 
 Streamer::~Streamer()
 {
+    if (directRx.active)
+        StopDirectRx();
     terminateTx.store(true);
     if (txThread.joinable())
         txThread.join();
@@ -191,7 +486,7 @@ StreamChannel* Streamer::SetupStream(const StreamConfig& config)
         return nullptr;
     }
 
-    if ((!mTxStreams[ch].used) && (!mRxStreams[ch].used) && (txThread.joinable() || rxThread.joinable()))
+    if ((!mTxStreams[ch].used) && (!mRxStreams[ch].used) && (txThread.joinable() || rxThread.joinable() || directRx.active))
     {
         lime::warning("Stopping data stream to set up a new stream");
         UpdateThreads(true);
@@ -206,12 +501,19 @@ StreamChannel* Streamer::SetupStream(const StreamConfig& config)
     double rate = lms->GetSampleRate(config.isTx,LMS7002M::ChA)/1e6;
     streamSize = (mTxStreams[0].used||mRxStreams[0].used) + (mTxStreams[1].used||mRxStreams[1].used);
 
+    const double maxRate = (rate + 5) * streamSize;
     rate = (rate + 5) * config.performanceLatency * streamSize;
     for (int batch = 1; batch < rate; batch <<= 1)
         if (config.isTx)
             txBatchSize = batch;
         else
             rxBatchSize = batch;
+    //batch used with highest latency setting, starting point for throughput tuning
+    for (int batch = 1; batch < maxRate; batch <<= 1)
+        if (config.isTx)
+            txMaxBatchSize = batch;
+        else
+            rxMaxBatchSize = batch;
 
     return config.isTx ? &mTxStreams[ch] : &mRxStreams[ch]; //success
 }
@@ -232,7 +534,7 @@ int Streamer::GetStreamSize(bool tx)
 
 uint64_t Streamer::GetHardwareTimestamp(void)
 {
-    if(!(rxThread.joinable() || txThread.joinable()))
+    if(!(rxThread.joinable() || txThread.joinable() || directRx.active))
     {
         //stop streaming just in case the board has not been configured
         fpga->WriteRegister(0xFFFF, 1 << chipId);
@@ -390,6 +692,7 @@ void Streamer::AlignRxRF(bool restoreValues)
         return;
     uint32_t reg20 = lms->SPI_read(0x20);
     auto regBackup = lms->BackupRegisterMap();
+    lms->BeginBatch();
     lms->SPI_write(0x20, 0xFFFF);
     lms->SetDefaults(LMS7002M::RFE);
     lms->SetDefaults(LMS7002M::RBB);
@@ -410,6 +713,7 @@ void Streamer::AlignRxRF(bool restoreValues)
     lms->SPI_write(0x40C, 0x01FF);
     lms->SPI_write(0x404, 0x0006);
     lms->LoadDC_REG_IQ(true, 0x3FFF, 0x3FFF);
+    lms->Commit();
     double srate = lms->GetSampleRate(false, LMS7002M::ChA);
     lms->SetFrequencySX(false,450e6);
     int dec = lms->Get_SPI_Reg_bits(LMS7_HBD_OVR_RXTSP);
@@ -459,6 +763,8 @@ void Streamer::AlignQuadrature(bool restoreValues)
 {
     auto regBackup = lms->BackupRegisterMap();
 
+    //writes are sent in one transaction, reads from chip below flush them in order
+    lms->BeginBatch();
     lms->SPI_write(0x20, 0xFFFF);
     lms->SetDefaults(LMS7002M::RBB);
     lms->SetDefaults(LMS7002M::TBB);
@@ -489,6 +795,7 @@ void Streamer::AlignQuadrature(bool restoreValues)
     lms->SPI_write(0x10D, val==3 ? 0x18F : val==2 ? 0x117 : 0x08F);
     lms->SPI_write(0x10C, val==2 ? 0x88C5 : 0x88A5);
     lms->SPI_write(0x119, 0x5293);
+    lms->Commit();
     double srate = lms->GetSampleRate(false, LMS7002M::ChA);
     double freq = lms->GetFrequencySX(false);
 
@@ -550,9 +857,11 @@ int Streamer::UpdateThreads(bool stopAll)
         terminateRx.store(true);
         rxThread.join();
     }
+    if((!needRx) && directRx.active)
+        StopDirectRx();
 
     //configure FPGA on first start, or disable FPGA when not streaming
-    if((needTx || needRx) && (!txThread.joinable()) && (!rxThread.joinable()))
+    if((needTx || needRx) && (!txThread.joinable()) && (!rxThread.joinable()) && (!directRx.active))
     {
         fpga->WriteRegister(0xFFFF, 1 << chipId);
         if (mRxStreams[0].used && mRxStreams[1].used)
@@ -616,7 +925,9 @@ int Streamer::UpdateThreads(bool stopAll)
     }
 
     //FPGA should be configured and activated, start needed threads
-    if(needRx && (!rxThread.joinable()))
+    if(needRx && (!rxThread.joinable()) && (!directRx.active) && UseDirectRx())
+        StartDirectRx();
+    else if(needRx && (!rxThread.joinable()) && (!directRx.active))
     {
         terminateRx.store(false);
         auto RxLoopFunction = std::bind(&Streamer::ReceivePacketsLoop, this);
@@ -640,106 +951,139 @@ void Streamer::TransmitPacketsLoop()
     const uint8_t chCount = streamSize;
     const bool packed = dataLinkFormat == StreamConfig::FMT_INT12;
     const int epIndex = chipId;
-    const uint8_t buffersCount = dataPort->GetBuffersCount();
-    const uint8_t packetsToBatch = dataPort->CheckStreamSize(rxBatchSize);
-    const uint32_t bufferSize = packetsToBatch*sizeof(FPGA_DataPacket);
+    ApplyThreadConfig(true);
+    TransferTuner tuner = CreateTransferTuner(true);
+    const int buffersCount = tuner.MaxDepth();
+    const uint32_t bufferSize = dataPort->CheckStreamSize(tuner.MaxBatch())*sizeof(FPGA_DataPacket);
     const uint32_t popTimeout_ms = 500;
 
     const int maxSamplesBatch = (packed ? samples12InPkt:samples16InPkt)/chCount;
     std::vector<int> handles(buffersCount, 0);
-    std::vector<bool> bufferUsed(buffersCount, 0);
     std::vector<uint32_t> bytesToSend(buffersCount, 0);
-    std::vector<complex16_t> samples[maxChannelCount];
-    std::vector<char> buffers;
+    std::vector<int> queue(buffersCount, 0); //buffers in flight, in submission order
+    std::vector<int> freeBuffers;
+    const int maxPackets = bufferSize/sizeof(FPGA_DataPacket);
+    std::vector<complex16_t> samples[maxChannelCount]; //samples of whole transfer, packet after packet
+    std::vector<SamplesFIFO::PacketInfo> packetInfo[maxChannelCount];
+    StreamBuffer buffers;
     try
     {
         for(int i=0; i<chCount; ++i)
-            samples[i].resize(maxSamplesBatch);
-        buffers.resize(buffersCount*bufferSize, 0);
+        {
+            samples[i].resize(maxPackets*maxSamplesBatch);
+            packetInfo[i].resize(maxPackets);
+        }
+        buffers.Allocate(buffersCount*bufferSize, GetMemoryFlags(true));
     }
     catch (const std::bad_alloc& ex) //not enough memory for buffers
     {
         return lime::error("Error allocating Tx buffers, not enough memory");
     }
+    for (int i = buffersCount-1; i >= 0; --i)
+        freeBuffers.push_back(i);
 
     long totalBytesSent = 0;
     auto t1 = std::chrono::high_resolution_clock::now();
     auto t2 = t1;
     bool end_burst = false;
-    uint8_t bi = 0; //buffer index
+    int qHead = 0;
+    int qCount = 0;
+    txLateEvents.store(0);
     while (terminateTx.load() != true)
     {
-        if (bufferUsed[bi])
+        //reclaim the oldest transfer when enough of them are in flight
+        if (qCount >= tuner.depth || freeBuffers.empty())
         {
+            const int bi = queue[qHead];
+            const auto waitStart = std::chrono::high_resolution_clock::now();
             if (dataPort->WaitForSending(handles[bi], 1000) == true)
             {
+                const auto waitTime = std::chrono::high_resolution_clock::now() - waitStart;
+                unsigned drops = txLateEvents.exchange(0);
                 unsigned bytesSent = dataPort->FinishDataSending(&buffers[bi*bufferSize], bytesToSend[bi], handles[bi]);
 
                 if (bytesSent != bytesToSend[bi])
                 {
+                    ++drops;
                     for (auto &value : mTxStreams)
                         if (value.used && value.mActive)
                             value.overflow++;
                 }
                 else
                     totalBytesSent += bytesSent;
-                bufferUsed[bi] = false;
+                qHead = (qHead + 1) % buffersCount;
+                --qCount;
+                freeBuffers.push_back(bi);
+                tuner.TransferDone(waitTime, drops);
             }
             else
             {
                 txDataRate_Bps.store(totalBytesSent);
                 totalBytesSent = 0;
-                continue;
             }
+            continue;
         }
 
+        const int bi = freeBuffers.back();
+        const int packetsToBatch = dataPort->CheckStreamSize(tuner.batch);
         FPGA_DataPacket* pkt = reinterpret_cast<FPGA_DataPacket*>(&buffers[bi*bufferSize]);
-        int i=0;
-        do
+
+        //take whole transfer worth of packets from each FIFO at once
+        int chPackets[maxChannelCount] = {0, 0};
+        int packetCount = 0;
+        int packetsToPop = packetsToBatch;
+        for(int ch=0; ch<maxChannelCount; ++ch)
         {
-            bool has_samples = false;
-            StreamChannel::Metadata meta = {0, 0};
-            for(int ch=0; ch<maxChannelCount; ++ch)
+            if (!mTxStreams[ch].used || mTxStreams[ch].mActive==false)
+                continue;
+            const int ind = chCount == maxChannelCount ? ch : 0;
+            int popped = mTxStreams[ch].ReadPackets(samples[ind].data(), maxSamplesBatch, packetInfo[ind].data(), packetsToPop, popTimeout_ms);
+            if (popped > 0)
             {
-                if (!mTxStreams[ch].used)
-                    continue;
-                const int ind = chCount == maxChannelCount ? ch : 0;
-                if (mTxStreams[ch].mActive==false)
-                {
-                    memset(&samples[ind][0],0,maxSamplesBatch*sizeof(complex16_t));
-                    continue;
-                }
-                int samplesPopped = mTxStreams[ch].Read(samples[ind].data(), maxSamplesBatch, &meta, popTimeout_ms);
-                if (samplesPopped != maxSamplesBatch)
+                const SamplesFIFO::PacketInfo &last = packetInfo[ind][popped-1];
+                if (int(last.count) != maxSamplesBatch)
                 {
-                    if ((!end_burst) && !(meta.flags & RingFIFO::END_BURST))
+                    if (!(popped == 1 && end_burst) && !(last.flags & RingFIFO::END_BURST))
                     {
                         mTxStreams[ch].underflow++;
-                        lime::warning("popping from TX, samples popped %i/%i", samplesPopped, maxSamplesBatch);
-                        continue;
+                        lime::warning("popping from TX, samples popped %i/%i", last.count, maxSamplesBatch);
+                        --popped;
                     }
-                    memset(&samples[ind][samplesPopped],0,(maxSamplesBatch-samplesPopped)*sizeof(complex16_t));
+                    else
+                        memset(&samples[ind][(popped-1)*maxSamplesBatch+last.count],0,(maxSamplesBatch-last.count)*sizeof(complex16_t));
                 }
-                has_samples = true;
             }
+            chPackets[ind] = popped;
+            //keep channels aligned, do not ask the other channel for more packets
+            if (popped > 0)
+                packetsToPop = popped;
+            packetCount = std::max(packetCount, popped);
+        }
 
-            if (!has_samples)
-                break;
+        int i=0;
+        for(; i<packetCount; ++i)
+        {
+            const SamplesFIFO::PacketInfo* meta = nullptr;
+            complex16_t* src[maxChannelCount];
+            for(uint8_t c=0; c<chCount; ++c)
+            {
+                src[c] = &samples[c][i*maxSamplesBatch];
+                if (i < chPackets[c])
+                    meta = &packetInfo[c][i];
+                else //inactive or underflowed channel
+                    memset(src[c],0,maxSamplesBatch*sizeof(complex16_t));
+            }
 
-            end_burst = (meta.flags & RingFIFO::END_BURST);
-            pkt[i].counter = meta.timestamp;
+            end_burst = (meta->flags & RingFIFO::END_BURST);
+            pkt[i].counter = meta->timestamp;
             pkt[i].reserved[0] = 0;
             //by default ignore timestamps
-            const int ignoreTimestamp = !(meta.flags & RingFIFO::SYNC_TIMESTAMP);
+            const int ignoreTimestamp = !(meta->flags & RingFIFO::SYNC_TIMESTAMP);
             pkt[i].reserved[0] |= ((int)ignoreTimestamp << 4); //ignore timestamp
 
-            std::vector<complex16_t*> src(chCount);
-            for(uint8_t c=0; c<chCount; ++c)
-                src[c] = (samples[c].data());
             uint8_t* const dataStart = (uint8_t*)pkt[i].data;
-            FPGA::Samples2FPGAPacketPayload(src.data(), maxSamplesBatch, chCount==2, packed, dataStart);
-
-        }while(++i<packetsToBatch && end_burst == false);
+            FPGA::Samples2FPGAPacketPayload(src, maxSamplesBatch, chCount==2, packed, dataStart);
+        }
 
         if(terminateTx.load() == true) //early termination
             break;
@@ -749,8 +1093,9 @@ void Streamer::TransmitPacketsLoop()
             bytesToSend[bi] = i*sizeof(FPGA_DataPacket);
             handles[bi] = dataPort->BeginDataSending(&buffers[bi*bufferSize], bytesToSend[bi], epIndex);
             txLastTimestamp.store(pkt[i-1].counter+maxSamplesBatch-1); //timestamp of the last sample that was sent to HW
-            bufferUsed[bi] = true;
-            bi = (bi + 1) & (buffersCount-1);
+            freeBuffers.pop_back();
+            queue[(qHead + qCount) % buffersCount] = bi;
+            ++qCount;
         }
 
         t2 = std::chrono::high_resolution_clock::now();
@@ -785,15 +1130,23 @@ void Streamer::ReceivePacketsLoop()
     const uint32_t samplesInPacket = (packed  ? samples12InPkt : samples16InPkt)/chCount;
 
     const int epIndex = chipId;
-    const uint8_t buffersCount = dataPort->GetBuffersCount();
-    const uint8_t packetsToBatch = dataPort->CheckStreamSize(rxBatchSize);
-    const uint32_t bufferSize = packetsToBatch*sizeof(FPGA_DataPacket);
+    ApplyThreadConfig(false);
+    TransferTuner tuner = CreateTransferTuner(false);
+    const int buffersCount = tuner.MaxDepth();
+    const uint32_t bufferSize = dataPort->CheckStreamSize(tuner.MaxBatch())*sizeof(FPGA_DataPacket);
     std::vector<int> handles(buffersCount, 0);
-    std::vector<char>buffers(buffersCount*bufferSize, 0);
-    std::vector<StreamChannel::Frame> chFrames;
+    std::vector<uint32_t> transferSize(buffersCount, 0);
+    std::vector<int> queue(buffersCount, 0); //buffers in flight, in submission order
+    std::vector<int> freeBuffers;
+    const int maxPackets = bufferSize/sizeof(FPGA_DataPacket);
+    StreamBuffer buffers;
+    std::vector<complex16_t> samples[maxChannelCount]; //samples of whole transfer, packet after packet
+    std::vector<SamplesFIFO::PacketInfo> packetInfo(maxPackets);
     try
     {
-        chFrames.resize(chCount);
+        buffers.Allocate(buffersCount*bufferSize, GetMemoryFlags(false));
+        for(int i=0; i<chCount; ++i)
+            samples[i].resize(maxPackets*samplesInPacket);
     }
     catch (const std::bad_alloc &ex)
     {
@@ -801,10 +1154,25 @@ void Streamer::ReceivePacketsLoop()
         return;
     }
 
-    for (int i = 0; i<buffersCount; ++i)
-        handles[i] = dataPort->BeginDataReading(&buffers[i*bufferSize], bufferSize, epIndex);
+    int qHead = 0;
+    int qCount = 0;
+    //keep the number of transfers selected by tuner in flight
+    auto SubmitTransfers = [&]()
+    {
+        while (qCount < tuner.depth && !freeBuffers.empty())
+        {
+            const int i = freeBuffers.back();
+            freeBuffers.pop_back();
+            transferSize[i] = dataPort->CheckStreamSize(tuner.batch)*sizeof(FPGA_DataPacket);
+            handles[i] = dataPort->BeginDataReading(&buffers[i*bufferSize], transferSize[i], epIndex);
+            queue[(qHead + qCount) % buffersCount] = i;
+            ++qCount;
+        }
+    };
+    for (int i = buffersCount-1; i >= 0; --i)
+        freeBuffers.push_back(i);
+    SubmitTransfers();
 
-    int bi = 0;
     unsigned long totalBytesReceived = 0; //for data rate calculation
 
     auto t1 = std::chrono::high_resolution_clock::now();
@@ -812,12 +1180,14 @@ void Streamer::ReceivePacketsLoop()
 
     std::mutex txFlagsLock;
     std::condition_variable resetTxFlags;
-    //worker thread for reseting late Tx packet flags
-    std::thread txReset([](FPGA* fpga,
+    //worker thread for reseting late Tx packet flags, scheduled like Rx thread
+    std::thread txReset([](Streamer* streamer,
+                        FPGA* fpga,
                         std::atomic<bool> *terminate,
                         std::mutex *spiLock,
                         std::condition_variable *doWork)
     {
+        streamer->ApplyThreadConfig(false, true);
         uint32_t reg9 = fpga->ReadRegister(0x0009);
         const uint32_t addr[] = {0x0009, 0x0009};
         const uint32_t data[] = {reg9 | (5 << 1), reg9 & ~(5 << 1)};
@@ -827,23 +1197,29 @@ void Streamer::ReceivePacketsLoop()
             doWork->wait(lck);
             fpga->WriteRegisters(addr, data, 2);
         }
-    }, fpga, &terminateRx, &txFlagsLock, &resetTxFlags);
+    }, this, fpga, &terminateRx, &txFlagsLock, &resetTxFlags);
 
     int resetFlagsDelay = 0;
     uint64_t prevTs = 0;
     while (terminateRx.load() == false)
     {
+        const int bi = queue[qHead];
         int32_t bytesReceived = 0;
+        unsigned drops = 0;
+        const auto waitStart = std::chrono::high_resolution_clock::now();
         if(handles[bi] >= 0)
         {
             if (dataPort->WaitForReading(handles[bi], 1000) == true)
             {
-                bytesReceived = dataPort->FinishDataReading(&buffers[bi*bufferSize], bufferSize, handles[bi]);
+                bytesReceived = dataPort->FinishDataReading(&buffers[bi*bufferSize], transferSize[bi], handles[bi]);
                 totalBytesReceived += bytesReceived;
-                if (bytesReceived != int32_t(bufferSize)) //data should come in full sized packets
+                if (bytesReceived != int32_t(transferSize[bi])) //data should come in full sized packets
+                {
+                    ++drops;
                     for(auto &value: mRxStreams)
                         if (value.used && value.mActive)
                             value.underflow++;
+                }
             }
             else
             {
@@ -852,14 +1228,17 @@ void Streamer::ReceivePacketsLoop()
                 continue;
             }
         }
+        const auto waitTime = std::chrono::high_resolution_clock::now() - waitStart;
         bool txLate=false;
-        for (uint8_t pktIndex = 0; pktIndex < bytesReceived / sizeof(FPGA_DataPacket); ++pktIndex)
+        const unsigned packetCount = bytesReceived / sizeof(FPGA_DataPacket);
+        for (unsigned pktIndex = 0; pktIndex < packetCount; ++pktIndex)
         {
             const FPGA_DataPacket* pkt = (FPGA_DataPacket*)&buffers[bi*bufferSize];
             const uint8_t byte0 = pkt[pktIndex].reserved[0];
             if ((byte0 & (1 << 3)) != 0 && !txLate) //report only once per batch
             {
                 txLate = true;
+                txLateEvents++;
                 if(resetFlagsDelay > 0)
                     --resetFlagsDelay;
                 else
@@ -876,6 +1255,7 @@ void Streamer::ReceivePacketsLoop()
             if(pkt[pktIndex].counter - prevTs != samplesInPacket && pkt[pktIndex].counter != prevTs)
             {
                 int packetLoss = ((pkt[pktIndex].counter - prevTs)/samplesInPacket)-1;
+                ++drops;
                 for(auto &value: mRxStreams)
                     if (value.used && value.mActive)
                         value.pktLost += packetLoss;
@@ -883,27 +1263,33 @@ void Streamer::ReceivePacketsLoop()
             prevTs = pkt[pktIndex].counter;
             rxLastTimestamp.store(prevTs);
             //parse samples
-            std::vector<complex16_t*> dest(chCount);
+            complex16_t* dest[maxChannelCount];
             for(uint8_t c=0; c<chCount; ++c)
-                dest[c] = (chFrames[c].samples);
-            int samplesCount = FPGA::FPGAPacketPayload2Samples(pktStart, 4080, chCount==2, packed, dest.data());
+                dest[c] = &samples[c][pktIndex*samplesInPacket];
+            packetInfo[pktIndex].count = FPGA::FPGAPacketPayload2Samples(pktStart, 4080, chCount==2, packed, dest);
+            packetInfo[pktIndex].timestamp = pkt[pktIndex].counter;
+            packetInfo[pktIndex].flags = RingFIFO::OVERWRITE_OLD | RingFIFO::SYNC_TIMESTAMP;
+        }
 
-            for(int ch=0; ch<maxChannelCount; ++ch)
+        //whole transfer is committed to each FIFO at once
+        for(int ch=0; ch<maxChannelCount && packetCount; ++ch)
+        {
+            if (mRxStreams[ch].used==false || mRxStreams[ch].mActive==false)
+                continue;
+            const int ind = chCount == maxChannelCount ? ch : 0;
+            const unsigned packetsPushed = mRxStreams[ch].WritePackets(samples[ind].data(), samplesInPacket, packetInfo.data(), packetCount, 100);
+            if(packetsPushed != packetCount)
             {
-                if (mRxStreams[ch].used==false || mRxStreams[ch].mActive==false)
-                    continue;
-                const int ind = chCount == maxChannelCount ? ch : 0;
-                StreamChannel::Metadata meta;
-                meta.timestamp = pkt[pktIndex].counter;
-                meta.flags = RingFIFO::OVERWRITE_OLD | RingFIFO::SYNC_TIMESTAMP;
-                int samplesPushed = mRxStreams[ch].Write((const void*)chFrames[ind].samples, samplesCount, &meta, 100);
-                if(samplesPushed != samplesCount)
-                    mRxStreams[ch].overflow++;
+                drops += packetCount - packetsPushed;
+                mRxStreams[ch].overflow += packetCount - packetsPushed;
             }
         }
         // Re-submit this request to keep the queue full
-        handles[bi] = dataPort->BeginDataReading(&buffers[bi*bufferSize], bufferSize, epIndex);
-        bi = (bi + 1) & (buffersCount-1);
+        qHead = (qHead + 1) % buffersCount;
+        --qCount;
+        freeBuffers.push_back(bi);
+        tuner.TransferDone(waitTime, drops);
+        SubmitTransfers();
 
         t2 = std::chrono::high_resolution_clock::now();
         auto timePeriod = std::chrono::duration_cast<std::chrono::milliseconds>(t2 - t1).count();
@@ -925,4 +1311,324 @@ void Streamer::ReceivePacketsLoop()
     rxDataRate_Bps.store(0);
 }
 
+/** @brief Selects initial and maximum transfer sizes for streaming loop
+    according to the transfer policy of the streams
+*/
+TransferTuner Streamer::CreateTransferTuner(bool tx)
+{
+    const int maxTunedBatch = 128;
+    StreamConfig::TransferPolicy policy = StreamConfig::TRANSFER_STATIC;
+    for(auto &i : (tx ? mTxStreams : mRxStreams))
+        if (i.used)
+        {
+            policy = i.config.transferPolicy;
+            break;
+        }
+    const int buffersCount = std::max(dataPort->GetBuffersCount(), 1);
+    const int staticDepth = std::min(buffersCount, legacyDepth);
+    const int setupBatch = rxBatchSize; //static sizing uses Rx batch size for both directions
+    const int maxBatch = std::min<int>(std::max<int>(2*(tx ? txMaxBatchSize : rxMaxBatchSize), setupBatch), maxTunedBatch);
+
+    switch (policy)
+    {
+    case StreamConfig::TRANSFER_LATENCY:
+        return TransferTuner(policy, buffersCount, maxBatch, std::min(buffersCount, 4), 1);
+    case StreamConfig::TRANSFER_THROUGHPUT:
+        return TransferTuner(policy, buffersCount, maxBatch, buffersCount, tx ? txMaxBatchSize : rxMaxBatchSize);
+    case StreamConfig::TRANSFER_AUTO:
+        return TransferTuner(policy, buffersCount, maxBatch, staticDepth, tx ? txBatchSize : rxBatchSize);
+    default:
+        return TransferTuner(policy, staticDepth, setupBatch, staticDepth, setupBatch);
+    }
+}
+
+/** @brief Applies scheduling options of the streams to the calling streaming
+    thread, must be called before the thread allocates its buffers
+    @param helper calling thread assists the streaming loop, applied settings
+    are not reported in stream status
+*/
+void Streamer::ApplyThreadConfig(bool tx, bool helper)
+{
+    StreamChannel::ThreadInfo info = {0, 0, -1, -1};
+    for(auto &i : (tx ? mTxStreams : mRxStreams))
+        if (i.used)
+        {
+            info.priority = ApplyThreadPriority(i.config.threadPriority);
+            info.affinity = ApplyThreadAffinity(i.config.cpuAffinity);
+            if (i.config.numaLocal && info.affinity)
+                info.bufferNode = GetCurrentNumaNode();
+            break;
+        }
+    if (helper)
+        return;
+    std::lock_guard<std::mutex> lock(threadInfoLock);
+    (tx ? txThreadInfo : rxThreadInfo) = info;
+}
+
+unsigned Streamer::GetMemoryFlags(bool tx) const
+{
+    for(auto &i : (tx ? mTxStreams : mRxStreams))
+        if (i.used)
+            return MemoryFlags(i.config);
+    return 0;
+}
+
+bool Streamer::UseDirectRx() const
+{
+    bool zeroCopy = false;
+    for(auto &i : mRxStreams)
+    {
+        if(!i.used)
+            continue;
+        if(!i.config.zeroCopy)
+        {
+            if (zeroCopy)
+                lime::warning("Zero-copy Rx disabled: all Rx streams have to enable it");
+            return false;
+        }
+        zeroCopy = true;
+    }
+    return zeroCopy;
+}
+
+void Streamer::StartDirectRx()
+{
+    std::lock_guard<std::mutex> lock(directRx.lock);
+    //zero-copy path keeps static sizing
+    const int buffersCount = std::min(std::max(dataPort->GetBuffersCount(), 1), legacyDepth);
+    const uint8_t packetsToBatch = dataPort->CheckStreamSize(rxBatchSize);
+    directRx.bufferSize = packetsToBatch*sizeof(FPGA_DataPacket);
+    try
+    {
+        directRx.buffers.Allocate(buffersCount*directRx.bufferSize, GetMemoryFlags(false));
+        directRx.handles.resize(buffersCount);
+    }
+    catch (const std::bad_alloc &ex)
+    {
+        lime::error("Error allocating Rx buffers, not enough memory");
+        return;
+    }
+    for (int i = 0; i<buffersCount; ++i)
+        directRx.handles[i] = dataPort->BeginDataReading(&directRx.buffers[i*directRx.bufferSize], directRx.bufferSize, chipId);
+    directRx.bi = 0;
+    directRx.borrowed = false;
+    directRx.pktCount = 0;
+    directRx.pktIndex = 0;
+    directRx.prevTs = 0;
+    directRx.resetFlagsDelay = 0;
+    directRx.bytesReceived = 0;
+    directRx.rateTime = std::chrono::high_resolution_clock::now();
+    directRx.active = true;
+}
+
+void Streamer::StopDirectRx()
+{
+    std::lock_guard<std::mutex> lock(directRx.lock);
+    directRx.active = false;
+    dataPort->AbortReading(chipId);
+    directRx.buffers.Free();
+    rxDataRate_Bps.store(0);
+}
+
+/** @brief Returns next packet of zero-copy Rx transfers, directRx.lock must be held
+    Finished transfers are resubmitted, link rate, packet loss and late Tx
+    events are accounted here.
+    @return packet or nullptr on timeout
+*/
+const FPGA_DataPacket* Streamer::NextDirectPacket(std::chrono::high_resolution_clock::time_point start, const int32_t timeout_ms)
+{
+    const int buffersCount = directRx.handles.size();
+    const uint8_t chCount = streamSize;
+    const bool packed = dataLinkFormat == StreamConfig::FMT_INT12;
+    const uint32_t samplesInPacket = (packed  ? samples12InPkt : samples16InPkt)/chCount;
+
+    while (directRx.pktIndex >= directRx.pktCount)
+    {
+        //return borrowed transfer to the connection and wait for the next one
+        if (directRx.borrowed)
+        {
+            const int bi = directRx.bi;
+            directRx.handles[bi] = dataPort->BeginDataReading(&directRx.buffers[bi*directRx.bufferSize], directRx.bufferSize, chipId);
+            directRx.bi = (bi + 1) % buffersCount;
+            directRx.borrowed = false;
+        }
+        const int bi = directRx.bi;
+        if (directRx.handles[bi] < 0)
+            return nullptr;
+        const auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::high_resolution_clock::now() - start).count();
+        if (elapsed > timeout_ms || !dataPort->WaitForReading(directRx.handles[bi], timeout_ms - elapsed))
+            return nullptr;
+        const int32_t bytesReceived = dataPort->FinishDataReading(&directRx.buffers[bi*directRx.bufferSize], directRx.bufferSize, directRx.handles[bi]);
+        directRx.borrowed = true;
+        directRx.pktIndex = 0;
+        directRx.pktCount = bytesReceived > 0 ? bytesReceived / sizeof(FPGA_DataPacket) : 0;
+        directRx.bytesReceived += bytesReceived > 0 ? bytesReceived : 0;
+        if (bytesReceived != int32_t(directRx.bufferSize)) //data should come in full sized packets
+            for(auto &value: mRxStreams)
+                if (value.used && value.mActive)
+                    value.underflow++;
+
+        const auto t2 = std::chrono::high_resolution_clock::now();
+        const auto timePeriod = std::chrono::duration_cast<std::chrono::milliseconds>(t2 - directRx.rateTime).count();
+        if (timePeriod >= 1000)
+        {
+            rxDataRate_Bps.store((uint32_t)(1000.0*directRx.bytesReceived / timePeriod));
+            directRx.bytesReceived = 0;
+            directRx.rateTime = t2;
+        }
+    }
+
+    const FPGA_DataPacket* pkt = (const FPGA_DataPacket*)&directRx.buffers[directRx.bi*directRx.bufferSize] + directRx.pktIndex++;
+    if ((pkt->reserved[0] & (1 << 3)) != 0)
+    {
+        if(directRx.resetFlagsDelay > 0)
+            --directRx.resetFlagsDelay;
+        else
+        {
+            lime::warning("L");
+            txLateEvents++;
+            uint32_t reg9 = fpga->ReadRegister(0x0009);
+            const uint32_t addr[] = {0x0009, 0x0009};
+            const uint32_t data[] = {reg9 | (5 << 1), reg9 & ~(5 << 1)};
+            fpga->WriteRegisters(addr, data, 2);
+            directRx.resetFlagsDelay = buffersCount*directRx.pktCount;
+            for(auto &value: mTxStreams)
+                if (value.used && value.mActive)
+                    value.pktLost++;
+        }
+    }
+    if(pkt->counter - directRx.prevTs != samplesInPacket && pkt->counter != directRx.prevTs)
+    {
+        int packetLoss = ((pkt->counter - directRx.prevTs)/samplesInPacket)-1;
+        for(auto &value: mRxStreams)
+            if (value.used && value.mActive)
+                value.pktLost += packetLoss;
+    }
+    directRx.prevTs = pkt->counter;
+    rxLastTimestamp.store(pkt->counter);
+    return pkt;
+}
+
+//! @brief Unpacks zero-copy packet, dest holds one buffer per link channel
+int Streamer::UnpackDirectPacket(const FPGA_DataPacket* pkt, complex16_t* const* dest)
+{
+    const bool packed = dataLinkFormat == StreamConfig::FMT_INT12;
+    complex16_t* channels[2] = {dest[0], streamSize == 2 ? dest[1] : nullptr};
+    return FPGA::FPGAPacketPayload2Samples((const uint8_t*)pkt->data, sizeof(pkt->data), streamSize == 2, packed, channels);
+}
+
+/** @brief Moves one zero-copy packet into FIFOs of all active Rx streams
+    Used by aligned reads of streams that span several Streamers.
+    @return false on timeout
+*/
+bool Streamer::PumpDirect(const int32_t timeout_ms)
+{
+    std::lock_guard<std::mutex> lock(directRx.lock);
+    if (!directRx.active)
+        return false;
+    const FPGA_DataPacket* pkt = NextDirectPacket(std::chrono::high_resolution_clock::now(), timeout_ms);
+    if (pkt == nullptr)
+        return false;
+    complex16_t* dest[2] = {directRx.frames[0].samples, directRx.frames[1].samples};
+    const int samplesCount = UnpackDirectPacket(pkt, dest);
+    for(int ch=0; ch<2; ++ch)
+    {
+        StreamChannel &value = mRxStreams[ch];
+        if (value.used==false || value.mActive==false)
+            continue;
+        if (int(value.fifo->push_samples(dest[streamSize == 2 ? ch : 0], samplesCount, 1, pkt->counter, 0, RingFIFO::OVERWRITE_OLD | RingFIFO::SYNC_TIMESTAMP)) != samplesCount)
+            value.overflow++;
+    }
+    return true;
+}
+
+/** @brief Reads zero-copy Rx streams of this Streamer
+    Packets are unpacked straight into the caller's buffers when whole packet
+    fits, samples that were not consumed are kept in the stream FIFOs.
+    Several streams are read at once only when their FIFOs are empty.
+*/
+int Streamer::ReadDirect(StreamChannel* const* streams, void* const* samples, unsigned streamCount, const uint32_t count, StreamChannel::Metadata* meta, const int32_t timeout_ms)
+{
+    std::lock_guard<std::mutex> lock(directRx.lock);
+    if (!directRx.active)
+        return 0;
+
+    const uint8_t maxChannelCount = 2;
+    const uint8_t chCount = streamSize;
+    const bool packed = dataLinkFormat == StreamConfig::FMT_INT12;
+    const uint32_t samplesInPacket = (packed  ? samples12InPkt : samples16InPkt)/chCount;
+    const bool toFloat = streams[0]->config.format == StreamConfig::FMT_FLOAT32;
+    const auto t1 = std::chrono::high_resolution_clock::now();
+
+    //samples left over from previous reads come first
+    uint32_t filled = 0;
+    meta->flags = 0;
+    if (streamCount == 1)
+    {
+        StreamChannel* stream = streams[0];
+        if (toFloat)
+            filled = stream->fifo->pop_samples((complex32f_t*)samples[0], count, 1, &meta->timestamp, 0, &meta->flags, stream->config.fullScale);
+        else
+            filled = stream->fifo->pop_samples((complex16_t*)samples[0], count, 1, &meta->timestamp, 0, &meta->flags);
+        if (filled == 0)
+            meta->flags = 0;
+    }
+
+    while (filled < count && !(meta->flags & RingFIFO::END_BURST))
+    {
+        const FPGA_DataPacket* pkt = NextDirectPacket(t1, timeout_ms);
+        if (pkt == nullptr)
+            break;
+
+        //whole packet fits into integer caller buffers: unpack straight into them
+        const bool direct = !toFloat && count - filled >= samplesInPacket;
+        complex16_t* dest[maxChannelCount] = {nullptr, nullptr};
+        for(uint8_t c=0; c<chCount; ++c)
+            dest[c] = directRx.frames[c].samples;
+        if (direct)
+            for (unsigned i = 0; i < streamCount; ++i)
+                dest[chCount == maxChannelCount ? (streams[i]->config.channelID&1) : 0] = (complex16_t*)samples[i] + filled;
+        const int samplesCount = UnpackDirectPacket(pkt, dest);
+
+        if (filled == 0)
+        {
+            meta->timestamp = pkt->counter;
+            meta->flags = RingFIFO::SYNC_TIMESTAMP;
+        }
+        int taken = samplesCount;
+        if (!direct)
+        {
+            taken = std::min<int>(samplesCount, count - filled);
+            for (unsigned i = 0; i < streamCount; ++i)
+            {
+                const complex16_t* src = dest[chCount == maxChannelCount ? (streams[i]->config.channelID&1) : 0];
+                if (toFloat)
+                    ConvertToFloat32((complex32f_t*)samples[i] + filled, src, taken, streams[i]->config.fullScale);
+                else
+                    memcpy((complex16_t*)samples[i] + filled, src, taken*sizeof(complex16_t));
+            }
+        }
+        filled += taken;
+
+        //keep samples that were not consumed by this read
+        for(int ch=0; ch<maxChannelCount; ++ch)
+        {
+            StreamChannel &value = mRxStreams[ch];
+            if (value.used==false || value.mActive==false)
+                continue;
+            const int ind = chCount == maxChannelCount ? ch : 0;
+            int offset = 0;
+            for (unsigned i = 0; i < streamCount; ++i)
+                if (streams[i] == &value)
+                    offset = taken;
+            if (offset >= samplesCount)
+                continue;
+            const int cnt = samplesCount - offset;
+            if (int(value.fifo->push_samples(dest[ind] + offset, cnt, 1, pkt->counter + offset, 0, RingFIFO::OVERWRITE_OLD | RingFIFO::SYNC_TIMESTAMP)) != cnt)
+                value.overflow++;
+        }
+    }
+    return filled;
+}
+
 }
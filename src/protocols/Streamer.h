@@ -16,7 +16,9 @@
 
 #include "dataTypes.h"
 #include "fifo.h"
+#include "StreamMemory.h"
 #include <vector>
+#include <atomic>
 
 namespace lime
 {
@@ -25,13 +27,25 @@ class IConnection;
 class FPGA;
 class Streamer;
 class LMS7002M;
+class TransferTuner;
+class CommandExecutor;
 
 /*!
  * The stream config structure is used with the SetupStream() API.
  */
 struct LIME_API StreamConfig
 {
-    StreamConfig(void){};
+    StreamConfig(void) :
+        fifoType(FIFO_LOCKING),
+        fifoWaitPolicy(LockFreeRingFIFO::WAIT_SPIN_THEN_BLOCK),
+        fullScale(32767.0f),
+        zeroCopy(false),
+        transferPolicy(TRANSFER_STATIC),
+        threadPriority(0),
+        cpuAffinity(0),
+        numaLocal(false),
+        hugePages(false),
+        lockMemory(false){};
 
     //! True for transmit stream, false for receive
     bool isTx;
@@ -66,6 +80,92 @@ struct LIME_API StreamConfig
      * Default: STREAM_12_BIT_IN_16
      */
     StreamDataFormat linkFormat;
+
+    //! FIFO implementations used between streaming threads and Read/Write()
+    enum FIFOType
+    {
+        FIFO_LOCKING,   ///<mutex protected RingFIFO
+        FIFO_LOCKFREE,  ///<single producer/single consumer LockFreeRingFIFO
+    };
+
+    /*!
+     * The FIFO used by the stream.
+     * FIFO_LOCKFREE requires that only one thread at a time
+     * calls Read() (Rx) or Write() (Tx) of the stream.
+     * Default: FIFO_LOCKING
+     */
+    FIFOType fifoType;
+
+    //! How FIFO_LOCKFREE waits for samples or free space
+    LockFreeRingFIFO::WaitPolicy fifoWaitPolicy;
+
+    /*!
+     * Integer sample value that corresponds to 1.0 in FMT_FLOAT32 format.
+     * Default: 32767
+     */
+    float fullScale;
+
+    /*!
+     * Rx only: Read() takes completed transfers directly from the
+     * connection and unpacks them into the caller's buffer, without the
+     * Rx thread and FIFO in between. Buffering is then limited to the
+     * connection's transfers, so Read() has to be called continuously.
+     * Used only when all Rx streams of the Streamer enable it.
+     * Default: false
+     */
+    bool zeroCopy;
+
+    //! How the streaming threads size data transfers to the device
+    enum TransferPolicy
+    {
+        TRANSFER_STATIC,     ///<fixed, derived from performanceLatency on setup
+        TRANSFER_LATENCY,    ///<start small, grow on drops, shrink back when calm
+        TRANSFER_THROUGHPUT, ///<start large, grow on drops, never shrink
+        TRANSFER_AUTO,       ///<start from performanceLatency, adapt both ways
+    };
+
+    /*!
+     * Number of in-flight transfers and packets per transfer are
+     * adjusted at runtime from observed drops and streaming thread load,
+     * unless TRANSFER_STATIC is selected. Policy of the first used stream
+     * of each direction is applied.
+     * Default: TRANSFER_STATIC
+     */
+    TransferPolicy transferPolicy;
+
+    /*!
+     * Realtime (SCHED_FIFO) priority 1-99 of the streaming thread serving
+     * this stream, 0 keeps default scheduling. Settings of the first used
+     * stream of each direction are applied.
+     * Default: 0
+     */
+    int threadPriority;
+
+    /*!
+     * Bit mask of CPUs the streaming thread may run on, 0 - any CPU.
+     * Default: 0
+     */
+    uint64_t cpuAffinity;
+
+    /*!
+     * Allocate FIFO and transfer buffers on the NUMA node of cpuAffinity
+     * CPUs, memory is first touched by a thread running on them.
+     * Default: false
+     */
+    bool numaLocal;
+
+    /*!
+     * Back FIFO and transfer buffers with huge pages (or transparent huge
+     * pages when none are reserved) to reduce TLB misses at high rates.
+     * Default: false
+     */
+    bool hugePages;
+
+    /*!
+     * Lock FIFO and transfer buffers in RAM, requires sufficient memlock limit.
+     * Default: false
+     */
+    bool lockMemory;
 };
 
 class LIME_API StreamChannel 
@@ -95,6 +195,15 @@ public:
         int droppedPackets;
         uint64_t timestamp;
     };
+
+    //! Scheduling that was actually applied to the stream
+    struct ThreadInfo
+    {
+        int priority;      ///<SCHED_FIFO priority, 0 - default scheduling
+        uint64_t affinity; ///<CPU mask of the streaming thread, 0 - not set
+        int bufferNode;    ///<NUMA node of transfer buffers, -1 if not bound
+        int fifoNode;      ///<NUMA node of FIFO memory, -1 if not bound
+    };
     
     StreamChannel(Streamer* streamer);
     ~StreamChannel();
@@ -104,6 +213,34 @@ public:
     void Close();
     int Read(void* samples, const uint32_t count, Metadata* meta, const int32_t timeout_ms = 100);
     int Write(const void* samples, const uint32_t count, const Metadata* meta, const int32_t timeout_ms = 100);
+    int ReadPackets(complex16_t* samples, const uint32_t samplesPerPacket, SamplesFIFO::PacketInfo* packets, const uint32_t count, const int32_t timeout_ms = 100);
+    int WritePackets(const complex16_t* samples, const uint32_t stride, const SamplesFIFO::PacketInfo* packets, const uint32_t count, const int32_t timeout_ms = 100);
+
+    static const unsigned maxAlignedStreams = 16;
+
+    /** @brief Reads samples of several Rx streams starting at the same timestamp
+        Streams may belong to different Streamers (chips). Samples older than
+        the newest stream head are dropped, reading stops early when samples
+        are not contiguous, so that all buffers always hold the same block.
+        @param streams Rx streams using the same sample format
+        @param streamCount number of streams, up to maxAlignedStreams
+        @param samples destination buffer for each stream
+        @param count number of samples to read into each buffer
+        @param meta in: with SYNC_TIMESTAMP flag samples older than timestamp are dropped
+                    out: timestamp of the first sample and flags
+        @return number of samples read into each buffer, 0 on timeout, -1 on error
+    */
+    static int ReadAligned(StreamChannel* const* streams, unsigned streamCount, void* const* samples, const uint32_t count, Metadata* meta, const int32_t timeout_ms = 100);
+
+    /** @brief Writes samples of several Tx streams with the same metadata
+        @return number of samples accepted by all streams, 0 on timeout, -1 on error
+    */
+    static int WriteAligned(StreamChannel* const* streams, unsigned streamCount, const void* const* samples, const uint32_t count, const Metadata* meta, const int32_t timeout_ms = 100);
+    int AcquireBuffer(void** samples, Metadata* meta, const int32_t timeout_ms = 100);
+    int ReleaseBuffer(const uint32_t count, const Metadata* meta = nullptr);
+    int SetScheduling(int priority, uint64_t cpuAffinity, bool numaLocal);
+    int SetMemoryOptions(bool hugePages, bool lockMemory);
+    ThreadInfo GetThreadInfo();
     StreamChannel::Info GetInfo();
     int GetStreamSize();
 
@@ -119,7 +256,10 @@ public:
     bool used;
        
 protected:
-    RingFIFO* fifo;  
+    friend class Streamer;
+    void AllocateFIFO();
+    SamplesFIFO* fifo;
+    int fifoNode;
 };
     
 class Streamer
@@ -151,10 +291,46 @@ public:
     int streamSize;
     unsigned txBatchSize;
     unsigned rxBatchSize;
+    unsigned txMaxBatchSize;
+    unsigned rxMaxBatchSize;
+    std::atomic<unsigned> txLateEvents; //late Tx packets reported by Rx
+    CommandExecutor* executor; //control queue of owning device, locked by stream start/stop
+    std::mutex threadInfoLock;
+    StreamChannel::ThreadInfo rxThreadInfo;
+    StreamChannel::ThreadInfo txThreadInfo;
     StreamConfig::StreamDataFormat dataLinkFormat;
     void ReceivePacketsLoop();
     void TransmitPacketsLoop();
+    int ReadDirect(StreamChannel* const* streams, void* const* samples, unsigned streamCount, const uint32_t count, StreamChannel::Metadata* meta, const int32_t timeout_ms);
+    bool PumpDirect(const int32_t timeout_ms);
 private:
+    const FPGA_DataPacket* NextDirectPacket(std::chrono::high_resolution_clock::time_point start, const int32_t timeout_ms);
+    int UnpackDirectPacket(const FPGA_DataPacket* pkt, complex16_t* const* dest);
+    friend class StreamChannel;
+    TransferTuner CreateTransferTuner(bool tx);
+    void ApplyThreadConfig(bool tx, bool helper = false);
+    unsigned GetMemoryFlags(bool tx) const;
+    bool UseDirectRx() const;
+    void StartDirectRx();
+    void StopDirectRx();
+    //! zero-copy Rx state, used from Read() instead of rxThread
+    struct DirectRx
+    {
+        std::mutex lock;
+        std::atomic<bool> active; //read without lock, ReadDirect() checks again under lock
+        StreamBuffer buffers;
+        std::vector<int> handles;
+        uint32_t bufferSize;
+        int bi;              //transfer currently being parsed
+        bool borrowed;       //transfer bi is finished and has to be resubmitted
+        unsigned pktCount;   //packets in transfer bi
+        unsigned pktIndex;   //next packet to parse
+        uint64_t prevTs;
+        int resetFlagsDelay;
+        unsigned long bytesReceived;
+        std::chrono::high_resolution_clock::time_point rateTime;
+        StreamChannel::Frame frames[2];
+    } directRx;
     void AlignRxTSP();
     void AlignRxRF(bool restoreValues);
     void AlignQuadrature(bool restoreValues);
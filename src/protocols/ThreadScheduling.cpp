@@ -0,0 +1,117 @@
+/**
+@file ThreadScheduling.cpp
+@author Lime Microsystems
+@brief Realtime priority, CPU affinity and NUMA helpers for streaming threads
+*/
+
+#include "ThreadScheduling.h"
+#include "Logger.h"
+#include <thread>
+#include <cstring>
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <pthread.h>
+#include <sched.h>
+#endif
+#ifdef __linux__
+#include <unistd.h>
+#include <sys/syscall.h>
+#endif
+
+namespace lime
+{
+
+int ApplyThreadPriority(int priority)
+{
+    if (priority <= 0)
+        return 0;
+#ifdef _WIN32
+    const int winPriority = priority >= 50 ? THREAD_PRIORITY_TIME_CRITICAL : THREAD_PRIORITY_HIGHEST;
+    if (SetThreadPriority(GetCurrentThread(), winPriority) == 0)
+    {
+        lime::warning("Failed to set streaming thread priority");
+        return 0;
+    }
+    return priority;
+#else
+    sched_param param;
+    memset(&param, 0, sizeof(param));
+    const int maxPriority = sched_get_priority_max(SCHED_FIFO);
+    const int minPriority = sched_get_priority_min(SCHED_FIFO);
+    param.sched_priority = priority > maxPriority ? maxPriority : (priority < minPriority ? minPriority : priority);
+    const int status = pthread_setschedparam(pthread_self(), SCHED_FIFO, &param);
+    if (status != 0)
+    {
+        lime::warning("Failed to set SCHED_FIFO priority %i for streaming thread: %s", param.sched_priority, strerror(status));
+        return 0;
+    }
+    return param.sched_priority;
+#endif
+}
+
+uint64_t ApplyThreadAffinity(uint64_t mask)
+{
+    if (mask == 0)
+        return 0;
+#ifdef _WIN32
+    if (SetThreadAffinityMask(GetCurrentThread(), DWORD_PTR(mask)) == 0)
+    {
+        lime::warning("Failed to set streaming thread CPU affinity 0x%llx", (unsigned long long)mask);
+        return 0;
+    }
+    return mask;
+#elif defined(__linux__)
+    cpu_set_t cpus;
+    CPU_ZERO(&cpus);
+    for (int i = 0; i < 64; ++i)
+        if (mask & (uint64_t(1) << i))
+            CPU_SET(i, &cpus);
+    const int status = pthread_setaffinity_np(pthread_self(), sizeof(cpus), &cpus);
+    if (status != 0)
+    {
+        lime::warning("Failed to set streaming thread CPU affinity 0x%llx: %s", (unsigned long long)mask, strerror(status));
+        return 0;
+    }
+    return mask;
+#else
+    lime::warning("CPU affinity is not supported on this platform");
+    return 0;
+#endif
+}
+
+int GetCurrentNumaNode()
+{
+#ifdef _WIN32
+    UCHAR node = 0;
+    if (!GetNumaProcessorNode(UCHAR(GetCurrentProcessorNumber()), &node) || node == 0xFF)
+        return -1;
+    return node;
+#elif defined(__linux__) && defined(SYS_getcpu)
+    unsigned cpu = 0;
+    unsigned node = 0;
+    if (syscall(SYS_getcpu, &cpu, &node, nullptr) != 0)
+        return -1;
+    return node;
+#else
+    return -1;
+#endif
+}
+
+int RunOnCPUs(uint64_t mask, const std::function<void()> &function)
+{
+    int node = -1;
+    std::thread worker([&]()
+    {
+        if (ApplyThreadAffinity(mask) != 0)
+            node = GetCurrentNumaNode();
+        function();
+    });
+    worker.join();
+    return node;
+}
+
+}
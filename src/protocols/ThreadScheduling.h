@@ -0,0 +1,39 @@
+/**
+@file ThreadScheduling.h
+@author Lime Microsystems
+@brief Realtime priority, CPU affinity and NUMA helpers for streaming threads
+*/
+
+#ifndef LMS_THREAD_SCHEDULING_H
+#define LMS_THREAD_SCHEDULING_H
+
+#include <stdint.h>
+#include <functional>
+
+namespace lime
+{
+
+/** @brief Switches calling thread to realtime scheduling
+    @param priority SCHED_FIFO priority 1-99, 0 leaves thread unchanged
+    @return applied priority, 0 if realtime scheduling could not be set
+*/
+int ApplyThreadPriority(int priority);
+
+/** @brief Restricts calling thread to the given CPUs
+    @param mask bit mask of allowed CPUs, 0 leaves thread unchanged
+    @return applied mask, 0 if affinity could not be set
+*/
+uint64_t ApplyThreadAffinity(uint64_t mask);
+
+//! @brief Returns NUMA node of the CPU calling thread runs on, -1 if unknown
+int GetCurrentNumaNode();
+
+/** @brief Runs function in a temporary thread restricted to the given CPUs
+    Memory first touched by the function is allocated on their NUMA node.
+    @return NUMA node the function was run on, -1 if unknown
+*/
+int RunOnCPUs(uint64_t mask, const std::function<void()> &function);
+
+}
+
+#endif
@@ -0,0 +1,140 @@
+/**
+@file TransferTuner.cpp
+@author Lime Microsystems
+@brief Runtime sizing of streaming transfers
+*/
+
+#include "TransferTuner.h"
+#include "Logger.h"
+#include <algorithm>
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <time.h>
+#endif
+
+using namespace lime;
+
+static const auto evaluationPeriod = std::chrono::milliseconds(250);
+static const double highLoad = 0.75; //loop thread is close to being the bottleneck
+static const double lowLoad = 0.3;
+static const int latencyCalmPeriods = 4;  //1 s without drops before shrinking
+static const int autoCalmPeriods = 16;    //4 s without drops before shrinking
+static const int floorDecayPeriods = 120; //30 s without drops to forget the floor
+
+TransferTuner::TransferTuner(StreamConfig::TransferPolicy policy, int maxDepth, int maxBatch, int depth, int batch) :
+    depth(depth),
+    batch(batch),
+    mPolicy(policy),
+    mMinDepth(std::min(2, maxDepth)),
+    mMaxDepth(maxDepth),
+    mMaxBatch(maxBatch),
+    mFloor(0),
+    mCalmPeriods(0),
+    mDrops(0),
+    mWaitTime(0)
+{
+    mPeriodStart = std::chrono::high_resolution_clock::now();
+    mCpuStart = ThreadCpuTime();
+}
+
+double TransferTuner::ThreadCpuTime()
+{
+#ifdef _WIN32
+    FILETIME creation, exit, kernel, user;
+    if (!GetThreadTimes(GetCurrentThread(), &creation, &exit, &kernel, &user))
+        return -1;
+    const uint64_t k = (uint64_t(kernel.dwHighDateTime) << 32) | kernel.dwLowDateTime;
+    const uint64_t u = (uint64_t(user.dwHighDateTime) << 32) | user.dwLowDateTime;
+    return (k + u) * 100e-9;
+#elif defined(CLOCK_THREAD_CPUTIME_ID)
+    timespec ts;
+    if (clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts) != 0)
+        return -1;
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+#else
+    return -1;
+#endif
+}
+
+bool TransferTuner::TransferDone(std::chrono::high_resolution_clock::duration waitTime, unsigned dropEvents)
+{
+    if (mPolicy == StreamConfig::TRANSFER_STATIC)
+        return false;
+    mWaitTime += waitTime;
+    mDrops += dropEvents;
+
+    const auto now = std::chrono::high_resolution_clock::now();
+    const auto period = now - mPeriodStart;
+    if (period < evaluationPeriod)
+        return false;
+
+    const double seconds = std::chrono::duration<double>(period).count();
+    const double cpuNow = ThreadCpuTime();
+    double load;
+    if (cpuNow >= 0 && mCpuStart >= 0)
+        load = (cpuNow - mCpuStart) / seconds;
+    else //time not spent waiting for transfers
+        load = 1.0 - std::chrono::duration<double>(mWaitTime).count() / seconds;
+
+    const bool changed = Evaluate(load, mDrops);
+    mPeriodStart = now;
+    mCpuStart = cpuNow;
+    mWaitTime = std::chrono::high_resolution_clock::duration(0);
+    mDrops = 0;
+    return changed;
+}
+
+bool TransferTuner::Evaluate(double load, unsigned drops)
+{
+    if (drops)
+    {
+        mCalmPeriods = 0;
+        mFloor = std::max(mFloor, depth*batch);
+        //busy thread needs fewer, larger transfers, otherwise queue more of them
+        return Grow(load > highLoad);
+    }
+    if (load > highLoad)
+    {
+        mCalmPeriods = 0;
+        return Grow(true);
+    }
+    if (++mCalmPeriods % floorDecayPeriods == 0)
+        mFloor /= 2;
+    if (mPolicy == StreamConfig::TRANSFER_THROUGHPUT || load > lowLoad)
+        return false;
+    const int calmNeeded = mPolicy == StreamConfig::TRANSFER_LATENCY ? latencyCalmPeriods : autoCalmPeriods;
+    if (mCalmPeriods % calmNeeded != 0)
+        return false;
+    return Shrink();
+}
+
+bool TransferTuner::Grow(bool preferBatch)
+{
+    if (preferBatch && batch < mMaxBatch)
+        batch = std::min(batch*2, mMaxBatch);
+    else if (depth < mMaxDepth)
+        depth = std::min(depth*2, mMaxDepth);
+    else if (batch < mMaxBatch)
+        batch = std::min(batch*2, mMaxBatch);
+    else
+        return false;
+    lime::debug("Streaming transfers increased to %i x %i packets", depth, batch);
+    return true;
+}
+
+bool TransferTuner::Shrink()
+{
+    //smaller transfers reduce latency the most, drop queue depth last
+    if (batch > 1 && (batch/2)*depth > mFloor)
+        batch /= 2;
+    else if (depth > mMinDepth && std::max(depth/2, mMinDepth)*batch > mFloor)
+        depth = std::max(depth/2, mMinDepth);
+    else
+        return false;
+    lime::debug("Streaming transfers reduced to %i x %i packets", depth, batch);
+    return true;
+}
@@ -0,0 +1,63 @@
+/**
+@file TransferTuner.h
+@author Lime Microsystems
+@brief Runtime sizing of streaming transfers
+*/
+
+#ifndef LMS_TRANSFER_TUNER_H
+#define LMS_TRANSFER_TUNER_H
+
+#include "Streamer.h"
+#include <chrono>
+
+namespace lime
+{
+
+/** @brief Chooses number of in-flight transfers and packets per transfer
+    for a streaming loop.
+
+    The loop reports every completed transfer with the time it spent waiting
+    for it and the number of drop events (overflows, underflows, lost or late
+    packets) it observed. Every evaluation period the tuner looks at drops and
+    at the CPU load of the loop thread: drops and high load grow the transfers,
+    a long calm period with low load shrinks them again, except for the
+    throughput-first policy. A configuration that produced drops is remembered
+    and is not shrunk into again until it has been calm for a long time.
+*/
+class TransferTuner
+{
+public:
+    TransferTuner(StreamConfig::TransferPolicy policy, int maxDepth, int maxBatch, int depth, int batch);
+
+    //! @brief Records completed transfer, returns true if depth or batch was changed
+    bool TransferDone(std::chrono::high_resolution_clock::duration waitTime, unsigned dropEvents);
+
+    int MaxDepth() const {return mMaxDepth;}
+    int MaxBatch() const {return mMaxBatch;}
+
+    //! Number of transfers to keep in flight
+    int depth;
+    //! Number of packets per transfer
+    int batch;
+
+private:
+    bool Evaluate(double load, unsigned drops);
+    bool Grow(bool preferBatch);
+    bool Shrink();
+    static double ThreadCpuTime();
+
+    const StreamConfig::TransferPolicy mPolicy;
+    const int mMinDepth;
+    const int mMaxDepth;
+    const int mMaxBatch;
+    int mFloor; //depth*batch known to drop packets
+    int mCalmPeriods;
+    unsigned mDrops;
+    std::chrono::high_resolution_clock::duration mWaitTime;
+    std::chrono::high_resolution_clock::time_point mPeriodStart;
+    double mCpuStart;
+};
+
+}
+
+#endif
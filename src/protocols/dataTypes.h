@@ -19,6 +19,12 @@ struct complex16_t
     int16_t q;
 };
 
+struct complex32f_t
+{
+    float i;
+    float q;
+};
+
 const int samples12InPkt = 1360;
 const int samples16InPkt = 1020; 
 
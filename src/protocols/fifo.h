@@ -9,21 +9,29 @@
 #include <queue>
 #include <condition_variable>
 #include "dataTypes.h"
+#include "SamplesConversion.h"
+#include "StreamMemory.h"
 #include <cmath>
+#include <algorithm>
+#include <chrono>
 #include <assert.h>
+#include <new>
+#include <string.h>
 
 namespace lime{
 
-class RingFIFO
+/** @brief Interface of the samples FIFO used between streaming threads and
+    StreamChannel Read()/Write()
+*/
+class SamplesFIFO
 {
 public:
-
     struct BufferInfo
     {
         uint32_t size;
         uint32_t itemsFilled;
     };
-    
+
     enum StreamFlags
     {
         SYNC_TIMESTAMP = 1,
@@ -31,8 +39,104 @@ public:
         OVERWRITE_OLD = 4,
     };
 
+    //! Samples count, timestamp and flags of one packet in batch operations
+    struct PacketInfo
+    {
+        uint64_t timestamp;
+        uint32_t flags;
+        uint32_t count;
+    };
+
+    virtual ~SamplesFIFO(){};
+    virtual BufferInfo GetInfo() = 0;
+    virtual uint32_t push_samples(const complex16_t *buffer, const uint32_t samplesCount, const uint8_t channelsCount, uint64_t timestamp, const uint32_t timeout_ms, const uint32_t flags = 0) = 0;
+    virtual uint32_t pop_samples(complex16_t* buffer, const uint32_t samplesCount, const uint8_t channelsCount, uint64_t *timestamp, const uint32_t timeout_ms, uint32_t *flags = nullptr) = 0;
+    //! @brief push_samples() variant converting from float, fullScale is the integer value of 1.0f
+    virtual uint32_t push_samples(const complex32f_t *buffer, const uint32_t samplesCount, const uint8_t channelsCount, uint64_t timestamp, const uint32_t timeout_ms, const uint32_t flags, const float fullScale) = 0;
+    //! @brief pop_samples() variant converting to float, fullScale is the integer value of 1.0f
+    virtual uint32_t pop_samples(complex32f_t* buffer, const uint32_t samplesCount, const uint8_t channelsCount, uint64_t *timestamp, const uint32_t timeout_ms, uint32_t *flags, const float fullScale) = 0;
+    virtual void Clear() = 0;
+
+    /** @brief Gives direct access to the samples of the oldest FIFO slot, consumer side
+        The slot stays owned by the caller until release_read(), the producer
+        drops new samples instead of overwriting it.
+        @param samples returns pointer to the first unread sample of the slot
+        @param timestamp returns timestamp of the first sample
+        @param flags returns flags associated with the slot
+        @param timeout_ms timeout duration for operation
+        @return number of samples available at *samples, 0 on timeout
+    */
+    virtual uint32_t acquire_read(const complex16_t** samples, uint64_t* timestamp, uint32_t* flags, const uint32_t timeout_ms) = 0;
+    //! @brief Consumes count samples of the slot returned by acquire_read()
+    virtual void release_read(const uint32_t count) = 0;
+    /** @brief Gives direct access to a free FIFO slot, producer side
+        @param samples returns pointer to the slot sample memory
+        @param timeout_ms timeout duration for operation
+        @return slot capacity in samples, 0 on timeout
+    */
+    virtual uint32_t acquire_write(complex16_t** samples, const uint32_t timeout_ms) = 0;
+    //! @brief Publishes count samples written into the slot returned by acquire_write()
+    virtual void release_write(const uint32_t count, const uint64_t timestamp, const uint32_t flags) = 0;
+
+    /** @brief Inserts several packets, waking the consumer only once
+        @param buffer samples of packet i start at buffer[i*stride]
+        @param stride distance between packets in buffer, in samples
+        @param packets samples count, timestamp and flags of each packet
+        @param packetCount number of packets to insert
+        @param timeout_ms timeout duration for operation
+        @return number of packets inserted completely
+    */
+    virtual uint32_t push_packets(const complex16_t* buffer, const uint32_t stride, const PacketInfo* packets, const uint32_t packetCount, const uint32_t timeout_ms) = 0;
+    /** @brief Takes up to packetCount packets of samplesPerPacket samples each,
+        waking the producer only once. Stops after a packet with END_BURST.
+        @param buffer destination, packet i is stored at buffer[i*samplesPerPacket]
+        @param samplesPerPacket number of samples in each packet
+        @param packets returns samples count, timestamp of the first sample and
+        combined flags of each packet
+        @param packetCount maximum number of packets
+        @param timeout_ms timeout duration for waiting on each packet
+        @return number of packets taken, last one has fewer samples than
+        samplesPerPacket on timeout or end of burst
+    */
+    virtual uint32_t pop_packets(complex16_t* buffer, const uint32_t samplesPerPacket, PacketInfo* packets, const uint32_t packetCount, const uint32_t timeout_ms) = 0;
+
+protected:
+    //! FIFO slots come from StreamMemory, so they stay faulted in between streams
+    static SamplesPacket* AllocatePackets(const uint32_t count, const unsigned memoryFlags)
+    {
+        void* memory = StreamMemory::Allocate(count*sizeof(SamplesPacket), memoryFlags);
+        if (memory == nullptr)
+            throw std::bad_alloc();
+        SamplesPacket* packets = static_cast<SamplesPacket*>(memory);
+        for (uint32_t i = 0; i < count; ++i)
+            new (&packets[i]) SamplesPacket();
+        return packets;
+    }
+    static void FreePackets(SamplesPacket* packets)
+    {
+        StreamMemory::Release(packets);
+    }
+
+    //! Copy between user buffers and FIFO slots, converting the format on the way
+    static inline void CopySamples(complex16_t* dest, const complex16_t* src, const uint32_t count, const float)
+    {
+        memcpy(dest, src, count*sizeof(complex16_t));
+    }
+    static inline void CopySamples(complex32f_t* dest, const complex16_t* src, const uint32_t count, const float fullScale)
+    {
+        ConvertToFloat32(dest, src, count, fullScale);
+    }
+    static inline void CopySamples(complex16_t* dest, const complex32f_t* src, const uint32_t count, const float fullScale)
+    {
+        ConvertFromFloat32(dest, src, count, fullScale);
+    }
+};
+
+class RingFIFO : public SamplesFIFO
+{
+public:
     //! @brief Returns information about FIFO size and fullness
-    BufferInfo GetInfo()
+    BufferInfo GetInfo() override
     {
         std::unique_lock<std::mutex> lck(lock);
         BufferInfo stats;
@@ -41,17 +145,20 @@ public:
         return stats;
     }
 
-    //!    @brief Initializes FIFO memory
-    RingFIFO(const uint32_t bufLength) : mBufferSize(1+(bufLength-1)/mBuffer->maxSamplesInPacket)
+    /** @brief Initializes FIFO memory
+        @param bufLength FIFO capacity in samples
+        @param memoryFlags StreamMemory::Flags for the FIFO memory
+    */
+    RingFIFO(const uint32_t bufLength, const unsigned memoryFlags = 0) : mBufferSize(1+(bufLength-1)/mBuffer->maxSamplesInPacket)
     {
-        mBuffer = new SamplesPacket[mBufferSize];
+        mBuffer = AllocatePackets(mBufferSize, memoryFlags);
         Clear();
     }
 
     ~RingFIFO()
     {
-        delete []mBuffer;
-    };
+        FreePackets(mBuffer);
+    }
 
     /** @brief inserts samples to FIFO, operation is thread-safe
     @param buffer pointers to arrays containing samples data of each channel
@@ -61,12 +168,165 @@ public:
     @param flags optional flags associated with the samples
     @return number of items inserted
     */
-    uint32_t push_samples(const complex16_t *buffer, const uint32_t samplesCount, const uint8_t channelsCount, uint64_t timestamp, const uint32_t timeout_ms, const uint32_t flags = 0)
+    uint32_t push_samples(const complex16_t *buffer, const uint32_t samplesCount, const uint8_t /*channelsCount*/, uint64_t timestamp, const uint32_t timeout_ms, const uint32_t flags = 0) override
+    {
+        return PushSamples(buffer, samplesCount, timestamp, timeout_ms, flags, 0);
+    }
+
+    uint32_t push_samples(const complex32f_t *buffer, const uint32_t samplesCount, const uint8_t /*channelsCount*/, uint64_t timestamp, const uint32_t timeout_ms, const uint32_t flags, const float fullScale) override
+    {
+        return PushSamples(buffer, samplesCount, timestamp, timeout_ms, flags, fullScale);
+    }
+
+    /** @brief Takes samples out of FIFO, operation is thread-safe
+        @param buffer pointers to destination arrays for each channel's samples data, each array must be big enough to contain \samplesCount number of samples.
+        @param samplesCount number of samples to pop
+        @param channelsCount number of channels to pop
+        @param timestamp returns timestamp of the first sample in buffer
+        @param timeout_ms timeout duration for operation
+        @param flags optional flags associated with the samples
+        @return number of samples popped
+    */
+    uint32_t pop_samples(complex16_t* buffer, const uint32_t samplesCount, const uint8_t /*channelsCount*/, uint64_t *timestamp, const uint32_t timeout_ms, uint32_t *flags = nullptr) override
+    {
+        return PopSamples(buffer, samplesCount, timestamp, timeout_ms, flags, 0);
+    }
+
+    uint32_t pop_samples(complex32f_t* buffer, const uint32_t samplesCount, const uint8_t /*channelsCount*/, uint64_t *timestamp, const uint32_t timeout_ms, uint32_t *flags, const float fullScale) override
+    {
+        return PopSamples(buffer, samplesCount, timestamp, timeout_ms, flags, fullScale);
+    }
+
+    void Clear() override
+    {
+        std::unique_lock<std::mutex> lck(lock);
+        mHead = 0;
+        mTail = 0;
+        mElementsFilled = 0;
+        mReadAcquired = false;
+    }
+
+    uint32_t acquire_read(const complex16_t** samples, uint64_t* timestamp, uint32_t* flags, const uint32_t timeout_ms) override
+    {
+        std::unique_lock<std::mutex> lck(lock);
+        while (mElementsFilled == 0) //buffer might be empty, wait for packets
+        {
+            if (timeout_ms == 0)
+                return 0;
+            if (hasItems.wait_for(lck, std::chrono::milliseconds(timeout_ms)) == std::cv_status::timeout)
+                return 0;
+        }
+        const SamplesPacket &pkt = mBuffer[mHead];
+        *samples = &pkt.samples[pkt.first];
+        if (timestamp != nullptr) *timestamp = pkt.timestamp + pkt.first;
+        if (flags != nullptr) *flags = pkt.flags;
+        mReadAcquired = true;
+        return pkt.last - pkt.first;
+    }
+
+    void release_read(const uint32_t count) override
+    {
+        std::unique_lock<std::mutex> lck(lock);
+        if (!mReadAcquired)
+            return;
+        mReadAcquired = false;
+        SamplesPacket &pkt = mBuffer[mHead];
+        if (pkt.first + count >= pkt.last) //packet depleated
+        {
+            mHead = (mHead + 1) & (mBufferSize - 1);//advance to next one
+            --mElementsFilled;
+        }
+        else
+            pkt.first += count;
+        lck.unlock();
+        hasItems.notify_one();
+    }
+
+    uint32_t acquire_write(complex16_t** samples, const uint32_t timeout_ms) override
+    {
+        std::unique_lock<std::mutex> lck(lock);
+        while (mElementsFilled >= mBufferSize) //buffer might be full, wait for free slots
+        {
+            if (timeout_ms == 0)
+                return 0;
+            if (hasItems.wait_for(lck, std::chrono::milliseconds(timeout_ms)) == std::cv_status::timeout)
+                return 0;
+        }
+        *samples = mBuffer[mTail].samples;
+        return SamplesPacket::maxSamplesInPacket;
+    }
+
+    void release_write(const uint32_t count, const uint64_t timestamp, const uint32_t flags) override
+    {
+        if (count == 0)
+            return;
+        std::unique_lock<std::mutex> lck(lock);
+        SamplesPacket &pkt = mBuffer[mTail];
+        pkt.timestamp = timestamp;
+        pkt.flags = flags;
+        pkt.first = 0;
+        pkt.last = std::min<uint32_t>(count, SamplesPacket::maxSamplesInPacket);
+        mTail = (mTail + 1) & (mBufferSize - 1);//advance to next one
+        ++mElementsFilled;
+        lck.unlock();
+        hasItems.notify_one();
+    }
+
+    uint32_t push_packets(const complex16_t* buffer, const uint32_t stride, const PacketInfo* packets, const uint32_t packetCount, const uint32_t timeout_ms) override
+    {
+        assert(buffer != nullptr);
+        uint32_t i = 0;
+        std::unique_lock<std::mutex> lck(lock);
+        const auto t1 = std::chrono::high_resolution_clock::now();
+        for (; i < packetCount; ++i)
+        {
+            const PacketInfo &pkt = packets[i];
+            if (PushLocked(lck, &buffer[i*stride], pkt.count, pkt.timestamp, t1, timeout_ms, pkt.flags, 0) != pkt.count)
+                break;
+        }
+        lck.unlock();
+        hasItems.notify_one();
+        return i;
+    }
+
+    uint32_t pop_packets(complex16_t* buffer, const uint32_t samplesPerPacket, PacketInfo* packets, const uint32_t packetCount, const uint32_t timeout_ms) override
+    {
+        assert(buffer != nullptr);
+        uint32_t i = 0;
+        std::unique_lock<std::mutex> lck(lock);
+        while (i < packetCount)
+        {
+            PacketInfo &pkt = packets[i];
+            pkt.count = PopLocked(lck, &buffer[i*samplesPerPacket], samplesPerPacket, &pkt.timestamp, timeout_ms, &pkt.flags, 0);
+            if (pkt.count == 0)
+                break;
+            ++i;
+            if (pkt.count != samplesPerPacket || (pkt.flags & END_BURST))
+                break;
+        }
+        lck.unlock();
+        hasItems.notify_one();
+        return i;
+    }
+
+protected:
+    template<typename T>
+    uint32_t PushSamples(const T *buffer, const uint32_t samplesCount, uint64_t timestamp, const uint32_t timeout_ms, const uint32_t flags, const float fullScale)
     {
         assert(buffer != nullptr);
-        uint32_t samplesTaken = 0;
         std::unique_lock<std::mutex> lck(lock);
-        auto t1 = std::chrono::high_resolution_clock::now();
+        const uint32_t samplesTaken = PushLocked(lck, buffer, samplesCount, timestamp, std::chrono::high_resolution_clock::now(), timeout_ms, flags, fullScale);
+        lck.unlock();
+        hasItems.notify_one();
+        return samplesTaken;
+    }
+
+    //! Inserts samples while lock is held, consumer is not notified
+    template<typename T>
+    uint32_t PushLocked(std::unique_lock<std::mutex> &lck, const T *buffer, const uint32_t samplesCount, uint64_t timestamp,
+        const std::chrono::high_resolution_clock::time_point t1, const uint32_t timeout_ms, const uint32_t flags, const float fullScale)
+    {
+        uint32_t samplesTaken = 0;
         while (samplesTaken < samplesCount)
         {
             if (mElementsFilled >= mBufferSize) //buffer might be full, wait for free slots
@@ -74,7 +334,9 @@ public:
                 auto t2 = std::chrono::high_resolution_clock::now();
                 if(t2-t1 >= std::chrono::milliseconds(timeout_ms))
                     return samplesTaken;
-                if(flags & OVERWRITE_OLD)
+                if((flags & OVERWRITE_OLD) && mReadAcquired) //oldest slot is in use, drop new samples
+                    return samplesTaken;
+                else if(flags & OVERWRITE_OLD)
                 {
                     int dropElements = 1+(samplesCount-samplesTaken)/SamplesPacket::maxSamplesInPacket;
                     mHead = (mHead + dropElements) & (mBufferSize - 1);//advance to next one
@@ -82,6 +344,7 @@ public:
                 }
                 else  //there is no space, wait on CV to give pop_samples the thread context
                 {
+                    hasItems.notify_one(); //packets of a batch have not been signaled yet
                     hasItems.wait_for(lck, std::chrono::milliseconds(timeout_ms));
                 }
             }
@@ -96,7 +359,7 @@ public:
                 }
                 else
                     mBuffer[mTail].flags = flags;
-                memcpy(mBuffer[mTail].samples,&buffer[samplesTaken],cnt*sizeof(complex16_t));
+                CopySamples(mBuffer[mTail].samples,&buffer[samplesTaken],cnt,fullScale);
                 samplesTaken+=cnt;
                 mBuffer[mTail].last = cnt;
                 mBuffer[mTail++].first = 0;
@@ -104,32 +367,33 @@ public:
                 ++mElementsFilled;
             }
         }
-        lck.unlock();
-        hasItems.notify_one();
         return samplesTaken;
     }
 
-    /** @brief Takes samples out of FIFO, operation is thread-safe
-        @param buffer pointers to destination arrays for each channel's samples data, each array must be big enough to contain \samplesCount number of samples.
-        @param samplesCount number of samples to pop
-        @param channelsCount number of channels to pop
-        @param timestamp returns timestamp of the first sample in buffer
-        @param timeout_ms timeout duration for operation
-        @param flags optional flags associated with the samples
-        @return number of samples popped
-    */
-    uint32_t pop_samples(complex16_t* buffer, const uint32_t samplesCount, const uint8_t channelsCount, uint64_t *timestamp, const uint32_t timeout_ms, uint32_t *flags = nullptr)
+    template<typename T>
+    uint32_t PopSamples(T* buffer, const uint32_t samplesCount, uint64_t *timestamp, const uint32_t timeout_ms, uint32_t *flags, const float fullScale)
     {
         assert(buffer != nullptr);
+        std::unique_lock<std::mutex> lck(lock);
+        const uint32_t samplesFilled = PopLocked(lck, buffer, samplesCount, timestamp, timeout_ms, flags, fullScale);
+        lck.unlock();
+        hasItems.notify_one();
+        return samplesFilled;
+    }
+
+    //! Takes samples while lock is held, producer is not notified
+    template<typename T>
+    uint32_t PopLocked(std::unique_lock<std::mutex> &lck, T* buffer, const uint32_t samplesCount, uint64_t *timestamp, const uint32_t timeout_ms, uint32_t *flags, const float fullScale)
+    {
         uint32_t samplesFilled = 0;
         if (flags != nullptr) *flags = 0;
-        std::unique_lock<std::mutex> lck(lock);
         while (samplesFilled < samplesCount)
         {
             while (mElementsFilled == 0) //buffer might be empty, wait for packets
             {
                 if (timeout_ms == 0)
                     return samplesFilled;
+                hasItems.notify_one(); //slots freed by a batch have not been signaled yet
                 if (hasItems.wait_for(lck, std::chrono::milliseconds(timeout_ms)) == std::cv_status::timeout)
                     return samplesFilled;
             }
@@ -146,7 +410,7 @@ public:
                 const int cntbuf = mBuffer[mHead].last - first;
                 cnt = cnt > cntbuf ? cntbuf : cnt;
 
-                memcpy(&buffer[samplesFilled],&mBuffer[mHead].samples[first],cnt*sizeof(complex16_t));
+                CopySamples(&buffer[samplesFilled],&mBuffer[mHead].samples[first],cnt,fullScale);
                 samplesFilled += cnt;
 
                 if (cntbuf == cnt) //packet depleated
@@ -159,33 +423,417 @@ public:
 
                 //leave the loop early when end of burst is encountered
                 //so that the calling loop can flush out the buffer
-                if (hasEOB) goto done;
+                if (hasEOB) return samplesFilled;
             }
         }
-        done:
-        lck.unlock();
-        hasItems.notify_one();
         return samplesFilled;
     }
 
-    void Clear()
-    {
-        std::unique_lock<std::mutex> lck(lock);
-        mHead = 0;
-        mTail = 0;
-        mElementsFilled = 0;
-    }
-
-protected:
     const uint32_t mBufferSize;
     SamplesPacket* mBuffer;
     uint32_t mHead;
     uint32_t mTail;
     uint32_t mElementsFilled;
+    bool mReadAcquired; //head slot is accessed through acquire_read()
     std::mutex lock;
     std::condition_variable hasItems;
 };
 
+/** @brief Single producer/single consumer FIFO with atomic head and tail indices.
+
+    The producer and the consumer never take a lock while there is data or free
+    space available. When waiting is necessary, the behaviour is selected by
+    WaitPolicy; the blocking part only takes a lock and notifies when the other
+    side is actually sleeping.
+
+    Exactly one thread may push and exactly one thread may pop at a time.
+    OVERWRITE_OLD is supported by letting the producer advance the head index,
+    the consumer detects such drops and discards the samples it copied from an
+    overwritten slot.
+*/
+class LockFreeRingFIFO : public SamplesFIFO
+{
+public:
+    enum WaitPolicy
+    {
+        WAIT_BLOCK,            ///<sleep immediately when FIFO is empty/full
+        WAIT_SPIN,             ///<busy wait until timeout, lowest latency
+        WAIT_SPIN_THEN_BLOCK,  ///<busy wait for a short while, then sleep
+    };
+
+    /** @brief Initializes FIFO memory
+        @param bufLength FIFO capacity in samples, rounded up to power of two packets
+        @param policy waiting strategy of blocking operations
+        @param memoryFlags StreamMemory::Flags for the FIFO memory
+    */
+    LockFreeRingFIFO(const uint32_t bufLength, const WaitPolicy policy = WAIT_SPIN_THEN_BLOCK, const unsigned memoryFlags = 0) :
+        mBufferSize(PacketsCount(bufLength)),
+        mPolicy(policy)
+    {
+        mBuffer = AllocatePackets(mBufferSize, memoryFlags);
+        mHead.store(0);
+        mTail.store(0);
+        mReadIndex = 0;
+        mReadOffset = 0;
+        mPinned.store(noPin);
+        mPopWaiters.store(0);
+        mPushWaiters.store(0);
+    }
+
+    ~LockFreeRingFIFO()
+    {
+        FreePackets(mBuffer);
+    }
+
+    //! @brief Returns information about FIFO size and fullness
+    BufferInfo GetInfo() override
+    {
+        BufferInfo stats;
+        const uint32_t filled = mTail.load(std::memory_order_acquire) - mHead.load(std::memory_order_acquire);
+        stats.size = mBufferSize*SamplesPacket::maxSamplesInPacket;
+        stats.itemsFilled = std::min(filled, mBufferSize)*SamplesPacket::maxSamplesInPacket;
+        return stats;
+    }
+
+    /** @brief inserts samples to FIFO, must be called only from the producer thread
+    @param buffer pointers to arrays containing samples data of each channel
+    @param samplesCount number of samples to insert from each buffer channel
+    @param channelsCount number of channels to insert
+    @param timeout_ms timeout duration for operation
+    @param flags optional flags associated with the samples
+    @return number of items inserted
+    */
+    uint32_t push_samples(const complex16_t *buffer, const uint32_t samplesCount, const uint8_t /*channelsCount*/, uint64_t timestamp, const uint32_t timeout_ms, const uint32_t flags = 0) override
+    {
+        return PushSamples(buffer, samplesCount, timestamp, timeout_ms, flags, 0);
+    }
+
+    uint32_t push_samples(const complex32f_t *buffer, const uint32_t samplesCount, const uint8_t /*channelsCount*/, uint64_t timestamp, const uint32_t timeout_ms, const uint32_t flags, const float fullScale) override
+    {
+        return PushSamples(buffer, samplesCount, timestamp, timeout_ms, flags, fullScale);
+    }
+
+    /** @brief Takes samples out of FIFO, must be called only from the consumer thread
+        @param buffer pointers to destination arrays for each channel's samples data, each array must be big enough to contain \samplesCount number of samples.
+        @param samplesCount number of samples to pop
+        @param channelsCount number of channels to pop
+        @param timestamp returns timestamp of the first sample in buffer
+        @param timeout_ms timeout duration for operation
+        @param flags optional flags associated with the samples
+        @return number of samples popped
+    */
+    uint32_t pop_samples(complex16_t* buffer, const uint32_t samplesCount, const uint8_t /*channelsCount*/, uint64_t *timestamp, const uint32_t timeout_ms, uint32_t *flags = nullptr) override
+    {
+        return PopSamples(buffer, samplesCount, timestamp, timeout_ms, flags, 0);
+    }
+
+    uint32_t pop_samples(complex32f_t* buffer, const uint32_t samplesCount, const uint8_t /*channelsCount*/, uint64_t *timestamp, const uint32_t timeout_ms, uint32_t *flags, const float fullScale) override
+    {
+        return PopSamples(buffer, samplesCount, timestamp, timeout_ms, flags, fullScale);
+    }
+
+    //! @brief Discards all packets, must be called only from the consumer thread
+    void Clear() override
+    {
+        const uint32_t tail = mTail.load(std::memory_order_acquire);
+        mHead.store(tail, std::memory_order_release);
+        mReadIndex = tail;
+        mReadOffset = 0;
+        mPinned.store(noPin);
+        Notify(mPushWaiters, mCanPush);
+    }
+
+    //! @brief acquire_read() must be called only from the consumer thread
+    uint32_t acquire_read(const complex16_t** samples, uint64_t* timestamp, uint32_t* flags, const uint32_t timeout_ms) override
+    {
+        uint32_t head = mHead.load(std::memory_order_acquire);
+        for (;;)
+        {
+            if (head == mTail.load(std::memory_order_acquire)) //buffer is empty, wait for packets
+            {
+                if (timeout_ms == 0 || !Wait(mPopWaiters, mCanPop, timeout_ms, [this]{
+                        return mHead.load(std::memory_order_acquire) != mTail.load(std::memory_order_acquire);}))
+                    return 0;
+                head = mHead.load(std::memory_order_acquire);
+                continue;
+            }
+            //pin the slot, then make sure producer has not dropped it in the meantime
+            mPinned.store(head);
+            const uint32_t check = mHead.load();
+            if (check == head)
+                break;
+            head = check;
+        }
+        if (head != mReadIndex) //partially read packet was dropped by producer
+        {
+            mReadIndex = head;
+            mReadOffset = 0;
+        }
+        const SamplesPacket &pkt = mBuffer[head & (mBufferSize - 1)];
+        *samples = &pkt.samples[mReadOffset];
+        if (timestamp != nullptr) *timestamp = pkt.timestamp + mReadOffset;
+        if (flags != nullptr) *flags = pkt.flags;
+        return std::max(int(pkt.last) - int(mReadOffset), 0);
+    }
+
+    //! @brief release_read() must be called only from the consumer thread
+    void release_read(const uint32_t count) override
+    {
+        if (mPinned.load(std::memory_order_relaxed) == noPin)
+            return;
+        uint32_t head = mReadIndex;
+        const uint32_t last = mBuffer[head & (mBufferSize - 1)].last;
+        mPinned.store(noPin);
+        if (mReadOffset + count >= last) //packet depleted
+        {
+            mHead.compare_exchange_strong(head, head + 1, std::memory_order_acq_rel);
+            mReadIndex = mReadIndex + 1;
+            mReadOffset = 0;
+        }
+        else
+            mReadOffset += count;
+        //producer may be waiting for the unpinned slot in acquire_write()
+        Notify(mPushWaiters, mCanPush);
+    }
+
+    //! @brief acquire_write() must be called only from the producer thread
+    uint32_t acquire_write(complex16_t** samples, const uint32_t timeout_ms) override
+    {
+        const uint32_t tail = mTail.load(std::memory_order_relaxed);
+        //buffer might be full, or slot dropped by overwrite is still used by consumer
+        auto writable = [this, tail]{
+            return tail - mHead.load(std::memory_order_acquire) < mBufferSize
+                && uint64_t(tail - mBufferSize) != mPinned.load();};
+        if (!writable() && (timeout_ms == 0 || !Wait(mPushWaiters, mCanPush, timeout_ms, writable)))
+            return 0;
+        *samples = mBuffer[tail & (mBufferSize - 1)].samples;
+        return SamplesPacket::maxSamplesInPacket;
+    }
+
+    //! @brief release_write() must be called only from the producer thread
+    void release_write(const uint32_t count, const uint64_t timestamp, const uint32_t flags) override
+    {
+        if (count == 0)
+            return;
+        const uint32_t tail = mTail.load(std::memory_order_relaxed);
+        SamplesPacket &pkt = mBuffer[tail & (mBufferSize - 1)];
+        pkt.timestamp = timestamp;
+        pkt.flags = flags;
+        pkt.first = 0;
+        pkt.last = std::min<uint32_t>(count, SamplesPacket::maxSamplesInPacket);
+        mTail.store(tail + 1, std::memory_order_release);
+        Notify(mPopWaiters, mCanPop);
+    }
+
+    //! @brief push_packets() must be called only from the producer thread
+    uint32_t push_packets(const complex16_t* buffer, const uint32_t stride, const PacketInfo* packets, const uint32_t packetCount, const uint32_t timeout_ms) override
+    {
+        assert(buffer != nullptr);
+        uint32_t i = 0;
+        for (; i < packetCount; ++i)
+        {
+            const PacketInfo &pkt = packets[i];
+            if (PushSamples(&buffer[i*stride], pkt.count, pkt.timestamp, timeout_ms, pkt.flags, 0, true) != pkt.count)
+                break;
+        }
+        Notify(mPopWaiters, mCanPop);
+        return i;
+    }
+
+    //! @brief pop_packets() must be called only from the consumer thread
+    uint32_t pop_packets(complex16_t* buffer, const uint32_t samplesPerPacket, PacketInfo* packets, const uint32_t packetCount, const uint32_t timeout_ms) override
+    {
+        assert(buffer != nullptr);
+        uint32_t i = 0;
+        while (i < packetCount)
+        {
+            PacketInfo &pkt = packets[i];
+            pkt.count = PopSamples(&buffer[i*samplesPerPacket], samplesPerPacket, &pkt.timestamp, timeout_ms, &pkt.flags, 0, true);
+            if (pkt.count == 0)
+                break;
+            ++i;
+            if (pkt.count != samplesPerPacket || (pkt.flags & END_BURST))
+                break;
+        }
+        Notify(mPushWaiters, mCanPush);
+        return i;
+    }
+
+protected:
+    /** Batch operations defer waking the other side until the whole batch is
+        done, but still wake it before going to sleep themselves.
+    */
+    template<typename T>
+    uint32_t PushSamples(const T *buffer, const uint32_t samplesCount, uint64_t timestamp, const uint32_t timeout_ms, const uint32_t flags, const float fullScale, const bool batch = false)
+    {
+        assert(buffer != nullptr);
+        uint32_t samplesTaken = 0;
+        while (samplesTaken < samplesCount)
+        {
+            const uint32_t tail = mTail.load(std::memory_order_relaxed);
+            uint32_t head = mHead.load(std::memory_order_acquire);
+            if (tail - head >= mBufferSize) //buffer is full
+            {
+                if(flags & OVERWRITE_OLD) //drop the oldest packet
+                {
+                    mHead.compare_exchange_strong(head, head + 1);
+                    continue;
+                }
+                if (batch)
+                    Notify(mPopWaiters, mCanPop);
+                if (!Wait(mPushWaiters, mCanPush, timeout_ms, [this, tail]{
+                        return tail - mHead.load(std::memory_order_acquire) < mBufferSize;}))
+                    return samplesTaken;
+                continue;
+            }
+
+            //slot dropped by overwrite is still accessed through acquire_read()
+            if (uint64_t(tail - mBufferSize) == mPinned.load())
+                return samplesTaken;
+
+            SamplesPacket &pkt = mBuffer[tail & (mBufferSize - 1)];
+            pkt.timestamp = timestamp + samplesTaken;
+            int cnt = samplesCount-samplesTaken;
+            if (cnt > SamplesPacket::maxSamplesInPacket)
+            {
+                cnt = SamplesPacket::maxSamplesInPacket;
+                pkt.flags = flags & SYNC_TIMESTAMP;
+            }
+            else
+                pkt.flags = flags;
+            CopySamples(pkt.samples,&buffer[samplesTaken],cnt,fullScale);
+            samplesTaken+=cnt;
+            pkt.last = cnt;
+            pkt.first = 0;
+            mTail.store(tail + 1, std::memory_order_release);
+            if (!batch)
+                Notify(mPopWaiters, mCanPop);
+        }
+        return samplesTaken;
+    }
+
+    template<typename T>
+    uint32_t PopSamples(T* buffer, const uint32_t samplesCount, uint64_t *timestamp, const uint32_t timeout_ms, uint32_t *flags, const float fullScale, const bool batch = false)
+    {
+        assert(buffer != nullptr);
+        uint32_t samplesFilled = 0;
+        if (flags != nullptr) *flags = 0;
+        while (samplesFilled < samplesCount)
+        {
+            uint32_t head = mHead.load(std::memory_order_acquire);
+            if (head == mTail.load(std::memory_order_acquire)) //buffer is empty, wait for packets
+            {
+                if (batch && timeout_ms != 0)
+                    Notify(mPushWaiters, mCanPush);
+                if (timeout_ms == 0 || !Wait(mPopWaiters, mCanPop, timeout_ms, [this]{
+                        return mHead.load(std::memory_order_acquire) != mTail.load(std::memory_order_acquire);}))
+                    return samplesFilled;
+                continue;
+            }
+            if (head != mReadIndex) //partially read packet was dropped by producer
+            {
+                mReadIndex = head;
+                mReadOffset = 0;
+            }
+
+            const SamplesPacket &pkt = mBuffer[head & (mBufferSize - 1)];
+            const uint64_t pktTimestamp = pkt.timestamp;
+            const uint32_t pktFlags = pkt.flags;
+            const int first = mReadOffset;
+            const int cntbuf = std::max(int(pkt.last) - first, 0);
+            const int cnt = std::min(int(samplesCount - samplesFilled), cntbuf);
+            CopySamples(&buffer[samplesFilled],&pkt.samples[first],cnt,fullScale);
+
+            if (cntbuf == cnt) //packet depleted
+            {
+                //fails if producer has overwritten the slot while it was copied
+                if (!mHead.compare_exchange_strong(head, head + 1, std::memory_order_acq_rel))
+                    continue;
+                mReadIndex = head + 1;
+                mReadOffset = 0;
+                if (!batch)
+                    Notify(mPushWaiters, mCanPush);
+            }
+            else
+            {
+                std::atomic_thread_fence(std::memory_order_acquire);
+                if (mHead.load(std::memory_order_relaxed) != head)
+                    continue;
+                mReadOffset += cnt;
+            }
+
+            if(samplesFilled == 0 && timestamp != nullptr)
+                *timestamp = pktTimestamp + first;
+            if (flags != nullptr) *flags |= pktFlags;
+            samplesFilled += cnt;
+
+            //leave the loop early when end of burst is encountered
+            //so that the calling loop can flush out the buffer
+            if (pktFlags & END_BURST)
+                break;
+        }
+        return samplesFilled;
+    }
+
+    template<typename Predicate>
+    bool Wait(std::atomic<uint32_t> &waiters, std::condition_variable &cv, const uint32_t timeout_ms, Predicate ready)
+    {
+        const auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeout_ms);
+        if (mPolicy != WAIT_BLOCK)
+        {
+            for (unsigned i = 0; mPolicy == WAIT_SPIN || i < spinCount; ++i)
+            {
+                if (ready())
+                    return true;
+                if ((i & 0xFF) == 0xFF && std::chrono::steady_clock::now() >= deadline)
+                    return false;
+                std::this_thread::yield();
+            }
+        }
+        std::unique_lock<std::mutex> lck(mWaitLock);
+        waiters.fetch_add(1);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        const bool status = cv.wait_until(lck, deadline, ready);
+        waiters.fetch_sub(1);
+        return status;
+    }
+
+    void Notify(std::atomic<uint32_t> &waiters, std::condition_variable &cv)
+    {
+        //pairs with waiters increment, so a sleeping thread can not miss the update
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (waiters.load(std::memory_order_relaxed) == 0)
+            return;
+        std::unique_lock<std::mutex> lck(mWaitLock);
+        cv.notify_one();
+    }
+
+    //! @brief Packets holding given number of samples, power of two for index masking
+    static uint32_t PacketsCount(const uint32_t samplesCount)
+    {
+        uint32_t count = 1;
+        while (count*SamplesPacket::maxSamplesInPacket < samplesCount)
+            count <<= 1;
+        return count;
+    }
+
+    static const unsigned spinCount = 4096;
+    static const uint64_t noPin = ~uint64_t(0);
+    const uint32_t mBufferSize;
+    const WaitPolicy mPolicy;
+    SamplesPacket* mBuffer;
+    std::atomic<uint32_t> mHead;
+    std::atomic<uint32_t> mTail;
+    uint32_t mReadIndex;  //consumer only, packet currently being read
+    uint32_t mReadOffset; //consumer only, samples already taken from mReadIndex
+    std::atomic<uint64_t> mPinned; //index of slot held by acquire_read(), noPin if none
+    std::atomic<uint32_t> mPopWaiters;
+    std::atomic<uint32_t> mPushWaiters;
+    std::mutex mWaitLock;
+    std::condition_variable mCanPop;
+    std::condition_variable mCanPush;
+};
+
 //https://www.justsoftwaresolutions.co.uk/threading/implementing-a-thread-safe-queue-using-condition-variables.html
 template <typename T>
 class ConcurrentQueue
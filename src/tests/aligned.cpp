@@ -0,0 +1,66 @@
+#include "gtest/gtest.h"
+#include "virtual.h"
+#include <string.h>
+#include <vector>
+
+using namespace std;
+
+//! Two Tx streams of virtual board, not started, so FIFOs are not drained
+class AlignedTx : public ::testing::Test
+{
+protected:
+    void SetUp() override
+    {
+        device = OpenVirtualDevice();
+        if (device == nullptr)
+            GTEST_SKIP() << "library built without virtual board";
+        ASSERT_EQ(0, LMS_Init(device));
+        for (int ch = 0; ch < 2; ++ch)
+        {
+            ASSERT_EQ(0, LMS_EnableChannel(device, LMS_CH_TX, ch, true));
+            memset(&streams[ch], 0, sizeof(lms_stream_t));
+            streams[ch].channel = ch;
+            streams[ch].isTx = true;
+            streams[ch].fifoSize = 16*1024;
+            streams[ch].dataFmt = lms_stream_t::LMS_FMT_I16;
+            ASSERT_EQ(0, LMS_SetupStream(device, &streams[ch]));
+        }
+    }
+
+    void TearDown() override
+    {
+        if (device == nullptr)
+            return;
+        for (auto &stream : streams)
+            LMS_DestroyStream(device, &stream);
+        LMS_Close(device);
+    }
+
+    lms_device_t* device;
+    lms_stream_t streams[2];
+};
+
+TEST_F(AlignedTx, TimeoutKeepsStreamsAligned)
+{
+    lms_stream_status_t status[2];
+    ASSERT_EQ(0, LMS_GetStreamStatus(&streams[0], &status[0]));
+    const uint32_t fifoSize = status[0].fifoSize;
+
+    //first stream has less space than the second one
+    vector<int16_t> buffer(2*2*fifoSize);
+    lms_stream_meta_t meta;
+    memset(&meta, 0, sizeof(meta));
+    ASSERT_EQ(100, LMS_SendStream(&streams[0], buffer.data(), 100, &meta, 100));
+
+    lms_stream_t* aligned[2] = {&streams[0], &streams[1]};
+    void* samples[2] = {buffer.data(), &buffer[2*fifoSize]};
+    const int written = LMS_SendStreamAligned(aligned, 2, samples, fifoSize, &meta, 10);
+    EXPECT_GT(written, 0);
+    EXPECT_LT(written, int(fifoSize));
+
+    //both streams took the same number of samples, so the second one is not full
+    ASSERT_EQ(0, LMS_GetStreamStatus(&streams[0], &status[0]));
+    ASSERT_EQ(0, LMS_GetStreamStatus(&streams[1], &status[1]));
+    EXPECT_EQ(status[0].fifoSize, status[0].fifoFilledCount);
+    EXPECT_LT(status[1].fifoFilledCount, status[1].fifoSize);
+}
@@ -0,0 +1,37 @@
+#include "gtest/gtest.h"
+#include "virtual.h"
+#include <future>
+
+using namespace std;
+
+static void WaitForRelease(lms_device_t*, int, void* user_data)
+{
+    static_cast<shared_future<void>*>(user_data)->wait();
+}
+
+TEST(AsyncControl, PhaseDoesNotReplaceFrequency)
+{
+    lms_device_t* device = OpenVirtualDevice();
+    if (device == nullptr)
+        GTEST_SKIP() << "library built without virtual board";
+
+    ASSERT_EQ(0, LMS_Init(device));
+    ASSERT_EQ(0, LMS_SetSampleRate(device, 10e6, 4));
+
+    //worker is held in callback, so following commands stay queued
+    promise<void> release;
+    shared_future<void> released = release.get_future().share();
+    ASSERT_EQ(0, LMS_SetGaindBAsync(device, false, 0, 30, WaitForRelease, &released));
+
+    float_type freqs[LMS_NCO_VAL_COUNT] = {1e6};
+    ASSERT_EQ(0, LMS_SetNCOFrequencyAsync(device, false, 0, freqs, 0, nullptr, nullptr));
+    ASSERT_EQ(0, LMS_SetNCOFrequencyAsync(device, false, 0, nullptr, 45, nullptr, nullptr));
+    release.set_value();
+    ASSERT_EQ(0, LMS_FlushAsync(device, 1000));
+
+    float_type readFreqs[LMS_NCO_VAL_COUNT] = {0};
+    float_type phase = 0;
+    ASSERT_EQ(0, LMS_GetNCOFrequency(device, false, 0, readFreqs, &phase));
+    EXPECT_NEAR(1e6, readFreqs[0], 1);
+    LMS_Close(device);
+}
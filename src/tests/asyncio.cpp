@@ -0,0 +1,124 @@
+#include "gtest/gtest.h"
+#include "AsyncFileIO.h"
+#include <fcntl.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <string>
+
+using namespace std;
+using namespace lime;
+
+//! Named pipe opened for non-blocking reading and writing
+class NamedPipe : public ::testing::Test
+{
+protected:
+    void SetUp() override
+    {
+        char dir[] = "/tmp/limeXXXXXX";
+        ASSERT_NE(nullptr, mkdtemp(dir));
+        path = string(dir) + "/pipe";
+        ASSERT_EQ(0, mkfifo(path.c_str(), 0600));
+        reader = open(path.c_str(), O_RDONLY | O_NONBLOCK);
+        ASSERT_GE(reader, 0);
+        writer = open(path.c_str(), O_WRONLY | O_NONBLOCK);
+        ASSERT_GE(writer, 0);
+    }
+
+    void TearDown() override
+    {
+        if (reader >= 0)
+            close(reader);
+        if (writer >= 0)
+            close(writer);
+        unlink(path.c_str());
+        rmdir(path.substr(0, path.rfind('/')).c_str());
+    }
+
+    void Send(const char* data)
+    {
+        ASSERT_EQ(ssize_t(strlen(data)), write(writer, data, strlen(data)));
+    }
+
+    string path;
+    int reader;
+    int writer;
+};
+
+TEST_F(NamedPipe, ReadCompletesInPieces)
+{
+    AsyncFileIO io(4, false);
+    char buffer[8];
+    const int handle = io.Submit(reader, false, buffer, sizeof(buffer));
+    ASSERT_GE(handle, 0);
+    EXPECT_FALSE(io.Wait(handle, 10));
+    Send("0123");
+    EXPECT_FALSE(io.Wait(handle, 10));
+    Send("4567");
+    ASSERT_TRUE(io.Wait(handle, 1000));
+    EXPECT_EQ(8, io.Finish(handle));
+    EXPECT_EQ(0, memcmp(buffer, "01234567", 8));
+    io.Cancel(reader);
+}
+
+TEST_F(NamedPipe, ReadsKeepOrder)
+{
+    AsyncFileIO io(4, false);
+    char a[4], b[4];
+    const int ha = io.Submit(reader, false, a, sizeof(a));
+    const int hb = io.Submit(reader, false, b, sizeof(b));
+    Send("abcdefgh");
+    ASSERT_TRUE(io.Wait(ha, 1000));
+    ASSERT_TRUE(io.Wait(hb, 1000));
+    EXPECT_EQ(4, io.Finish(ha));
+    EXPECT_EQ(4, io.Finish(hb));
+    EXPECT_EQ(0, memcmp(a, "abcd", 4));
+    EXPECT_EQ(0, memcmp(b, "efgh", 4));
+    io.Cancel(reader);
+}
+
+TEST_F(NamedPipe, CancelledPartialReadKeepsData)
+{
+    AsyncFileIO io(4, false);
+    char first[8], second[8];
+    int handle = io.Submit(reader, false, first, sizeof(first));
+    Send("01234");
+    EXPECT_FALSE(io.Wait(handle, 50));
+    //consumed bytes are not returned, so the stream stays contiguous
+    EXPECT_EQ(0, io.Finish(handle));
+
+    handle = io.Submit(reader, false, second, sizeof(second));
+    EXPECT_FALSE(io.Wait(handle, 10));
+    Send("567");
+    ASSERT_TRUE(io.Wait(handle, 1000));
+    EXPECT_EQ(8, io.Finish(handle));
+    EXPECT_EQ(0, memcmp(second, "01234567", 8));
+    io.Cancel(reader);
+}
+
+TEST_F(NamedPipe, EndOfFile)
+{
+    AsyncFileIO io(4, false);
+    char buffer[8];
+    const int handle = io.Submit(reader, false, buffer, sizeof(buffer));
+    Send("xyz");
+    close(writer);
+    writer = -1;
+    ASSERT_TRUE(io.Wait(handle, 1000));
+    EXPECT_EQ(3, io.Finish(handle));
+    io.Cancel(reader);
+}
+
+TEST_F(NamedPipe, Write)
+{
+    AsyncFileIO io(4, false);
+    char data[] = "written";
+    const int handle = io.Submit(writer, true, data, 7);
+    ASSERT_TRUE(io.Wait(handle, 1000));
+    EXPECT_EQ(7, io.Finish(handle));
+    char buffer[8] = {};
+    EXPECT_EQ(7, read(reader, buffer, sizeof(buffer)));
+    EXPECT_STREQ("written", buffer);
+    io.Cancel(writer);
+}
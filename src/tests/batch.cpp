@@ -0,0 +1,123 @@
+#include "gtest/gtest.h"
+#include "LMS7002M.h"
+#include "IConnection.h"
+#include <vector>
+
+using namespace std;
+using namespace lime;
+
+//! Records SPI transactions instead of accessing hardware
+class SPICounter : public IConnection
+{
+public:
+    SPICounter() : writes(0), reads(0), resets(0), failWrites(false) {}
+
+    int WriteLMS7002MSPI(const uint32_t *writeData, size_t size, unsigned) override
+    {
+        ++writes;
+        words.insert(words.end(), writeData, writeData+size);
+        return failWrites ? -1 : 0;
+    }
+    int ReadLMS7002MSPI(const uint32_t *, uint32_t *readData, size_t size, unsigned) override
+    {
+        ++reads;
+        for (size_t i = 0; i < size; ++i)
+            readData[i] = 0;
+        return 0;
+    }
+    int DeviceReset(int) override
+    {
+        ++resets;
+        order.push_back(writes);
+        return 0;
+    }
+
+    int writes;
+    int reads;
+    int resets;
+    bool failWrites;
+    vector<uint32_t> words;
+    vector<int> order; //writes count at each reset
+};
+
+TEST(LMS7002MBatch, SingleTransaction)
+{
+    SPICounter port;
+    LMS7002M lms;
+    lms.SetConnection(&port);
+
+    lms.BeginBatch();
+    lms.SPI_write(0x0020, 0xFFFD);
+    lms.SPI_write(0x0082, 0x800B);
+    lms.Modify_SPI_Reg_bits(LMS7param(EN_G_TRF), 0);
+    EXPECT_EQ(0, port.writes);
+    lms.BeginBatch(); //nested
+    lms.SPI_write(0x0084, 0x0400);
+    EXPECT_EQ(0, lms.Commit());
+    EXPECT_EQ(0, port.writes);
+    EXPECT_EQ(0, lms.Commit());
+    EXPECT_EQ(1, port.writes);
+    EXPECT_EQ(4u, port.words.size());
+    EXPECT_EQ(0, port.reads);
+}
+
+TEST(LMS7002MBatch, MergeAndStrobes)
+{
+    SPICounter port;
+    LMS7002M lms;
+    lms.SetConnection(&port);
+
+    lms.BeginBatch();
+    //consecutive writes to the same register are merged
+    lms.SPI_write(0x0100, 0x0001);
+    lms.SPI_write(0x0100, 0x0003);
+    //bit pulsed 0->1->0 has to reach the chip
+    lms.SPI_write(0x0101, 0x0001);
+    lms.SPI_write(0x0101, 0x0000);
+    lms.Commit();
+    ASSERT_EQ(1, port.writes);
+    ASSERT_EQ(3u, port.words.size());
+    EXPECT_EQ(0x80000000u | (0x0100 << 16) | 0x0003, port.words[0]);
+    EXPECT_EQ(0x80000000u | (0x0101 << 16) | 0x0001, port.words[1]);
+    EXPECT_EQ(0x80000000u | (0x0101 << 16) | 0x0000, port.words[2]);
+}
+
+TEST(LMS7002MBatch, ReadFlushes)
+{
+    SPICounter port;
+    LMS7002M lms;
+    lms.SetConnection(&port);
+
+    lms.BeginBatch();
+    lms.SPI_write(0x0020, 0xFFFD);
+    lms.SPI_read(0x0020, true);
+    EXPECT_EQ(1, port.writes);
+    EXPECT_EQ(1, port.reads);
+    lms.SPI_write(0x0082, 0x800B);
+    lms.Commit();
+    EXPECT_EQ(2, port.writes);
+}
+
+TEST(LMS7002MBatch, ResetChip)
+{
+    SPICounter port;
+    LMS7002M lms;
+    lms.SetConnection(&port);
+
+    lms.BeginBatch();
+    lms.SPI_write(0x0082, 0x800B);
+    EXPECT_EQ(0, lms.ResetChip());
+    ASSERT_EQ(1, port.resets);
+    //pending write was sent before reset
+    EXPECT_EQ(1, port.order[0]);
+    lms.Commit();
+
+    //failed write of pending data is reported
+    lms.BeginBatch();
+    lms.SPI_write(0x0082, 0x800F);
+    port.failWrites = true;
+    EXPECT_NE(0, lms.ResetChip());
+    EXPECT_EQ(2, port.resets);
+    port.failWrites = false;
+    lms.Commit();
+}
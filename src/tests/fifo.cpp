@@ -0,0 +1,145 @@
+#include "gtest/gtest.h"
+#include "fifo.h"
+#include <thread>
+#include <vector>
+
+using namespace std;
+using namespace lime;
+
+static const uint32_t pktSamples = SamplesPacket::maxSamplesInPacket;
+
+static vector<complex16_t> Ramp(const uint32_t count, const uint32_t start)
+{
+    vector<complex16_t> samples(count);
+    for (uint32_t n = 0; n < count; ++n)
+    {
+        samples[n].i = int16_t(start + n);
+        samples[n].q = int16_t(~(start + n));
+    }
+    return samples;
+}
+
+TEST(LockFreeRingFIFO, PushPop)
+{
+    LockFreeRingFIFO fifo(4*pktSamples);
+    auto src = Ramp(2*pktSamples+100, 0);
+    ASSERT_EQ(src.size(), fifo.push_samples(src.data(), src.size(), 1, 1000, 0, RingFIFO::SYNC_TIMESTAMP));
+    EXPECT_EQ(3*pktSamples, fifo.GetInfo().itemsFilled);
+
+    vector<complex16_t> dest(src.size());
+    uint64_t timestamp = 0;
+    uint32_t flags = 0;
+    //read across packet boundaries in uneven chunks
+    ASSERT_EQ(500u, fifo.pop_samples(dest.data(), 500, 1, &timestamp, 0, &flags));
+    EXPECT_EQ(1000u, timestamp);
+    EXPECT_TRUE(flags & RingFIFO::SYNC_TIMESTAMP);
+    ASSERT_EQ(src.size()-500, fifo.pop_samples(&dest[500], src.size()-500, 1, &timestamp, 0));
+    EXPECT_EQ(1500u, timestamp);
+    for (size_t n = 0; n < src.size(); ++n)
+    {
+        ASSERT_EQ(src[n].i, dest[n].i) << "sample " << n;
+        ASSERT_EQ(src[n].q, dest[n].q) << "sample " << n;
+    }
+    EXPECT_EQ(0u, fifo.GetInfo().itemsFilled);
+    EXPECT_EQ(0u, fifo.pop_samples(dest.data(), 1, 1, &timestamp, 0));
+}
+
+TEST(LockFreeRingFIFO, Wraparound)
+{
+    LockFreeRingFIFO fifo(4*pktSamples);
+    vector<complex16_t> dest(pktSamples);
+    //pass the ring many times, with FIFO holding 3 packets at each push
+    for (uint32_t i = 0; i < 3; ++i)
+    {
+        auto src = Ramp(pktSamples, i*pktSamples);
+        ASSERT_EQ(pktSamples, fifo.push_samples(src.data(), pktSamples, 1, i*pktSamples, 0));
+    }
+    for (uint32_t i = 3; i < 100; ++i)
+    {
+        auto src = Ramp(pktSamples, i*pktSamples);
+        ASSERT_EQ(pktSamples, fifo.push_samples(src.data(), pktSamples, 1, i*pktSamples, 0));
+        uint64_t timestamp;
+        ASSERT_EQ(pktSamples, fifo.pop_samples(dest.data(), pktSamples, 1, &timestamp, 0));
+        const uint32_t expected = (i-3)*pktSamples;
+        ASSERT_EQ(expected, timestamp);
+        ASSERT_EQ(int16_t(expected), dest[0].i);
+        ASSERT_EQ(int16_t(expected+pktSamples-1), dest[pktSamples-1].i);
+    }
+}
+
+TEST(LockFreeRingFIFO, Full)
+{
+    LockFreeRingFIFO fifo(2*pktSamples, LockFreeRingFIFO::WAIT_BLOCK);
+    auto src = Ramp(3*pktSamples, 0);
+    //producer gives up after timeout with the samples that fit
+    EXPECT_EQ(2*pktSamples, fifo.push_samples(src.data(), src.size(), 1, 0, 1));
+
+    //oldest packet is dropped when overwriting is allowed
+    EXPECT_EQ(pktSamples, fifo.push_samples(&src[2*pktSamples], pktSamples, 1, 2*pktSamples, 0, RingFIFO::OVERWRITE_OLD));
+    vector<complex16_t> dest(2*pktSamples);
+    uint64_t timestamp;
+    EXPECT_EQ(2*pktSamples, fifo.pop_samples(dest.data(), dest.size(), 1, &timestamp, 0));
+    EXPECT_EQ(pktSamples, timestamp);
+    EXPECT_EQ(int16_t(pktSamples), dest[0].i);
+}
+
+TEST(LockFreeRingFIFO, ConcurrentProducer)
+{
+    const uint32_t total = 200*pktSamples;
+    const uint32_t chunk = 1000;
+    LockFreeRingFIFO fifo(8*pktSamples);
+    thread producer([&fifo, total, chunk]()
+    {
+        for (uint32_t sent = 0; sent < total; sent += chunk)
+        {
+            auto src = Ramp(chunk, sent);
+            if (fifo.push_samples(src.data(), chunk, 1, sent, 1000) != chunk)
+                return;
+        }
+    });
+
+    vector<complex16_t> dest(777);
+    uint32_t received = 0;
+    while (received < total)
+    {
+        uint64_t timestamp;
+        const uint32_t count = std::min<uint32_t>(dest.size(), total-received);
+        const uint32_t popped = fifo.pop_samples(dest.data(), count, 1, &timestamp, 1000);
+        ASSERT_EQ(count, popped);
+        ASSERT_EQ(received, timestamp);
+        for (uint32_t n = 0; n < popped; ++n)
+            ASSERT_EQ(int16_t(received+n), dest[n].i);
+        received += popped;
+    }
+    producer.join();
+}
+
+TEST(LockFreeRingFIFO, SizeRoundedUp)
+{
+    //index masking needs power of two packets
+    LockFreeRingFIFO fifo(3*pktSamples-10);
+    EXPECT_EQ(4*pktSamples, fifo.GetInfo().size);
+    auto src = Ramp(4*pktSamples, 0);
+    EXPECT_EQ(4*pktSamples, fifo.push_samples(src.data(), src.size(), 1, 0, 0));
+}
+
+TEST(LockFreeRingFIFO, AcquireWriteWaitsForPinnedSlot)
+{
+    LockFreeRingFIFO fifo(2*pktSamples, LockFreeRingFIFO::WAIT_BLOCK);
+    auto src = Ramp(3*pktSamples, 0);
+    ASSERT_EQ(2*pktSamples, fifo.push_samples(src.data(), 2*pktSamples, 1, 0, 0));
+    const complex16_t* reading;
+    ASSERT_EQ(pktSamples, fifo.acquire_read(&reading, nullptr, nullptr, 0));
+    //overwrite drops the packet being read, but its slot stays pinned
+    ASSERT_EQ(0u, fifo.push_samples(&src[2*pktSamples], pktSamples, 1, 2*pktSamples, 0, RingFIFO::OVERWRITE_OLD));
+
+    complex16_t* writing;
+    EXPECT_EQ(0u, fifo.acquire_write(&writing, 10));
+    thread consumer([&fifo]()
+    {
+        this_thread::sleep_for(chrono::milliseconds(20));
+        fifo.release_read(pktSamples);
+    });
+    EXPECT_EQ(pktSamples, fifo.acquire_write(&writing, 1000));
+    consumer.join();
+}
@@ -0,0 +1,84 @@
+#include "gtest/gtest.h"
+#include "lms_gfir.h"
+#include <cmath>
+#include <string>
+
+using namespace std;
+
+//Integer coefficients (scaled by 2^16) designed by previous LU based
+//least squares solver, ConfigureGFIR() parameters for various ratios
+static const int ref120[] = {
+    -366, -184, 25, 204, 315, 343, 289, 172, 17, -146, -285, -378,
+    -409, -371, -272, -124, 49, 222, 370, 469, 505, 469, 364, 202,
+    3, -209, -404, -556, -642, -647, -565, -403, -175, 94, 371, 622,
+    814, 916, 908, 781, 539, 201, -202, -627, -1026, -1347, -1539, -1559,
+    -1378, -980, -366, 441, 1404, 2468, 3568, 4634, 5592, 6377, 6934, 7223,
+    7223, 6934, 6377, 5592, 4634, 3568, 2468, 1404, 441, -366, -980, -1378,
+    -1559, -1539, -1347, -1026, -627, -202, 201, 539, 781, 908, 916, 814,
+    622, 371, 94, -175, -403, -565, -647, -642, -556, -404, -209, 3,
+    202, 364, 469, 505, 469, 370, 222, 49, -124, -272, -371, -409,
+    -378, -285, -146, 17, 172, 289, 343, 315, 204, 25, -184, -366
+};
+static const int ref40[] = {
+    -1740, 79, 1155, 1533, 1325, 698, -151, -1018, -1713, -2080, -2016, -1474,
+    -473, 913, 2558, 4304, 5979, 7413, 8460, 9012, 9012, 8460, 7413, 5979,
+    4304, 2558, 913, -473, -1474, -2016, -2080, -1713, -1018, -151, 698, 1325,
+    1533, 1155, 79, -1740
+};
+static const int ref60[] = {
+    -233, 645, -357, -523, 359, 616, -228, -753, -31, 831, 405, -754,
+    -831, 449, 1194, 108, -1345, -867, 1128, 1694, -412, -2369, -889, 2595,
+    2859, -1922, -5849, -900, 12907, 25244, 25244, 12907, -900, -5849, -1922, 2859,
+    2595, -889, -2369, -412, 1694, 1128, -867, -1345, 108, 1194, 449, -831,
+    -754, 405, 831, -31, -753, -228, 616, 359, -523, -357, 645, -233
+};
+static const int ref20[] = {
+    -448, 2222, -2665, -1145, 3680, 1598, -5486, -4057, 11389, 27728, 27728, 11389,
+    -4057, -5486, 1598, 3680, -1145, -2665, 2222, -448
+};
+static const int ref30[] = {
+    246, -660, 1194, -1691, 1924, -1669, 803, 611, -2279, 3694, -4209, 3120,
+    422, -8495, 39798, 39798, -8495, 422, 3120, -4209, 3694, -2279, 611, 803,
+    -1669, 1924, -1691, 1194, -660, 246
+};
+static const int ref10[] = {
+    696, -2190, 5191, -11803, 40982, 40982, -11803, 5191, -2190, 696
+};
+static const int ref15[] = {
+    -656, 2466, -4503, 4293, 443, -9223, 18032, 43789, 18032, -9223, 443, 4293,
+    -4503, 2466, -656
+};
+static const int ref5[] = {
+    -1056, 2128, 62926, 2128, -1056
+};
+
+struct Design
+{
+    int n;
+    double w1;
+    double w2;
+    const int* coefs;
+};
+
+static const Design designs[] = {
+    {120, 0.95*0.05, 0.95*0.05*1.1, ref120},
+    {40, 0.95*0.05, 0.95*0.05*1.1, ref40},
+    {60, 0.95*0.2, 0.95*0.2*1.1, ref60},
+    {20, 0.95*0.2, 0.95*0.2*1.1, ref20},
+    {30, 0.95*0.4, 0.95*0.4*1.05, ref30},
+    {10, 0.95*0.4, 0.95*0.4*1.05, ref10},
+    {15, 0.95*0.3, 0.95*0.3*1.1, ref15},
+    {5, 0.95*0.3, 0.95*0.3*1.1, ref5},
+};
+
+TEST(GFIR, SameAsLUSolver)
+{
+    for (const Design &d : designs)
+    {
+        SCOPED_TRACE("taps " + to_string(d.n));
+        double coefs[120];
+        GenerateFilter(d.n, d.w1, d.w2, 1.0, 0, coefs);
+        for (int i = 0; i < d.n; ++i)
+            ASSERT_EQ(d.coefs[i], lround(coefs[i]*65536)) << "coefficient " << i;
+    }
+}
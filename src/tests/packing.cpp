@@ -0,0 +1,113 @@
+#include "gtest/gtest.h"
+#include "FPGA_packing.h"
+#include <random>
+#include <vector>
+#include <string.h>
+
+using namespace std;
+using namespace lime;
+
+static const int payloadSize = 4080;
+
+static vector<uint8_t> RandomBytes(const size_t count, const unsigned seed)
+{
+    mt19937 random(seed);
+    uniform_int_distribution<int> value(0, 255);
+    vector<uint8_t> bytes(count);
+    for (auto &b : bytes)
+        b = value(random);
+    return bytes;
+}
+
+static vector<complex16_t> RandomSamples(const size_t count, const unsigned seed)
+{
+    //full int16 range, 12 bit packing has to drop the upper bits the same way
+    auto bytes = RandomBytes(count*sizeof(complex16_t), seed);
+    vector<complex16_t> samples(count);
+    memcpy(samples.data(), bytes.data(), bytes.size());
+    return samples;
+}
+
+static bool SameSamples(const vector<complex16_t> &a, const vector<complex16_t> &b)
+{
+    return memcmp(a.data(), b.data(), a.size()*sizeof(complex16_t)) == 0;
+}
+
+//lengths cover whole packets and the scalar tails of vector loops
+static const int payloadLengths[] = {payloadSize, 4068, 12, 24, 36, 48, 60, 4080-48};
+static const int samplesCounts[] = {1360, 1020, 680, 510, 1, 3, 5, 7, 9, 15, 17, 33};
+
+TEST(PacketKernels, Unpack12)
+{
+    const auto kernels = GetPacketKernels();
+    const PacketKernels* ref = kernels[0];
+    for (const PacketKernels* k : kernels)
+        for (int len : payloadLengths)
+            for (int mimo = 0; mimo < 2; ++mimo)
+            {
+                SCOPED_TRACE(string(k->name) + " length " + to_string(len) + (mimo ? " MIMO" : " SISO"));
+                const auto payload = RandomBytes(len, len);
+                vector<complex16_t> refA(payloadSize/3), refB(payloadSize/3), a(payloadSize/3), b(payloadSize/3);
+                const int refCount = ref->unpack12(payload.data(), len, mimo, refA.data(), mimo ? refB.data() : nullptr);
+                EXPECT_EQ(refCount, k->unpack12(payload.data(), len, mimo, a.data(), mimo ? b.data() : nullptr));
+                EXPECT_TRUE(SameSamples(refA, a));
+                EXPECT_TRUE(SameSamples(refB, b));
+            }
+}
+
+TEST(PacketKernels, Unpack16MIMO)
+{
+    const auto kernels = GetPacketKernels();
+    const PacketKernels* ref = kernels[0];
+    for (const PacketKernels* k : kernels)
+        for (int len : payloadLengths)
+        {
+            const int alignedLen = len & ~7;
+            SCOPED_TRACE(string(k->name) + " length " + to_string(alignedLen));
+            const auto payload = RandomBytes(alignedLen, len);
+            vector<complex16_t> refA(payloadSize/8), refB(payloadSize/8), a(payloadSize/8), b(payloadSize/8);
+            const int refCount = ref->unpack16mimo(payload.data(), alignedLen, refA.data(), refB.data());
+            EXPECT_EQ(refCount, k->unpack16mimo(payload.data(), alignedLen, a.data(), b.data()));
+            EXPECT_TRUE(SameSamples(refA, a));
+            EXPECT_TRUE(SameSamples(refB, b));
+        }
+}
+
+TEST(PacketKernels, Pack12)
+{
+    const auto kernels = GetPacketKernels();
+    const PacketKernels* ref = kernels[0];
+    for (const PacketKernels* k : kernels)
+        for (int count : samplesCounts)
+            for (int mimo = 0; mimo < 2; ++mimo)
+            {
+                if (count*(mimo ? 6 : 3) > payloadSize)
+                    continue;
+                SCOPED_TRACE(string(k->name) + " samples " + to_string(count) + (mimo ? " MIMO" : " SISO"));
+                const auto chA = RandomSamples(count, count);
+                const auto chB = RandomSamples(count, count+1);
+                vector<uint8_t> refPayload(payloadSize, 0xAA), payload(payloadSize, 0xAA);
+                const int refLen = ref->pack12(chA.data(), chB.data(), count, mimo, refPayload.data());
+                EXPECT_EQ(refLen, k->pack12(chA.data(), chB.data(), count, mimo, payload.data()));
+                EXPECT_EQ(refPayload, payload);
+            }
+}
+
+TEST(PacketKernels, Pack16MIMO)
+{
+    const auto kernels = GetPacketKernels();
+    const PacketKernels* ref = kernels[0];
+    for (const PacketKernels* k : kernels)
+        for (int count : samplesCounts)
+        {
+            if (count*8 > payloadSize)
+                continue;
+            SCOPED_TRACE(string(k->name) + " samples " + to_string(count));
+            const auto chA = RandomSamples(count, count);
+            const auto chB = RandomSamples(count, count+1);
+            vector<uint8_t> refPayload(payloadSize, 0xAA), payload(payloadSize, 0xAA);
+            const int refLen = ref->pack16mimo(chA.data(), chB.data(), count, refPayload.data());
+            EXPECT_EQ(refLen, k->pack16mimo(chA.data(), chB.data(), count, payload.data()));
+            EXPECT_EQ(refPayload, payload);
+        }
+}
@@ -0,0 +1,34 @@
+#include "gtest/gtest.h"
+#include "ConnectionRegistry.h"
+#include <algorithm>
+
+using namespace std;
+using namespace lime;
+
+static int CountVirtual(const ConnectionHandle &hint)
+{
+    const auto handles = ConnectionRegistry::findConnections(hint);
+    return count_if(handles.begin(), handles.end(), [](const ConnectionHandle &h) {return h.module == "Virtual";});
+}
+
+TEST(ConnectionRegistry, VirtualBoardMatchesOnlyItsHint)
+{
+    //listed only when library is built with virtual board
+    const int listed = CountVirtual(ConnectionHandle());
+
+    ConnectionHandle hint;
+    hint.media = "TCP";
+    hint.addr = "127.0.0.1:5000";
+    EXPECT_EQ(0, CountVirtual(hint));
+
+    hint = ConnectionHandle();
+    hint.serial = "0009060B00471B1F";
+    EXPECT_EQ(0, CountVirtual(hint));
+
+    hint = ConnectionHandle();
+    hint.media = "Virtual";
+    EXPECT_EQ(listed, CountVirtual(hint));
+    hint.media.clear();
+    hint.name = "Virtual";
+    EXPECT_EQ(listed, CountVirtual(hint));
+}
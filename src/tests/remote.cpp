@@ -0,0 +1,172 @@
+#include "gtest/gtest.h"
+#include "RemoteControlServer.h"
+#include "ConnectionRegistry.h"
+#include "IConnection.h"
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <atomic>
+#include <string>
+#include <vector>
+
+using namespace std;
+using namespace lime;
+
+//! Board registers served to remote client, connection can be broken on request
+class HangUpRegisters : public IConnection
+{
+public:
+    HangUpRegisters() : port(0), writes(0), reads(0), hangUp(false) {}
+
+    int WriteLMS7002MSPI(const uint32_t *, size_t, unsigned) override
+    {
+        return 0;
+    }
+    int ReadLMS7002MSPI(const uint32_t *, uint32_t *, size_t, unsigned) override
+    {
+        return 0;
+    }
+    int WriteRegisters(const uint32_t *, const uint32_t *, const size_t) override
+    {
+        ++writes;
+        HangUp();
+        return 0;
+    }
+    int ReadRegisters(const uint32_t *addrs, uint32_t *data, const size_t size) override
+    {
+        ++reads;
+        for (size_t i = 0; i < size; ++i)
+            data[i] = addrs[i] + 1;
+        HangUp();
+        return 0;
+    }
+
+    //! shuts down sockets accepted by the server, like network failure would
+    void HangUp()
+    {
+        if (!hangUp.exchange(false))
+            return;
+        for (int fd = 0; fd < 1024; ++fd)
+        {
+            sockaddr_in local, peer;
+            socklen_t length = sizeof(local);
+            if (getsockname(fd, (sockaddr*)&local, &length) != 0 || local.sin_family != AF_INET
+                || ntohs(local.sin_port) != port)
+                continue;
+            length = sizeof(peer);
+            if (getpeername(fd, (sockaddr*)&peer, &length) == 0)
+                shutdown(fd, SHUT_RDWR);
+        }
+    }
+
+    uint16_t port;
+    atomic<int> writes;
+    atomic<int> reads;
+    atomic<bool> hangUp; //break connection after executing the next command
+};
+
+//! RemoteControlServer and ConnectionRemote talking over 127.0.0.1
+class RemoteControl : public ::testing::Test
+{
+protected:
+    RemoteControl() : server(&registers), remote(nullptr) {}
+
+    void SetUp() override
+    {
+        ASSERT_EQ(0, server.Start(0));
+        registers.port = server.GetPort();
+        ConnectionHandle handle;
+        handle.module = "Z_Remote";
+        handle.addr = "127.0.0.1:" + to_string(server.GetPort());
+        remote = ConnectionRegistry::makeConnection(handle);
+        ASSERT_NE(nullptr, remote);
+    }
+
+    void TearDown() override
+    {
+        ConnectionRegistry::freeConnection(remote);
+        server.Stop();
+    }
+
+    HangUpRegisters registers;
+    RemoteControlServer server;
+    IConnection* remote;
+};
+
+TEST_F(RemoteControl, WriteIsNotRepeated)
+{
+    ASSERT_EQ(0, remote->WriteRegister(0x10, 1));
+    EXPECT_EQ(1, registers.writes);
+
+    //server executed the write before connection broke, it must not be sent again
+    registers.hangUp = true;
+    EXPECT_NE(0, remote->WriteRegister(0x10, 2));
+    EXPECT_EQ(2, registers.writes);
+
+    //next request reconnects
+    EXPECT_EQ(0, remote->WriteRegister(0x10, 3));
+    EXPECT_EQ(3, registers.writes);
+}
+
+TEST_F(RemoteControl, ReadIsRepeated)
+{
+    registers.hangUp = true;
+    uint32_t value = 0;
+    EXPECT_EQ(0, remote->ReadRegister(0x20, value));
+    EXPECT_EQ(0x21u, value);
+    EXPECT_EQ(2, registers.reads);
+}
+
+//! Client streaming through server serving loopback test connection
+class RemoteLoopback : public ::testing::Test
+{
+protected:
+    RemoteLoopback() : server(nullptr), remote(nullptr), sent(4096), received(4096) {}
+
+    void SetUp() override
+    {
+        ASSERT_EQ(0, server.Start(0));
+        ConnectionHandle handle;
+        handle.module = "Z_Remote";
+        handle.addr = "127.0.0.1:" + to_string(server.GetPort());
+        remote = ConnectionRegistry::makeConnection(handle);
+        ASSERT_NE(nullptr, remote);
+        for (size_t i = 0; i < sent.size(); ++i)
+            sent[i] = i*7;
+    }
+
+    void TearDown() override
+    {
+        ConnectionRegistry::freeConnection(remote);
+        server.Stop();
+    }
+
+    RemoteControlServer server;
+    IConnection* remote;
+    vector<char> sent;
+    vector<char> received;
+};
+
+TEST_F(RemoteLoopback, PacketRoundTrip)
+{
+    //single packet is much shorter than transfers of server relay
+    const int handle = remote->BeginDataReading(received.data(), received.size(), 0);
+    ASSERT_GE(handle, 0);
+    ASSERT_EQ(int(sent.size()), remote->SendData(sent.data(), sent.size(), 0, 1000));
+    EXPECT_TRUE(remote->WaitForReading(handle, 2000));
+    ASSERT_EQ(int(received.size()), remote->FinishDataReading(received.data(), received.size(), handle));
+    EXPECT_EQ(sent, received);
+    remote->AbortReading(0);
+}
+
+TEST_F(RemoteLoopback, NextClientGetsPackets)
+{
+    //reading client disconnects, packets sent meanwhile are kept for the next one
+    const int handle = remote->BeginDataReading(received.data(), received.size(), 0);
+    ASSERT_GE(handle, 0);
+    remote->AbortReading(0);
+    ASSERT_EQ(int(sent.size()), remote->SendData(sent.data(), sent.size(), 0, 1000));
+    EXPECT_EQ(int(received.size()), remote->ReceiveData(received.data(), received.size(), 0, 2000));
+    EXPECT_EQ(sent, received);
+    remote->AbortReading(0);
+}
@@ -0,0 +1,13 @@
+#include "virtual.h"
+#include <string.h>
+
+lms_device_t* OpenVirtualDevice()
+{
+    lms_device_t* device = nullptr;
+    lms_info_str_t list[32];
+    const int count = LMS_GetDeviceList(list);
+    for (int i = 0; i < count && device == nullptr; ++i)
+        if (strstr(list[i], "media=Virtual") != nullptr && LMS_Open(&device, list[i], nullptr) != 0)
+            device = nullptr;
+    return device;
+}
@@ -0,0 +1,8 @@
+#ifndef VIRTUAL_DEVICE_H
+#define VIRTUAL_DEVICE_H
+#include "lime/LimeSuite.h"
+
+//! Opens first virtual board of device list, nullptr when library is built without it
+lms_device_t* OpenVirtualDevice();
+
+#endif